@@ -0,0 +1,1351 @@
+// -------------------- Headless benchmark suite --------------------
+// Generates synthetic scenes of the requested sizes and times the hot paths
+// of the editor on them. Results are written as JSON so runs can be
+// compared over time.
+//
+//   drawer_bench [--vertices 1000,100000,1000000] [--mix mixed,polygons] [--seed N]
+//                [--min-time SECONDS] [--filter TEXT] [--out FILE]
+//
+// Scene mixes: "mixed" has the editor's usual share of every shape kind,
+// "polygons" only multilines and regular polygons.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <thread>
+#include <string>
+#include <vector>
+
+#include "BoundsTree.h"
+#include "DisplayList.h"
+#include "FrameArena.h"
+#include "LatencyStats.h"
+#include "RegularPolygon.h"
+#include "RenderLayers.h"
+#include "RenderThread.h"
+#include "SceneFile.h"
+#include "SceneGenerator.h"
+#include "SceneStore.h"
+#include "ShapePicking.h"
+#include "SnapFeatures.h"
+#include "SnapGrid.h"
+#include "SvgImport.h"
+#include "ThreadPool.h"
+#include "TileCache.h"
+#include "TileRasterizer.h"
+#include "TransformKernel.h"
+#include "VertexCodec.h"
+#include "ViewportClip.h"
+
+// -------------------- Allocation counting --------------------
+// Every heap allocation of the process goes through these, so each result
+// can report how many allocations one operation makes.
+static std::atomic<uint64_t> g_allocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+// Every delete form ends here, in one free that stays out of line: inlined
+// into callers, GCC pairs it with their operator new call and warns
+// (-Wmismatched-new-delete) although the new above allocates with malloc
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+namespace {
+
+    const int SNAP_RADIUS_PIXELS = 10;          // same as the app
+    const int VIEW_WIDTH = 1920;
+    const int VIEW_HEIGHT = 1080;
+    const size_t QUERY_COUNT = 1024;            // random cursor positions per batch
+    const size_t PICK_SCENE_SHAPES = 1000000;   // pick suite: shapes in its scene
+    const int32_t PICK_SCENE_WORLD = 1 << 20;
+    const size_t PICK_CHECKED_CURSORS = 256;    // compared with a linear scan
+
+    struct Options {
+        std::vector<size_t> sizes{ 1000, 100000, 1000000 };
+        bool mixed = true;
+        bool polygons = true;
+        uint64_t seed = 1;
+        double minSeconds = 0.25;
+        std::string filter;
+        std::string outPath;
+    };
+
+    struct Result {
+        std::string name;
+        uint64_t iterations = 0;
+        double nsPerOp = 0.0;
+        double itemsPerOp = 0.0;
+        double allocsPerOp = 0.0;       // heap allocations per operation, last batch
+    };
+
+    volatile uint64_t g_sink = 0;               // keeps results observable
+
+    // Runs fn in doubling batches until one batch lasts minSeconds
+    template <class Fn>
+    Result Measure(const Options& options, const char* name, double itemsPerOp, Fn&& fn)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        Result r;
+        r.name = name;
+        r.itemsPerOp = itemsPerOp;
+
+        fn();   // warm up
+        for (uint64_t batch = 1; ; batch *= 2)
+        {
+            const uint64_t allocsBefore = g_allocations.load(std::memory_order_relaxed);
+            auto start = Clock::now();
+            for (uint64_t i = 0; i < batch; ++i)
+                fn();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            const uint64_t allocs = g_allocations.load(std::memory_order_relaxed) - allocsBefore;
+
+            if (seconds >= options.minSeconds || batch >= (1ull << 32))
+            {
+                r.iterations = batch;
+                r.nsPerOp = seconds * 1e9 / (double)batch;
+                r.allocsPerOp = (double)allocs / (double)batch;
+                return r;
+            }
+        }
+    }
+
+    bool Selected(const Options& options, const char* name)
+    {
+        return options.filter.empty() || std::strstr(name, options.filter.c_str()) != nullptr;
+    }
+
+    // Same recording as the app's RecordShape, without levels of detail
+    void RecordSceneShape(const SceneStore& scene, DisplayList& list, uint32_t id)
+    {
+        const uint32_t count = scene.Count(id);
+        if (count < 2)
+            return;
+
+        const int32_t* xs = scene.Xs() + scene.Offset(id);
+        const int32_t* ys = scene.Ys() + scene.Offset(id);
+        WorldPoint a{ xs[0], ys[0] };
+        WorldPoint b{ xs[1], ys[1] };
+
+        switch (scene.Kind(id))
+        {
+        case SHAPE_LINE:      list.AddLine(a, b); break;
+        case SHAPE_RECT:      list.AddRect(a, b); break;
+        case SHAPE_ELLIPSE:   list.AddEllipse(a, b); break;
+        case SHAPE_MULTILINE:
+        case SHAPE_POLIGON:   list.AddPolygon(xs, ys, count); break;
+        }
+    }
+
+    // The snap search before the grid: every vertex to screen, nearest in pixels
+    bool LinearSnapScan(const SceneStore& scene, const Camera& cam, int mouseX, int mouseY, WorldPoint& out)
+    {
+        bool found = false;
+        int64_t best = (int64_t)SNAP_RADIUS_PIXELS * SNAP_RADIUS_PIXELS;
+        const int32_t* xs = scene.Xs();
+        const int32_t* ys = scene.Ys();
+
+        for (size_t i = 0; i < scene.VertexCount(); ++i)
+        {
+            int64_t dx = (int32_t)(xs[i] * cam.zoom) + cam.panX - mouseX;
+            int64_t dy = (int32_t)(ys[i] * cam.zoom) + cam.panY - mouseY;
+            int64_t d2 = dx * dx + dy * dy;
+            if (d2 <= best)
+            {
+                best = d2;
+                out = WorldPoint{ xs[i], ys[i] };
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // The scene layout before SceneStore: Shape records and a vector of
+    // POINT vectors (WorldPoint has the POINT layout)
+    const size_t ALLOCATION_HEADER_BYTES = 16;  // typical malloc bookkeeping per block
+
+    struct LegacyShape {
+        int tool;
+        WorldPoint init;
+        WorldPoint end;
+    };
+
+    struct LegacyScene {
+        std::vector<LegacyShape> shapes;
+        std::vector<std::vector<WorldPoint>> polygons;
+    };
+
+    void BuildLegacyScene(const SceneStore& scene, LegacyScene& legacy)
+    {
+        for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+        {
+            const ShapeKind kind = scene.Kind(id);
+            if (kind == SHAPE_MULTILINE || kind == SHAPE_POLIGON)
+            {
+                std::vector<WorldPoint> poly(scene.Count(id));
+                for (uint32_t i = 0; i < scene.Count(id); ++i)
+                    poly[i] = scene.Vertex(id, i);
+                legacy.polygons.push_back(std::move(poly));
+            }
+            else if (scene.Count(id) >= 2)
+                legacy.shapes.push_back(LegacyShape{ (int)kind, scene.Vertex(id, 0), scene.Vertex(id, 1) });
+        }
+    }
+
+    std::vector<WorldPoint> RandomPoints(uint64_t seed, int32_t lo, int32_t hi, size_t count)
+    {
+        SceneRandom rng(seed);
+        std::vector<WorldPoint> pts(count);
+        for (WorldPoint& p : pts)
+            p = WorldPoint{ rng.Range(lo, hi), rng.Range(lo, hi) };
+        return pts;
+    }
+
+    // ---- viewport clipping ----
+    ClipPoint RandomClipPoint(SceneRandom& rng, const ClipRect& r)
+    {
+        // up to one rectangle size past every side, with fractional parts
+        const double w = r.maxX - r.minX;
+        const double h = r.maxY - r.minY;
+        return ClipPoint{
+            r.minX - w + (double)rng.Range(0, 3 << 16) / (1 << 16) * w,
+            r.minY - h + (double)rng.Range(0, 3 << 16) / (1 << 16) * h };
+    }
+
+    struct ClipRandomState {
+        std::vector<ClipPoint> in;
+        std::vector<ClipPoint> out;
+        std::vector<ClipPoint> scratch;
+        std::vector<uint32_t> runs;
+    };
+
+    // One random segment, polyline and polygon through ClipSegment,
+    // ClipPolyline and ClipPolygon; returns the points kept
+    size_t ClipRandomRound(SceneRandom& rng, const ClipRect& r, ClipRandomState& st)
+    {
+        ClipPoint a = RandomClipPoint(rng, r);
+        ClipPoint b = RandomClipPoint(rng, r);
+        size_t kept = ClipSegment(r, a, b) ? 2 : 0;
+
+        st.in.resize((size_t)rng.Range(2, 24));
+        for (ClipPoint& p : st.in)
+            p = RandomClipPoint(rng, r);
+        st.out.clear();
+        st.runs.clear();
+        ClipPolyline(r, st.in.data(), st.in.size(), st.out, st.runs);
+        kept += st.out.size();
+
+        st.in.resize((size_t)rng.Range(3, 24));
+        for (ClipPoint& p : st.in)
+            p = RandomClipPoint(rng, r);
+        return kept + ClipPolygon(r, st.in.data(), st.in.size(), st.out, st.scratch);
+    }
+
+    // Same shapes with the same vertices, in the same order
+    bool SameScene(const SceneStore& a, const SceneStore& b)
+    {
+        if (a.ShapeCount() != b.ShapeCount() || a.VertexCount() != b.VertexCount())
+            return false;
+        for (uint32_t id = 0; id < (uint32_t)a.ShapeCount(); ++id)
+        {
+            if (a.Kind(id) != b.Kind(id) || a.Count(id) != b.Count(id))
+                return false;
+            for (uint32_t i = 0; i < a.Count(id); ++i)
+            {
+                const WorldPoint p = a.Vertex(id, i);
+                const WorldPoint q = b.Vertex(id, i);
+                if (p.x != q.x || p.y != q.y)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // The scene as SVG text: lines, rects and ellipses as elements, dense
+    // shapes as paths with relative line-tos. onePath puts all of them in a
+    // single path, like a traced drawing exported by another editor.
+    std::string SceneSvg(const SceneStore& scene, bool onePath)
+    {
+        std::string svg = "<svg xmlns=\"http://www.w3.org/2000/svg\">\n";
+        std::string d;
+        char text[160];
+        for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+        {
+            const WorldPoint a = scene.Vertex(id, 0);
+            const WorldPoint b = scene.Vertex(id, 1);
+            switch (scene.Kind(id))
+            {
+            case SHAPE_LINE:
+                std::snprintf(text, sizeof(text), "<line x1=\"%d\" y1=\"%d\" x2=\"%d\" y2=\"%d\"/>\n", a.x, a.y, b.x, b.y);
+                svg += text;
+                break;
+            case SHAPE_RECT:
+                std::snprintf(text, sizeof(text), "<rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\"/>\n", a.x, a.y, b.x - a.x, b.y - a.y);
+                svg += text;
+                break;
+            case SHAPE_ELLIPSE:
+                std::snprintf(text, sizeof(text), "<ellipse cx=\"%.1f\" cy=\"%.1f\" rx=\"%.1f\" ry=\"%.1f\"/>\n",
+                    (a.x + b.x) / 2.0, (a.y + b.y) / 2.0, (b.x - a.x) / 2.0, (b.y - a.y) / 2.0);
+                svg += text;
+                break;
+            case SHAPE_MULTILINE:
+            case SHAPE_POLIGON: {
+                std::string& out = onePath ? d : svg;
+                if (!onePath)
+                    out += "<path d=\"";
+                std::snprintf(text, sizeof(text), "M%d %d", a.x, a.y);
+                out += text;
+                for (uint32_t i = 1; i < scene.Count(id); ++i)
+                {
+                    const WorldPoint p = scene.Vertex(id, i - 1), q = scene.Vertex(id, i);
+                    std::snprintf(text, sizeof(text), " l%d %d", q.x - p.x, q.y - p.y);
+                    out += text;
+                }
+                out += onePath ? "z" : "z\"/>\n";
+                break;
+            }
+            }
+        }
+        if (onePath)
+            svg += "<path d=\"" + d + "\"/>\n";
+        svg += "</svg>\n";
+        return svg;
+    }
+
+    void RunSuite(const Options& options, const SceneSpec& spec, const SceneStore& scene, std::vector<Result>& results)
+    {
+        const size_t vertices = scene.VertexCount();
+        const size_t shapes = scene.ShapeCount();
+
+        // Camera centred on the world at 1:1, the usual editing view
+        Camera view;
+        view.panX = VIEW_WIDTH / 2 - spec.worldSize / 2;
+        view.panY = VIEW_HEIGHT / 2 - spec.worldSize / 2;
+        const WorldRect viewRect{ -view.panX, -view.panY, -view.panX + VIEW_WIDTH, -view.panY + VIEW_HEIGHT };
+
+        const std::vector<WorldPoint> cursors = RandomPoints(spec.seed + 1, 0, spec.worldSize - 1, QUERY_COUNT);
+        size_t next = 0;
+
+        // ---- scene layout ----
+        // The SoA store against the layout it replaced: basic shapes as AoS
+        // records, every multiline / poligon in its own vector, allocated in
+        // commit order like the app did. Both walk every shape's vertices.
+        if (Selected(options, "layout_iterate"))
+        {
+            LegacyScene legacy;
+            BuildLegacyScene(scene, legacy);
+
+            const size_t soaBytes = scene.MemoryBytes();
+            size_t legacyBytes = legacy.shapes.capacity() * sizeof(LegacyShape) + legacy.polygons.capacity() * sizeof(std::vector<WorldPoint>);
+            size_t legacyBlocks = 2;
+            for (const std::vector<WorldPoint>& poly : legacy.polygons)
+            {
+                legacyBytes += poly.capacity() * sizeof(WorldPoint);
+                legacyBlocks += poly.capacity() > 0;
+            }
+            std::fprintf(stderr, "  layout: soa %zu bytes in 5 blocks, legacy %zu bytes in %zu blocks (+%zu allocator headers)\n",
+                soaBytes, legacyBytes, legacyBlocks, legacyBlocks * ALLOCATION_HEADER_BYTES);
+
+            results.push_back(Measure(options, "layout_iterate_soa", (double)vertices, [&]()
+                {
+                    int64_t sum = 0;
+                    const int32_t* xs = scene.Xs();
+                    const int32_t* ys = scene.Ys();
+                    for (uint32_t id = 0; id < (uint32_t)shapes; ++id)
+                    {
+                        const uint32_t end = scene.Offset(id) + scene.Count(id);
+                        for (uint32_t v = scene.Offset(id); v < end; ++v)
+                            sum += xs[v] + ys[v];
+                    }
+                    g_sink = g_sink + (uint64_t)sum;
+                }));
+
+            results.push_back(Measure(options, "layout_iterate_legacy", (double)vertices, [&]()
+                {
+                    int64_t sum = 0;
+                    for (const LegacyShape& s : legacy.shapes)
+                        sum += s.init.x + s.init.y + s.end.x + s.end.y;
+                    for (const std::vector<WorldPoint>& poly : legacy.polygons)
+                    {
+                        for (const WorldPoint& p : poly)
+                            sum += p.x + p.y;
+                    }
+                    g_sink = g_sink + (uint64_t)sum;
+                }));
+        }
+
+        // ---- snapping ----
+        if (Selected(options, "snap_linear_scan"))
+        {
+            results.push_back(Measure(options, "snap_linear_scan", (double)vertices, [&]()
+                {
+                    const WorldPoint& c = cursors[next++ % cursors.size()];
+                    WorldPoint hit{};
+                    g_sink = g_sink + LinearSnapScan(scene, view, c.x + view.panX, c.y + view.panY, hit) + hit.x;
+                }));
+        }
+
+        SnapGrid grid;
+        if (Selected(options, "snap_grid"))
+        {
+            results.push_back(Measure(options, "snap_grid_build", (double)vertices, [&]()
+                {
+                    grid.Clear();
+                    for (size_t i = 0; i < vertices; ++i)
+                        grid.Insert(WorldPoint{ scene.Xs()[i], scene.Ys()[i] });
+                }));
+
+            results.push_back(Measure(options, "snap_grid_query", 1.0, [&]()
+                {
+                    const WorldPoint& c = cursors[next++ % cursors.size()];
+                    WorldPoint hit{};
+                    g_sink = g_sink + grid.FindNearest(c.x, c.y, SNAP_RADIUS_PIXELS / view.zoom, hit) + hit.x;
+                }));
+        }
+
+        // ---- world -> screen ----
+        std::vector<ScreenPoint> screen(vertices);
+        const TransformPath paths[] = { TRANSFORM_SCALAR, TRANSFORM_SSE2, TRANSFORM_AVX2 };
+        for (TransformPath path : paths)
+        {
+            if (path > BestTransformPath())
+                continue;
+
+            std::string name = std::string("transform_") + TransformPathName(path);
+            if (!Selected(options, name.c_str()))
+                continue;
+
+            results.push_back(Measure(options, name.c_str(), (double)vertices, [&]()
+                {
+                    TransformToScreenWith(path, view, scene.Xs(), scene.Ys(), vertices, screen.data());
+                    g_sink = g_sink + (uint64_t)screen[vertices / 2].x;
+                }));
+        }
+
+        // ---- regular polygons ----
+        if (Selected(options, "regular_polygon"))
+        {
+            WorldPoint out[MAX_POLY_VERTICES];
+            int sides = MIN_POLY_SIDES;
+            results.push_back(Measure(options, "regular_polygon_generate", 1.0, [&]()
+                {
+                    const WorldPoint& c = cursors[next++ % cursors.size()];
+                    sides = sides == MAX_POLY_SIDES ? MIN_POLY_SIDES : sides + 1;
+                    g_sink = g_sink + GenerateRegularPolygon(c, WorldPoint{ c.x + 500, c.y + 120 }, sides, out) + out[1].x;
+                }));
+
+            RegularPolygonCache cache;
+            results.push_back(Measure(options, "regular_polygon_cache_hit", 1.0, [&]()
+                {
+                    g_sink = g_sink + cache.Update(WorldPoint{ 100, 100 }, WorldPoint{ 600, 220 }, 7);
+                }));
+        }
+
+        // ---- paint list ----
+        BoundsTree tree;
+        for (uint32_t id = 0; id < (uint32_t)shapes; ++id)
+        {
+            if (scene.Count(id) > 0)
+                tree.Insert(id, scene.Bounds(id));
+        }
+
+        DisplayList list;
+        const PenStyle pen{ 0, 0, 255, 2 };
+
+        if (Selected(options, "displaylist_record_view"))
+        {
+            results.push_back(Measure(options, "displaylist_record_view", 1.0, [&]()
+                {
+                    list.Clear();
+                    list.SetPen(pen);
+                    tree.Query(viewRect, [&](uint32_t id) { RecordSceneShape(scene, list, id); });
+                    g_sink = g_sink + list.PrimitiveCount();
+                }));
+        }
+
+        if (Selected(options, "displaylist_record_all") || Selected(options, "displaylist_replay_all"))
+        {
+            list.Clear();
+            list.SetPen(pen);
+            for (uint32_t id = 0; id < (uint32_t)shapes; ++id)
+                RecordSceneShape(scene, list, id);
+
+            if (Selected(options, "displaylist_record_all"))
+            {
+                results.push_back(Measure(options, "displaylist_record_all", (double)shapes, [&]()
+                    {
+                        list.Clear();
+                        list.SetPen(pen);
+                        for (uint32_t id = 0; id < (uint32_t)shapes; ++id)
+                            RecordSceneShape(scene, list, id);
+                        g_sink = g_sink + list.PrimitiveCount();
+                    }));
+            }
+
+            if (Selected(options, "displaylist_replay_all"))
+            {
+                const Camera fit = FitCameraToScene(scene, VIEW_WIDTH, VIEW_HEIGHT, 0);
+                results.push_back(Measure(options, "displaylist_replay_all", (double)list.VertexCount(), [&]()
+                    {
+                        RecordingBackend backend;
+                        list.Replay(fit, backend);
+                        g_sink = g_sink + (uint64_t)backend.checksum;
+                    }));
+            }
+        }
+
+        // ---- whole scene layer frames, as WM_PAINT renders them ----
+        if (Selected(options, "paint_frame"))
+        {
+            FrameArena arena;
+            DisplayList frameList;
+            const Camera fit = FitCameraToScene(scene, VIEW_WIDTH, VIEW_HEIGHT, 0);
+            const WorldRect all{ INT32_MIN, INT32_MIN, INT32_MAX, INT32_MAX };
+
+            auto paint = [&](const Camera& cam, const WorldRect& visible)
+                {
+                    arena.Reset();
+                    frameList.Clear();
+                    frameList.SetPen(pen);
+                    tree.Query(visible, [&](uint32_t id) { RecordSceneShape(scene, frameList, id); });
+
+                    RecordingBackend backend;
+                    frameList.Replay(cam, backend, arena);
+                    g_sink = g_sink + (uint64_t)backend.checksum;
+                };
+
+            results.push_back(Measure(options, "paint_frame_view", 1.0, [&]() { paint(view, viewRect); }));
+            results.push_back(Measure(options, "paint_frame_all", (double)shapes, [&]() { paint(fit, all); }));
+        }
+
+        // ---- viewport clipping ----
+        // clip_random: one random segment, polyline and polygon through
+        // the clipper (their correctness is checked by the viewport_clip
+        // tests). The zoomed frames replay the view at the 10x zoom clamp,
+        // where shapes reach far past the window, without and with clipping.
+        if (Selected(options, "clip_random"))
+        {
+            const ClipRect r = ExpandedClipRect(ScreenRect{ 0, 0, VIEW_WIDTH, VIEW_HEIGHT });
+            SceneRandom rng(spec.seed + 5);
+            ClipRandomState state;
+            results.push_back(Measure(options, "clip_random", 1.0, [&]()
+                {
+                    g_sink = g_sink + ClipRandomRound(rng, r, state);
+                }));
+        }
+
+        if (Selected(options, "clip_polygon"))
+        {
+            const ClipRect r = ExpandedClipRect(ScreenRect{ 0, 0, VIEW_WIDTH, VIEW_HEIGHT });
+            std::vector<ClipPoint> circle;
+            FlattenEllipse(ClipPoint{ -VIEW_WIDTH, -VIEW_HEIGHT }, ClipPoint{ VIEW_WIDTH, VIEW_HEIGHT }, circle);
+            std::vector<ClipPoint> out, scratch;
+            results.push_back(Measure(options, "clip_polygon", (double)circle.size(), [&]()
+                {
+                    g_sink = g_sink + ClipPolygon(r, circle.data(), circle.size(), out, scratch);
+                }));
+        }
+
+        if (Selected(options, "paint_frame_zoomed"))
+        {
+            FrameArena arena;
+            DisplayList frameList;
+            const ScreenRect viewport{ 0, 0, VIEW_WIDTH, VIEW_HEIGHT };
+
+            // The scene's shapes packed into a small world, so many of them
+            // cross the 10x view around its centre
+            SceneSpec denseSpec = spec;
+            denseSpec.worldSize = 4 * denseSpec.maxShapeSize;
+            SceneStore dense;
+            GenerateScene(denseSpec, dense);
+
+            Camera zoomed;
+            zoomed.zoom = 10.0;
+            zoomed.panX = VIEW_WIDTH / 2 - denseSpec.worldSize / 2 * 10;
+            zoomed.panY = VIEW_HEIGHT / 2 - denseSpec.worldSize / 2 * 10;
+            const WorldRect zoomedRect{
+                (int32_t)std::floor(-zoomed.panX / zoomed.zoom), (int32_t)std::floor(-zoomed.panY / zoomed.zoom),
+                (int32_t)std::ceil((VIEW_WIDTH - zoomed.panX) / zoomed.zoom), (int32_t)std::ceil((VIEW_HEIGHT - zoomed.panY) / zoomed.zoom) };
+
+            frameList.SetPen(pen);
+            for (uint32_t id = 0; id < (uint32_t)dense.ShapeCount(); ++id)
+            {
+                if (dense.Count(id) > 0 && RectsIntersect(dense.Bounds(id), zoomedRect))
+                    RecordSceneShape(dense, frameList, id);
+            }
+
+            size_t submitted = 0;
+            results.push_back(Measure(options, "paint_frame_zoomed", (double)frameList.VertexCount(), [&]()
+                {
+                    arena.Reset();
+                    RecordingBackend backend;
+                    frameList.Replay(zoomed, backend, arena);
+                    g_sink = g_sink + (uint64_t)backend.checksum;
+                }));
+
+            results.push_back(Measure(options, "paint_frame_zoomed_clipped", (double)frameList.VertexCount(), [&]()
+                {
+                    arena.Reset();
+                    RecordingBackend backend;
+                    frameList.Replay(zoomed, viewport, backend, arena);
+                    g_sink = g_sink + (uint64_t)backend.checksum;
+                    submitted = backend.vertices;
+                }));
+
+            std::fprintf(stderr, "  zoomed view: %zu recorded vertices, %zu submitted after clipping\n", frameList.VertexCount(), submitted);
+        }
+
+        // ---- tiled rasterizer scaling ----
+        // raster_scene_t<n>: the whole scene fitted into a 4096 x 4096 export
+        // on a pool of n threads, n = 1, 2, 4, ... up to the hardware threads
+        if (Selected(options, "raster_scene_t"))
+        {
+            RasterOptions raster;
+            raster.width = 4096;
+            raster.height = 4096;
+            raster.camera = FitCameraToScene(scene, raster.width, raster.height, 16);
+
+            const unsigned hardware = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+            std::vector<unsigned> counts;
+            for (unsigned n = 1; n < hardware; n *= 2)
+                counts.push_back(n);
+            counts.push_back(hardware);
+
+            PixelBuffer image;
+            double oneThreadNs = 0.0;
+            for (unsigned n : counts)
+            {
+                ThreadPool pool(n);
+                const std::string name = "raster_scene_t" + std::to_string(n);
+                results.push_back(Measure(options, name.c_str(), (double)vertices, [&]()
+                    {
+                        RasterizeScene(scene, raster, pool, image);
+                        g_sink = g_sink + image.Get(2048, 2048);
+                    }));
+                if (n == 1)
+                    oneThreadNs = results.back().nsPerOp;
+                std::fprintf(stderr, "  raster_scene: %u threads, %.2fx of one thread\n", n, oneThreadNs / results.back().nsPerOp);
+            }
+        }
+
+        // ---- tile pyramid ----
+        if (Selected(options, "tile_render") || Selected(options, "tile_view_cold") ||
+            Selected(options, "tile_pan_warm") || Selected(options, "tile_invalidate"))
+        {
+            ThreadPool pool;
+            TileCache cache;
+            const ScreenRect viewArea{ 0, 0, VIEW_WIDTH, VIEW_HEIGHT };
+            std::vector<TileDraw> draws;
+            std::vector<TileKey> missing;
+
+            // One tile, single threaded, somewhere in the view
+            if (Selected(options, "tile_render"))
+            {
+                const TileRange r = TileCache::TilesInView(view, 0, viewArea);
+                PixelBuffer tile;
+                int32_t i = 0;
+                results.push_back(Measure(options, "tile_render", 1.0, [&]()
+                    {
+                        const TileKey key{ 0, r.x0 + i % (r.x1 - r.x0 + 1), r.y0 + (i / (r.x1 - r.x0 + 1)) % (r.y1 - r.y0 + 1) };
+                        ++i;
+                        cache.RenderTile(scene, tree, key, tile);
+                        g_sink = g_sink + tile.Get(7, 7);
+                    }));
+            }
+
+            // A whole view from an empty cache, tiles rendered on the pool
+            if (Selected(options, "tile_view_cold"))
+            {
+                results.push_back(Measure(options, "tile_view_cold", 1.0, [&]()
+                    {
+                        cache.Clear();
+                        cache.PlanView(view, viewArea, draws, missing);
+                        cache.RenderTiles(scene, tree, pool, missing.data(), missing.size());
+                        g_sink = g_sink + missing.size();
+                    }));
+            }
+
+            // Panning over a warm cache: only planning, every tile is a hit
+            if (Selected(options, "tile_pan_warm"))
+            {
+                const int32_t reach = TileCache::TILE_SIZE;
+                cache.Clear();
+                cache.PlanView(view, ScreenRect{ -reach, -reach, VIEW_WIDTH + reach, VIEW_HEIGHT + reach }, draws, missing);
+                cache.RenderTiles(scene, tree, pool, missing.data(), missing.size());
+
+                SceneRandom rng(spec.seed + 2);
+                results.push_back(Measure(options, "tile_pan_warm", 1.0, [&]()
+                    {
+                        Camera panned = view;
+                        panned.panX += rng.Range(-reach, reach);
+                        panned.panY += rng.Range(-reach, reach);
+                        cache.PlanView(panned, viewArea, draws, missing);
+                        g_sink = g_sink + draws.size() + missing.size();
+                    }));
+            }
+
+            // Edit of one shape: drop the tiles it touches (of a cache warmed
+            // with the view at three levels)
+            if (Selected(options, "tile_invalidate") && shapes > 0)
+            {
+                cache.Clear();
+                for (int32_t level = -1; level <= 1; ++level)
+                {
+                    Camera cam = view;
+                    cam.zoom = TileCache::LevelZoom(level);
+                    cache.PlanView(cam, viewArea, draws, missing);
+                    cache.RenderTiles(scene, tree, pool, missing.data(), missing.size());
+                }
+
+                size_t next = 0;
+                results.push_back(Measure(options, "tile_invalidate", 1.0, [&]()
+                    {
+                        const uint32_t id = (uint32_t)(next++ % shapes);
+                        g_sink = g_sink + cache.InvalidateWorldRect(scene.Bounds(id));
+                    }));
+            }
+        }
+
+        // ---- panning the retained scene layer ----
+        // A view sized PixelBuffer layer follows mouse sized pan steps, either
+        // moving its pixels and drawing the exposed strips or redrawing it all
+        if (Selected(options, "pan_scroll") || Selected(options, "pan_full") || Selected(options, "pan_pixels_scroll"))
+        {
+            const int32_t margin = (pen.width > 1 ? pen.width : 1) / 2 + 2;
+            std::vector<uint32_t> ids;
+            PixelBuffer strip;
+
+            // Draw the shapes overlapping area of the view panned by cam
+            auto render = [&](const Camera& cam, PixelBuffer& surface, const ScreenRect& area)
+                {
+                    const WorldRect world{
+                        area.left - cam.panX - margin, area.top - cam.panY - margin,
+                        area.right - cam.panX + margin, area.bottom - cam.panY + margin };
+                    ids.clear();
+                    tree.Query(world, [&](uint32_t id) { ids.push_back(id); });
+
+                    RasterOptions raster;
+                    raster.width = (uint32_t)(area.right - area.left);
+                    raster.height = (uint32_t)(area.bottom - area.top);
+                    raster.camera = cam;
+                    raster.camera.panX -= area.left;
+                    raster.camera.panY -= area.top;
+                    raster.pen = pen;
+                    RasterizeShapes(scene, ids.data(), ids.size(), raster, strip);
+                    surface.Blit(strip, area.left, area.top);
+                };
+
+            auto bench = [&](const char* name, bool scroll)
+                {
+                    RetainedLayer<PixelBuffer> layer;
+                    SceneRandom rng(spec.seed + 3);
+                    Camera cam = view;
+                    LayerKey key;
+                    key.panX = cam.panX;
+                    key.panY = cam.panY;
+                    key.width = VIEW_WIDTH;
+                    key.height = VIEW_HEIGHT;
+                    layer.Update(key, [&](PixelBuffer& surface) { render(cam, surface, ScreenRect{ 0, 0, VIEW_WIDTH, VIEW_HEIGHT }); });
+
+                    results.push_back(Measure(options, name, 1.0, [&]()
+                        {
+                            // wander around the starting view
+                            cam.panX += rng.Range(-32, 32) + (cam.panX < view.panX ? 4 : -4);
+                            cam.panY += rng.Range(-32, 32) + (cam.panY < view.panY ? 4 : -4);
+                            key.panX = cam.panX;
+                            key.panY = cam.panY;
+
+                            if (!scroll || !layer.Scroll(key, [&](PixelBuffer& surface, const ScreenRect& area) { render(cam, surface, area); }))
+                            {
+                                layer.Invalidate();
+                                layer.Update(key, [&](PixelBuffer& surface) { render(cam, surface, ScreenRect{ 0, 0, VIEW_WIDTH, VIEW_HEIGHT }); });
+                            }
+                            g_sink = g_sink + layer.GetSurface().Get(VIEW_WIDTH / 2, VIEW_HEIGHT / 2);
+                        }));
+                };
+
+            if (Selected(options, "pan_pixels_scroll"))
+            {
+                PixelBuffer pixels(VIEW_WIDTH, VIEW_HEIGHT);
+                int32_t step = 0;
+                results.push_back(Measure(options, "pan_pixels_scroll", 1.0, [&]()
+                    {
+                        const int32_t d = (step++ & 1) ? 17 : -17;
+                        pixels.Scroll(d, -d);
+                        g_sink = g_sink + pixels.Get(0, 0);
+                    }));
+            }
+            if (Selected(options, "pan_scroll"))
+                bench("pan_scroll", true);
+            if (Selected(options, "pan_full"))
+                bench("pan_full", false);
+        }
+
+        // ---- render thread handoff ----
+        // render_thread_pan: publish a panned view and wait for its frame (the
+        // round trip a WM_PAINT sees). render_thread_flood: publish bursts of
+        // views and scene versions (one drawn line each) without waiting,
+        // taking frames as they come; every frame must match a published
+        // snapshot, in order. Run these under -DDRAWER_SANITIZE=thread to
+        // check the handoff for races.
+        if (Selected(options, "render_thread_pan") || Selected(options, "render_thread_flood"))
+        {
+            ThreadPool pool;
+            RenderThread renderer;
+            renderer.Start(pool, nullptr);
+            SceneStore edited = scene;                  // the flood draws into it
+
+            LayerKey key;
+            key.sceneVersion = 1;
+            key.panX = view.panX;
+            key.panY = view.panY;
+            key.width = VIEW_WIDTH;
+            key.height = VIEW_HEIGHT;
+            Camera cam = view;
+            SceneRandom rng(spec.seed + 4);
+            uint64_t taken = 0;
+
+            auto check = [&]()
+                {
+                    const RenderedFrame& frame = renderer.Frame();
+                    if (frame.serial < taken || frame.serial > renderer.LastPublished() ||
+                        frame.pixels.Width() != frame.key.width || frame.pixels.Height() != frame.key.height ||
+                        frame.camera.panX != frame.key.panX || frame.camera.panY != frame.key.panY)
+                    {
+                        std::fprintf(stderr, "render thread: inconsistent frame %llu\n", (unsigned long long)frame.serial);
+                        std::abort();
+                    }
+                    taken = frame.serial;
+                };
+
+            auto publish = [&]()
+                {
+                    cam.panX += rng.Range(-32, 32) + (cam.panX < view.panX ? 4 : -4);
+                    cam.panY += rng.Range(-32, 32) + (cam.panY < view.panY ? 4 : -4);
+                    key.panX = cam.panX;
+                    key.panY = cam.panY;
+                    return renderer.Publish(edited, key, cam, pen, 0x00FFFFFF);
+                };
+
+            auto waitFor = [&](uint64_t serial)
+                {
+                    while (true)
+                    {
+                        if (renderer.TakeFrame())
+                        {
+                            check();
+                            if (taken >= serial)
+                                return;
+                        }
+                        std::this_thread::yield();
+                    }
+                };
+
+            waitFor(publish());
+
+            if (Selected(options, "render_thread_pan"))
+            {
+                results.push_back(Measure(options, "render_thread_pan", 1.0, [&]() { waitFor(publish()); }));
+            }
+
+            if (Selected(options, "render_thread_flood"))
+            {
+                results.push_back(Measure(options, "render_thread_flood", 16.0, [&]()
+                    {
+                        // a line drawn per burst: only the shapes past the shared copy are copied
+                        const WorldPoint line[2] = { { rng.Range(0, spec.worldSize), rng.Range(0, spec.worldSize) },
+                            { rng.Range(0, spec.worldSize), rng.Range(0, spec.worldSize) } };
+                        edited.Append(SHAPE_LINE, line, 2);
+                        ++key.sceneVersion;
+                        uint64_t last = 0;
+                        for (int i = 0; i < 16; ++i)
+                        {
+                            last = publish();
+                            if (renderer.TakeFrame())
+                                check();
+                        }
+                        waitFor(last);
+                    }));
+            }
+
+            renderer.Stop();
+            g_sink = g_sink + renderer.FramesRendered() + renderer.SnapshotsSkipped();
+        }
+
+        // ---- compressed vertex storage ----
+        // codec_encode packs the whole scene, codec_decode unpacks it and
+        // codec_decode_shape decodes one random shape (round trips are
+        // checked by the vertex_codec tests)
+        if (Selected(options, "codec_encode") || Selected(options, "codec_decode"))
+        {
+            PackedShapes packed;
+            packed.Pack(scene);
+            std::fprintf(stderr, "  packed: %zu bytes for %zu raw (%.2fx)\n",
+                packed.MemoryBytes(), scene.MemoryBytes(), (double)scene.MemoryBytes() / (double)packed.MemoryBytes());
+
+            SceneStore unpacked;
+            std::vector<int32_t> xs, ys;
+            SceneRandom rng(spec.seed + 6);
+
+            if (Selected(options, "codec_encode"))
+            {
+                results.push_back(Measure(options, "codec_encode", (double)vertices, [&]()
+                    {
+                        packed.Pack(scene);
+                        g_sink = g_sink + packed.EncodedBytes();
+                    }));
+            }
+
+            if (Selected(options, "codec_decode"))
+            {
+                packed.Pack(scene);
+                results.push_back(Measure(options, "codec_decode", (double)vertices, [&]()
+                    {
+                        packed.Unpack(unpacked);
+                        g_sink = g_sink + unpacked.VertexCount();
+                    }));
+
+                results.push_back(Measure(options, "codec_decode_shape", 1.0, [&]()
+                    {
+                        const uint32_t id = (uint32_t)rng.Range(0, (int32_t)shapes - 1);
+                        xs.resize(scene.Count(id));
+                        ys.resize(scene.Count(id));
+                        g_sink = g_sink + packed.DecodeShape(id, xs.data(), ys.data());
+                    }));
+            }
+        }
+
+        // ---- SVG import ----
+        // Throughput of ImportSvg on the scene written as SVG (items are
+        // bytes): svg_import with one element per shape, svg_import_one_path
+        // with every dense shape in one long path.
+        if (Selected(options, "svg_import"))
+        {
+            ThreadPool pool;
+            const std::filesystem::path path = std::filesystem::temp_directory_path() / "drawer_bench_scene.svg";
+            for (bool onePath : { false, true })
+            {
+                const char* name = onePath ? "svg_import_one_path" : "svg_import";
+                if (!Selected(options, name))
+                    continue;
+
+                const std::string svg = SceneSvg(scene, onePath);
+                FILE* f = std::fopen(path.string().c_str(), "wb");
+                if (!f || std::fwrite(svg.data(), 1, svg.size(), f) != svg.size())
+                {
+                    std::fprintf(stderr, "svg import: cannot write %s\n", path.string().c_str());
+                    std::abort();
+                }
+                std::fclose(f);
+
+                SceneStore imported;
+                results.push_back(Measure(options, name, (double)svg.size(), [&]()
+                    {
+                        imported.Clear();
+                        if (!ImportSvg(path, imported, pool))
+                        {
+                            std::fprintf(stderr, "svg import: %s failed\n", name);
+                            std::abort();
+                        }
+                        g_sink = g_sink + imported.VertexCount();
+                    }));
+                std::fprintf(stderr, "  %s: %.1f MB/s on %u threads\n", name,
+                    (double)svg.size() / (results.back().nsPerOp * 1e-9) / 1e6, pool.Size());
+            }
+
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+
+        // ---- binary scene file ----
+        // scene_file_open maps and validates the file (the view is what a
+        // load shows first), scene_file_load also copies it into a store.
+        if (Selected(options, "scene_file_save") || Selected(options, "scene_file_open") || Selected(options, "scene_file_load"))
+        {
+            const std::filesystem::path path = std::filesystem::temp_directory_path() / "drawer_bench_scene.bin";
+            if (!SaveSceneFile(path, scene))
+            {
+                std::fprintf(stderr, "scene file: cannot write %s\n", path.string().c_str());
+                std::abort();
+            }
+
+            if (Selected(options, "scene_file_save"))
+            {
+                results.push_back(Measure(options, "scene_file_save", (double)vertices, [&]()
+                    {
+                        g_sink = g_sink + SaveSceneFile(path, scene);
+                    }));
+            }
+
+            SceneFileView view;
+            if (Selected(options, "scene_file_open"))
+            {
+                results.push_back(Measure(options, "scene_file_open", (double)shapes, [&]()
+                    {
+                        g_sink = g_sink + view.Open(path);
+                        g_sink = g_sink + view.ShapeCount();
+                        view.Close();
+                    }));
+            }
+
+            if (Selected(options, "scene_file_load"))
+            {
+                SceneStore loaded;
+                results.push_back(Measure(options, "scene_file_load", (double)vertices, [&]()
+                    {
+                        if (view.Open(path))
+                            view.CopyTo(loaded);
+                        view.Close();
+                        g_sink = g_sink + loaded.VertexCount();
+                    }));
+                if (!SameScene(scene, loaded))
+                {
+                    std::fprintf(stderr, "scene file: loaded scene differs\n");
+                    std::abort();
+                }
+            }
+
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+
+        // ---- picking and snap features ----
+        if (Selected(options, "pick_shape"))
+        {
+            results.push_back(Measure(options, "pick_shape", 1.0, [&]()
+                {
+                    const WorldPoint& c = cursors[next++ % cursors.size()];
+                    PickResult pick = PickShape(scene, tree, c.x, c.y, 5.0);
+                    g_sink = g_sink + pick.hit + pick.id;
+                }));
+        }
+
+        if (Selected(options, "snap_features_rebuild"))
+        {
+            SnapFeatureCache features;
+            results.push_back(Measure(options, "snap_features_rebuild", (double)vertices, [&]()
+                {
+                    features.Rebuild(scene);
+                    g_sink = g_sink + features.Crossings().size();
+                }));
+        }
+    }
+
+    // What PickShape answers, found by visiting every shape (outlines are
+    // only measured when the box is within tolerance)
+    PickResult LinearPick(const SceneStore& scene, double px, double py, double tolerance)
+    {
+        PickResult result;
+        for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+        {
+            const WorldRect box = scene.Bounds(id);
+            if (px < box.minX - tolerance || px > box.maxX + tolerance || py < box.minY - tolerance || py > box.maxY + tolerance)
+                continue;
+            const double d = DistanceToShape(scene, id, px, py);
+            if (d <= tolerance && (!result.hit || d <= result.distance))
+            {
+                result.hit = true;
+                result.id = id;
+                result.distance = d;
+            }
+        }
+        return result;
+    }
+
+    // Picking on a million shapes. The per size scenes get there only at
+    // ~18M vertices (dense multilines hold most of them), so this scene keeps
+    // every shape small. Half the cursors sit next to an outline so picks
+    // hit; the first ones are checked against LinearPick.
+    void RunPickSuite(const Options& options, const SceneStore& scene, std::vector<Result>& results)
+    {
+        BoundsTree tree;
+        for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+            tree.Insert(id, scene.Bounds(id));
+
+        const double tolerance = 5.0;
+        SceneRandom rng(options.seed + 2);
+        std::vector<WorldPoint> cursors = RandomPoints(options.seed + 1, 0, PICK_SCENE_WORLD - 1, QUERY_COUNT);
+        for (size_t i = 0; i < cursors.size(); i += 2)
+        {
+            const uint32_t id = (uint32_t)rng.Range(0, (int32_t)scene.ShapeCount() - 1);
+            const WorldPoint v = scene.Vertex(id, 0);
+            cursors[i] = WorldPoint{ v.x + rng.Range(-4, 4), v.y + rng.Range(-4, 4) };
+        }
+
+        size_t hits = 0;
+        for (size_t i = 0; i < PICK_CHECKED_CURSORS; ++i)
+        {
+            const WorldPoint& c = cursors[i];
+            const PickResult pick = PickShape(scene, tree, c.x, c.y, tolerance);
+            const PickResult linear = LinearPick(scene, c.x, c.y, tolerance);
+            if (pick.hit != linear.hit || (pick.hit && (pick.id != linear.id || pick.distance != linear.distance)))
+            {
+                std::fprintf(stderr, "pick_shape: (%d, %d) differs from the linear scan\n", c.x, c.y);
+                std::abort();
+            }
+            hits += pick.hit;
+        }
+        std::fprintf(stderr, "  pick: %zu of %zu checked cursors hit a shape\n", hits, PICK_CHECKED_CURSORS);
+
+        size_t next = 0;
+        results.push_back(Measure(options, "pick_shape", 1.0, [&]()
+            {
+                const WorldPoint& c = cursors[next++ % cursors.size()];
+                PickResult pick = PickShape(scene, tree, c.x, c.y, tolerance);
+                g_sink = g_sink + pick.hit + pick.id;
+            }));
+
+        results.push_back(Measure(options, "pick_shape_linear", (double)scene.ShapeCount(), [&]()
+            {
+                const WorldPoint& c = cursors[next++ % cursors.size()];
+                PickResult pick = LinearPick(scene, c.x, c.y, tolerance);
+                g_sink = g_sink + pick.hit + pick.id;
+            }));
+    }
+
+    // Scene independent: the cost of leaving the instrumentation on
+    void RunLatencySuite(const Options& options, std::vector<Result>& results)
+    {
+        LatencyHistogram histogram;
+        SceneRandom rng(options.seed);
+        std::vector<uint64_t> samples(QUERY_COUNT);
+        for (uint64_t& v : samples)
+            v = (uint64_t)rng.Range(1000, 20000000);    // 1 us .. 20 ms
+        size_t next = 0;
+
+        if (Selected(options, "latency_record"))
+        {
+            results.push_back(Measure(options, "latency_record", 1.0, [&]()
+                {
+                    histogram.Record(samples[next++ % samples.size()]);
+                }));
+
+            results.push_back(Measure(options, "latency_record_timed", 1.0, [&]()
+                {
+                    const uint64_t start = LatencyNowNanos();
+                    histogram.Record(LatencyNowNanos() - start);
+                }));
+        }
+
+        if (Selected(options, "latency_percentile"))
+        {
+            results.push_back(Measure(options, "latency_percentile", 1.0, [&]()
+                {
+                    g_sink = g_sink + histogram.ValueAtPercentile(99.0);
+                }));
+        }
+    }
+
+    std::vector<size_t> ParseSizes(const char* text)
+    {
+        std::vector<size_t> sizes;
+        while (*text)
+        {
+            char* end = nullptr;
+            unsigned long long v = std::strtoull(text, &end, 10);
+            if (end == text)
+                break;
+            if (v > 0)
+                sizes.push_back((size_t)v);
+            text = *end == ',' ? end + 1 : end;
+        }
+        return sizes;
+    }
+
+    bool ParseArgs(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* arg = argv[i];
+            const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+            if (std::strcmp(arg, "--vertices") == 0 && value)
+                options.sizes = ParseSizes(value);
+            else if (std::strcmp(arg, "--mix") == 0 && value)
+            {
+                options.mixed = std::strstr(value, "mixed") != nullptr;
+                options.polygons = std::strstr(value, "polygons") != nullptr;
+            }
+            else if (std::strcmp(arg, "--seed") == 0 && value)
+                options.seed = std::strtoull(value, nullptr, 10);
+            else if (std::strcmp(arg, "--min-time") == 0 && value)
+                options.minSeconds = std::atof(value);
+            else if (std::strcmp(arg, "--filter") == 0 && value)
+                options.filter = value;
+            else if (std::strcmp(arg, "--out") == 0 && value)
+                options.outPath = value;
+            else
+                return false;
+            ++i;
+        }
+        return !options.sizes.empty() && (options.mixed || options.polygons);
+    }
+
+    void WriteJsonString(FILE* f, const std::string& s)
+    {
+        std::fputc('"', f);
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                std::fputc('\\', f);
+            std::fputc(c, f);
+        }
+        std::fputc('"', f);
+    }
+
+    // One entry of the "scenes" array
+    void WriteSceneResults(FILE* out, bool first, const char* mix, const SceneSpec& spec, const SceneStore& scene,
+        double generateSeconds, const std::vector<Result>& results)
+    {
+        std::fprintf(out, "%s\n    {\n      \"mix\": \"%s\",\n      \"target_vertices\": %zu,\n      \"vertices\": %zu,\n      \"shapes\": %zu,\n"
+            "      \"generate_ms\": %.3f,\n      \"results\": [",
+            first ? "" : ",", mix, spec.targetVertices, scene.VertexCount(), scene.ShapeCount(), generateSeconds * 1000.0);
+    
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            std::fprintf(out, "%s\n        { \"name\": ", i ? "," : "");
+            WriteJsonString(out, r.name);
+            std::fprintf(out, ", \"iterations\": %llu, \"ns_per_op\": %.3f, \"items_per_op\": %.0f, \"ns_per_item\": %.4f, \"allocs_per_op\": %.3f }",
+                (unsigned long long)r.iterations, r.nsPerOp, r.itemsPerOp, r.itemsPerOp > 0 ? r.nsPerOp / r.itemsPerOp : 0.0, r.allocsPerOp);
+    
+            std::fprintf(stderr, "  %-28s %14.1f ns/op %10.2f allocs/op\n", r.name.c_str(), r.nsPerOp, r.allocsPerOp);
+        }
+        std::fprintf(out, "\n      ]\n    }");
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseArgs(argc, argv, options))
+    {
+        std::fprintf(stderr, "usage: %s [--vertices N[,N...]] [--mix mixed,polygons] [--seed N] [--min-time SECONDS] [--filter TEXT] [--out FILE]\n", argv[0]);
+        return 2;
+    }
+
+    FILE* out = stdout;
+    if (!options.outPath.empty())
+    {
+        out = std::fopen(options.outPath.c_str(), "w");
+        if (!out)
+        {
+            std::fprintf(stderr, "cannot write %s\n", options.outPath.c_str());
+            return 1;
+        }
+    }
+
+    std::fprintf(out, "{\n  \"suite\": \"drawer_bench\",\n  \"transform_path\": ");
+    WriteJsonString(out, TransformPathName(BestTransformPath()));
+    std::fprintf(out, ",\n  \"seed\": %llu,\n  \"min_time_s\": %g,\n  \"scenes\": [", (unsigned long long)options.seed, options.minSeconds);
+
+    size_t sceneIndex = 0;
+    for (size_t s = 0; s < options.sizes.size() * 2; ++s)
+    {
+        const bool polygonMix = s % 2 == 1;
+        if (polygonMix ? !options.polygons : !options.mixed)
+            continue;
+
+        SceneSpec spec;
+        spec.targetVertices = options.sizes[s / 2];
+        spec.seed = options.seed;
+        if (polygonMix)
+        {
+            spec.lineWeight = 0;
+            spec.rectWeight = 0;
+            spec.ellipseWeight = 0;
+        }
+
+        SceneStore scene;
+        auto start = std::chrono::steady_clock::now();
+        GenerateScene(spec, scene);
+        double generateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const char* mix = polygonMix ? "polygons" : "mixed";
+        std::fprintf(stderr, "scene %s, %zu vertices, %zu shapes\n", mix, scene.VertexCount(), scene.ShapeCount());
+
+        std::vector<Result> results;
+        RunSuite(options, spec, scene, results);
+
+        WriteSceneResults(out, sceneIndex++ == 0, mix, spec, scene, generateSeconds, results);
+    }
+
+    // "pick_shape" also selects the pick suite and its million shape scene:
+    // lines, rects and ellipses, two vertices each
+    if (Selected(options, "pick_shape"))
+    {
+        SceneSpec spec;
+        spec.targetVertices = PICK_SCENE_SHAPES * 2;
+        spec.seed = options.seed;
+        spec.worldSize = PICK_SCENE_WORLD;
+        spec.multilineWeight = 0;
+        spec.poligonWeight = 0;
+
+        SceneStore scene;
+        auto start = std::chrono::steady_clock::now();
+        GenerateScene(spec, scene);
+        double generateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::fprintf(stderr, "scene pick, %zu vertices, %zu shapes\n", scene.VertexCount(), scene.ShapeCount());
+
+        std::vector<Result> results;
+        RunPickSuite(options, scene, results);
+        WriteSceneResults(out, sceneIndex++ == 0, "pick", spec, scene, generateSeconds, results);
+    }
+
+    std::vector<Result> latency;
+    RunLatencySuite(options, latency);
+
+    std::fprintf(out, "\n  ],\n  \"latency\": [");
+    for (size_t i = 0; i < latency.size(); ++i)
+    {
+        const Result& r = latency[i];
+        std::fprintf(out, "%s\n    { \"name\": ", i ? "," : "");
+        WriteJsonString(out, r.name);
+        std::fprintf(out, ", \"iterations\": %llu, \"ns_per_op\": %.3f }", (unsigned long long)r.iterations, r.nsPerOp);
+
+        std::fprintf(stderr, "  %-28s %14.1f ns/op\n", r.name.c_str(), r.nsPerOp);
+    }
+    std::fprintf(out, "\n  ]\n}\n");
+    if (out != stdout)
+        std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "BoundsTree.h"
+
+#include <algorithm>
+
+namespace {
+    const uint32_t LEAF_SIZE = 4;
+    const int MAX_DEPTH = 48;           // keeps the query stack bounded
+    const size_t MIN_PENDING = 64;
+}
+
+void BoundsTree::Insert(uint32_t id, const WorldRect& box)
+{
+    m_items.push_back(Item{ box, id });
+    m_pending.push_back(static_cast<uint32_t>(m_items.size() - 1));
+
+    // Rebuild once the linear part is no longer negligible
+    if (m_pending.size() > MIN_PENDING && m_pending.size() * 4 > m_order.size())
+        m_needsRebuild = true;
+}
+
+bool BoundsTree::Remove(uint32_t id)
+{
+    for (size_t i = 0; i < m_items.size(); ++i)
+    {
+        if (m_items[i].id == id)
+        {
+            m_items.erase(m_items.begin() + i);
+            Rebuild();
+            return true;
+        }
+    }
+    return false;
+}
+
+void BoundsTree::Clear()
+{
+    m_items.clear();
+    m_order.clear();
+    m_pending.clear();
+    m_nodes.clear();
+    m_dead = 0;
+    m_needsRebuild = false;
+}
+
+void BoundsTree::Rebuild()
+{
+    m_needsRebuild = false;
+    m_pending.clear();
+    m_nodes.clear();
+
+    if (m_dead > 0)
+    {
+        m_items.erase(std::remove_if(m_items.begin(), m_items.end(), [](const Item& item) { return item.id == NO_ID; }),
+            m_items.end());
+        m_dead = 0;
+    }
+
+    m_order.resize(m_items.size());
+    for (uint32_t i = 0; i < m_order.size(); ++i)
+        m_order[i] = i;
+
+    if (!m_order.empty())
+    {
+        m_nodes.reserve(2 * m_order.size() / LEAF_SIZE + 1);
+        BuildNode(0, static_cast<uint32_t>(m_order.size()), 0);
+    }
+}
+
+// Top-down build: split the longest axis of the centroid bounds at the median
+uint32_t BoundsTree::BuildNode(uint32_t begin, uint32_t end, int depth)
+{
+    const uint32_t index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.push_back(Node{});
+
+    WorldRect box = m_items[m_order[begin]].box;
+    int64_t cMinX = INT64_MAX, cMinY = INT64_MAX, cMaxX = INT64_MIN, cMaxY = INT64_MIN;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const WorldRect& b = m_items[m_order[i]].box;
+        box = RectUnion(box, b);
+
+        // centroids doubled to stay in integers
+        int64_t cx = (int64_t)b.minX + b.maxX;
+        int64_t cy = (int64_t)b.minY + b.maxY;
+        cMinX = std::min(cMinX, cx); cMaxX = std::max(cMaxX, cx);
+        cMinY = std::min(cMinY, cy); cMaxY = std::max(cMaxY, cy);
+    }
+
+    m_nodes[index].box = box;
+
+    if (end - begin <= LEAF_SIZE || depth >= MAX_DEPTH)
+    {
+        m_nodes[index].first = begin;
+        m_nodes[index].count = end - begin;
+        return index;
+    }
+
+    const bool splitX = (cMaxX - cMinX) >= (cMaxY - cMinY);
+    const uint32_t mid = begin + (end - begin) / 2;
+
+    std::nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end,
+        [&](uint32_t a, uint32_t b)
+        {
+            const WorldRect& ra = m_items[a].box;
+            const WorldRect& rb = m_items[b].box;
+            if (splitX)
+                return (int64_t)ra.minX + ra.maxX < (int64_t)rb.minX + rb.maxX;
+            return (int64_t)ra.minY + ra.maxY < (int64_t)rb.minY + rb.maxY;
+        });
+
+    BuildNode(begin, mid, depth + 1);
+    uint32_t right = BuildNode(mid, end, depth + 1);
+
+    m_nodes[index].first = right;
+    m_nodes[index].count = 0;
+    return index;
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Geometry.h"
+
+// -------------------- Bounds tree --------------------
+// Bounding volume hierarchy over shape AABBs (world coords). Shapes are
+// identified by an opaque 32 bit id chosen by the caller.
+//
+// New shapes go to a small pending list that is scanned linearly; the tree
+// is rebuilt lazily once the pending list grows past a fraction of the tree,
+// so committing one shape at a time stays cheap.
+//
+// Remap renumbers the ids in place (the caller's ids shifted) and can drop
+// shapes on the way; dropped shapes stay in the tree as dead items, skipped
+// by queries, until the next rebuild.
+class BoundsTree
+{
+public:
+    static const uint32_t NO_ID = 0xFFFFFFFFu;
+
+    void Insert(uint32_t id, const WorldRect& box);
+    bool Remove(uint32_t id);
+    void Clear();
+
+    // fn(id) returns the new id of every shape, NO_ID to drop it
+    template <class Fn>
+    void Remap(Fn&& fn)
+    {
+        for (Item& item : m_items)
+        {
+            if (item.id == NO_ID)
+                continue;
+            item.id = fn(item.id);
+            if (item.id == NO_ID)
+                ++m_dead;
+        }
+        if (m_dead * 4 > m_items.size())
+            m_needsRebuild = true;
+    }
+
+    size_t Size() const { return m_items.size() - m_dead; }
+
+    // Visit the id of every shape whose box intersects the query rect
+    template <class Fn>
+    void Query(const WorldRect& rect, Fn&& fn)
+    {
+        if (m_needsRebuild)
+            Rebuild();
+
+        if (!m_nodes.empty())
+        {
+            uint32_t stack[64];
+            int top = 0;
+            stack[top++] = 0;
+
+            while (top > 0)
+            {
+                const uint32_t index = stack[--top];
+                const Node& node = m_nodes[index];
+                if (!RectsIntersect(node.box, rect))
+                    continue;
+
+                if (node.count > 0)
+                {
+                    for (uint32_t i = node.first; i < node.first + node.count; ++i)
+                    {
+                        const Item& item = m_items[m_order[i]];
+                        if (item.id != NO_ID && RectsIntersect(item.box, rect))
+                            fn(item.id);
+                    }
+                }
+                else
+                {
+                    stack[top++] = node.first;      // right child
+                    stack[top++] = index + 1;       // left child
+                }
+            }
+        }
+
+        for (uint32_t i : m_pending)
+        {
+            if (m_items[i].id != NO_ID && RectsIntersect(m_items[i].box, rect))
+                fn(m_items[i].id);
+        }
+    }
+
+private:
+    struct Item {
+        WorldRect box;
+        uint32_t id;
+    };
+
+    // Leaves cover m_order[first, first + count). Internal nodes have
+    // count == 0, the left child right after them and the right child at first.
+    struct Node {
+        WorldRect box;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    void Rebuild();
+    uint32_t BuildNode(uint32_t begin, uint32_t end, int depth);
+
+    std::vector<Item> m_items;
+    std::vector<uint32_t> m_order;      // item indices in tree order
+    std::vector<uint32_t> m_pending;    // items not yet in the tree
+    std::vector<Node> m_nodes;
+    size_t m_dead = 0;                  // dropped items still in m_items
+    bool m_needsRebuild = false;
+};
@@ -0,0 +1,74 @@
+#include "DirtyRegion.h"
+
+void DirtyRegion::Add(const ScreenRect& r)
+{
+    if (m_all || RectIsEmpty(r))
+        return;
+
+    // Swallow rects already covered, grow one that covers the new rect
+    for (ScreenRect& cur : m_rects)
+    {
+        if (r.left >= cur.left && r.top >= cur.top && r.right <= cur.right && r.bottom <= cur.bottom)
+            return;
+    }
+    for (size_t i = 0; i < m_rects.size();)
+    {
+        const ScreenRect& cur = m_rects[i];
+        if (cur.left >= r.left && cur.top >= r.top && cur.right <= r.right && cur.bottom <= r.bottom)
+        {
+            m_rects[i] = m_rects.back();
+            m_rects.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    m_rects.push_back(r);
+    if (m_rects.size() > MAX_RECTS)
+        MergeCheapestPair();
+}
+
+void DirtyRegion::AddAll()
+{
+    m_all = true;
+    m_rects.clear();
+}
+
+void DirtyRegion::Clear()
+{
+    m_all = false;
+    m_rects.clear();
+}
+
+ScreenRect DirtyRegion::Bounds() const
+{
+    ScreenRect bounds{ 0, 0, 0, 0 };
+    for (const ScreenRect& r : m_rects)
+        bounds = RectUnion(bounds, r);
+    return bounds;
+}
+
+void DirtyRegion::MergeCheapestPair()
+{
+    size_t bestA = 0, bestB = 1;
+    int64_t bestWaste = INT64_MAX;
+
+    for (size_t a = 0; a < m_rects.size(); ++a)
+    {
+        for (size_t b = a + 1; b < m_rects.size(); ++b)
+        {
+            int64_t waste = RectArea(RectUnion(m_rects[a], m_rects[b])) - RectArea(m_rects[a]) - RectArea(m_rects[b]);
+            if (waste < bestWaste)
+            {
+                bestWaste = waste;
+                bestA = a;
+                bestB = b;
+            }
+        }
+    }
+
+    m_rects[bestA] = RectUnion(m_rects[bestA], m_rects[bestB]);
+    m_rects.erase(m_rects.begin() + bestB);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "Geometry.h"
+
+// -------------------- Dirty region --------------------
+// Accumulates the screen rectangles that changed since the last repaint.
+// Keeps at most MAX_RECTS disjoint-ish rects; when that is exceeded the pair
+// whose union wastes the least area is merged.
+class DirtyRegion
+{
+public:
+    static const size_t MAX_RECTS = 4;
+
+    void Add(const ScreenRect& r);
+    void AddAll();                          // everything is dirty (camera change, resize...)
+    void Clear();
+
+    bool IsEmpty() const { return !m_all && m_rects.empty(); }
+    bool IsAll() const { return m_all; }
+
+    const std::vector<ScreenRect>& Rects() const { return m_rects; }
+    ScreenRect Bounds() const;
+
+private:
+    void MergeCheapestPair();
+
+    std::vector<ScreenRect> m_rects;
+    bool m_all = false;
+};
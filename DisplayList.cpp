@@ -0,0 +1,369 @@
+#include "DisplayList.h"
+
+#include "TransformKernel.h"
+
+void DisplayList::Clear()
+{
+    if (m_groups.size() > MAX_RETAINED_GROUPS)
+    {
+        m_groups.clear();
+    }
+    else
+    {
+        for (PenGroup& g : m_groups)
+        {
+            g.polylines.Clear();
+            g.polygons.Clear();
+            g.ellipses.Clear();
+        }
+    }
+    m_current = 0;
+    m_primitives = 0;
+}
+
+void DisplayList::SetPen(const PenStyle& pen)
+{
+    for (size_t i = 0; i < m_groups.size(); ++i)
+    {
+        if (m_groups[i].pen == pen)
+        {
+            m_current = i;
+            return;
+        }
+    }
+
+    m_groups.push_back(PenGroup{});
+    m_groups.back().pen = pen;
+    m_current = m_groups.size() - 1;
+}
+
+void DisplayList::AddLine(WorldPoint a, WorldPoint b)
+{
+    if (m_groups.empty())
+        SetPen(PenStyle{ 0, 0, 0, 1 });
+
+    Stream& s = m_groups[m_current].polylines;
+    s.xs.push_back(a.x); s.ys.push_back(a.y);
+    s.xs.push_back(b.x); s.ys.push_back(b.y);
+    s.counts.push_back(2);
+    s.bounds.push_back(RectFromPoints(a, b));
+    ++m_primitives;
+}
+
+// Rectangles are submitted as closed 4 point polygons so they share the polygon batches
+void DisplayList::AddRect(WorldPoint a, WorldPoint b)
+{
+    const int32_t xs[4] = { a.x, b.x, b.x, a.x };
+    const int32_t ys[4] = { a.y, a.y, b.y, b.y };
+    AddPolygon(xs, ys, 4);
+}
+
+void DisplayList::AddEllipse(WorldPoint a, WorldPoint b)
+{
+    if (m_groups.empty())
+        SetPen(PenStyle{ 0, 0, 0, 1 });
+
+    Stream& s = m_groups[m_current].ellipses;
+    s.xs.push_back(a.x); s.ys.push_back(a.y);
+    s.xs.push_back(b.x); s.ys.push_back(b.y);
+    s.bounds.push_back(RectFromPoints(a, b));
+    ++m_primitives;
+}
+
+void DisplayList::AddPolygon(const int32_t* xs, const int32_t* ys, uint32_t count)
+{
+    if (count < 2)
+        return;
+    if (m_groups.empty())
+        SetPen(PenStyle{ 0, 0, 0, 1 });
+
+    Stream& s = m_groups[m_current].polygons;
+    s.xs.insert(s.xs.end(), xs, xs + count);
+    s.ys.insert(s.ys.end(), ys, ys + count);
+    s.counts.push_back(count);
+
+    WorldRect box{ xs[0], ys[0], xs[0], ys[0] };
+    for (uint32_t i = 1; i < count; ++i)
+        RectInclude(box, WorldPoint{ xs[i], ys[i] });
+    s.bounds.push_back(box);
+    ++m_primitives;
+}
+
+size_t DisplayList::VertexCount() const
+{
+    size_t n = 0;
+    for (const PenGroup& g : m_groups)
+        n += g.polylines.xs.size() + g.polygons.xs.size() + g.ellipses.xs.size();
+    return n;
+}
+
+void DisplayList::Replay(const Camera& camera, DrawBackend& backend)
+{
+    m_scratch.Reset();
+    Replay(camera, backend, m_scratch);
+}
+
+void DisplayList::Replay(const Camera& camera, DrawBackend& backend, FrameArena& scratch)
+{
+    ReplayGroups(camera, nullptr, backend, scratch);
+}
+
+void DisplayList::Replay(const Camera& camera, const ScreenRect& viewport, DrawBackend& backend, FrameArena& scratch)
+{
+    const ClipRect clip = ExpandedClipRect(viewport);
+    ReplayGroups(camera, &clip, backend, scratch);
+}
+
+void DisplayList::ReplayGroups(const Camera& camera, const ClipRect* clip, DrawBackend& backend, FrameArena& scratch)
+{
+    ScreenBuffer screen{ scratch, nullptr, nullptr, 0 };
+
+    for (const PenGroup& g : m_groups)
+    {
+        if (g.polylines.xs.empty() && g.polygons.xs.empty() && g.ellipses.xs.empty())
+            continue;
+
+        backend.SetPen(g.pen);
+        if (clip)
+        {
+            ReplayClipped(g.polylines, STREAM_POLYLINE, camera, *clip, backend, screen);
+            ReplayClipped(g.polygons, STREAM_POLYGON, camera, *clip, backend, screen);
+            ReplayClipped(g.ellipses, STREAM_ELLIPSE, camera, *clip, backend, screen);
+        }
+        else
+        {
+            ReplayStream(g.polylines, STREAM_POLYLINE, camera, backend, screen);
+            ReplayStream(g.polygons, STREAM_POLYGON, camera, backend, screen);
+            ReplayStream(g.ellipses, STREAM_ELLIPSE, camera, backend, screen);
+        }
+    }
+}
+
+void DisplayList::ReplayStream(const Stream& stream, StreamKind kind, const Camera& camera, DrawBackend& backend, ScreenBuffer& screen)
+{
+    const size_t total = stream.xs.size();
+    size_t vertex = 0;
+    size_t prim = 0;
+
+    while (vertex < total)
+    {
+        // Take whole primitives until the chunk is full (a single huge
+        // polygon still goes out in one call)
+        size_t chunkVerts = 0;
+        size_t chunkPrims = 0;
+        if (kind == STREAM_ELLIPSE)
+        {
+            chunkVerts = total - vertex;
+            if (chunkVerts > MAX_BATCH_VERTICES)
+                chunkVerts = MAX_BATCH_VERTICES;
+            chunkPrims = chunkVerts / 2;
+        }
+        else
+        {
+            while (prim + chunkPrims < stream.counts.size() &&
+                (chunkPrims == 0 || chunkVerts + stream.counts[prim + chunkPrims] <= MAX_BATCH_VERTICES))
+            {
+                chunkVerts += stream.counts[prim + chunkPrims];
+                ++chunkPrims;
+            }
+        }
+
+        // One buffer serves every chunk of the replay, it only grows for an
+        // oversized polygon
+        if (chunkVerts > screen.capacity)
+        {
+            screen.capacity = chunkVerts > MAX_BATCH_VERTICES ? chunkVerts : MAX_BATCH_VERTICES;
+            screen.points = screen.arena.AllocateArray<ScreenPoint>(screen.capacity);
+        }
+        TransformToScreen(camera, stream.xs.data() + vertex, stream.ys.data() + vertex, chunkVerts, screen.points);
+
+        switch (kind)
+        {
+        case STREAM_POLYLINE:
+            backend.PolyPolyline(screen.points, stream.counts.data() + prim, chunkPrims);
+            break;
+        case STREAM_POLYGON:
+            backend.PolyPolygon(screen.points, stream.counts.data() + prim, chunkPrims);
+            break;
+        case STREAM_ELLIPSE:
+            backend.Ellipses(screen.points, chunkPrims);
+            break;
+        }
+
+        vertex += chunkVerts;
+        if (kind != STREAM_ELLIPSE)
+            prim += chunkPrims;
+    }
+}
+
+// Like ReplayStream, but every primitive is first checked against the clip
+// rectangle with its recorded bounds. Runs of primitives wholly inside go
+// through the batch transform untouched; crossing ones are transformed in
+// double precision, clipped, and written after them into the same batch.
+void DisplayList::ReplayClipped(const Stream& stream, StreamKind kind, const Camera& camera, const ClipRect& clip, DrawBackend& backend, ScreenBuffer& screen)
+{
+    const ClipRect guard{
+        clip.minX - ELLIPSE_GUARD_PIXELS, clip.minY - ELLIPSE_GUARD_PIXELS,
+        clip.maxX + ELLIPSE_GUARD_PIXELS, clip.maxY + ELLIPSE_GUARD_PIXELS };
+
+    size_t used = 0;        // points of the batch being filled
+    size_t prims = 0;       // and its primitives
+    size_t runSource = 0;   // inside primitives waiting for the batch transform:
+    size_t runLength = 0;   // source vertices [runSource, runSource + runLength)
+    size_t runTarget = 0;   // go to screen.points + runTarget
+
+    auto transformRun = [&]()
+        {
+            if (runLength)
+                TransformToScreen(camera, stream.xs.data() + runSource, stream.ys.data() + runSource, runLength, screen.points + runTarget);
+            runLength = 0;
+        };
+
+    auto submit = [&]()
+        {
+            transformRun();
+            if (prims)
+            {
+                switch (kind)
+                {
+                case STREAM_POLYLINE: backend.PolyPolyline(screen.points, screen.counts, prims); break;
+                case STREAM_POLYGON:  backend.PolyPolygon(screen.points, screen.counts, prims); break;
+                case STREAM_ELLIPSE:  backend.Ellipses(screen.points, prims); break;
+                }
+            }
+            used = 0;
+            prims = 0;
+        };
+
+    // Room for n more points. Batches stay under MAX_BATCH_VERTICES unless a
+    // single primitive is larger; the buffer only grows while it is empty.
+    // Every primitive has at least 2 points, so capacity / 2 counts suffice.
+    auto reserve = [&](size_t n)
+        {
+            if (used > 0 && used + n > MAX_BATCH_VERTICES)
+                submit();
+            if (used + n > screen.capacity)
+            {
+                screen.capacity = n > MAX_BATCH_VERTICES ? n : MAX_BATCH_VERTICES;
+                screen.points = screen.arena.AllocateArray<ScreenPoint>(screen.capacity);
+                screen.counts = screen.arena.AllocateArray<uint32_t>(screen.capacity / 2);
+            }
+        };
+
+    auto addInside = [&](size_t vertex, uint32_t n)
+        {
+            reserve(n);
+            if (runLength && runSource + runLength == vertex && runTarget + runLength == used)
+                runLength += n;
+            else
+            {
+                transformRun();
+                runSource = vertex;
+                runLength = n;
+                runTarget = used;
+            }
+            if (kind != STREAM_ELLIPSE)
+                screen.counts[prims] = n;
+            used += n;
+            ++prims;
+        };
+
+    auto addClipped = [&](const ClipPoint* pts, uint32_t n)
+        {
+            reserve(n);
+            for (uint32_t i = 0; i < n; ++i)
+                screen.points[used + i] = RoundClipPoint(pts[i]);
+            screen.counts[prims] = n;
+            used += n;
+            ++prims;
+        };
+
+    size_t vertex = 0;
+    for (size_t prim = 0; prim < stream.bounds.size(); ++prim)
+    {
+        const uint32_t n = kind == STREAM_ELLIPSE ? 2 : stream.counts[prim];
+        const size_t first = vertex;
+        vertex += n;
+
+        const ClipSide side = ClassifyBox(clip, camera, stream.bounds[prim]);
+        if (side == CLIP_OUTSIDE)
+            continue;
+        if (side == CLIP_INSIDE ||
+            (kind == STREAM_ELLIPSE && ClassifyBox(guard, camera, stream.bounds[prim]) == CLIP_INSIDE))
+        {
+            addInside(first, n);
+            continue;
+        }
+
+        m_clipIn.resize(n);
+        for (uint32_t i = 0; i < n; ++i)
+            m_clipIn[i] = ToClipPoint(camera, stream.xs[first + i], stream.ys[first + i]);
+
+        if (kind == STREAM_POLYLINE)
+        {
+            m_clipOut.clear();
+            m_clipRuns.clear();
+            ClipPolyline(clip, m_clipIn.data(), n, m_clipOut, m_clipRuns);
+
+            const ClipPoint* run = m_clipOut.data();
+            for (uint32_t runCount : m_clipRuns)
+            {
+                addClipped(run, runCount);
+                run += runCount;
+            }
+        }
+        else if (kind == STREAM_POLYGON)
+        {
+            if (ClipPolygon(clip, m_clipIn.data(), n, m_clipOut, m_clipStage) >= 2)
+                addClipped(m_clipOut.data(), (uint32_t)m_clipOut.size());
+        }
+        else
+        {
+            // Too large to hand over as an ellipse: its visible part goes out
+            // as a polygon call of its own
+            FlattenEllipse(m_clipIn[0], m_clipIn[1], m_clipStage);
+            m_clipIn.swap(m_clipStage);
+            if (ClipPolygon(clip, m_clipIn.data(), m_clipIn.size(), m_clipOut, m_clipStage) >= 2)
+            {
+                submit();
+                reserve(m_clipOut.size());
+                for (size_t i = 0; i < m_clipOut.size(); ++i)
+                    screen.points[i] = RoundClipPoint(m_clipOut[i]);
+                screen.counts[0] = (uint32_t)m_clipOut.size();
+                backend.PolyPolygon(screen.points, screen.counts, 1);
+            }
+        }
+    }
+
+    submit();
+}
+
+// -------------------- Recording backend --------------------
+void RecordingBackend::PolyPolyline(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount)
+{
+    PolyPolygon(pts, counts, polyCount);
+}
+
+void RecordingBackend::PolyPolygon(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount)
+{
+    ++calls;
+    primitives += polyCount;
+
+    size_t n = 0;
+    for (size_t i = 0; i < polyCount; ++i)
+        n += counts[i];
+
+    for (size_t i = 0; i < n; ++i)
+        checksum += (int64_t)pts[i].x + pts[i].y;
+    vertices += n;
+}
+
+void RecordingBackend::Ellipses(const ScreenPoint* corners, size_t ellipseCount)
+{
+    ++calls;
+    primitives += ellipseCount;
+
+    for (size_t i = 0; i < 2 * ellipseCount; ++i)
+        checksum += (int64_t)corners[i].x + corners[i].y;
+    vertices += 2 * ellipseCount;
+}
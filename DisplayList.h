@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrameArena.h"
+#include "Geometry.h"
+#include "ViewportClip.h"
+
+// -------------------- Display list --------------------
+// Pen used to stroke a group of primitives
+struct PenStyle {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    int32_t width;
+
+    bool operator==(const PenStyle& o) const { return r == o.r && g == o.g && b == o.b && width == o.width; }
+};
+
+// Receives the batched draw calls of a display list replay. Point and count
+// buffers are only valid for the duration of the call.
+class DrawBackend
+{
+public:
+    virtual ~DrawBackend() = default;
+
+    virtual void SetPen(const PenStyle& pen) = 0;
+    virtual void PolyPolyline(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount) = 0;
+    virtual void PolyPolygon(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount) = 0;
+    // corners holds two points (bounding box) per ellipse
+    virtual void Ellipses(const ScreenPoint* corners, size_t ellipseCount) = 0;
+};
+
+// Recorded draw commands in world coordinates. Primitives are grouped by pen
+// and by kind into shared vertex streams (open polylines, closed polygons,
+// ellipses) so a replay issues a handful of batched calls instead of one call
+// per shape. Streams are submitted in chunks of at most MAX_BATCH_VERTICES.
+// Clear keeps the stream storage, so re-recording a similar frame does not
+// allocate.
+class DisplayList
+{
+public:
+    static const uint32_t MAX_BATCH_VERTICES = 16384;
+    static const size_t MAX_RETAINED_GROUPS = 8;    // more pens than this: Clear frees them
+    static const int32_t ELLIPSE_GUARD_PIXELS = 32768;
+
+    void Clear();
+
+    void SetPen(const PenStyle& pen);   // pen for the primitives added next
+
+    void AddLine(WorldPoint a, WorldPoint b);
+    void AddRect(WorldPoint a, WorldPoint b);
+    void AddEllipse(WorldPoint a, WorldPoint b);
+    void AddPolygon(const int32_t* xs, const int32_t* ys, uint32_t count);
+
+    // Transform to screen with the camera and submit every batch. Screen
+    // points are written to a buffer taken from scratch (the caller's frame
+    // arena) or from the list's own arena.
+    void Replay(const Camera& camera, DrawBackend& backend);
+    void Replay(const Camera& camera, DrawBackend& backend, FrameArena& scratch);
+
+    // Same, but only what falls in the viewport grown by CLIP_MARGIN_PIXELS
+    // is submitted: primitives wholly outside are dropped, the ones crossing
+    // its border are clipped (polylines split into their visible runs).
+    // Ellipses crossing it are passed whole while they stay within
+    // ELLIPSE_GUARD_PIXELS of it, larger ones are flattened into clipped
+    // polygons.
+    void Replay(const Camera& camera, const ScreenRect& viewport, DrawBackend& backend, FrameArena& scratch);
+
+    size_t PrimitiveCount() const { return m_primitives; }
+    size_t VertexCount() const;
+
+private:
+    // One kind of primitive for one pen, vertices of all primitives back to back
+    struct Stream {
+        std::vector<int32_t> xs;
+        std::vector<int32_t> ys;
+        std::vector<uint32_t> counts;
+        std::vector<WorldRect> bounds;  // one per primitive, for clipping
+
+        void Clear() { xs.clear(); ys.clear(); counts.clear(); bounds.clear(); }
+    };
+
+    struct PenGroup {
+        PenStyle pen;
+        Stream polylines;
+        Stream polygons;
+        Stream ellipses;    // 2 vertices per ellipse, counts unused
+    };
+
+    enum StreamKind { STREAM_POLYLINE, STREAM_POLYGON, STREAM_ELLIPSE };
+
+    struct ScreenBuffer {
+        FrameArena& arena;
+        ScreenPoint* points;
+        uint32_t* counts;       // capacity / 2 entries, clipped replays only
+        size_t capacity;
+    };
+
+    void ReplayGroups(const Camera& camera, const ClipRect* clip, DrawBackend& backend, FrameArena& scratch);
+    void ReplayStream(const Stream& stream, StreamKind kind, const Camera& camera, DrawBackend& backend, ScreenBuffer& screen);
+    void ReplayClipped(const Stream& stream, StreamKind kind, const Camera& camera, const ClipRect& clip, DrawBackend& backend, ScreenBuffer& screen);
+
+    std::vector<PenGroup> m_groups;
+    size_t m_current = 0;
+    size_t m_primitives = 0;
+
+    FrameArena m_scratch{ MAX_BATCH_VERTICES * sizeof(ScreenPoint) };  // replay scratch without a caller arena
+
+    // clipping stages in double precision, kept between replays
+    std::vector<ClipPoint> m_clipIn;
+    std::vector<ClipPoint> m_clipOut;
+    std::vector<ClipPoint> m_clipStage;
+    std::vector<uint32_t> m_clipRuns;
+};
+
+// Backend that only records what it was asked to draw (headless checks, benchmarks)
+class RecordingBackend : public DrawBackend
+{
+public:
+    void SetPen(const PenStyle&) override { ++penChanges; }
+    void PolyPolyline(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount) override;
+    void PolyPolygon(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount) override;
+    void Ellipses(const ScreenPoint* corners, size_t ellipseCount) override;
+
+    size_t penChanges = 0;
+    size_t calls = 0;
+    size_t primitives = 0;
+    size_t vertices = 0;
+    int64_t checksum = 0;   // sum of all submitted coordinates
+};
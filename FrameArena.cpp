@@ -0,0 +1,64 @@
+#include "FrameArena.h"
+
+FrameArena::FrameArena(size_t initialBytes)
+    : m_initialBytes(initialBytes > 0 ? initialBytes : DEFAULT_BLOCK_SIZE)
+{
+}
+
+void FrameArena::AddBlock(size_t minBytes)
+{
+    // Chained blocks at least double, so an overflowing frame needs few of them
+    size_t size = m_blocks.empty() ? m_initialBytes : m_blocks.back().size * 2;
+    if (size < minBytes)
+        size = minBytes;
+
+    m_blocks.push_back(Block{ std::unique_ptr<unsigned char[]>(new unsigned char[size]), size });
+    ++m_heapAllocations;
+}
+
+// Blocks come from new[], so offsets rounded to align are aligned addresses
+// for any align up to alignof(std::max_align_t)
+void* FrameArena::Allocate(size_t bytes, size_t align)
+{
+    size_t start = (m_offset + align - 1) & ~(align - 1);
+
+    // The first block is only allocated on first use
+    if (m_blocks.empty() || start + bytes > m_blocks.back().size)
+    {
+        m_usedBefore += m_offset;
+        AddBlock(bytes);
+        start = 0;
+    }
+    Block* block = &m_blocks.back();
+
+    m_offset = start + bytes;
+    if (BytesUsed() > m_peak)
+        m_peak = BytesUsed();
+    return block->data.get() + start;
+}
+
+void FrameArena::Reset()
+{
+    // Fold an overflowed chain into a single block big enough for the peak
+    if (m_blocks.size() > 1)
+    {
+        size_t total = 0;
+        for (const Block& b : m_blocks)
+            total += b.size;
+
+        m_blocks.clear();
+        m_initialBytes = total;
+        AddBlock(total);
+    }
+
+    m_offset = 0;
+    m_usedBefore = 0;
+}
+
+size_t FrameArena::Capacity() const
+{
+    size_t total = 0;
+    for (const Block& b : m_blocks)
+        total += b.size;
+    return total;
+}
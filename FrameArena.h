@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// -------------------- Frame arena --------------------
+// Bump allocator for paint-time temporaries (screen-space point buffers and
+// the like). Allocations are a pointer bump and are never freed one by one;
+// Reset at the start of each frame releases everything at once. When a frame
+// overflows the current block, further blocks are chained, and the next Reset
+// replaces the chain with one block sized for that peak, so a steady stream
+// of similar frames stops touching the heap after the first one.
+class FrameArena
+{
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit FrameArena(size_t initialBytes = DEFAULT_BLOCK_SIZE);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // align: a power of two, at most alignof(std::max_align_t)
+    void* Allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+
+    // Uninitialized storage for count trivial objects, valid until Reset
+    template <class T>
+    T* AllocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena memory is never destroyed");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void Reset();
+
+    size_t BytesUsed() const { return m_usedBefore + m_offset; }
+    size_t PeakBytes() const { return m_peak; }
+    size_t Capacity() const;
+    uint64_t HeapAllocations() const { return m_heapAllocations; }    // blocks allocated so far
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    void AddBlock(size_t minBytes);
+
+    std::vector<Block> m_blocks;        // m_blocks.back() is the one being bumped
+    size_t m_initialBytes;
+    size_t m_offset = 0;                // bytes used in the current block
+    size_t m_usedBefore = 0;            // bytes used in the blocks before it
+    size_t m_peak = 0;
+    uint64_t m_heapAllocations = 0;
+};
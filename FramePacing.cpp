@@ -0,0 +1,88 @@
+#include "FramePacing.h"
+
+#include <chrono>
+
+uint64_t SteadyClock::NowMicros() const
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void MoveCoalescer::Push(ScreenPoint p)
+{
+    ++m_received;
+    if (m_pending)
+        ++m_merged;
+
+    m_latest = p;
+    m_pending = true;
+}
+
+bool MoveCoalescer::Take(ScreenPoint& out)
+{
+    if (!m_pending)
+        return false;
+
+    out = m_latest;
+    m_pending = false;
+    ++m_processed;
+    return true;
+}
+
+FrameScheduler::FrameScheduler(const Clock& clock, uint32_t targetFps)
+    : m_clock(clock)
+{
+    SetTargetFps(targetFps);
+}
+
+void FrameScheduler::SetTargetFps(uint32_t fps)
+{
+    m_interval = fps > 0 ? 1000000u / fps : 0;
+}
+
+bool FrameScheduler::Request()
+{
+    ++m_requested;
+
+    if (m_pending)
+    {
+        ++m_merged;
+        return false;
+    }
+
+    const uint64_t now = m_clock.NowMicros();
+    if (now >= m_nextSlot)
+    {
+        Present(now);
+        return true;
+    }
+
+    m_pending = true;
+    return false;
+}
+
+uint64_t FrameScheduler::MicrosUntilDue() const
+{
+    const uint64_t now = m_clock.NowMicros();
+    return now >= m_nextSlot ? 0 : m_nextSlot - now;
+}
+
+bool FrameScheduler::TakeDue()
+{
+    if (!m_pending)
+        return false;
+
+    const uint64_t now = m_clock.NowMicros();
+    if (now < m_nextSlot)
+        return false;
+
+    m_pending = false;
+    Present(now);
+    return true;
+}
+
+void FrameScheduler::Present(uint64_t now)
+{
+    ++m_presented;
+    m_nextSlot = now + m_interval;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+
+#include "Geometry.h"
+
+// -------------------- Input coalescing and frame pacing --------------------
+// Platform neutral pieces of the mouse-move pipeline: the window procedure
+// feeds raw moves to a MoveCoalescer (only the newest position is acted on)
+// and asks a FrameScheduler before invalidating (at most one repaint per
+// frame interval; requests inside the interval are merged into one deferred
+// frame). Time comes from a Clock so both can be driven by a manual clock.
+
+class Clock
+{
+public:
+    virtual ~Clock() = default;
+    virtual uint64_t NowMicros() const = 0;
+};
+
+// std::chrono::steady_clock
+class SteadyClock : public Clock
+{
+public:
+    uint64_t NowMicros() const override;
+};
+
+// Time only moves when told to
+class ManualClock : public Clock
+{
+public:
+    uint64_t NowMicros() const override { return m_now; }
+    void Set(uint64_t micros) { m_now = micros; }
+    void Advance(uint64_t micros) { m_now += micros; }
+
+private:
+    uint64_t m_now = 0;
+};
+
+// Latest-wins buffer for cursor positions
+class MoveCoalescer
+{
+public:
+    void Push(ScreenPoint p);
+    bool Take(ScreenPoint& out);        // newest position since the last Take, false if none
+    bool HasPending() const { return m_pending; }
+
+    uint64_t Received() const { return m_received; }
+    uint64_t Merged() const { return m_merged; }        // overwritten before being taken
+    uint64_t Processed() const { return m_processed; }
+
+private:
+    ScreenPoint m_latest{ 0, 0 };
+    bool m_pending = false;
+    uint64_t m_received = 0;
+    uint64_t m_merged = 0;
+    uint64_t m_processed = 0;
+};
+
+class FrameScheduler
+{
+public:
+    static const uint32_t DEFAULT_FPS = 60;
+
+    explicit FrameScheduler(const Clock& clock, uint32_t targetFps = DEFAULT_FPS);
+
+    void SetTargetFps(uint32_t fps);
+    uint64_t IntervalMicros() const { return m_interval; }
+
+    // A repaint is wanted. True: present now (the frame slot is taken).
+    // False: a deferred frame is pending, present it once TakeDue is true.
+    bool Request();
+
+    bool HasPending() const { return m_pending; }
+    uint64_t MicrosUntilDue() const;    // 0 when the pending frame is due
+    bool TakeDue();                     // pending and due: takes the frame slot
+
+    uint64_t Requested() const { return m_requested; }
+    uint64_t Presented() const { return m_presented; }
+    uint64_t Merged() const { return m_merged; }        // requests folded into a pending frame
+
+private:
+    void Present(uint64_t now);
+
+    const Clock& m_clock;
+    uint64_t m_interval;
+    uint64_t m_nextSlot = 0;
+    bool m_pending = false;
+    uint64_t m_requested = 0;
+    uint64_t m_presented = 0;
+    uint64_t m_merged = 0;
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+
+// -------------------- Portable geometry types --------------------
+// World space point, same layout as the Win32 POINT (two 32 bit LONGs) so
+// buffers can be shared with GDI without conversion.
+struct WorldPoint {
+    int32_t x;
+    int32_t y;
+};
+
+// World space axis aligned box, bounds are inclusive
+struct WorldRect {
+    int32_t minX;
+    int32_t minY;
+    int32_t maxX;
+    int32_t maxY;
+};
+
+inline WorldRect RectFromPoints(WorldPoint a, WorldPoint b)
+{
+    return WorldRect{
+        a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y,
+        a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y };
+}
+
+inline void RectInclude(WorldRect& r, WorldPoint p)
+{
+    if (p.x < r.minX) r.minX = p.x;
+    if (p.y < r.minY) r.minY = p.y;
+    if (p.x > r.maxX) r.maxX = p.x;
+    if (p.y > r.maxY) r.maxY = p.y;
+}
+
+inline WorldRect RectUnion(const WorldRect& a, const WorldRect& b)
+{
+    return WorldRect{
+        a.minX < b.minX ? a.minX : b.minX, a.minY < b.minY ? a.minY : b.minY,
+        a.maxX > b.maxX ? a.maxX : b.maxX, a.maxY > b.maxY ? a.maxY : b.maxY };
+}
+
+inline bool RectsIntersect(const WorldRect& a, const WorldRect& b)
+{
+    return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY;
+}
+
+// Screen (client) space rectangle, right/bottom exclusive like a Win32 RECT
+struct ScreenRect {
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+};
+
+inline bool RectIsEmpty(const ScreenRect& r)
+{
+    return r.left >= r.right || r.top >= r.bottom;
+}
+
+inline int64_t RectArea(const ScreenRect& r)
+{
+    return RectIsEmpty(r) ? 0 : (int64_t)(r.right - r.left) * (r.bottom - r.top);
+}
+
+inline ScreenRect RectUnion(const ScreenRect& a, const ScreenRect& b)
+{
+    if (RectIsEmpty(a)) return b;
+    if (RectIsEmpty(b)) return a;
+    return ScreenRect{
+        a.left < b.left ? a.left : b.left, a.top < b.top ? a.top : b.top,
+        a.right > b.right ? a.right : b.right, a.bottom > b.bottom ? a.bottom : b.bottom };
+}
+
+inline ScreenRect RectIntersection(const ScreenRect& a, const ScreenRect& b)
+{
+    return ScreenRect{
+        a.left > b.left ? a.left : b.left, a.top > b.top ? a.top : b.top,
+        a.right < b.right ? a.right : b.right, a.bottom < b.bottom ? a.bottom : b.bottom };
+}
+
+// Screen space point, same layout as the Win32 POINT
+struct ScreenPoint {
+    int32_t x;
+    int32_t y;
+};
+
+// World -> screen mapping: screen = (int)(world * zoom) + pan.
+// panY already includes the toolbar margin.
+struct Camera {
+    double zoom = 1.0;
+    int32_t panX = 0;
+    int32_t panY = 0;
+};
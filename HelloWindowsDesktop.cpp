@@ -1,11 +1,34 @@
 ﻿#include <windows.h>
 #include <windowsx.h>
+#include <commdlg.h>
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <cstdio>
-#include <iostream>
-#include <sstream>
 #include <cmath>
 
+#include "BoundsTree.h"
+#include "DirtyRegion.h"
+#include "DisplayList.h"
+#include "FrameArena.h"
+#include "FramePacing.h"
+#include "LatencyStats.h"
+#include "Logger.h"
+#include "PolygonLod.h"
+#include "RegularPolygon.h"
+#include "SceneFile.h"
+#include "SceneHistory.h"
+#include "RenderLayers.h"
+#include "RenderThread.h"
+#include "SceneStore.h"
+#include "ShapePicking.h"
+#include "SnapFeatures.h"
+#include "SnapGrid.h"
+#include "SvgImport.h"
+#include "ThreadPool.h"
+#include "TileCache.h"
+#include "TileRasterizer.h"
+
 // -------------------- Globals --------------------
 HINSTANCE g_hInst = nullptr;                    // App instance handling the window
 
@@ -26,14 +49,15 @@ int g_panStartOffsetY = 0;
 bool g_hasHoverSnap = false;
 POINT g_hoverSnapWorld{};
 
-// --------- Shape definition (stored in WORLD coordinates) ---------
+// --------- Drawing tools (committed shapes are kept in a SceneStore) ---------
 enum Tool
 {
     TOOL_LINE = 0,
     TOOL_RECT,
     TOOL_ELLIPSE,
     TOOL_MULTILINE,
-    TOOL_POLIGON
+    TOOL_POLIGON,
+    TOOL_SELECT         // picks shapes instead of drawing them
 };
 
 Tool g_currentTool = TOOL_LINE;
@@ -44,21 +68,127 @@ Tool g_currentTool = TOOL_LINE;
 #define ID_TOOL_ELLIPSE 1003
 #define ID_TOOL_MULTILINE 1004
 #define ID_TOOL_POLIGON 1005
+#define ID_TOOL_SELECT  1006
 
 // Input Labels IDs
 #define ID_EDIT_SIDES 2001
 
 std::vector<POINT> g_points;
 
-// Basic shapes can be defined only by two points and the type of the shape
-struct Shape {
-    Tool type;
-    POINT p_init; // world coords (start)
-    POINT p_end; // world coords (end)
+// Basic shapes are defined by two points and the type of the shape,
+// multilines and poligons by their closed vertex list. Tool values match
+// the store's ShapeKind values.
+static_assert(sizeof(POINT) == sizeof(WorldPoint), "POINT and WorldPoint must share a layout");
+static_assert((int)TOOL_LINE == SHAPE_LINE && (int)TOOL_RECT == SHAPE_RECT && (int)TOOL_ELLIPSE == SHAPE_ELLIPSE &&
+    (int)TOOL_MULTILINE == SHAPE_MULTILINE && (int)TOOL_POLIGON == SHAPE_POLIGON, "Tool and ShapeKind must match");
+
+SceneStore g_scene;                             // All committed shapes (world coords)
+
+SnapGrid g_snapGrid;                            // Committed vertices, edge midpoints and crossings indexed for snapping
+SnapFeatureCache g_snapFeatures;                // edge midpoints and crossings of the committed shapes
+BoundsTree g_shapeTree;                         // Committed shape AABBs (by scene id) for viewport culling
+
+const PenStyle SHAPE_PEN{ 0, 0, 255, 2 };       // committed shapes: solid blue, 2px
+DisplayList g_displayList;                      // batched draw commands of the visible scene
+DisplayList g_overlayList;                      // batched draw commands of the selection overlay
+FrameArena g_frameArena;                        // paint-time temporaries, reset at every WM_PAINT
+PolygonLod g_polygonLod;                        // simplified copies of dense polygons for zoomed out views
+SceneHistory g_history;                         // undo / redo journal of scene edits
+
+// Mouse-move pipeline: newest cursor position only, at most one repaint per frame
+SteadyClock g_clock;
+MoveCoalescer g_moves;
+FrameScheduler g_frameScheduler(g_clock);
+const UINT_PTR FRAME_TIMER_ID = 1;              // fires when a deferred frame is due
+bool g_frameTimerArmed = false;
+
+// Latency instrumentation: WndProc dispatch time per message type and the
+// phases of WM_PAINT. F2 dumps the histograms to the log, F3 toggles the
+// on-screen stats overlay.
+enum LatencyChannel : size_t
+{
+    LATENCY_WM_PAINT = 0,
+    LATENCY_WM_MOUSEMOVE,
+    LATENCY_WM_MOUSEWHEEL,
+    LATENCY_WM_LBUTTONDOWN,
+    LATENCY_WM_LBUTTONUP,
+    LATENCY_WM_RBUTTON,
+    LATENCY_WM_KEYDOWN,
+    LATENCY_WM_KEYUP,
+    LATENCY_WM_TIMER,
+    LATENCY_WM_COMMAND,
+    LATENCY_WM_OTHER,
+    LATENCY_PAINT_SCENE,            // scene layer patch / re-render
+    LATENCY_PAINT_OVERLAY,          // scene copy + transient overlay
+    LATENCY_PAINT_PRESENT,          // blit to the window
+    LATENCY_CHANNEL_COUNT
 };
 
-std::vector<Shape> g_shapes;                    // Basic shapes
-std::vector<std::vector<POINT>> g_poligons;     // Poligons
+const char* const LATENCY_CHANNEL_NAMES[LATENCY_CHANNEL_COUNT] = {
+    "WM_PAINT", "WM_MOUSEMOVE", "WM_MOUSEWHEEL", "WM_LBUTTONDOWN", "WM_LBUTTONUP",
+    "WM_RBUTTON*", "WM_KEYDOWN", "WM_KEYUP", "WM_TIMER", "WM_COMMAND", "other",
+    "paint.scene", "paint.overlay", "paint.present"
+};
+
+LatencyRecorder g_latency(LATENCY_CHANNEL_NAMES, LATENCY_CHANNEL_COUNT);
+const UINT_PTR STATS_TIMER_ID = 2;              // refreshes the stats overlay
+const UINT STATS_REFRESH_MS = 500;
+const int STATS_LINE_HEIGHT = 16;
+const int STATS_WIDTH = 560;
+bool g_showStats = false;
+
+uint64_t g_sceneVersion = 0;                    // bumped on every scene edit
+
+// GDI backend for the render layers: a 32 bpp DIB selected into a memory DC
+struct GdiSurface {
+    HDC dc = nullptr;
+    HBITMAP bitmap = nullptr;
+    HBITMAP oldBitmap = nullptr;
+    uint32_t* bits = nullptr;                   // top-down 32 bit DIB section pixels
+    int width = 0;
+    int height = 0;
+
+    void Resize(int w, int h);
+    void Release();
+    void Scroll(int dx, int dy);
+    int Width() const { return width; }
+    int Height() const { return height; }
+};
+
+RetainedLayer<GdiSurface> g_sceneLayer;         // cached raster of all committed shapes
+GdiSurface g_frameSurface;                      // scene layer + overlay, blitted to the window
+
+// Fallback scene layer when painting on the UI thread (F5 off the render
+// thread): it is composed from a tile pyramid, so pans and wheel zooms reuse
+// rasterized tiles and edits only drop the tiles they touch; pans scroll
+// g_sceneLayer and only the exposed strips are composed. F4 switches to
+// drawing the scene directly with GDI. The render thread does not use the
+// pyramid, it scrolls its own retained frame instead (RenderThread::Render).
+TileCache g_tileCache;
+bool g_useTileCache = true;
+const size_t MAX_TILES_PER_PAINT = 24;          // the rest show stand-ins and are rendered on later frames
+std::vector<TileDraw> g_tileDraws;
+std::vector<TileKey> g_tilesMissing;
+ScreenRect g_pendingTileArea{ 0, 0, 0, 0 };     // screen area of tiles left for the next frame
+
+// The scene layer is rasterized on a render thread from published snapshots
+// of the scene and camera; WM_PAINT shows its newest frame, scaled and moved
+// to the current camera until the matching one arrives. Edits the shown frame
+// does not have yet are drawn over it with GDI. This is the default path;
+// F5 switches to painting on the UI thread with the tile pyramid above.
+RenderThread g_renderThread;
+bool g_useRenderThread = true;
+const UINT WM_APP_FRAME_READY = WM_APP + 1;    // posted by the render thread
+std::atomic<bool> g_frameReadyPosted{ false };  // one WM_APP_FRAME_READY in the queue at most
+LayerKey g_publishedKey{};
+bool g_hasPublished = false;
+uint64_t g_composedSerial = 0;                  // frame and key the scene layer surface shows
+LayerKey g_composedKey{};
+WorldRect g_renderLag{ 0, 0, -1, -1 };          // edits since the shown frame's scene version
+bool g_renderLagAll = false;                    // the whole scene was replaced, nothing to patch
+
+DirtyRegion g_dirty;                            // screen areas to invalidate on the next flush
+DirtyRegion g_sceneDirty;                       // screen areas of the scene layer made stale by edits
 
 // Current drawing state (left mouse)
 bool g_isDrawing = false;
@@ -66,6 +196,17 @@ POINT  g_polyCenterWorld{};
 POINT  g_polyEdgeWorld{};  // current mouse in world
 int    g_polySides = 5;    // example: pentagon
 double g_polyBaseAngle = 0.0; // orientation (radians)
+RegularPolygonCache g_polyPreview; // last generated regular polygon (preview and commit)
+
+// Selection state (select tool)
+const int PICK_TOLERANCE_PIXELS = 5;            // click distance to a shape outline
+const int BOX_SELECT_MIN_PIXELS = 3;            // smaller drags are clicks
+const PenStyle SELECTION_PEN{ 255, 140, 0, 2 }; // selected shapes: orange
+std::vector<uint32_t> g_selection;              // selected scene ids, ascending
+WorldRect g_selectionBounds{ 0, 0, -1, -1 };
+bool g_isBoxSelecting = false;
+ScreenPoint g_boxStart{};
+ScreenPoint g_boxEnd{};
 
 // Zoom state
 double g_zoom = 1.0;
@@ -76,16 +217,47 @@ HWND g_hBtnRect = nullptr;
 HWND g_hBtnEllipse = nullptr;
 HWND g_hBtnMultiLine = nullptr;
 HWND g_hBtnPoligon = nullptr;
+HWND g_hBtnSelect = nullptr;
 
 // Input handles
 HWND g_hEditSides = nullptr;        // input for g_polySides
 
 // -------------------- Forward declarations --------------------
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
-void printConsole(const std::ostringstream& oss);
+LRESULT HandleWindowMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 void printConsolePoints();
 bool getMouseWorldCoord(LPARAM lParam, POINT& out);
 bool FindSnapPoint(int mouseX, int mouseY, POINT& outWorld);
+void IndexShape(uint32_t id);
+void IndexSnapFeatures(uint32_t first);
+void UnindexShapes(const uint32_t* ids, size_t count);
+void IndexRestoredShapes(const uint32_t* ids, size_t count);
+uint32_t CommitShape(Tool type, const POINT* pts, size_t count);
+void RebuildSceneIndices();
+void SaveScene(HWND hwnd);
+void OpenScene(HWND hwnd);
+void ImportSvgScene(HWND hwnd);
+void ExportPng(HWND hwnd);
+ThreadPool& WorkerPool();
+void RecordShape(DisplayList& list, uint32_t id, int lodLevel);
+void RenderSceneLayer(HWND hwnd, GdiSurface& surface, const ScreenRect* clip);
+void RenderSceneTiles(GdiSurface& surface, const ScreenRect* clip);
+void ToggleTileCache(HWND hwnd);
+void ComposeRenderedScene(HWND hwnd, const LayerKey& key);
+void ToggleRenderThread(HWND hwnd);
+ScreenRect OverlayBounds();
+void FlushDirty(HWND hwnd);
+void RequestFrame(HWND hwnd);
+void InvalidateOverlay(HWND hwnd, const ScreenRect& before);
+void InvalidateAll(HWND hwnd);
+void UndoRedo(HWND hwnd, bool undo);
+ScreenRect SelectionBoxRect();
+void SetSelection(std::vector<uint32_t>&& ids);
+void FinishBoxSelection(HWND hwnd);
+void DeleteSelection(HWND hwnd);
+void DumpLatencyStats();
+void ToggleStatsOverlay(HWND hwnd);
+ScreenRect StatsOverlayBounds();
 
 // -------------------- WinMain --------------------
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
@@ -112,7 +284,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
         0,                                  // Extended window style
         CLASS_NAME,                         // pointer to the name of registered class
         L"Win32 + GDI - Toolbar Demo",      // pointer to window name
-        WS_OVERLAPPEDWINDOW,                // window style
+        WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN, // window style (children excluded from painting)
         CW_USEDEFAULT, CW_USEDEFAULT,       // horizontal and vertical window position
         800, 600,                           // width and height of window
         nullptr,                            // father window handler
@@ -128,7 +300,17 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
     FILE* fp;
     freopen_s(&fp, "CONOUT$", "w", stdout);
     freopen_s(&fp, "CONOUT$", "w", stderr);
-    std::cout << "Hello from console!\n";
+
+    // console output is written by the logger's drain thread, never by the UI thread
+    Logger::Instance().Start(stdout);
+    LOG_INFO("Hello from console!");
+
+    // the first WM_PAINT publishes the first snapshot
+    g_renderThread.Start(WorkerPool(), [hwnd]()
+        {
+            if (!g_frameReadyPosted.exchange(true))
+                PostMessage(hwnd, WM_APP_FRAME_READY, 0, 0);
+        });
 
     ShowWindow(hwnd, nCmdShow);
     UpdateWindow(hwnd);
@@ -140,6 +322,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
         DispatchMessage(&msg);
     }
 
+    Logger::Instance().Stop();
     return (int)msg.wParam;
 }
 
@@ -154,6 +337,7 @@ void UpdateWindowTitleWithTool(HWND hwnd)
         case TOOL_ELLIPSE: toolName = L"Ellipse"; break;
         case TOOL_MULTILINE: toolName = L"Multi Line"; break;
         case TOOL_POLIGON: toolName = L"Poligon"; break;
+        case TOOL_SELECT:  toolName = L"Select";  break;
     }
 
     wchar_t title[256];
@@ -177,6 +361,42 @@ void WorldToScreen(double wx, double wy, int& sx, int& sy)
     sy = (int)(wy * g_zoom) + g_panY + topMargin;
 }
 
+// Pixels added around screen areas so the 2px pen stroke of shapes sitting
+// right on their border is covered as well
+const int STROKE_MARGIN_PIXELS = 4;
+
+// World rectangle covered by a screen rectangle (grown by the stroke margin)
+WorldRect ScreenRectToWorld(const ScreenRect& r)
+{
+    double minX, minY, maxX, maxY;
+    ScreenToWorld(r.left - STROKE_MARGIN_PIXELS, r.top - STROKE_MARGIN_PIXELS, minX, minY);
+    ScreenToWorld(r.right + STROKE_MARGIN_PIXELS, r.bottom + STROKE_MARGIN_PIXELS, maxX, maxY);
+
+    return WorldRect{
+        (int32_t)std::floor(minX), (int32_t)std::floor(minY),
+        (int32_t)std::ceil(maxX), (int32_t)std::ceil(maxY) };
+}
+
+// Screen rectangle covering a world rectangle (grown by the stroke margin)
+ScreenRect WorldRectToScreen(const WorldRect& r)
+{
+    int left, top, right, bottom;
+    WorldToScreen(r.minX, r.minY, left, top);
+    WorldToScreen(r.maxX, r.maxY, right, bottom);
+
+    return ScreenRect{
+        left - STROKE_MARGIN_PIXELS, top - STROKE_MARGIN_PIXELS,
+        right + STROKE_MARGIN_PIXELS + 1, bottom + STROKE_MARGIN_PIXELS + 1 };
+}
+
+// Visible world rectangle of the client area
+WorldRect VisibleWorldRect(HWND hwnd)
+{
+    RECT client;
+    GetClientRect(hwnd, &client);
+    return ScreenRectToWorld(ScreenRect{ client.left, client.top, client.right, client.bottom });
+}
+
 // ---------------------- Helper: snapping ----------------------
 const int SNAP_RADIUS_PIXELS = 10; // how close (in screen pixels) to snap
 
@@ -201,29 +421,1017 @@ bool FindSnapPoint(int mouseX, int mouseY, POINT& outWorld)
             }
         };
 
-    // 1) Endpoints of basic shapes
-    for (const Shape& s : g_shapes)
+    // 1) Committed vertices, edge midpoints and edge crossings near the cursor.
+    //    One extra pixel absorbs the int truncation done by WorldToScreen.
+    const int reach = SNAP_RADIUS_PIXELS + 1;
+    double minX, minY, maxX, maxY;
+    ScreenToWorld(mouseX - reach, mouseY - reach, minX, minY);
+    ScreenToWorld(mouseX + reach, mouseY + reach, maxX, maxY);
+
+    g_snapGrid.ForEachInRect(
+        (int32_t)std::floor(minX), (int32_t)std::floor(minY),
+        (int32_t)std::ceil(maxX), (int32_t)std::ceil(maxY),
+        [&](const WorldPoint& wp)
+        {
+            POINT p{ wp.x, wp.y };
+            consider(p);
+        });
+
+    // 2) Current in-progress poly points (so you can snap to what's being built)
+    for (const POINT& p : g_points)
+        consider(p);
+
+    return found;
+}
+
+// ---------------------- Helper: commit shapes to the scene ----------------------
+// The edited world area has to be re-rendered into the scene layer and repainted
+void MarkSceneDirty(const WorldRect& box)
+{
+    ScreenRect r = WorldRectToScreen(box);
+    g_sceneDirty.Add(r);
+    g_dirty.Add(r);
+    g_tileCache.InvalidateWorldRect(box);
+    g_renderLag = g_renderLag.maxX < g_renderLag.minX ? box : RectUnion(g_renderLag, box);
+}
+
+// Add one stored shape to the snap grid, bounds tree and LOD levels
+void IndexShape(uint32_t id)
+{
+    const uint32_t offset = g_scene.Offset(id);
+    const uint32_t count = g_scene.Count(id);
+    if (count == 0)
+        return;
+
+    const int32_t* xs = g_scene.Xs() + offset;
+    const int32_t* ys = g_scene.Ys() + offset;
+
+    g_shapeTree.Insert(id, g_scene.Bounds(id));
+    for (uint32_t i = 0; i < count; ++i)
+        g_snapGrid.Insert(WorldPoint{ xs[i], ys[i] });
+
+    ShapeKind kind = g_scene.Kind(id);
+    if (kind == SHAPE_MULTILINE || kind == SHAPE_POLIGON)
+        g_polygonLod.Build(id, xs, ys, count);
+}
+
+// Snap grid entries for the cached midpoints / crossings from the given indices on
+void InsertSnapFeatures(size_t firstMidpoint, size_t firstCrossing)
+{
+    const std::vector<WorldPoint>& midpoints = g_snapFeatures.Midpoints();
+    const std::vector<WorldPoint>& crossings = g_snapFeatures.Crossings();
+
+    for (size_t i = firstMidpoint; i < midpoints.size(); ++i)
+        g_snapGrid.Insert(midpoints[i]);
+    for (size_t i = firstCrossing; i < crossings.size(); ++i)
+        g_snapGrid.Insert(crossings[i]);
+}
+
+// Shapes [first, end) were appended and indexed: find their midpoints and
+// crossings once, here, instead of on every mouse move
+void IndexSnapFeatures(uint32_t first)
+{
+    const size_t firstMidpoint = g_snapFeatures.Midpoints().size();
+    const size_t firstCrossing = g_snapFeatures.Crossings().size();
+
+    g_snapFeatures.AddShapes(g_scene, g_shapeTree, first);
+    InsertSnapFeatures(firstMidpoint, firstCrossing);
+}
+
+// The ascending ids are about to leave the scene (delete, redo of a delete,
+// undo of an append): take them out of every index while the scene still
+// holds them, and renumber the shapes after them the way the scene will
+void UnindexShapes(const uint32_t* ids, size_t count)
+{
+    std::vector<WorldPoint> dropped;
+    g_snapFeatures.RemoveShapes(g_scene, g_shapeTree, ids, count, dropped);
+    for (const WorldPoint& p : dropped)
+        g_snapGrid.Remove(p);
+
+    for (size_t i = 0; i < count; ++i)
     {
-        consider(s.p_init);
-        consider(s.p_end);
+        const uint32_t id = ids[i];
+        const uint32_t offset = g_scene.Offset(id);
+        for (uint32_t v = 0; v < g_scene.Count(id); ++v)
+            g_snapGrid.Remove(WorldPoint{ g_scene.Xs()[offset + v], g_scene.Ys()[offset + v] });
+        g_polygonLod.Remove(id);
+        if (g_scene.Count(id) > 0)
+            MarkSceneDirty(g_scene.Bounds(id));
     }
 
-    // 2) All vertices of stored polygons
-    for (const std::vector<POINT>& poly : g_poligons)
+    g_shapeTree.Remap([&](uint32_t id)
+        {
+            const uint32_t to = SceneStore::IdAfterExtract(ids, count, id);
+            return to == SceneStore::NO_ID ? BoundsTree::NO_ID : to;
+        });
+    g_polygonLod.Remap([&](uint32_t id) { return SceneStore::IdAfterExtract(ids, count, id); });
+    ++g_sceneVersion;
+}
+
+// The ascending ids were just put back into the scene (undo of a delete):
+// renumber the shapes they landed in front of, then index them like new ones
+void IndexRestoredShapes(const uint32_t* ids, size_t count)
+{
+    g_shapeTree.Remap([&](uint32_t id) { return SceneStore::IdAfterMerge(ids, count, id); });
+    g_polygonLod.Remap([&](uint32_t id) { return SceneStore::IdAfterMerge(ids, count, id); });
+
+    for (size_t i = 0; i < count; ++i)
     {
-        for (const POINT& p : poly)
-            consider(p);
+        IndexShape(ids[i]);
+        if (g_scene.Count(ids[i]) > 0)
+            MarkSceneDirty(g_scene.Bounds(ids[i]));
     }
 
-    // 3) Current in-progress poly points (so you can snap to what's being built)
-    for (const POINT& p : g_points)
-        consider(p);
+    const size_t firstMidpoint = g_snapFeatures.Midpoints().size();
+    const size_t firstCrossing = g_snapFeatures.Crossings().size();
+    g_snapFeatures.AddShapes(g_scene, g_shapeTree, ids, count);
+    InsertSnapFeatures(firstMidpoint, firstCrossing);
+    ++g_sceneVersion;
+}
 
-    return found;
+uint32_t CommitShape(Tool type, const POINT* pts, size_t count)
+{
+    const WorldPoint* wpts = reinterpret_cast<const WorldPoint*>(pts);
+    uint32_t id = g_scene.Append((ShapeKind)type, wpts, (uint32_t)count);
+    ++g_sceneVersion;
+
+    IndexShape(id);
+    IndexSnapFeatures(id);
+    if (count > 0)
+        MarkSceneDirty(g_scene.Bounds(id));
+
+    g_history.RecordAppend(id, 1);
+    return id;
+}
+
+// Rebuild every index derived from g_scene (after a load or a compaction)
+void RebuildSceneIndices()
+{
+    g_snapGrid.Clear();
+    g_shapeTree.Clear();
+    g_polygonLod.Clear();
+    g_selection.clear();        // ids may have shifted
+    g_selectionBounds = WorldRect{ 0, 0, -1, -1 };
+
+    for (uint32_t id = 0; id < (uint32_t)g_scene.ShapeCount(); ++id)
+        IndexShape(id);
+
+    // one sweep over every edge
+    g_snapFeatures.Rebuild(g_scene);
+    InsertSnapFeatures(0, 0);
+
+    ++g_sceneVersion;
+    g_sceneDirty.AddAll();
+    g_tileCache.Clear();
+}
+
+// ---------------------- Helper: scene files ----------------------
+const wchar_t SCENE_FILE_FILTER[] = L"Scene files (*.gdscene)\0*.gdscene\0All files (*.*)\0*.*\0";
+
+void SaveScene(HWND hwnd)
+{
+    wchar_t path[MAX_PATH] = L"";
+
+    OPENFILENAME ofn{};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFilter = SCENE_FILE_FILTER;
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"gdscene";
+    ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT;
+
+    if (!GetSaveFileName(&ofn))
+        return;
+
+    if (!SaveSceneFile(path, g_scene))
+    {
+        MessageBox(hwnd, L"Could not write the scene file.", L"Save scene", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    LOG_INFO("Saved " << (unsigned long long)g_scene.ShapeCount() << " shapes, "
+        << (unsigned long long)g_scene.VertexCount() << " vertices");
+}
+
+void OpenScene(HWND hwnd)
+{
+    wchar_t path[MAX_PATH] = L"";
+
+    OPENFILENAME ofn{};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFilter = SCENE_FILE_FILTER;
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST;
+
+    if (!GetOpenFileName(&ofn))
+        return;
+
+    // the mapped file is copied in bulk into a new store, the old scene
+    // stays in the history
+    SceneFileView view;
+    if (!view.Open(path))
+    {
+        MessageBox(hwnd, L"Not a valid scene file.", L"Open scene", MB_OK | MB_ICONERROR);
+        return;
+    }
+    SceneStore loaded;
+    view.CopyTo(loaded);
+    view.Close();
+    g_history.ReplaceScene(g_scene, std::move(loaded));
+
+    g_points.clear();
+    g_isDrawing = false;
+    g_hasHoverSnap = false;
+
+    RebuildSceneIndices();
+    InvalidateAll(hwnd);
+
+    LOG_INFO("Opened " << (unsigned long long)g_scene.ShapeCount() << " shapes, "
+        << (unsigned long long)g_scene.VertexCount() << " vertices");
+}
+
+// ---------------------- Helper: selection ----------------------
+// Dragged selection box, corners in any order -> exclusive screen rect
+ScreenRect SelectionBoxRect()
+{
+    ScreenRect r;
+    r.left = g_boxStart.x < g_boxEnd.x ? g_boxStart.x : g_boxEnd.x;
+    r.top = g_boxStart.y < g_boxEnd.y ? g_boxStart.y : g_boxEnd.y;
+    r.right = (g_boxStart.x < g_boxEnd.x ? g_boxEnd.x : g_boxStart.x) + 1;
+    r.bottom = (g_boxStart.y < g_boxEnd.y ? g_boxEnd.y : g_boxStart.y) + 1;
+    return r;
+}
+
+void SetSelection(std::vector<uint32_t>&& ids)
+{
+    g_selection = std::move(ids);
+    g_selectionBounds = WorldRect{ 0, 0, -1, -1 };
+
+    for (size_t i = 0; i < g_selection.size(); ++i)
+    {
+        WorldRect box = g_scene.Bounds(g_selection[i]);
+        g_selectionBounds = i == 0 ? box : RectUnion(g_selectionBounds, box);
+    }
+}
+
+// Mouse released: a click picks the nearest outline, a drag selects the
+// shapes completely inside the box
+void FinishBoxSelection(HWND hwnd)
+{
+    ScreenRect before = OverlayBounds();
+    g_isBoxSelecting = false;
+    ReleaseCapture();
+
+    std::vector<uint32_t> ids;
+    const ScreenRect drag = SelectionBoxRect();
+    if (drag.right - drag.left <= BOX_SELECT_MIN_PIXELS && drag.bottom - drag.top <= BOX_SELECT_MIN_PIXELS)
+    {
+        double wx, wy;
+        ScreenToWorld(g_boxStart.x, g_boxStart.y, wx, wy);
+        PickResult pick = PickShape(g_scene, g_shapeTree, wx, wy, PICK_TOLERANCE_PIXELS / g_zoom);
+        if (pick.hit)
+            ids.push_back(pick.id);
+    }
+    else
+    {
+        double x0, y0, x1, y1;
+        ScreenToWorld(drag.left, drag.top, x0, y0);
+        ScreenToWorld(drag.right - 1, drag.bottom - 1, x1, y1);
+        WorldRect box{ (int32_t)std::ceil(x0), (int32_t)std::ceil(y0), (int32_t)std::floor(x1), (int32_t)std::floor(y1) };
+        SelectInRect(g_scene, g_shapeTree, box, ids);
+    }
+
+    SetSelection(std::move(ids));
+    LOG_DEBUG("Selected " << (unsigned long long)g_selection.size() << " shapes");
+    InvalidateOverlay(hwnd, before);
+}
+
+void DeleteSelection(HWND hwnd)
+{
+    if (g_selection.empty())
+        return;
+
+    std::vector<uint32_t> ids = g_selection;
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    const ScreenRect before = OverlayBounds();
+    UnindexShapes(ids.data(), ids.size());
+    g_history.RemoveShapes(g_scene, ids.data(), ids.size());
+    SetSelection(std::vector<uint32_t>());
+    InvalidateOverlay(hwnd, before);
+
+    LOG_INFO("Deleted " << (unsigned long long)ids.size() << " shapes");
+}
+
+// ---------------------- Helper: undo / redo ----------------------
+// Only the shapes the step moves are (un)indexed; a scene swap rebuilds
+void UndoRedo(HWND hwnd, bool undo)
+{
+    HistoryChange change;
+    if (!(undo ? g_history.PeekUndo(change) : g_history.PeekRedo(change)))
+        return;
+
+    g_points.clear();
+    g_isDrawing = false;
+    g_hasHoverSnap = false;
+
+    // selected ids may shift
+    const ScreenRect before = OverlayBounds();
+    SetSelection(std::vector<uint32_t>());
+
+    // shapes about to leave the scene
+    std::vector<uint32_t> leaving;
+    if (change.kind == HISTORY_APPEND && change.undo)
+    {
+        leaving.resize(change.count);
+        for (uint32_t i = 0; i < change.count; ++i)
+            leaving[i] = change.first + i;
+    }
+    else if (change.kind == HISTORY_REMOVE && !change.undo)
+    {
+        leaving.assign(change.ids, change.ids + change.count);
+    }
+    if (!leaving.empty())
+        UnindexShapes(leaving.data(), leaving.size());
+
+    if (undo)
+        g_history.Undo(g_scene, &change);
+    else
+        g_history.Redo(g_scene, &change);
+
+    if (change.kind == HISTORY_APPEND && !change.undo)
+    {
+        // redone shapes are back at the tail: index just those
+        ++g_sceneVersion;
+        for (uint32_t id = change.first; id < change.first + change.count; ++id)
+        {
+            IndexShape(id);
+            if (g_scene.Count(id) > 0)
+                MarkSceneDirty(g_scene.Bounds(id));
+        }
+        IndexSnapFeatures(change.first);
+    }
+    else if (change.kind == HISTORY_REMOVE && change.undo)
+    {
+        IndexRestoredShapes(change.ids, change.count);
+    }
+    else if (change.kind == HISTORY_REPLACE)
+    {
+        RebuildSceneIndices();
+        g_dirty.AddAll();
+    }
+    InvalidateOverlay(hwnd, before);
+
+    LOG_DEBUG((undo ? "Undo" : "Redo") << ": " << (unsigned long long)g_history.UndoSteps() << " of "
+        << (unsigned long long)g_history.Steps() << " steps, "
+        << (unsigned long long)g_history.MemoryBytes() << " history bytes");
+}
+
+// Background workers for imports and exports, created on first use
+ThreadPool& WorkerPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+const wchar_t SVG_FILE_FILTER[] = L"SVG files (*.svg)\0*.svg\0All files (*.*)\0*.*\0";
+
+// Appends the shapes of an SVG file to the current scene
+void ImportSvgScene(HWND hwnd)
+{
+    wchar_t path[MAX_PATH] = L"";
+
+    OPENFILENAME ofn{};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFilter = SVG_FILE_FILTER;
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST;
+
+    if (!GetOpenFileName(&ofn))
+        return;
+
+    const uint32_t firstId = (uint32_t)g_scene.ShapeCount();
+    SvgImportStats stats;
+    if (!ImportSvg(path, g_scene, WorkerPool(), &stats))
+    {
+        MessageBox(hwnd, L"Could not read the SVG file.", L"Import SVG", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    // only the appended shapes need indexing
+    for (uint32_t id = firstId; id < (uint32_t)g_scene.ShapeCount(); ++id)
+        IndexShape(id);
+    IndexSnapFeatures(firstId);
+    g_history.RecordAppend(firstId, (uint32_t)g_scene.ShapeCount() - firstId);
+
+    ++g_sceneVersion;
+    g_sceneDirty.AddAll();
+    g_tileCache.Clear();
+    InvalidateAll(hwnd);
+
+    LOG_INFO("Imported " << (unsigned long long)stats.shapes << " shapes, "
+        << (unsigned long long)stats.vertices << " vertices from "
+        << (unsigned long long)stats.elements << " SVG elements ("
+        << (unsigned long long)stats.bytes << " bytes, " << WorkerPool().Size() << " threads)");
+}
+
+const wchar_t PNG_FILE_FILTER[] = L"PNG images (*.png)\0*.png\0All files (*.*)\0*.*\0";
+const int EXPORT_SCALE = 4;         // exported image: current view at 4x the window resolution
+
+void ExportPng(HWND hwnd)
+{
+    RECT rc;
+    GetClientRect(hwnd, &rc);
+    if (rc.right <= 0 || rc.bottom <= topMargin)
+        return;
+
+    wchar_t path[MAX_PATH] = L"";
+
+    OPENFILENAME ofn{};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFilter = PNG_FILE_FILTER;
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"png";
+    ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT;
+
+    if (!GetSaveFileName(&ofn))
+        return;
+
+    // the drawing area below the toolbar, scaled up
+    RasterOptions options;
+    options.width = (uint32_t)rc.right * EXPORT_SCALE;
+    options.height = (uint32_t)(rc.bottom - topMargin) * EXPORT_SCALE;
+    options.camera.zoom = g_zoom * EXPORT_SCALE;
+    options.camera.panX = g_panX * EXPORT_SCALE;
+    options.camera.panY = g_panY * EXPORT_SCALE;
+    options.pen = SHAPE_PEN;
+    options.background = 0x00FFFFFF;
+
+    RasterStats stats;
+    if (!ExportScenePng(path, g_scene, options, WorkerPool(), &stats))
+    {
+        MessageBox(hwnd, L"Could not write the PNG file.", L"Export PNG", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    LOG_INFO("Exported " << options.width << "x" << options.height << " PNG: " << stats.tiles << " tiles, raster "
+        << stats.rasterSeconds * 1000.0 << " ms, encode " << stats.encodeSeconds * 1000.0 << " ms");
+}
+
+// ---------------------- Helper: drawing ----------------------
+// GDI replay target for display lists
+class GdiDrawBackend : public DrawBackend
+{
+public:
+    explicit GdiDrawBackend(HDC hdc) : m_hdc(hdc)
+    {
+        m_oldBrush = (HBRUSH)SelectObject(m_hdc, GetStockObject(HOLLOW_BRUSH));
+    }
+
+    ~GdiDrawBackend() override
+    {
+        if (m_pen)
+        {
+            SelectObject(m_hdc, m_oldPen);
+            DeleteObject(m_pen);
+        }
+        SelectObject(m_hdc, m_oldBrush);
+    }
+
+    void SetPen(const PenStyle& pen) override
+    {
+        HPEN newPen = CreatePen(PS_SOLID, pen.width, RGB(pen.r, pen.g, pen.b));
+        HPEN prev = (HPEN)SelectObject(m_hdc, newPen);
+        if (m_pen)
+            DeleteObject(m_pen);
+        else
+            m_oldPen = prev;
+        m_pen = newPen;
+    }
+
+    void PolyPolyline(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount) override
+    {
+        ::PolyPolyline(m_hdc, reinterpret_cast<const POINT*>(pts), reinterpret_cast<const DWORD*>(counts), (DWORD)polyCount);
+    }
+
+    void PolyPolygon(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount) override
+    {
+        ::PolyPolygon(m_hdc, reinterpret_cast<const POINT*>(pts), reinterpret_cast<const int*>(counts), (int)polyCount);
+    }
+
+    void Ellipses(const ScreenPoint* corners, size_t ellipseCount) override
+    {
+        for (size_t i = 0; i < ellipseCount; ++i)
+            ::Ellipse(m_hdc, corners[2 * i].x, corners[2 * i].y, corners[2 * i + 1].x, corners[2 * i + 1].y);
+    }
+
+private:
+    HDC m_hdc;
+    HPEN m_pen = nullptr;
+    HPEN m_oldPen = nullptr;
+    HBRUSH m_oldBrush = nullptr;
+};
+
+Camera CurrentCamera()
+{
+    Camera cam;
+    cam.zoom = g_zoom;
+    cam.panX = g_panX;
+    cam.panY = g_panY + topMargin;
+    return cam;
+}
+
+// Add one committed shape to a display list. Dense polygons are taken from
+// the given level of detail (-1 = full geometry).
+void RecordShape(DisplayList& list, uint32_t id, int lodLevel)
+{
+    const uint32_t count = g_scene.Count(id);
+    if (count < 2)
+        return;
+
+    const int32_t* xs = g_scene.Xs() + g_scene.Offset(id);
+    const int32_t* ys = g_scene.Ys() + g_scene.Offset(id);
+    WorldPoint a{ xs[0], ys[0] };
+    WorldPoint b{ xs[1], ys[1] };
+
+    switch (g_scene.Kind(id))
+    {
+    case SHAPE_LINE:
+        list.AddLine(a, b);
+        break;
+
+    case SHAPE_RECT:
+        list.AddRect(a, b);
+        break;
+
+    case SHAPE_ELLIPSE:
+        list.AddEllipse(a, b);
+        break;
+
+    case SHAPE_MULTILINE:
+    case SHAPE_POLIGON: {
+        const int32_t* lodXs;
+        const int32_t* lodYs;
+        uint32_t lodCount;
+        if (g_polygonLod.Get(id, lodLevel, lodXs, lodYs, lodCount))
+            list.AddPolygon(lodXs, lodYs, lodCount);
+        else
+            list.AddPolygon(xs, ys, count);
+        break;
+    }
+    }
+}
+
+// ---------------------- Helper: render layers ----------------------
+void GdiSurface::Resize(int w, int h)
+{
+    if (dc && w == width && h == height)
+        return;
+
+    Release();
+
+    width = w > 0 ? w : 1;
+    height = h > 0 ? h : 1;
+
+    BITMAPINFO bmi{};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;               // top-down
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    void* pixels = nullptr;
+    dc = CreateCompatibleDC(nullptr);
+    bitmap = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &pixels, nullptr, 0);
+    oldBitmap = (HBITMAP)SelectObject(dc, bitmap);
+    bits = (uint32_t*)pixels;
+}
+
+// Moves the surface content in place (see ScrollPixels); GDI has to finish
+// any batched drawing into the DIB section first
+void GdiSurface::Scroll(int dx, int dy)
+{
+    if (!bits)
+        return;
+    GdiFlush();
+    ScrollPixels(bits, width, height, dx, dy);
+}
+
+void GdiSurface::Release()
+{
+    if (dc)
+    {
+        SelectObject(dc, oldBitmap);
+        DeleteObject(bitmap);
+        DeleteDC(dc);
+    }
+    dc = nullptr;
+    bitmap = nullptr;
+    oldBitmap = nullptr;
+    bits = nullptr;
+    width = 0;
+    height = 0;
+}
+
+// Draw every committed shape intersecting the view (or only the clip
+// rectangle when given) into the scene layer
+void RenderSceneLayer(HWND hwnd, GdiSurface& surface, const ScreenRect* clip)
+{
+    HDC hdc = surface.dc;
+    int savedDC = SaveDC(hdc);
+
+    RECT area{ 0, 0, surface.width, surface.height };
+    ScreenRect viewport{ 0, 0, surface.width, surface.height };
+    WorldRect view = VisibleWorldRect(hwnd);
+    if (clip)
+    {
+        SetRect(&area, clip->left, clip->top, clip->right, clip->bottom);
+        viewport = *clip;
+        IntersectClipRect(hdc, area.left, area.top, area.right, area.bottom);
+        view = ScreenRectToWorld(*clip);
+    }
+
+    FillRect(hdc, &area, GetSysColorBrush(COLOR_WINDOW));
+
+    // record only the shapes and polygons intersecting the view, then
+    // submit their visible parts as a few batched GDI calls
+    const int lodLevel = PolygonLod::SelectLevel(g_zoom);
+
+    g_displayList.Clear();
+    g_displayList.SetPen(SHAPE_PEN);
+    g_shapeTree.Query(view, [&](uint32_t id)
+        {
+            RecordShape(g_displayList, id, lodLevel);
+        });
+
+    {
+        GdiDrawBackend backend(hdc);
+        g_displayList.Replay(CurrentCamera(), viewport, backend, g_frameArena);
+    }
+
+    RestoreDC(hdc, savedDC);
+}
+
+// Scene layer composed from cached tiles at the nearest zoom level. Missing
+// tiles are rendered on the worker pool, at most MAX_TILES_PER_PAINT per
+// call; the others are covered by scaled tiles of neighbouring levels and
+// left in g_pendingTileArea for the next frame.
+void RenderSceneTiles(GdiSurface& surface, const ScreenRect* clip)
+{
+    HDC hdc = surface.dc;
+    int savedDC = SaveDC(hdc);
+
+    ScreenRect area{ 0, 0, surface.width, surface.height };
+    if (clip)
+    {
+        area = *clip;
+        IntersectClipRect(hdc, area.left, area.top, area.right, area.bottom);
+    }
+
+    RECT fill{ area.left, area.top, area.right, area.bottom };
+    FillRect(hdc, &fill, GetSysColorBrush(COLOR_WINDOW));
+
+    const COLORREF window = GetSysColor(COLOR_WINDOW);
+    g_tileCache.SetStyle(SHAPE_PEN, ((uint32_t)GetRValue(window) << 16) | ((uint32_t)GetGValue(window) << 8) | GetBValue(window));
+
+    const Camera cam = CurrentCamera();
+    g_tileCache.PlanView(cam, area, g_tileDraws, g_tilesMissing);
+    if (!g_tilesMissing.empty())
+    {
+        const size_t count = g_tilesMissing.size() < MAX_TILES_PER_PAINT ? g_tilesMissing.size() : MAX_TILES_PER_PAINT;
+        g_tileCache.RenderTiles(g_scene, g_shapeTree, WorkerPool(), g_tilesMissing.data(), count);
+
+        for (size_t i = count; i < g_tilesMissing.size(); ++i)
+            g_pendingTileArea = RectUnion(g_pendingTileArea, TileCache::TileScreenRect(cam, g_tilesMissing[i]));
+
+        // inserting may have evicted planned tiles: plan again
+        g_tileCache.PlanView(cam, area, g_tileDraws, g_tilesMissing);
+    }
+
+    BITMAPINFO bmi{};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = TileCache::TILE_SIZE;
+    bmi.bmiHeader.biHeight = -TileCache::TILE_SIZE;     // top-down
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    SetStretchBltMode(hdc, HALFTONE);
+    SetBrushOrgEx(hdc, 0, 0, nullptr);
+
+    // stand-ins first, the view's own tiles overdraw whatever they spill
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (const TileDraw& d : g_tileDraws)
+        {
+            if (d.standIn != (pass == 0))
+                continue;
+
+            StretchDIBits(hdc, d.dst.left, d.dst.top, d.dst.right - d.dst.left, d.dst.bottom - d.dst.top,
+                0, 0, TileCache::TILE_SIZE, TileCache::TILE_SIZE, d.tile->Data(), &bmi, DIB_RGB_COLORS, SRCCOPY);
+        }
+    }
+
+    RestoreDC(hdc, savedDC);
+}
+
+void ToggleTileCache(HWND hwnd)
+{
+    g_useTileCache = !g_useTileCache;
+    g_sceneLayer.Invalidate();
+    LOG_INFO("Scene layer: " << (g_useTileCache ? "tile cache" : "direct GDI"));
+    InvalidateAll(hwnd);
+}
+
+// Scene layer from the render thread: publish the current view when it
+// changed, then draw the newest finished frame into the layer surface
+void ComposeRenderedScene(HWND hwnd, const LayerKey& key)
+{
+    const COLORREF window = GetSysColor(COLOR_WINDOW);
+    const Camera cam = CurrentCamera();
+    if (!g_hasPublished || key != g_publishedKey)
+    {
+        g_renderThread.Publish(g_scene, key, cam, SHAPE_PEN,
+            ((uint32_t)GetRValue(window) << 16) | ((uint32_t)GetGValue(window) << 8) | GetBValue(window));
+        g_publishedKey = key;
+        g_hasPublished = true;
+    }
+
+    if (g_sceneDirty.IsAll())
+        g_renderLagAll = true;
+
+    g_renderThread.TakeFrame();
+    const RenderedFrame& frame = g_renderThread.Frame();
+
+    // overlay-only repaints keep what was composed last
+    if (frame.serial != 0 && frame.serial == g_composedSerial && key == g_composedKey && g_sceneDirty.IsEmpty())
+        return;
+    g_composedSerial = frame.serial;
+    g_composedKey = key;
+
+    GdiSurface& surface = g_sceneLayer.GetSurface();
+    surface.Resize(key.width, key.height);
+    HDC hdc = surface.dc;
+    int savedDC = SaveDC(hdc);
+
+    RECT all{ 0, 0, surface.width, surface.height };
+    FillRect(hdc, &all, GetSysColorBrush(COLOR_WINDOW));
+
+    if (frame.serial != 0 && frame.pixels.Width() > 0 && frame.pixels.Height() > 0)
+    {
+        // frame pixel f shows world (f - frame pan) / frame zoom, now at
+        // screen (f - frame pan) * zoom / frame zoom + pan
+        const double scale = cam.zoom / frame.camera.zoom;
+        const int x = (int)std::llround(cam.panX - frame.camera.panX * scale);
+        const int y = (int)std::llround(cam.panY - frame.camera.panY * scale);
+        const int w = (int)std::llround(frame.pixels.Width() * scale);
+        const int h = (int)std::llround(frame.pixels.Height() * scale);
+
+        BITMAPINFO bmi{};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = frame.pixels.Width();
+        bmi.bmiHeader.biHeight = -frame.pixels.Height();    // top-down
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        if (scale != 1.0)
+        {
+            SetStretchBltMode(hdc, HALFTONE);
+            SetBrushOrgEx(hdc, 0, 0, nullptr);
+        }
+        StretchDIBits(hdc, x, y, w, h, 0, 0, frame.pixels.Width(), frame.pixels.Height(),
+            frame.pixels.Data(), &bmi, DIB_RGB_COLORS, SRCCOPY);
+    }
+
+    // edits published but not in the frame yet
+    if (frame.serial != 0 && frame.key.sceneVersion == key.sceneVersion)
+    {
+        g_renderLag = WorldRect{ 0, 0, -1, -1 };
+        g_renderLagAll = false;
+    }
+    else if (!g_renderLagAll && g_renderLag.maxX >= g_renderLag.minX)
+    {
+        ScreenRect lag = RectIntersection(WorldRectToScreen(g_renderLag), ScreenRect{ 0, 0, key.width, key.height });
+        if (!RectIsEmpty(lag))
+            RenderSceneLayer(hwnd, surface, &lag);
+    }
+
+    RestoreDC(hdc, savedDC);
+    g_sceneDirty.Clear();
+}
+
+void ToggleRenderThread(HWND hwnd)
+{
+    g_useRenderThread = !g_useRenderThread;
+    g_sceneLayer.Invalidate();
+    g_hasPublished = false;
+    g_composedSerial = 0;
+    g_renderLag = WorldRect{ 0, 0, -1, -1 };
+    g_renderLagAll = false;
+    LOG_INFO("Scene layer: " << (g_useRenderThread ? "render thread" : "UI thread"));
+    InvalidateAll(hwnd);
+}
+
+// ---------------------- Helper: invalidation ----------------------
+// Screen area covered by the hover snap circle and the in-progress preview
+ScreenRect OverlayBounds()
+{
+    ScreenRect bounds{ 0, 0, 0, 0 };
+
+    if (g_hasHoverSnap)
+    {
+        int sx, sy;
+        WorldToScreen(g_hoverSnapWorld.x, g_hoverSnapWorld.y, sx, sy);
+        const int r = 6 + 2;    // snap circle radius + pen
+        bounds = ScreenRect{ sx - r, sy - r, sx + r + 1, sy + r + 1 };
+    }
+
+    if (g_isDrawing && g_points.size() > 1)
+    {
+        WorldRect box{ g_points[0].x, g_points[0].y, g_points[0].x, g_points[0].y };
+
+        if (g_currentTool == TOOL_POLIGON)
+        {
+            // regular polygon preview is inscribed in the circle drawn around it
+            double dx = g_points[1].x - g_points[0].x;
+            double dy = g_points[1].y - g_points[0].y;
+            int32_t r = (int32_t)std::ceil(std::sqrt(dx * dx + dy * dy)) + 1;
+            box = WorldRect{ g_points[0].x - r, g_points[0].y - r, g_points[0].x + r, g_points[0].y + r };
+        }
+        else
+        {
+            for (const POINT& p : g_points)
+                RectInclude(box, WorldPoint{ p.x, p.y });
+        }
+
+        bounds = RectUnion(bounds, WorldRectToScreen(box));
+    }
+
+    if (!g_selection.empty())
+        bounds = RectUnion(bounds, WorldRectToScreen(g_selectionBounds));
+
+    if (g_isBoxSelecting)
+    {
+        ScreenRect box = SelectionBoxRect();
+        bounds = RectUnion(bounds, ScreenRect{ box.left - 1, box.top - 1, box.right + 1, box.bottom + 1 });
+    }
+
+    return bounds;
+}
+
+void FlushDirty(HWND hwnd)
+{
+    if (g_dirty.IsAll())
+    {
+        InvalidateRect(hwnd, nullptr, FALSE);
+    }
+    else
+    {
+        for (const ScreenRect& r : g_dirty.Rects())
+        {
+            RECT rc{ r.left, r.top, r.right, r.bottom };
+            InvalidateRect(hwnd, &rc, FALSE);
+        }
+    }
+    g_dirty.Clear();
+}
+
+// Queue a repaint of what the overlay covered before a state change and
+// covers now, plus any scene edits made in between
+void InvalidateOverlay(HWND hwnd, const ScreenRect& before)
+{
+    g_dirty.Add(before);
+    g_dirty.Add(OverlayBounds());
+    FlushDirty(hwnd);
+}
+
+// Paced invalidation for high rate input: g_dirty is flushed now if the
+// frame slot is free, otherwise when the frame timer fires
+void RequestFrame(HWND hwnd)
+{
+    if (g_frameScheduler.Request())
+    {
+        FlushDirty(hwnd);
+        return;
+    }
+
+    if (!g_frameTimerArmed)
+    {
+        UINT delayMs = (UINT)((g_frameScheduler.MicrosUntilDue() + 999) / 1000);
+        SetTimer(hwnd, FRAME_TIMER_ID, delayMs, nullptr);
+        g_frameTimerArmed = true;
+    }
+}
+
+// Camera changes move every pixel
+void InvalidateAll(HWND hwnd)
+{
+    g_dirty.AddAll();
+    FlushDirty(hwnd);
+}
+
+// -------------------- Latency stats --------------------
+size_t LatencyChannelOf(UINT msg)
+{
+    switch (msg)
+    {
+        case WM_PAINT:          return LATENCY_WM_PAINT;
+        case WM_MOUSEMOVE:      return LATENCY_WM_MOUSEMOVE;
+        case WM_MOUSEWHEEL:     return LATENCY_WM_MOUSEWHEEL;
+        case WM_LBUTTONDOWN:    return LATENCY_WM_LBUTTONDOWN;
+        case WM_LBUTTONUP:      return LATENCY_WM_LBUTTONUP;
+        case WM_RBUTTONDOWN:
+        case WM_RBUTTONUP:      return LATENCY_WM_RBUTTON;
+        case WM_KEYDOWN:        return LATENCY_WM_KEYDOWN;
+        case WM_KEYUP:          return LATENCY_WM_KEYUP;
+        case WM_TIMER:          return LATENCY_WM_TIMER;
+        case WM_COMMAND:        return LATENCY_WM_COMMAND;
+        default:                return LATENCY_WM_OTHER;
+    }
+}
+
+void DumpLatencyStats()
+{
+    char line[160];
+    LOG_INFO("Latency (dispatch per message type, WM_PAINT phases):");
+    for (size_t i = 0; i < g_latency.ChannelCount(); ++i)
+    {
+        if (g_latency.Histogram(i).Count() == 0)
+            continue;
+        g_latency.FormatChannel(i, line, sizeof(line));
+        LOG_INFO("  " << line);
+    }
+}
+
+// Top left corner of the client area, below the toolbar
+ScreenRect StatsOverlayBounds()
+{
+    if (!g_showStats)
+        return ScreenRect{ 0, 0, 0, 0 };
+
+    const int top = topMargin + 4;
+    return ScreenRect{ 4, top, 4 + STATS_WIDTH, top + (int)LATENCY_CHANNEL_COUNT * STATS_LINE_HEIGHT + 8 };
+}
+
+void ToggleStatsOverlay(HWND hwnd)
+{
+    if (g_showStats)
+    {
+        g_dirty.Add(StatsOverlayBounds());
+        g_showStats = false;
+        KillTimer(hwnd, STATS_TIMER_ID);
+    }
+    else
+    {
+        g_showStats = true;
+        g_dirty.Add(StatsOverlayBounds());
+        SetTimer(hwnd, STATS_TIMER_ID, STATS_REFRESH_MS, nullptr);
+    }
+    FlushDirty(hwnd);
+}
+
+void DrawStatsOverlay(HDC hdc)
+{
+    const ScreenRect bounds = StatsOverlayBounds();
+    RECT rc{ bounds.left, bounds.top, bounds.right, bounds.bottom };
+    FillRect(hdc, &rc, (HBRUSH)GetStockObject(WHITE_BRUSH));
+    FrameRect(hdc, &rc, (HBRUSH)GetStockObject(GRAY_BRUSH));
+
+    HFONT prevFont = (HFONT)SelectObject(hdc, GetStockObject(ANSI_FIXED_FONT));
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, RGB(0, 0, 0));
+
+    char line[160];
+    for (size_t i = 0; i < g_latency.ChannelCount(); ++i)
+    {
+        size_t len = g_latency.FormatChannel(i, line, sizeof(line));
+        TextOutA(hdc, bounds.left + 4, bounds.top + 4 + (int)i * STATS_LINE_HEIGHT, line, (int)len);
+    }
+    SelectObject(hdc, prevFont);
 }
 
 // -------------------- WndProc --------------------
+// Times every dispatch into the per-message histograms. Messages sent while
+// another is being handled are counted in both.
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    const uint64_t start = LatencyNowNanos();
+    LRESULT result = HandleWindowMessage(hwnd, msg, wParam, lParam);
+    g_latency.Record(LatencyChannelOf(msg), LatencyNowNanos() - start);
+    return result;
+}
+
+LRESULT HandleWindowMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
     switch (msg)
     {
@@ -280,11 +1488,20 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 g_hInst,
                 nullptr);
 
+            g_hBtnSelect = CreateWindowEx(
+                0, L"BUTTON", L"Select",
+                WS_CHILD | WS_VISIBLE | BS_PUSHLIKE | BS_AUTORADIOBUTTON,
+                5 * btnWidth, y, btnWidth, btnHeight,
+                hwnd,
+                (HMENU)ID_TOOL_SELECT,
+                g_hInst,
+                nullptr);
+
             // Label "Sides"
             CreateWindowEx(
                 0, L"STATIC", L"Sides:",
                 WS_CHILD | WS_VISIBLE,
-                5 * btnWidth + 10, 8,   // x, y
+                6 * btnWidth + 10, 8,   // x, y
                 40, 20,                 // width, height
                 hwnd,
                 nullptr,
@@ -297,7 +1514,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 L"EDIT",
                 L"5",   // initial text
                 WS_CHILD | WS_VISIBLE | ES_NUMBER | ES_AUTOHSCROLL,
-                6 * btnWidth + 60, 5,   // x, y
+                7 * btnWidth + 60, 5,   // x, y
                 40, 20,                 // width, height
                 hwnd,
                 (HMENU)ID_EDIT_SIDES,
@@ -318,33 +1535,45 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
             if (wmEvent == BN_CLICKED)
             {
+                // the preview depends on the tool
+                ScreenRect before = OverlayBounds();
+
                 switch (wmId) {
                     case ID_TOOL_LINE:
                         g_currentTool = TOOL_LINE;
                         UpdateWindowTitleWithTool(hwnd);
-                        InvalidateRect(hwnd, nullptr, TRUE);
+                        InvalidateOverlay(hwnd, before);
                         break;
 
                     case ID_TOOL_RECT:
                         g_currentTool = TOOL_RECT;
                         UpdateWindowTitleWithTool(hwnd);
-                        InvalidateRect(hwnd, nullptr, TRUE);
+                        InvalidateOverlay(hwnd, before);
                         break;
 
                     case ID_TOOL_ELLIPSE:
                         g_currentTool = TOOL_ELLIPSE;
                         UpdateWindowTitleWithTool(hwnd);
-                        InvalidateRect(hwnd, nullptr, TRUE);
+                        InvalidateOverlay(hwnd, before);
                         break;
                     case ID_TOOL_MULTILINE:
                         g_currentTool = TOOL_MULTILINE;
                         UpdateWindowTitleWithTool(hwnd);
-                        InvalidateRect(hwnd, nullptr, TRUE);
+                        InvalidateOverlay(hwnd, before);
                         break;
                     case ID_TOOL_POLIGON:
                         g_currentTool = TOOL_POLIGON;
                         UpdateWindowTitleWithTool(hwnd);
-                        InvalidateRect(hwnd, nullptr, TRUE);
+                        InvalidateOverlay(hwnd, before);
+                        break;
+                    case ID_TOOL_SELECT:
+                        // a shape in progress cannot be committed as a selection
+                        g_points.clear();
+                        g_isDrawing = false;
+                        g_hasHoverSnap = false;
+                        g_currentTool = TOOL_SELECT;
+                        UpdateWindowTitleWithTool(hwnd);
+                        InvalidateOverlay(hwnd, before);
                         break;
 
                 }
@@ -366,8 +1595,8 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                         int value = _wtoi(buf);
 
                         // clamp to a sensible range (at least triangle)
-                        if (value < 3)  value = 3;
-                        if (value > 64) value = 64;
+                        if (value < MIN_POLY_SIDES) value = MIN_POLY_SIDES;
+                        if (value > MAX_POLY_SIDES) value = MAX_POLY_SIDES;
 
                         g_polySides = value;
 
@@ -384,22 +1613,59 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
 
         case WM_KEYDOWN: {
-            if (wParam == 'E') {
+            if (GetKeyState(VK_CONTROL) < 0) {
+                // Ctrl+S / Ctrl+O: save / open the scene, Ctrl+I: import SVG, Ctrl+E: export PNG
+                // Ctrl+Z / Ctrl+Y: undo / redo
+                if (wParam == 'S')
+                    SaveScene(hwnd);
+                else if (wParam == 'O')
+                    OpenScene(hwnd);
+                else if (wParam == 'I')
+                    ImportSvgScene(hwnd);
+                else if (wParam == 'E')
+                    ExportPng(hwnd);
+                else if (wParam == 'Z')
+                    UndoRedo(hwnd, true);
+                else if (wParam == 'Y')
+                    UndoRedo(hwnd, false);
+                return 0;
+            }
+
+            if (wParam == 'E' && g_currentTool != TOOL_SELECT) {
                 // Start drawing a new shape
                 g_isDrawing = true;
             }
+            else if (wParam == VK_DELETE) {
+                DeleteSelection(hwnd);
+            }
+            else if (wParam == VK_F2) {
+                DumpLatencyStats();
+            }
+            else if (wParam == VK_F3) {
+                ToggleStatsOverlay(hwnd);
+            }
+            else if (wParam == VK_F4) {
+                ToggleTileCache(hwnd);
+            }
+            else if (wParam == VK_F5) {
+                ToggleRenderThread(hwnd);
+            }
             return 0;
         }
 
         case WM_KEYUP: {
             if (wParam == 'E') {
+                ScreenRect before = OverlayBounds();
+
                 // End drawing a new shape
                 //ReleaseCapture();                     // Release mouse capture
                 g_isDrawing = false;
                 g_hasHoverSnap = false;
 
-                if (g_points.size() == 0)
+                if (g_points.size() == 0) {
+                    InvalidateOverlay(hwnd, before);
                     return 0;
+                }
 
                 if (g_points.size() == 1) {
                     POINT tmp_p = g_points[0];
@@ -407,54 +1673,42 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 }
 
                 if (g_currentTool == TOOL_MULTILINE) {
-                    g_poligons.push_back(g_points);
+                    CommitShape(TOOL_MULTILINE, g_points.data(), g_points.size());
                 }
+                else if (g_currentTool == TOOL_POLIGON) {
+                    // Create poligon setpoint (usually already generated by the preview)
+                    WorldPoint center{ g_points[0].x, g_points[0].y };
+                    WorldPoint edge{ g_points[1].x, g_points[1].y };
+                    g_polyPreview.Update(center, edge, g_polySides);
 
-                if (g_currentTool == TOOL_POLIGON) {
-                    // Create poligon setpoint
-                    double dx = g_points[1].x - g_points[0].x;
-                    double dy = g_points[1].y - g_points[0].y;
-                    double r = std::sqrt(dx * dx + dy * dy);
-
-                    // angle step
-                    double dtheta = 2.0 * 3.1415 / g_polySides;
-
-                    g_polyBaseAngle = std::atan2(dy, dx);
-
-                    std::vector<POINT> regPolygonPreview;
-
-                    for (int i = 0; i < g_polySides; ++i) {
-                        double theta = g_polyBaseAngle + i * dtheta;
-                        double wx = g_points[0].x + r * std::cos(theta);
-                        double wy = g_points[0].y + r * std::sin(theta);
-
-                        POINT w{};
-                        w.x = (LONG)wx;
-                        w.y = (LONG)wy;
-                        regPolygonPreview.push_back(w);
-                    }
-
-                    regPolygonPreview.push_back(regPolygonPreview.front());
+                    g_polyBaseAngle = std::atan2((double)edge.y - center.y, (double)edge.x - center.x);
 
-                    g_poligons.push_back(regPolygonPreview);
+                    CommitShape(TOOL_POLIGON, reinterpret_cast<const POINT*>(g_polyPreview.Points()), g_polyPreview.Count());
                 }
                 else {
-                    Shape s{};
-                    s.type = g_currentTool;
-                    s.p_init = g_points[0];
-                    s.p_end = g_points[1];
-
-                    g_shapes.push_back(s);
+                    // basic shapes keep the two last clicked points
+                    CommitShape(g_currentTool, g_points.data(), 2);
                 }
                 g_points.clear();
-                InvalidateRect(hwnd, nullptr, TRUE);
+                InvalidateOverlay(hwnd, before);
             }
             return 0;
         }
 
         case WM_LBUTTONDOWN:
         {
+            if (!g_isDrawing && g_currentTool == TOOL_SELECT && GET_Y_LPARAM(lParam) >= topMargin) {
+                // Click or box drag, resolved on release
+                g_isBoxSelecting = true;
+                g_boxStart = ScreenPoint{ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) };
+                g_boxEnd = g_boxStart;
+                SetCapture(hwnd);
+                return 0;
+            }
+
             if (g_isDrawing) {
+                ScreenRect before = OverlayBounds();
+
                 POINT tmp_pnt;
                 if (!getMouseWorldCoord(lParam, tmp_pnt)) {
                     return 0;
@@ -469,9 +1723,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 if (FindSnapPoint(sx, sy, snappedWorld))
                 {
                     tmp_pnt = snappedWorld;
-                    /*std::ostringstream oss;
-                    oss << "Snapped to existing point: x=" << tmp_pnt.x << ", y=" << tmp_pnt.y << "\n";
-                    printConsole(oss);*/
+                    //LOG_DEBUG("Snapped to existing point: x=" << tmp_pnt.x << ", y=" << tmp_pnt.y);
                 }
 
                 if (g_currentTool == TOOL_MULTILINE) {
@@ -503,14 +1755,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                             }
                         }
 
-                        g_poligons.push_back(poly);
+                        CommitShape(TOOL_MULTILINE, poly.data(), poly.size());
 
                         // reset drawing state
                         g_points.clear();
                         g_isDrawing = false;
                         g_hasHoverSnap = false;
 
-                        InvalidateRect(hwnd, nullptr, TRUE);
+                        InvalidateOverlay(hwnd, before);
                         return 0;
                     }
                     else {
@@ -529,7 +1781,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 }
 
                 printConsolePoints();
-                InvalidateRect(hwnd, nullptr, TRUE);
+                InvalidateOverlay(hwnd, before);
             }
 
             //SetCapture(hwnd); // capture mouse while drawing (keep getting mouse move events while dragging)
@@ -553,7 +1805,10 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
         case WM_LBUTTONUP:
         {
-            // Implement mouse left click button release trigger
+            if (g_isBoxSelecting) {
+                g_boxEnd = ScreenPoint{ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) };
+                FinishBoxSelection(hwnd);
+            }
             return 0;
         }
 
@@ -569,8 +1824,20 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
         case WM_MOUSEMOVE:
         {
-            int sx = GET_X_LPARAM(lParam);
-            int sy = GET_Y_LPARAM(lParam);
+            // Moves queued right behind this one are folded in, only the
+            // newest position is acted on. The fold stops at the first other
+            // message, so a click is never handled after a later move.
+            g_moves.Push(ScreenPoint{ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) });
+            MSG next;
+            while (PeekMessage(&next, hwnd, 0, 0, PM_NOREMOVE) && next.message == WM_MOUSEMOVE &&
+                PeekMessage(&next, hwnd, WM_MOUSEMOVE, WM_MOUSEMOVE, PM_REMOVE))
+                g_moves.Push(ScreenPoint{ GET_X_LPARAM(next.lParam), GET_Y_LPARAM(next.lParam) });
+
+            ScreenPoint cursor;
+            if (!g_moves.Take(cursor))
+                return 0;
+            int sx = cursor.x;
+            int sy = cursor.y;
 
             if (g_isPanning)
             {
@@ -580,13 +1847,25 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 g_panX = g_panStartOffsetX + dx;
                 g_panY = g_panStartOffsetY + dy;
 
-                InvalidateRect(hwnd, nullptr, TRUE);
+                g_dirty.AddAll();
+                RequestFrame(hwnd);
+                return 0;
+            }
+
+            if (g_isBoxSelecting)
+            {
+                g_dirty.Add(OverlayBounds());
+                g_boxEnd = cursor;
+                g_dirty.Add(OverlayBounds());
+                RequestFrame(hwnd);
                 return 0;
             }
 
             // Hover snap
             if (g_isDrawing)
             {
+                ScreenRect before = OverlayBounds();
+
                 POINT snapWorld;
                 if (FindSnapPoint(sx, sy, snapWorld))
                 {
@@ -598,12 +1877,41 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                     g_hasHoverSnap = false;
                 }
 
-                InvalidateRect(hwnd, nullptr, TRUE); // redraw to show/hide circle
+                // redraw to show/hide circle, paced to the frame rate
+                g_dirty.Add(before);
+                g_dirty.Add(OverlayBounds());
+                RequestFrame(hwnd);
             }
 
             return 0;
         }
 
+        case WM_TIMER:
+        {
+            if (wParam == STATS_TIMER_ID)
+            {
+                g_dirty.Add(StatsOverlayBounds());
+                FlushDirty(hwnd);
+                return 0;
+            }
+
+            if (wParam != FRAME_TIMER_ID)
+                break;
+
+            if (g_frameScheduler.TakeDue())
+            {
+                KillTimer(hwnd, FRAME_TIMER_ID);
+                g_frameTimerArmed = false;
+                FlushDirty(hwnd);
+            }
+            else if (!g_frameScheduler.HasPending())
+            {
+                KillTimer(hwnd, FRAME_TIMER_ID);
+                g_frameTimerArmed = false;
+            }
+            return 0;
+        }
+
         case WM_MOUSEWHEEL:
         {
             int delta = GET_WHEEL_DELTA_WPARAM(wParam); // positive = wheel up
@@ -642,7 +1950,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 g_zoom = newZoom;
 
                 UpdateWindowTitleWithTool(hwnd);
-                InvalidateRect(hwnd, nullptr, TRUE);
+                InvalidateAll(hwnd);
             }
             return 0;
         }
@@ -650,57 +1958,111 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         case WM_PAINT:
         {
             PAINTSTRUCT ps;
-            HDC hdc = BeginPaint(hwnd, &ps);
-
-            // ---- Draw all stored shapes ----
-            HPEN hPen = CreatePen(PS_SOLID, 2, RGB(0, 0, 255));
-            HBRUSH hBr = (HBRUSH)GetStockObject(HOLLOW_BRUSH);
-            HPEN oldPen = (HPEN)SelectObject(hdc, hPen);
-            HBRUSH oldBr = (HBRUSH)SelectObject(hdc, hBr);
-
-            // draw shapes
-            for (const Shape& s : g_shapes)
+            HDC windowDC = BeginPaint(hwnd, &ps);
+            LatencySplit phases(g_latency);
+            g_frameArena.Reset();
+
+            RECT client;
+            GetClientRect(hwnd, &client);
+            const int width = client.right - client.left;
+            const int height = client.bottom - client.top;
+
+            // ---- Scene layer: re-rendered only when the scene or camera changed ----
+            LayerKey key;
+            key.sceneVersion = g_sceneVersion;
+            key.zoom = g_zoom;
+            key.panX = g_panX;
+            key.panY = g_panY;
+            key.width = width;
+            key.height = height;
+
+            if (g_useRenderThread)
             {
-                int sx1, sy1, sx2, sy2;
-                WorldToScreen(s.p_init.x, s.p_init.y, sx1, sy1);
-                WorldToScreen(s.p_end.x, s.p_end.y, sx2, sy2);
-
-                switch (s.type)
+                ComposeRenderedScene(hwnd, key);
+            }
+            else
+            {
+                // Scene edits with an unchanged camera only re-render the edited area
+                bool patched = false;
+                if (!g_sceneDirty.IsEmpty() && !g_sceneDirty.IsAll())
                 {
-                case TOOL_LINE:
-                    MoveToEx(hdc, sx1, sy1, nullptr);
-                    LineTo(hdc, sx2, sy2);
-                    break;
-
-                case TOOL_RECT:
-                    Rectangle(hdc, sx1, sy1, sx2, sy2);
-                    break;
-
-                case TOOL_ELLIPSE:
-                    Ellipse(hdc, sx1, sy1, sx2, sy2);
-                    break;
+                    ScreenRect sceneDirty = g_sceneDirty.Bounds();
+                    patched = g_sceneLayer.Patch(key, [&](GdiSurface& surface)
+                        {
+                            if (g_useTileCache)
+                                RenderSceneTiles(surface, &sceneDirty);
+                            else
+                                RenderSceneLayer(hwnd, surface, &sceneDirty);
+                        });
                 }
-            }
-
-            // draw polygons
-            for (const std::vector<POINT>& polyWorld : g_poligons) {
-                if (polyWorld.size() < 2)
-                    continue;
 
-                // build a screen-space copy
-                std::vector<POINT> polyScreen;
-                polyScreen.resize(polyWorld.size());
+                // Pans move the pixels already rendered and only draw the exposed
+                // strips; areas left stale by edits or pending tiles move along and
+                // are redrawn at their new place
+                if (!patched && !g_sceneDirty.IsAll())
+                {
+                    const LayerKey previous = g_sceneLayer.Key();
+                    patched = g_sceneLayer.Scroll(key, [&](GdiSurface& surface, const ScreenRect& strip)
+                        {
+                            if (g_useTileCache)
+                                RenderSceneTiles(surface, &strip);
+                            else
+                                RenderSceneLayer(hwnd, surface, &strip);
+                        });
+
+                    if (patched && !g_sceneDirty.IsEmpty())
+                    {
+                        ScreenRect moved = g_sceneDirty.Bounds();
+                        const int32_t dx = key.panX - previous.panX;
+                        const int32_t dy = key.panY - previous.panY;
+                        moved = ScreenRect{ moved.left + dx, moved.top + dy, moved.right + dx, moved.bottom + dy };
+                        moved = RectIntersection(moved, ScreenRect{ 0, 0, width, height });
+                        if (!RectIsEmpty(moved))
+                        {
+                            if (g_useTileCache)
+                                RenderSceneTiles(g_sceneLayer.GetSurface(), &moved);
+                            else
+                                RenderSceneLayer(hwnd, g_sceneLayer.GetSurface(), &moved);
+                        }
+                    }
+                }
 
-                for (size_t i = 0; i < polyWorld.size(); ++i)
+                if (!patched)
                 {
-                    int sx, sy;
-                    WorldToScreen(polyWorld[i].x, polyWorld[i].y, sx, sy);
-                    polyScreen[i].x = sx;
-                    polyScreen[i].y = sy;
+                    g_sceneLayer.Update(key, [&](GdiSurface& surface)
+                        {
+                            if (g_useTileCache)
+                                RenderSceneTiles(surface, nullptr);
+                            else
+                                RenderSceneLayer(hwnd, surface, nullptr);
+                        });
                 }
+                g_sceneDirty.Clear();
 
-                Polygon(hdc, polyScreen.data(), static_cast<int>(polyScreen.size()));
+                // tiles not rendered this frame: patch them in on the next one
+                if (!RectIsEmpty(g_pendingTileArea))
+                {
+                    g_sceneDirty.Add(g_pendingTileArea);
+                    g_dirty.Add(g_pendingTileArea);
+                    g_pendingTileArea = ScreenRect{ 0, 0, 0, 0 };
+                    RequestFrame(hwnd);
+                }
             }
+            phases.Mark(LATENCY_PAINT_SCENE);
+
+            // ---- Overlay: composed on a copy of the scene layer, only inside rcPaint ----
+            const RECT& rc = ps.rcPaint;
+            const int rcWidth = rc.right - rc.left;
+            const int rcHeight = rc.bottom - rc.top;
+
+            g_frameSurface.Resize(width, height);
+            HDC hdc = g_frameSurface.dc;
+            BitBlt(hdc, rc.left, rc.top, rcWidth, rcHeight, g_sceneLayer.GetSurface().dc, rc.left, rc.top, SRCCOPY);
+
+            HPEN hPen = CreatePen(PS_SOLID, 2, RGB(0, 0, 255));
+            HBRUSH hBr = (HBRUSH)GetStockObject(HOLLOW_BRUSH);
+            HPEN oldPen = (HPEN)SelectObject(hdc, hPen);
+            HBRUSH oldBr = (HBRUSH)SelectObject(hdc, hBr);
 
             // ---- Draw hover snap indicator ----
             if (g_hasHoverSnap)
@@ -725,6 +2087,29 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 DeleteObject(snapPen);
             }
 
+            // ---- Draw selected shapes and the selection box ----
+            if (!g_selection.empty())
+            {
+                g_overlayList.Clear();
+                g_overlayList.SetPen(SELECTION_PEN);
+                const int lodLevel = PolygonLod::SelectLevel(g_zoom);
+                for (uint32_t id : g_selection)
+                    RecordShape(g_overlayList, id, lodLevel);
+
+                GdiDrawBackend backend(hdc);
+                g_overlayList.Replay(CurrentCamera(), ScreenRect{ 0, 0, width, height }, backend, g_frameArena);
+            }
+
+            if (g_isBoxSelecting)
+            {
+                HPEN boxPen = CreatePen(PS_DOT, 1, RGB(96, 96, 96));
+                HPEN prevPen = (HPEN)SelectObject(hdc, boxPen);
+                ScreenRect box = SelectionBoxRect();
+                Rectangle(hdc, box.left, box.top, box.right, box.bottom);
+                SelectObject(hdc, prevPen);
+                DeleteObject(boxPen);
+            }
+
             // ---- Draw current in-progress shape (preview) ----
             if (g_isDrawing && g_points.size() > 1)
             {
@@ -747,8 +2132,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                         break;
 
                     case TOOL_MULTILINE: {
-                        std::vector<POINT> multiLine;
-                        multiLine.resize(g_points.size());
+                        POINT* multiLine = g_frameArena.AllocateArray<POINT>(g_points.size());
 
                         for (size_t i = 0; i < g_points.size(); ++i)
                         {
@@ -758,59 +2142,41 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                             multiLine[i].y = sy;
                         }
 
-                        Polygon(hdc, multiLine.data(), static_cast<int>(multiLine.size()));
+                        Polygon(hdc, multiLine, static_cast<int>(g_points.size()));
                         break;
                     }
                     case TOOL_POLIGON: {
-                        // Create poligon setpoint
-                        double dx = g_points[1].x - g_points[0].x;
-                        double dy = g_points[1].y - g_points[0].y;
-                        double r = std::sqrt(dx * dx + dy * dy);
-
-                        // angle step
-                        double dtheta = 2.0 * 3.1415 / g_polySides;
-
-                        std::vector<POINT> regPolygonPreview;
-                        //regPolygonPreview.reserve(g_polySides + 1);
-
-                        std::ostringstream sso;
-                        sso << "Index | Theta | wx | wy\n";
-
-                        g_polyBaseAngle = std::atan2(dy, dx);
-
-                        for (int i = 0; i < g_polySides; ++i) {
-                            double theta = g_polyBaseAngle + i * dtheta;
-                            double wx = g_points[0].x + r * std::cos(theta);
-                            double wy = g_points[0].y + r * std::sin(theta);
-
-                            sso << i << " | " << theta << " | " << wx << " | " << wy << "\n";
-                            
-                            POINT w{};
-                            w.x = (LONG)wx;
-                            w.y = (LONG)wy;
-                            regPolygonPreview.push_back(w);
+                        // Create poligon setpoint, reused while the mouse does not move
+                        WorldPoint center{ g_points[0].x, g_points[0].y };
+                        WorldPoint edge{ g_points[1].x, g_points[1].y };
+
+                        if (g_polyPreview.Update(center, edge, g_polySides)) {
+                            LOG_DEBUG("Index | wx | wy");
+                            for (int i = 0; i < g_polyPreview.Count() - 1; ++i) {
+                                const WorldPoint& w = g_polyPreview.Points()[i];
+                                LOG_DEBUG(i << " | " << w.x << " | " << w.y);
+                            }
                         }
 
-                        printConsole(sso);
-
-                        regPolygonPreview.push_back(regPolygonPreview.front());
-
-                        for (size_t i = 0; i < regPolygonPreview.size(); ++i)
+                        const int count = g_polyPreview.Count();
+                        POINT* regPolygonPreview = g_frameArena.AllocateArray<POINT>(count);
+                        for (int i = 0; i < count; ++i)
                         {
                             int sx, sy;
-                            WorldToScreen(regPolygonPreview[i].x, regPolygonPreview[i].y, sx, sy);
+                            WorldToScreen(g_polyPreview.Points()[i].x, g_polyPreview.Points()[i].y, sx, sy);
                             regPolygonPreview[i].x = sx;
                             regPolygonPreview[i].y = sy;
                         }
 
                         // create circle pointset
+                        const double r = g_polyPreview.Radius();
                         int left, top, right, botton;
                         WorldToScreen(g_points[0].x + r * -1.0, g_points[0].y + r * 1.0, left, top);
                         WorldToScreen(g_points[0].x + r * 1.0, g_points[0].y + r * -1.0, right, botton);
 
                         // Draw pilogon and cicle
                         Ellipse(hdc, left, top, right, botton);
-                        Polygon(hdc, regPolygonPreview.data(), static_cast<int>(regPolygonPreview.size()));
+                        Polygon(hdc, regPolygonPreview, count);
                         break;
                     }
                 }
@@ -821,11 +2187,58 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             SelectObject(hdc, oldBr);
             DeleteObject(hPen);
 
+            if (g_showStats)
+                DrawStatsOverlay(hdc);
+            phases.Mark(LATENCY_PAINT_OVERLAY);
+
+            BitBlt(windowDC, rc.left, rc.top, rcWidth, rcHeight, hdc, rc.left, rc.top, SRCCOPY);
+            phases.Mark(LATENCY_PAINT_PRESENT);
+
             EndPaint(hwnd, &ps);
             return 0;
         }
 
+        case WM_ERASEBKGND: {
+            // The whole client area is covered by the frame blit in WM_PAINT
+            return 1;
+        }
+
+        case WM_APP_FRAME_READY:
+        {
+            g_frameReadyPosted.store(false);
+            if (g_useRenderThread)
+            {
+                g_dirty.AddAll();
+                RequestFrame(hwnd);
+            }
+            return 0;
+        }
+
         case WM_DESTROY: {
+            g_renderThread.Stop();
+            KillTimer(hwnd, FRAME_TIMER_ID);
+            KillTimer(hwnd, STATS_TIMER_ID);
+            DumpLatencyStats();
+            LOG_INFO("Mouse moves: " << (unsigned long long)g_moves.Received() << " received, "
+                << (unsigned long long)g_moves.Merged() << " merged; frames: "
+                << (unsigned long long)g_frameScheduler.Requested() << " requested, "
+                << (unsigned long long)g_frameScheduler.Presented() << " presented, "
+                << (unsigned long long)g_frameScheduler.Merged() << " merged");
+
+            LOG_INFO("Tiles: " << (unsigned long long)g_tileCache.Rendered() << " rendered, "
+                << (unsigned long long)g_tileCache.Hits() << " hits, "
+                << (unsigned long long)g_tileCache.Misses() << " misses, "
+                << (unsigned long long)g_tileCache.Evictions() << " evicted, "
+                << (unsigned long long)g_tileCache.Invalidated() << " invalidated");
+
+            LOG_INFO("Render thread: " << (unsigned long long)g_renderThread.FramesRendered() << " frames, "
+                << (unsigned long long)g_renderThread.FramesScrolled() << " scrolled, "
+                << (unsigned long long)g_renderThread.SnapshotsSkipped() << " snapshots skipped, "
+                << (unsigned long long)g_renderThread.SceneCopies() << " scene copies, "
+                << (unsigned long long)g_renderThread.SceneShares() << " shared");
+
+            g_sceneLayer.GetSurface().Release();
+            g_frameSurface.Release();
             PostQuitMessage(0);
             return 0;
         }
@@ -833,27 +2246,18 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
     return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
-void printConsole(const std::ostringstream& oss) {
-    std::string msg = oss.str();
-    std::cout << msg;
-}
-
 void printConsolePoints() {
-    std::ostringstream oss;
-    oss << "----- g_points list -----\n";
+    LOG_DEBUG("----- g_points list -----");
     for (int i = 0; i < g_points.size(); i++) {
-        oss << "Point " << i << ": x->" << g_points[i].x << ", y->" << g_points[i].y << "\n";
+        LOG_DEBUG("Point " << i << ": x->" << g_points[i].x << ", y->" << g_points[i].y);
     }
-    printConsole(oss);
 }
 
 bool getMouseWorldCoord(LPARAM lParam, POINT& out) {
     int sx = GET_X_LPARAM(lParam);
     int sy = GET_Y_LPARAM(lParam);
 
-    std::ostringstream oss;
-    oss << "Screen coord: " << sx << " " << sy << "\n";
-    printConsole(oss);
+    LOG_DEBUG("Screen coord: " << sx << " " << sy);
 
     // Ignore clicks on toolbar area
     if (sy < topMargin) {
@@ -0,0 +1,137 @@
+#include "LatencyStats.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+
+uint32_t LatencyHistogram::BucketOf(uint64_t nanos)
+{
+    if (nanos > MAX_VALUE)
+        nanos = MAX_VALUE;
+
+    // Values below 2 * SUB_BUCKETS map 1:1, above that each power of two
+    // contributes SUB_BUCKETS buckets of width 2^shift
+    if (nanos < 2 * SUB_BUCKETS)
+        return (uint32_t)nanos;
+
+    const uint32_t msb = 63u - (uint32_t)std::countl_zero(nanos);
+    const uint32_t shift = msb - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + (uint32_t)(nanos >> shift) - SUB_BUCKETS;
+}
+
+uint64_t LatencyHistogram::BucketLow(uint32_t bucket)
+{
+    if (bucket < 2 * SUB_BUCKETS)
+        return bucket;
+
+    const uint32_t shift = bucket / SUB_BUCKETS - 1;
+    const uint64_t sub = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return sub << shift;
+}
+
+uint64_t LatencyHistogram::BucketHigh(uint32_t bucket)
+{
+    if (bucket < 2 * SUB_BUCKETS)
+        return bucket;
+
+    const uint32_t shift = bucket / SUB_BUCKETS - 1;
+    return BucketLow(bucket) + ((1ull << shift) - 1);
+}
+
+void LatencyHistogram::Record(uint64_t nanos)
+{
+    ++m_counts[BucketOf(nanos)];
+    ++m_count;
+    m_sum += nanos;
+    if (nanos < m_min)
+        m_min = nanos;
+    if (nanos > m_max)
+        m_max = nanos;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other)
+{
+    for (uint32_t i = 0; i < BUCKET_COUNT; ++i)
+        m_counts[i] += other.m_counts[i];
+
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    if (other.m_min < m_min)
+        m_min = other.m_min;
+    if (other.m_max > m_max)
+        m_max = other.m_max;
+}
+
+void LatencyHistogram::Reset()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = UINT64_MAX;
+    m_max = 0;
+}
+
+uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const
+{
+    if (m_count == 0)
+        return 0;
+
+    if (percentile < 0.0)
+        percentile = 0.0;
+    if (percentile > 100.0)
+        percentile = 100.0;
+
+    // Rank of the sample that has percentile% of the samples at or below it
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)m_count + 0.5);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += m_counts[i];
+        if (seen >= rank)
+        {
+            const uint64_t high = BucketHigh(i);
+            return high < m_max ? high : m_max;
+        }
+    }
+    return m_max;
+}
+
+uint64_t LatencyNowNanos()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+LatencyRecorder::LatencyRecorder(const char* const* names, size_t channelCount)
+    : m_names(names)
+    , m_channels(channelCount)
+{
+}
+
+void LatencyRecorder::Reset()
+{
+    for (LatencyHistogram& h : m_channels)
+        h.Reset();
+}
+
+size_t LatencyRecorder::FormatChannel(size_t channel, char* buf, size_t size) const
+{
+    if (size == 0)
+        return 0;
+
+    const LatencyHistogram& h = m_channels[channel];
+    int n = std::snprintf(buf, size, "%-16s n=%-8llu p50=%.3fms p99=%.3fms max=%.3fms",
+        m_names[channel],
+        (unsigned long long)h.Count(),
+        h.ValueAtPercentile(50.0) / 1e6,
+        h.ValueAtPercentile(99.0) / 1e6,
+        h.Max() / 1e6);
+
+    if (n < 0)
+        return 0;
+    return (size_t)n < size ? (size_t)n : size - 1;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// -------------------- Latency histograms --------------------
+// Log-linear (HDR style) histogram of durations in nanoseconds. Each power of
+// two range is split into SUB_BUCKETS linear buckets, so any recorded value
+// is reported within 1/SUB_BUCKETS (~3%) of its true value while the whole
+// range from 1 ns to ~36 minutes fits in a fixed array. Recording is a bit
+// scan and an increment: cheap enough to leave on in release builds.
+class LatencyHistogram
+{
+public:
+    static const uint32_t SUB_BITS = 5;
+    static const uint32_t SUB_BUCKETS = 1u << SUB_BITS;
+    static const uint32_t MAX_BIT = 41;                         // values are clamped below 2^MAX_BIT ns
+    static const uint64_t MAX_VALUE = (1ull << MAX_BIT) - 1;
+    static const uint32_t BUCKET_COUNT = (MAX_BIT - SUB_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram() : m_counts(BUCKET_COUNT, 0) {}
+
+    void Record(uint64_t nanos);
+    void Merge(const LatencyHistogram& other);
+    void Reset();
+
+    uint64_t Count() const { return m_count; }
+    uint64_t Min() const { return m_count ? m_min : 0; }
+    uint64_t Max() const { return m_max; }
+    double Mean() const { return m_count ? (double)m_sum / (double)m_count : 0.0; }
+
+    // Smallest bucket bound that at least percentile% of the samples fall at
+    // or below (never above Max). 0 when empty.
+    uint64_t ValueAtPercentile(double percentile) const;
+
+    static uint32_t BucketOf(uint64_t nanos);
+    static uint64_t BucketLow(uint32_t bucket);                 // smallest value in the bucket
+    static uint64_t BucketHigh(uint32_t bucket);                // largest value in the bucket
+
+private:
+    std::vector<uint64_t> m_counts;
+    uint64_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint64_t m_min = UINT64_MAX;
+    uint64_t m_max = 0;
+};
+
+// Monotonic nanoseconds (std::chrono::steady_clock)
+uint64_t LatencyNowNanos();
+
+// One histogram per named channel (a message type or a paint phase). Channel
+// names are owned by the caller and must outlive the recorder. Not thread
+// safe: every channel is recorded and read on the same (UI) thread.
+class LatencyRecorder
+{
+public:
+    LatencyRecorder(const char* const* names, size_t channelCount);
+
+    size_t ChannelCount() const { return m_channels.size(); }
+    const char* Name(size_t channel) const { return m_names[channel]; }
+    const LatencyHistogram& Histogram(size_t channel) const { return m_channels[channel]; }
+
+    void Record(size_t channel, uint64_t nanos) { m_channels[channel].Record(nanos); }
+    void Reset();
+
+    // "WM_PAINT n=120 p50=0.41ms p99=2.30ms max=5.12ms" into buf, returns the length
+    size_t FormatChannel(size_t channel, char* buf, size_t size) const;
+
+private:
+    const char* const* m_names;
+    std::vector<LatencyHistogram> m_channels;
+};
+
+// Times consecutive phases: each Mark records the time since the previous one
+class LatencySplit
+{
+public:
+    explicit LatencySplit(LatencyRecorder& recorder) : m_recorder(recorder), m_last(LatencyNowNanos()) {}
+
+    void Mark(size_t channel)
+    {
+        const uint64_t now = LatencyNowNanos();
+        m_recorder.Record(channel, now - m_last);
+        m_last = now;
+    }
+
+private:
+    LatencyRecorder& m_recorder;
+    uint64_t m_last;
+};
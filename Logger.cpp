@@ -0,0 +1,133 @@
+#include "Logger.h"
+
+#include <cstring>
+
+static_assert((Logger::SLOT_COUNT & (Logger::SLOT_COUNT - 1)) == 0, "SLOT_COUNT must be a power of two");
+
+Logger::~Logger()
+{
+    Stop();
+}
+
+Logger& Logger::Instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+void Logger::Start(FILE* sink)
+{
+    if (m_running.load())
+        return;
+
+    m_sink = sink;
+    m_running.store(true);
+    m_thread = std::thread(&Logger::DrainLoop, this);
+}
+
+void Logger::Stop()
+{
+    if (!m_running.exchange(false))
+        return;
+
+    m_signal.fetch_add(1);
+    m_signal.notify_one();
+    m_thread.join();
+}
+
+bool Logger::Push(LogLevel level, const char* text, size_t len)
+{
+    const uint64_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= SLOT_COUNT)
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Slot& slot = m_slots[head & (SLOT_COUNT - 1)];
+    if (len >= MESSAGE_SIZE)
+        len = MESSAGE_SIZE - 1;
+    slot.level = level;
+    slot.len = (uint32_t)len;
+    std::memcpy(slot.text, text, len);
+
+    m_head.store(head + 1, std::memory_order_seq_cst);
+
+    // Only pay for a wake-up when the drain thread is actually parked
+    m_signal.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_seq_cst))
+        m_signal.notify_one();
+    return true;
+}
+
+// Writes every published slot, returns false if there was nothing to write
+bool Logger::DrainAvailable()
+{
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    const uint64_t head = m_head.load(std::memory_order_acquire);
+    if (tail == head)
+        return false;
+
+    static const char* const prefixes[] = { "[debug] ", "[info] ", "[warn] ", "[error] " };
+
+    for (; tail != head; ++tail)
+    {
+        const Slot& slot = m_slots[tail & (SLOT_COUNT - 1)];
+        if (m_sink)
+        {
+            if (slot.level >= LOG_LEVEL_DEBUG && slot.level <= LOG_LEVEL_ERROR)
+                std::fputs(prefixes[slot.level], m_sink);
+            std::fwrite(slot.text, 1, slot.len, m_sink);
+            if (slot.len == 0 || slot.text[slot.len - 1] != '\n')
+                std::fputc('\n', m_sink);
+        }
+        m_tail.store(tail + 1, std::memory_order_release);
+        m_written.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (m_sink)
+        std::fflush(m_sink);
+    return true;
+}
+
+void Logger::DrainLoop()
+{
+    while (true)
+    {
+        const uint32_t signal = m_signal.load(std::memory_order_seq_cst);
+        if (DrainAvailable())
+            continue;
+
+        if (!m_running.load())
+            break;
+
+        m_sleeping.store(true, std::memory_order_seq_cst);
+        if (m_head.load(std::memory_order_seq_cst) == m_tail.load(std::memory_order_relaxed))
+            m_signal.wait(signal);
+        m_sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    DrainAvailable();
+}
+
+// -------------------- LogLine --------------------
+LogLine& LogLine::operator<<(const char* s)
+{
+    if (!s)
+        return *this;
+
+    size_t n = std::strlen(s);
+    size_t room = sizeof(m_text) - 1 - m_len;
+    if (n > room)
+        n = room;
+    std::memcpy(m_text + m_len, s, n);
+    m_len += n;
+    return *this;
+}
+
+LogLine& LogLine::operator<<(char c)
+{
+    if (m_len + 1 < sizeof(m_text))
+        m_text[m_len++] = c;
+    return *this;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// -------------------- Asynchronous logger --------------------
+enum LogLevel : int
+{
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+};
+
+// Levels below LOG_MIN_LEVEL are compiled out of the LOG_* macros
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+// Single producer / single consumer ring of fixed size message slots.
+// The producer (UI thread) formats into a slot and publishes it with one
+// atomic store; it never blocks or allocates, a full ring drops the message.
+// A drain thread writes published slots to the sink.
+class Logger
+{
+public:
+    static const size_t SLOT_COUNT = 1024;      // power of two
+    static const size_t MESSAGE_SIZE = 240;
+
+    Logger() = default;
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static Logger& Instance();
+
+    void Start(FILE* sink);
+    void Stop();                                // drains what is queued, then joins
+
+    void SetLevel(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+    bool Enabled(LogLevel level) const { return level >= m_level.load(std::memory_order_relaxed); }
+
+    // Producer side. Returns false when the ring was full and the message dropped.
+    bool Push(LogLevel level, const char* text, size_t len);
+
+    uint64_t Written() const { return m_written.load(std::memory_order_relaxed); }
+    uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        LogLevel level;
+        uint32_t len;
+        char text[MESSAGE_SIZE];
+    };
+
+    void DrainLoop();
+    bool DrainAvailable();
+
+    Slot m_slots[SLOT_COUNT];
+
+    alignas(64) std::atomic<uint64_t> m_head{ 0 };     // next slot to publish (producer)
+    alignas(64) std::atomic<uint64_t> m_tail{ 0 };     // next slot to drain (consumer)
+
+    std::atomic<uint32_t> m_signal{ 0 };                // bumped to wake the drain thread
+    std::atomic<bool> m_sleeping{ false };
+    std::atomic<bool> m_running{ false };
+    std::atomic<int> m_level{ LOG_LEVEL_DEBUG };
+
+    std::atomic<uint64_t> m_written{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+
+    FILE* m_sink = nullptr;
+    std::thread m_thread;
+};
+
+// Formats one message on the stack and pushes it on destruction
+class LogLine
+{
+public:
+    explicit LogLine(LogLevel level, Logger& logger = Logger::Instance()) : m_level(level), m_logger(logger) {}
+    ~LogLine() { m_logger.Push(m_level, m_text, m_len); }
+
+    LogLine& operator<<(const char* s);
+    LogLine& operator<<(const std::string& s) { return *this << s.c_str(); }
+    LogLine& operator<<(char c);
+    LogLine& operator<<(int v) { return Format("%d", v); }
+    LogLine& operator<<(unsigned v) { return Format("%u", v); }
+    LogLine& operator<<(long v) { return Format("%ld", v); }
+    LogLine& operator<<(unsigned long v) { return Format("%lu", v); }
+    LogLine& operator<<(long long v) { return Format("%lld", v); }
+    LogLine& operator<<(unsigned long long v) { return Format("%llu", v); }
+    LogLine& operator<<(double v) { return Format("%g", v); }
+
+private:
+    template <class T>
+    LogLine& Format(const char* fmt, T v)
+    {
+        if (m_len < sizeof(m_text))
+        {
+            int n = std::snprintf(m_text + m_len, sizeof(m_text) - m_len, fmt, v);
+            if (n > 0)
+                m_len = (m_len + (size_t)n < sizeof(m_text)) ? m_len + (size_t)n : sizeof(m_text) - 1;
+        }
+        return *this;
+    }
+
+    LogLevel m_level;
+    Logger& m_logger;
+    char m_text[Logger::MESSAGE_SIZE];
+    size_t m_len = 0;
+};
+
+#define LOG_AT(level, expr)                                             \
+    do {                                                                \
+        if constexpr ((level) >= LOG_MIN_LEVEL) {                       \
+            if (Logger::Instance().Enabled(level)) {                    \
+                LogLine logLine_(level);                                \
+                logLine_ << expr;                                       \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+#define LOG_DEBUG(expr) LOG_AT(LOG_LEVEL_DEBUG, expr)
+#define LOG_INFO(expr)  LOG_AT(LOG_LEVEL_INFO, expr)
+#define LOG_WARN(expr)  LOG_AT(LOG_LEVEL_WARN, expr)
+#define LOG_ERROR(expr) LOG_AT(LOG_LEVEL_ERROR, expr)
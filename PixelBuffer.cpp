@@ -0,0 +1,79 @@
+#include "PixelBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+PixelBuffer::PixelBuffer(int width, int height)
+{
+    Resize(width, height);
+}
+
+void PixelBuffer::Resize(int width, int height)
+{
+    if (width < 0) width = 0;
+    if (height < 0) height = 0;
+    if (width == m_width && height == m_height)
+        return;
+
+    m_width = width;
+    m_height = height;
+    m_pixels.assign((size_t)width * height, 0);
+}
+
+void PixelBuffer::Fill(uint32_t color)
+{
+    std::fill(m_pixels.begin(), m_pixels.end(), color);
+}
+
+void PixelBuffer::FillRect(int left, int top, int right, int bottom, uint32_t color)
+{
+    left = std::max(left, 0);
+    top = std::max(top, 0);
+    right = std::min(right, m_width);
+    bottom = std::min(bottom, m_height);
+    if (left >= right || top >= bottom)
+        return;
+
+    for (int y = top; y < bottom; ++y)
+        std::fill(Row(y) + left, Row(y) + right, color);
+}
+
+void ScrollPixels(uint32_t* pixels, int width, int height, int dx, int dy)
+{
+    if ((dx == 0 && dy == 0) || dx >= width || -dx >= width || dy >= height || -dy >= height)
+        return;
+
+    // Columns that survive, in source and destination
+    const int srcX = dx >= 0 ? 0 : -dx;
+    const int dstX = dx >= 0 ? dx : 0;
+    const size_t rowBytes = (size_t)(width - (dx >= 0 ? dx : -dx)) * sizeof(uint32_t);
+    const int rows = height - (dy >= 0 ? dy : -dy);
+
+    // Walk rows against the direction of the move so a source row is read
+    // before it is overwritten; memmove handles the overlap within a row
+    if (dy > 0)
+    {
+        for (int y = rows - 1; y >= 0; --y)
+            std::memmove(pixels + (size_t)(y + dy) * width + dstX, pixels + (size_t)y * width + srcX, rowBytes);
+    }
+    else
+    {
+        for (int y = -dy; y < height; ++y)
+            std::memmove(pixels + (size_t)(y + dy) * width + dstX, pixels + (size_t)y * width + srcX, rowBytes);
+    }
+}
+
+void PixelBuffer::Blit(const PixelBuffer& src, int dstX, int dstY)
+{
+    const int x0 = std::max(dstX, 0);
+    const int y0 = std::max(dstY, 0);
+    const int x1 = std::min(dstX + src.Width(), m_width);
+    const int y1 = std::min(dstY + src.Height(), m_height);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    for (int y = y0; y < y1; ++y)
+    {
+        std::memcpy(Row(y) + x0, src.Row(y - dstY) + (x0 - dstX), (size_t)(x1 - x0) * sizeof(uint32_t));
+    }
+}
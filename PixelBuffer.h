@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Moves the content of a width x height 32 bit raster by (dx, dy) in place.
+// Pixels moved out are lost; the exposed strips keep their old, now stale
+// content and are expected to be redrawn (see ExposedStrips).
+void ScrollPixels(uint32_t* pixels, int width, int height, int dx, int dy);
+
+// -------------------- Pixel buffer --------------------
+// In-memory 32 bit raster (0x00RRGGBB, rows top-down). Headless backend for
+// the render layers; the byte layout matches a top-down 32 bpp DIB section.
+class PixelBuffer
+{
+public:
+    PixelBuffer() = default;
+    PixelBuffer(int width, int height);
+
+    // Surface interface used by RetainedLayer
+    void Resize(int width, int height);
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+
+    uint32_t* Data() { return m_pixels.data(); }
+    const uint32_t* Data() const { return m_pixels.data(); }
+    uint32_t* Row(int y) { return m_pixels.data() + (size_t)y * m_width; }
+    const uint32_t* Row(int y) const { return m_pixels.data() + (size_t)y * m_width; }
+
+    uint32_t Get(int x, int y) const { return m_pixels[(size_t)y * m_width + x]; }
+    void Set(int x, int y, uint32_t color) { m_pixels[(size_t)y * m_width + x] = color; }
+
+    void Fill(uint32_t color);
+    void FillRect(int left, int top, int right, int bottom, uint32_t color);     // clipped, right/bottom exclusive
+
+    // Copy src into this buffer with its top-left corner at (dstX, dstY), clipped
+    void Blit(const PixelBuffer& src, int dstX, int dstY);
+
+    // Surface interface used by RetainedLayer::Scroll, see ScrollPixels
+    void Scroll(int dx, int dy) { ScrollPixels(m_pixels.data(), m_width, m_height, dx, dy); }
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<uint32_t> m_pixels;
+};
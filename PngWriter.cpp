@@ -0,0 +1,290 @@
+#include "PngWriter.h"
+
+#include <cstring>
+
+namespace {
+
+    const size_t IDAT_BYTES = 64 * 1024;            // payload of each IDAT chunk
+    const uint32_t MIN_RUN = 3;                     // deflate minimum match
+    const uint32_t MAX_RUN = 258;                   // deflate maximum match
+
+    struct CrcTable {
+        uint32_t entries[256];
+
+        CrcTable()
+        {
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[n] = c;
+            }
+        }
+    };
+
+    uint32_t UpdateCrc(uint32_t crc, const uint8_t* data, size_t size)
+    {
+        static const CrcTable table;
+        for (size_t i = 0; i < size; ++i)
+            crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+    void PutBigEndian(uint8_t* p, uint32_t v)
+    {
+        p[0] = (uint8_t)(v >> 24);
+        p[1] = (uint8_t)(v >> 16);
+        p[2] = (uint8_t)(v >> 8);
+        p[3] = (uint8_t)v;
+    }
+
+    // Deflate length symbols 257..285: base length and extra bits
+    const uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+    FILE* OpenForWrite(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        FILE* f = nullptr;
+        if (_wfopen_s(&f, path.c_str(), L"wb") != 0)
+            return nullptr;
+        return f;
+#else
+        return std::fopen(path.c_str(), "wb");
+#endif
+    }
+
+} // namespace
+
+PngWriter::~PngWriter()
+{
+    if (m_file)
+        std::fclose(m_file);
+}
+
+bool PngWriter::Open(const std::filesystem::path& path, uint32_t width, uint32_t height)
+{
+    if (m_file || width == 0 || height == 0 || width > (UINT32_MAX - 1) / 3)
+        return false;
+
+    m_file = OpenForWrite(path);
+    if (!m_file)
+        return false;
+
+    m_width = width;
+    m_height = height;
+    m_rowsWritten = 0;
+    m_bytesWritten = 0;
+    m_failed = false;
+    m_row.assign(1 + (size_t)width * 3, 0);
+    m_out.clear();
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+    m_adlerA = 1;
+    m_adlerB = 0;
+    m_lastByte = -1;
+
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    m_failed = std::fwrite(SIGNATURE, 1, sizeof(SIGNATURE), m_file) != sizeof(SIGNATURE);
+    m_bytesWritten += sizeof(SIGNATURE);
+
+    uint8_t ihdr[13];
+    PutBigEndian(ihdr, width);
+    PutBigEndian(ihdr + 4, height);
+    ihdr[8] = 8;        // bit depth
+    ihdr[9] = 2;        // colour type: RGB
+    ihdr[10] = 0;       // deflate
+    ihdr[11] = 0;       // adaptive filtering
+    ihdr[12] = 0;       // no interlace
+    WriteChunk("IHDR", ihdr, sizeof(ihdr));
+
+    // zlib header (deflate, 32K window, no dictionary) and one final fixed Huffman block
+    m_out.push_back(0x78);
+    m_out.push_back(0x01);
+    PutBits(1, 1);      // BFINAL
+    PutBits(1, 2);      // BTYPE = fixed Huffman
+
+    return !m_failed;
+}
+
+bool PngWriter::WriteRow(const uint32_t* pixels)
+{
+    if (!m_file || m_rowsWritten >= m_height)
+        return false;
+
+    // Sub filter: each byte minus the same channel of the pixel to its left
+    uint8_t* out = m_row.data();
+    out[0] = 1;
+    uint8_t prevR = 0, prevG = 0, prevB = 0;
+    for (uint32_t x = 0; x < m_width; ++x)
+    {
+        uint8_t r = (uint8_t)(pixels[x] >> 16);
+        uint8_t g = (uint8_t)(pixels[x] >> 8);
+        uint8_t b = (uint8_t)pixels[x];
+        out[1 + x * 3 + 0] = (uint8_t)(r - prevR);
+        out[1 + x * 3 + 1] = (uint8_t)(g - prevG);
+        out[1 + x * 3 + 2] = (uint8_t)(b - prevB);
+        prevR = r;
+        prevG = g;
+        prevB = b;
+    }
+
+    EncodeBytes(m_row.data(), m_row.size());
+    ++m_rowsWritten;
+    FlushIdat(false);
+    return !m_failed;
+}
+
+bool PngWriter::Close()
+{
+    if (!m_file)
+        return false;
+
+    bool complete = m_rowsWritten == m_height;
+    if (complete)
+    {
+        PutHuffman(0, 7);   // end of block (symbol 256)
+        if (m_bitCount > 0)
+            PutBits(0, 8 - m_bitCount);
+
+        uint32_t adler = (m_adlerB << 16) | m_adlerA;
+        uint8_t trailer[4];
+        PutBigEndian(trailer, adler);
+        m_out.insert(m_out.end(), trailer, trailer + 4);
+
+        FlushIdat(true);
+        WriteChunk("IEND", nullptr, 0);
+    }
+
+    if (std::fclose(m_file) != 0)
+        m_failed = true;
+    m_file = nullptr;
+    return complete && !m_failed;
+}
+
+void PngWriter::PutBits(uint32_t bits, int count)
+{
+    m_bitBuffer |= (uint64_t)bits << m_bitCount;
+    m_bitCount += count;
+    while (m_bitCount >= 8)
+    {
+        m_out.push_back((uint8_t)m_bitBuffer);
+        m_bitBuffer >>= 8;
+        m_bitCount -= 8;
+    }
+}
+
+void PngWriter::PutHuffman(uint32_t code, int length)
+{
+    // Huffman codes are packed starting with their most significant bit
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; ++i)
+        reversed |= ((code >> i) & 1) << (length - 1 - i);
+    PutBits(reversed, length);
+}
+
+void PngWriter::PutLiteral(uint8_t value)
+{
+    if (value < 144)
+        PutHuffman(0x30 + value, 8);
+    else
+        PutHuffman(0x190 + (value - 144), 9);
+}
+
+void PngWriter::PutRun(uint32_t length)
+{
+    int symbol = 0;
+    while (symbol < 28 && LENGTH_BASE[symbol + 1] <= length)
+        ++symbol;
+
+    uint32_t code = 257 + symbol;
+    if (code < 280)
+        PutHuffman(code - 256, 7);
+    else
+        PutHuffman(0xC0 + (code - 280), 8);
+
+    if (LENGTH_EXTRA[symbol])
+        PutBits(length - LENGTH_BASE[symbol], LENGTH_EXTRA[symbol]);
+
+    PutHuffman(0, 5);   // distance code 0: distance 1
+}
+
+void PngWriter::EncodeBytes(const uint8_t* data, size_t size)
+{
+    // Adler-32 of the uncompressed stream (sums reduced before they can overflow)
+    for (size_t i = 0; i < size; )
+    {
+        size_t block = size - i < 5552 ? size - i : 5552;
+        for (size_t k = 0; k < block; ++k)
+        {
+            m_adlerA += data[i + k];
+            m_adlerB += m_adlerA;
+        }
+        m_adlerA %= 65521;
+        m_adlerB %= 65521;
+        i += block;
+    }
+
+    size_t i = 0;
+    while (i < size)
+    {
+        // run of bytes equal to the previous one
+        size_t run = 0;
+        if (m_lastByte >= 0)
+        {
+            while (i + run < size && run < MAX_RUN && data[i + run] == (uint8_t)m_lastByte)
+                ++run;
+        }
+
+        if (run >= MIN_RUN)
+        {
+            PutRun((uint32_t)run);
+            i += run;
+        }
+        else
+        {
+            PutLiteral(data[i]);
+            m_lastByte = data[i];
+            ++i;
+        }
+    }
+}
+
+void PngWriter::FlushIdat(bool force)
+{
+    size_t start = 0;
+    while (m_out.size() - start >= IDAT_BYTES || (force && m_out.size() > start))
+    {
+        size_t size = m_out.size() - start < IDAT_BYTES ? m_out.size() - start : IDAT_BYTES;
+        WriteChunk("IDAT", m_out.data() + start, size);
+        start += size;
+    }
+    m_out.erase(m_out.begin(), m_out.begin() + start);
+}
+
+bool PngWriter::WriteChunk(const char type[4], const uint8_t* data, size_t size)
+{
+    uint8_t header[8];
+    PutBigEndian(header, (uint32_t)size);
+    std::memcpy(header + 4, type, 4);
+
+    uint32_t crc = UpdateCrc(0xFFFFFFFFu, header + 4, 4);
+    if (size)
+        crc = UpdateCrc(crc, data, size);
+    uint8_t footer[4];
+    PutBigEndian(footer, crc ^ 0xFFFFFFFFu);
+
+    bool ok = std::fwrite(header, 1, 8, m_file) == 8 &&
+        (size == 0 || std::fwrite(data, 1, size, m_file) == size) &&
+        std::fwrite(footer, 1, 4, m_file) == 4;
+    if (!ok)
+        m_failed = true;
+
+    m_bytesWritten += 12 + size;
+    return ok;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+// -------------------- Streaming PNG writer --------------------
+// Writes an 8-bit RGB PNG row by row, so images far larger than memory can
+// be produced band by band. Rows use the Sub filter and a single fixed
+// Huffman deflate block whose only matches are byte runs (distance 1):
+// flat drawing backgrounds compress to a few bits per row while the writer
+// stays dependency free.
+//
+// Pixels are 0x00RRGGBB, the PixelBuffer layout.
+
+class PngWriter
+{
+public:
+    PngWriter() = default;
+    ~PngWriter();
+    PngWriter(const PngWriter&) = delete;
+    PngWriter& operator=(const PngWriter&) = delete;
+
+    bool Open(const std::filesystem::path& path, uint32_t width, uint32_t height);
+    bool WriteRow(const uint32_t* pixels);          // width pixels
+    bool Close();                                   // false if rows are missing or a write failed
+
+    uint32_t RowsWritten() const { return m_rowsWritten; }
+    uint64_t BytesWritten() const { return m_bytesWritten; }
+
+private:
+    void PutBits(uint32_t bits, int count);
+    void PutHuffman(uint32_t code, int length);     // code is MSB first
+    void PutLiteral(uint8_t value);
+    void PutRun(uint32_t length);                   // match at distance 1
+    void EncodeBytes(const uint8_t* data, size_t size);
+    void FlushIdat(bool force);
+    bool WriteChunk(const char type[4], const uint8_t* data, size_t size);
+
+    FILE* m_file = nullptr;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_rowsWritten = 0;
+    uint64_t m_bytesWritten = 0;
+    bool m_failed = false;
+
+    std::vector<uint8_t> m_row;                     // filter byte + filtered RGB
+    std::vector<uint8_t> m_out;                     // pending IDAT payload
+    uint64_t m_bitBuffer = 0;
+    int m_bitCount = 0;
+    uint32_t m_adlerA = 1;
+    uint32_t m_adlerB = 0;
+    int m_lastByte = -1;                            // previous byte of the stream, -1 at start
+};
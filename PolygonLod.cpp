@@ -0,0 +1,155 @@
+#include "PolygonLod.h"
+
+#include <cmath>
+#include <utility>
+
+// Squared distance from p to segment ab
+static double SegmentDistance2(double px, double py, double ax, double ay, double bx, double by)
+{
+    const double dx = bx - ax;
+    const double dy = by - ay;
+    const double len2 = dx * dx + dy * dy;
+
+    double t = 0.0;
+    if (len2 > 0.0)
+    {
+        t = ((px - ax) * dx + (py - ay) * dy) / len2;
+        if (t < 0.0) t = 0.0;
+        if (t > 1.0) t = 1.0;
+    }
+
+    const double ex = ax + t * dx - px;
+    const double ey = ay + t * dy - py;
+    return ex * ex + ey * ey;
+}
+
+std::vector<uint32_t> SimplifyDouglasPeucker(const int32_t* xs, const int32_t* ys, uint32_t count, double tolerance)
+{
+    std::vector<uint32_t> kept;
+    if (count <= 2)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            kept.push_back(i);
+        return kept;
+    }
+
+    const double tol2 = tolerance * tolerance;
+    std::vector<bool> keep(count, false);
+    keep[0] = true;
+    keep[count - 1] = true;
+
+    // explicit stack: traced multilines can have hundreds of thousands of vertices
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.emplace_back(0, count - 1);
+
+    while (!stack.empty())
+    {
+        auto [first, last] = stack.back();
+        stack.pop_back();
+
+        double maxDist2 = -1.0;
+        uint32_t farthest = first;
+        for (uint32_t i = first + 1; i < last; ++i)
+        {
+            double d2 = SegmentDistance2(xs[i], ys[i], xs[first], ys[first], xs[last], ys[last]);
+            if (d2 > maxDist2)
+            {
+                maxDist2 = d2;
+                farthest = i;
+            }
+        }
+
+        if (maxDist2 > tol2)
+        {
+            keep[farthest] = true;
+            if (farthest - first > 1) stack.emplace_back(first, farthest);
+            if (last - farthest > 1) stack.emplace_back(farthest, last);
+        }
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (keep[i])
+            kept.push_back(i);
+    }
+    return kept;
+}
+
+int PolygonLod::SelectLevel(double zoom)
+{
+    if (zoom > 1.0)
+        return -1;
+
+    int level = (int)std::floor(std::log2(1.0 / zoom));
+    return level < LEVELS ? level : LEVELS - 1;
+}
+
+void PolygonLod::Build(uint32_t id, const int32_t* xs, const int32_t* ys, uint32_t count)
+{
+    if (count < MIN_VERTICES)
+    {
+        m_entries.erase(id);
+        return;
+    }
+
+    Entry& entry = m_entries[id];
+
+    // each level simplifies the previous one, tolerances double per level
+    std::vector<int32_t> srcX(xs, xs + count);
+    std::vector<int32_t> srcY(ys, ys + count);
+
+    for (int k = 0; k < LEVELS; ++k)
+    {
+        const double tolerance = PIXEL_TOLERANCE * std::ldexp(1.0, k);
+        std::vector<uint32_t> kept = SimplifyDouglasPeucker(srcX.data(), srcY.data(), (uint32_t)srcX.size(), tolerance);
+
+        Level& level = entry.levels[k];
+        level.xs.resize(kept.size());
+        level.ys.resize(kept.size());
+        for (size_t i = 0; i < kept.size(); ++i)
+        {
+            level.xs[i] = srcX[kept[i]];
+            level.ys[i] = srcY[kept[i]];
+        }
+
+        srcX = level.xs;
+        srcY = level.ys;
+    }
+}
+
+void PolygonLod::Remove(uint32_t id)
+{
+    m_entries.erase(id);
+}
+
+void PolygonLod::Clear()
+{
+    m_entries.clear();
+}
+
+bool PolygonLod::Get(uint32_t id, int level, const int32_t*& xs, const int32_t*& ys, uint32_t& count) const
+{
+    if (level < 0 || level >= LEVELS)
+        return false;
+
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+        return false;
+
+    const Level& l = it->second.levels[level];
+    xs = l.xs.data();
+    ys = l.ys.data();
+    count = (uint32_t)l.xs.size();
+    return true;
+}
+
+size_t PolygonLod::MemoryBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& kv : m_entries)
+    {
+        for (const Level& l : kv.second.levels)
+            bytes += (l.xs.capacity() + l.ys.capacity()) * sizeof(int32_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// -------------------- Polygon level of detail --------------------
+// Douglas-Peucker simplification of a vertex chain. Returns the indices of
+// the kept vertices; the first and last vertex are always kept.
+std::vector<uint32_t> SimplifyDouglasPeucker(const int32_t* xs, const int32_t* ys, uint32_t count, double tolerance);
+
+// Multi-resolution copies of dense polygons. Level k is simplified from
+// level k - 1 with a world tolerance of PIXEL_TOLERANCE * 2^k, so its total
+// error stays under 2 * PIXEL_TOLERANCE screen pixels while zoom <= 1 / 2^k.
+// The stored geometry is never touched.
+class PolygonLod
+{
+public:
+    static const int LEVELS = 4;
+    static const uint32_t MIN_VERTICES = 32;    // smaller polygons are always drawn in full
+    static constexpr double PIXEL_TOLERANCE = 0.5;
+
+    // Level to draw at the given zoom, -1 for the full geometry
+    static int SelectLevel(double zoom);
+
+    void Build(uint32_t id, const int32_t* xs, const int32_t* ys, uint32_t count);
+    void Remove(uint32_t id);
+    void Clear();
+
+    // Renumber the shapes after their ids shifted: fn(id) returns the new id
+    // (every id still present must map to a distinct one)
+    template <class Fn>
+    void Remap(Fn&& fn)
+    {
+        std::unordered_map<uint32_t, Entry> entries;
+        entries.reserve(m_entries.size());
+        for (auto& kv : m_entries)
+            entries.emplace(fn(kv.first), std::move(kv.second));
+        m_entries.swap(entries);
+    }
+
+    // Simplified vertices of a shape at a level; false when the shape has no
+    // levels (too small) or level is -1
+    bool Get(uint32_t id, int level, const int32_t*& xs, const int32_t*& ys, uint32_t& count) const;
+
+    size_t MemoryBytes() const;
+
+private:
+    struct Level {
+        std::vector<int32_t> xs;
+        std::vector<int32_t> ys;
+    };
+
+    struct Entry {
+        Level levels[LEVELS];
+    };
+
+    std::unordered_map<uint32_t, Entry> m_entries;
+};
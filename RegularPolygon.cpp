@@ -0,0 +1,80 @@
+#include "RegularPolygon.h"
+
+#include <cmath>
+
+namespace {
+
+    // cos / sin of i * 2pi / sides for every supported side count
+    struct UnitCircleTables {
+        double cosv[MAX_POLY_SIDES + 1][MAX_POLY_SIDES];
+        double sinv[MAX_POLY_SIDES + 1][MAX_POLY_SIDES];
+
+        UnitCircleTables()
+        {
+            const double pi = std::acos(-1.0);
+            for (int sides = MIN_POLY_SIDES; sides <= MAX_POLY_SIDES; ++sides)
+            {
+                for (int i = 0; i < sides; ++i)
+                {
+                    double theta = 2.0 * pi * i / sides;
+                    cosv[sides][i] = std::cos(theta);
+                    sinv[sides][i] = std::sin(theta);
+                }
+            }
+        }
+    };
+
+    const UnitCircleTables& Tables()
+    {
+        static const UnitCircleTables tables;
+        return tables;
+    }
+
+} // namespace
+
+int GenerateRegularPolygon(WorldPoint center, WorldPoint edge, int sides, WorldPoint* out)
+{
+    if (sides < MIN_POLY_SIDES) sides = MIN_POLY_SIDES;
+    if (sides > MAX_POLY_SIDES) sides = MAX_POLY_SIDES;
+
+    const UnitCircleTables& t = Tables();
+    const double* c = t.cosv[sides];
+    const double* s = t.sinv[sides];
+
+    // (dx, dy) = r * (cos base, sin base): rotating it by theta_i gives vertex i
+    const double dx = (double)edge.x - center.x;
+    const double dy = (double)edge.y - center.y;
+
+    for (int i = 0; i < sides; ++i)
+    {
+        double wx = center.x + dx * c[i] - dy * s[i];
+        double wy = center.y + dx * s[i] + dy * c[i];
+        out[i].x = (int32_t)wx;
+        out[i].y = (int32_t)wy;
+    }
+
+    out[sides] = out[0];
+    return sides + 1;
+}
+
+bool RegularPolygonCache::Update(WorldPoint center, WorldPoint edge, int sides)
+{
+    if (m_valid && sides == m_sides &&
+        center.x == m_center.x && center.y == m_center.y &&
+        edge.x == m_edge.x && edge.y == m_edge.y)
+    {
+        return false;
+    }
+
+    m_center = center;
+    m_edge = edge;
+    m_sides = sides;
+    m_valid = true;
+
+    m_count = GenerateRegularPolygon(center, edge, sides, m_points);
+
+    const double dx = (double)edge.x - center.x;
+    const double dy = (double)edge.y - center.y;
+    m_radius = std::sqrt(dx * dx + dy * dy);
+    return true;
+}
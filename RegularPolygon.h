@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+#include "Geometry.h"
+
+// -------------------- Regular polygon generator --------------------
+// Side count range accepted by the Sides edit box
+const int MIN_POLY_SIDES = 3;
+const int MAX_POLY_SIDES = 64;
+
+// Vertex capacity callers must provide (closing vertex included)
+const int MAX_POLY_VERTICES = MAX_POLY_SIDES + 1;
+
+// Writes the closed regular polygon centred on center whose first vertex is
+// edge (sides + 1 points, last == first) into out. Vertices come from
+// precomputed unit circle tables rotated and scaled by (edge - center), so
+// no trig is evaluated and nothing is allocated. sides is clamped to
+// [MIN_POLY_SIDES, MAX_POLY_SIDES]. Returns the number of points written.
+int GenerateRegularPolygon(WorldPoint center, WorldPoint edge, int sides, WorldPoint* out);
+
+// Last generated polygon; regenerates only when center, edge or side count change
+class RegularPolygonCache
+{
+public:
+    // Returns true when the vertices had to be regenerated
+    bool Update(WorldPoint center, WorldPoint edge, int sides);
+
+    const WorldPoint* Points() const { return m_points; }
+    int Count() const { return m_count; }
+    double Radius() const { return m_radius; }
+
+private:
+    bool m_valid = false;
+    WorldPoint m_center{};
+    WorldPoint m_edge{};
+    int m_sides = 0;
+
+    WorldPoint m_points[MAX_POLY_VERTICES]{};
+    int m_count = 0;
+    double m_radius = 0.0;
+};
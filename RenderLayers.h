@@ -0,0 +1,156 @@
+#pragma once
+#include <cstdint>
+
+#include "Geometry.h"
+
+// -------------------- Render layers --------------------
+// A frame is composed from a retained scene layer (all committed geometry)
+// and a cheap overlay (hover snap circle, in-progress preview) drawn on top.
+// The scene layer is only re-rendered when its key changes, i.e. when the
+// scene is edited or the camera / surface size changes.
+
+// Everything the cached scene raster depends on
+struct LayerKey {
+    uint64_t sceneVersion = 0;
+    double zoom = 1.0;
+    int32_t panX = 0;
+    int32_t panY = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+
+    bool operator==(const LayerKey& o) const
+    {
+        return sceneVersion == o.sceneVersion && zoom == o.zoom &&
+            panX == o.panX && panY == o.panY && width == o.width && height == o.height;
+    }
+    bool operator!=(const LayerKey& o) const { return !(*this == o); }
+};
+
+// Area of a width x height surface left uncovered after its content moved by
+// (dx, dy): an L of at most two rectangles, a full height column and the
+// remaining part of a row band. Returns the number of rectangles written.
+inline int ExposedStrips(int32_t width, int32_t height, int32_t dx, int32_t dy, ScreenRect out[2])
+{
+    if (dx >= width || -dx >= width || dy >= height || -dy >= height)
+    {
+        out[0] = ScreenRect{ 0, 0, width, height };
+        return 1;
+    }
+
+    int count = 0;
+    int32_t left = 0, right = width;        // columns not taken by the vertical strip
+    if (dx > 0)
+    {
+        out[count++] = ScreenRect{ 0, 0, dx, height };
+        left = dx;
+    }
+    else if (dx < 0)
+    {
+        out[count++] = ScreenRect{ width + dx, 0, width, height };
+        right = width + dx;
+    }
+
+    if (dy > 0)
+        out[count++] = ScreenRect{ left, 0, right, dy };
+    else if (dy < 0)
+        out[count++] = ScreenRect{ left, height + dy, right, height };
+
+    return count;
+}
+
+// Surface must provide Resize(int, int), Width() and Height(), and
+// Scroll(int, int) when RetainedLayer::Scroll is used.
+// PixelBuffer is the portable backend, the app uses a GDI memory DC.
+template <class Surface>
+class RetainedLayer
+{
+public:
+    // Make the surface hold the content for key. render(Surface&) is only
+    // invoked on a cache miss. Returns true on a hit.
+    template <class RenderFn>
+    bool Update(const LayerKey& key, RenderFn&& render)
+    {
+        if (m_valid && key == m_key)
+        {
+            ++m_hits;
+            return true;
+        }
+
+        m_surface.Resize(key.width, key.height);
+        render(m_surface);
+
+        m_key = key;
+        m_valid = true;
+        ++m_misses;
+        return false;
+    }
+
+    // Re-render part of a valid layer after a scene edit that kept the camera
+    // and size. render(Surface&) is expected to clip itself to the changed area.
+    // Returns false (and does nothing) when a full Update is needed instead.
+    template <class RenderFn>
+    bool Patch(const LayerKey& key, RenderFn&& render)
+    {
+        LayerKey sameScene = key;
+        sameScene.sceneVersion = m_key.sceneVersion;
+        if (!m_valid || sameScene != m_key)
+            return false;
+
+        render(m_surface);
+
+        m_key = key;
+        ++m_patches;
+        return true;
+    }
+
+    // Follow a pan: when only the pan changed, by less than the surface size,
+    // the surface content is moved by the pan delta and render(Surface&,
+    // const ScreenRect&) is called for each exposed strip only. Returns false
+    // (and does nothing) when a full Update is needed instead.
+    template <class RenderFn>
+    bool Scroll(const LayerKey& key, RenderFn&& render)
+    {
+        LayerKey samePan = key;
+        samePan.panX = m_key.panX;
+        samePan.panY = m_key.panY;
+        if (!m_valid || samePan != m_key)
+            return false;
+
+        const int64_t dx = (int64_t)key.panX - m_key.panX;
+        const int64_t dy = (int64_t)key.panY - m_key.panY;
+        if (dx >= key.width || -dx >= key.width || dy >= key.height || -dy >= key.height)
+            return false;
+
+        m_surface.Scroll((int)dx, (int)dy);
+
+        ScreenRect strips[2];
+        const int count = ExposedStrips(key.width, key.height, (int32_t)dx, (int32_t)dy, strips);
+        for (int i = 0; i < count; ++i)
+            render(m_surface, strips[i]);
+
+        m_key = key;
+        ++m_scrolls;
+        return true;
+    }
+
+    void Invalidate() { m_valid = false; }
+    bool IsValid() const { return m_valid; }
+    const LayerKey& Key() const { return m_key; }
+
+    Surface& GetSurface() { return m_surface; }
+    const Surface& GetSurface() const { return m_surface; }
+
+    uint64_t Hits() const { return m_hits; }
+    uint64_t Misses() const { return m_misses; }
+    uint64_t Patches() const { return m_patches; }
+    uint64_t Scrolls() const { return m_scrolls; }
+
+private:
+    Surface m_surface{};
+    LayerKey m_key{};
+    bool m_valid = false;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_patches = 0;
+    uint64_t m_scrolls = 0;
+};
@@ -0,0 +1,279 @@
+#include "RenderThread.h"
+
+#include <cmath>
+#include <cstring>
+#include <future>
+
+#include "LatencyStats.h"
+#include "ThreadPool.h"
+#include "TileRasterizer.h"
+
+namespace
+{
+    // World area whose shapes can reach the screen area, like
+    // TileCache::TileWorldRect: the extra pixel absorbs the truncation of
+    // world * zoom towards zero
+    WorldRect AreaWorldRect(const Camera& cam, const ScreenRect& area, int32_t marginPixels)
+    {
+        const int64_t grow = (int64_t)marginPixels + 1;
+        return WorldRect{
+            (int32_t)std::floor(((int64_t)area.left - cam.panX - grow) / cam.zoom),
+            (int32_t)std::floor(((int64_t)area.top - cam.panY - grow) / cam.zoom),
+            (int32_t)std::ceil(((int64_t)area.right - cam.panX + grow) / cam.zoom),
+            (int32_t)std::ceil(((int64_t)area.bottom - cam.panY + grow) / cam.zoom) };
+    }
+}
+
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+void RenderThread::Start(ThreadPool& pool, std::function<void()> onFrame)
+{
+    if (m_running.load())
+        return;
+
+    m_pool = &pool;
+    m_onFrame = std::move(onFrame);
+    m_running.store(true);
+    m_thread = std::thread(&RenderThread::RenderLoop, this);
+}
+
+void RenderThread::Stop()
+{
+    if (!m_running.exchange(false))
+        return;
+
+    m_signal.fetch_add(1);
+    m_signal.notify_one();
+    m_thread.join();
+}
+
+// -------------------- UI side --------------------
+uint64_t RenderThread::Publish(SceneStore& scene, const LayerKey& key, const Camera& camera,
+    const PenStyle& pen, uint32_t background)
+{
+    if (!m_publishedScene || key.sceneVersion != m_publishedVersion)
+    {
+        // Shapes [0, shared) are unchanged since the last publish, which
+        // shared the copy the same way: only the ones after it are copied
+        const uint32_t shared = m_publishedScene ? (uint32_t)m_publishedScene->ShapeCount() : 0;
+        const size_t sharedVertices = m_publishedScene ? m_publishedScene->VertexCount() : 0;
+        if (m_publishedScene && scene.FirstChanged() >= shared &&
+            (scene.VertexCount() - sharedVertices) * MAX_APPENDED_SHARE <= sharedVertices)
+        {
+            std::shared_ptr<SceneStore> appended;
+            if (scene.ShapeCount() > shared)
+            {
+                appended = std::make_shared<SceneStore>();
+                scene.CopyTail(shared, *appended);
+            }
+            m_publishedAppended = std::move(appended);
+            ++m_sceneShares;
+        }
+        else
+        {
+            m_publishedScene = std::make_shared<const SceneStore>(scene);
+            m_publishedAppended.reset();
+            ++m_sceneCopies;
+        }
+        m_publishedVersion = key.sceneVersion;
+        scene.ClearChanges();
+    }
+
+    SceneSnapshot& snapshot = m_snapshots.Back();
+    snapshot.scene = m_publishedScene;
+    snapshot.appended = m_publishedAppended;
+    snapshot.key = key;
+    snapshot.camera = camera;
+    snapshot.pen = pen;
+    snapshot.background = background;
+    snapshot.serial = ++m_serial;
+    m_snapshots.Publish();
+
+    m_signal.fetch_add(1);
+    m_signal.notify_one();
+    return m_serial;
+}
+
+// -------------------- Render side --------------------
+void RenderThread::RenderLoop()
+{
+    while (true)
+    {
+        const uint32_t signal = m_signal.load(std::memory_order_seq_cst);
+        if (!m_running.load())
+            break;
+
+        if (m_snapshots.Take())
+        {
+            Render(m_snapshots.Front());
+            continue;
+        }
+
+        m_signal.wait(signal);
+    }
+}
+
+void RenderThread::Render(const SceneSnapshot& snapshot)
+{
+    const int64_t start = LatencyNowNanos();
+
+    if (snapshot.serial > m_lastSerial + 1)
+        m_skipped.fetch_add(snapshot.serial - m_lastSerial - 1, std::memory_order_relaxed);
+    m_lastSerial = snapshot.serial;
+
+    UpdateScene(snapshot);
+
+    if (!(snapshot.pen == m_pen) || snapshot.background != m_background)
+        m_layer.Invalidate();
+    m_camera = snapshot.camera;
+    m_pen = snapshot.pen;
+    m_background = snapshot.background;
+
+    const LayerKey& key = snapshot.key;
+    if (m_layer.Scroll(key, [&](PixelBuffer& surface, const ScreenRect& strip) { RenderArea(surface, strip); }))
+    {
+        m_scrolled.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        m_layer.Update(key, [&](PixelBuffer& surface)
+            {
+                RenderArea(surface, ScreenRect{ 0, 0, surface.Width(), surface.Height() });
+            });
+    }
+
+    // The layer is kept for the next scroll, the UI gets a copy
+    const PixelBuffer& pixels = m_layer.GetSurface();
+    RenderedFrame& frame = m_frames.Back();
+    frame.pixels.Resize(pixels.Width(), pixels.Height());
+    if (pixels.Width() > 0 && pixels.Height() > 0)
+        std::memcpy(frame.pixels.Data(), pixels.Data(), (size_t)pixels.Width() * pixels.Height() * sizeof(uint32_t));
+    frame.key = key;
+    frame.camera = snapshot.camera;
+    frame.serial = snapshot.serial;
+    frame.renderNanos = LatencyNowNanos() - start;
+    m_frames.Publish();
+
+    m_rendered.fetch_add(1, std::memory_order_relaxed);
+    if (m_onFrame)
+        m_onFrame();
+}
+
+// Brings the render thread's scene copy, tree and polygon levels to the
+// snapshot's scene: a new shared copy is copied and indexed in full, new
+// appended shapes only replace the previous ones
+void RenderThread::UpdateScene(const SceneSnapshot& snapshot)
+{
+    if (snapshot.scene != m_shared)
+    {
+        m_shared = snapshot.scene;
+        m_appended.reset();
+        m_scene = *m_shared;
+        m_tree.Clear();
+        m_lod.Clear();
+        IndexShapes(0);
+    }
+
+    if (snapshot.appended != m_appended)
+    {
+        const uint32_t first = (uint32_t)m_shared->ShapeCount();
+        const uint32_t last = (uint32_t)m_scene.ShapeCount();
+        if (last > first)
+        {
+            for (uint32_t id = first; id < last; ++id)
+                m_lod.Remove(id);
+            m_tree.Remap([first](uint32_t id) { return id < first ? id : BoundsTree::NO_ID; });
+            m_scene.Truncate(first);
+        }
+
+        m_appended = snapshot.appended;
+        if (m_appended)
+            m_appended->CopyTail(0, m_scene);
+        IndexShapes(first);
+    }
+}
+
+void RenderThread::IndexShapes(uint32_t first)
+{
+    const uint32_t shapes = (uint32_t)m_scene.ShapeCount();
+    for (uint32_t id = first; id < shapes; ++id)
+    {
+        const uint32_t count = m_scene.Count(id);
+        if (count == 0)
+            continue;
+
+        m_tree.Insert(id, m_scene.Bounds(id));
+        const ShapeKind kind = m_scene.Kind(id);
+        if (kind == SHAPE_MULTILINE || kind == SHAPE_POLIGON)
+            m_lod.Build(id, m_scene.Xs() + m_scene.Offset(id), m_scene.Ys() + m_scene.Offset(id), count);
+    }
+}
+
+// Renders the shapes reaching area into surface. Tall areas are cut into
+// horizontal bands stroked on the pool; the tree is only queried here, it
+// rebuilds lazily and is not safe to share.
+void RenderThread::RenderArea(PixelBuffer& surface, const ScreenRect& area)
+{
+    const int32_t width = area.right - area.left;
+    const int32_t height = area.bottom - area.top;
+    if (width <= 0 || height <= 0 || !m_shared)
+        return;
+
+    size_t bands = m_pool->Size();
+    if (bands > (size_t)(height / MIN_BAND_ROWS))
+        bands = (size_t)(height / MIN_BAND_ROWS);
+    if (bands == 0)
+        bands = 1;
+    if (m_bandIds.size() < bands)
+    {
+        m_bandIds.resize(bands);
+        m_bandPixels.resize(bands);
+    }
+
+    const int32_t margin = (m_pen.width > 1 ? m_pen.width : 1) / 2 + 2;
+    for (size_t i = 0; i < bands; ++i)
+    {
+        const ScreenRect band{
+            area.left, area.top + (int32_t)((int64_t)height * i / bands),
+            area.right, area.top + (int32_t)((int64_t)height * (i + 1) / bands) };
+        m_bandIds[i].clear();
+        m_tree.Query(AreaWorldRect(m_camera, band, margin), [&](uint32_t id) { m_bandIds[i].push_back(id); });
+    }
+
+    auto rasterize = [this, &area, height, bands](size_t i)
+        {
+            const int32_t top = area.top + (int32_t)((int64_t)height * i / bands);
+            const int32_t bottom = area.top + (int32_t)((int64_t)height * (i + 1) / bands);
+
+            RasterOptions options;
+            options.width = (uint32_t)(area.right - area.left);
+            options.height = (uint32_t)(bottom - top);
+            options.camera = m_camera;
+            options.camera.panX -= area.left;
+            options.camera.panY -= top;
+            options.pen = m_pen;
+            options.background = m_background;
+            options.lod = &m_lod;
+            RasterizeShapes(m_scene, m_bandIds[i].data(), m_bandIds[i].size(), options, m_bandPixels[i]);
+        };
+
+    if (bands == 1)
+    {
+        rasterize(0);
+    }
+    else
+    {
+        std::vector<std::future<void>> jobs;
+        jobs.reserve(bands);
+        for (size_t i = 0; i < bands; ++i)
+            jobs.push_back(m_pool->Submit([&rasterize, i]() { rasterize(i); }));
+        for (std::future<void>& job : jobs)
+            job.get();
+    }
+
+    for (size_t i = 0; i < bands; ++i)
+        surface.Blit(m_bandPixels[i], area.left, area.top + (int32_t)((int64_t)height * i / bands));
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BoundsTree.h"
+#include "DisplayList.h"
+#include "Geometry.h"
+#include "PixelBuffer.h"
+#include "PolygonLod.h"
+#include "RenderLayers.h"
+#include "SceneStore.h"
+#include "TripleBuffer.h"
+
+class ThreadPool;
+
+// -------------------- Render thread --------------------
+// Rasterizes the committed scene away from the UI thread. The UI thread
+// publishes immutable snapshots (scene, camera, viewport) and picks up the
+// finished frames; both directions are triple buffers, so publishing and
+// taking never lock or wait, and a render thread that falls behind only
+// skips to the newest snapshot.
+//
+// A snapshot shares its scene with the snapshots published before it. When
+// the scene version changes and every edit since the shared copy was made
+// lies past its last shape (shapes drawn, or drawn and undone), only the
+// shapes after it are copied, into the snapshot's appended store; other
+// edits, or appended shapes outgrowing a quarter of the copy, make the UI
+// thread copy the whole store again (one bulk copy per array). The render
+// thread keeps its own copy with a bounds tree and polygon levels (zoomed
+// out frames stroke simplified dense polygons) and only swaps the appended
+// shapes while the shared copy stays the same. Frames are kept in a
+// RetainedLayer, so pans only render the exposed strips.
+struct SceneSnapshot {
+    std::shared_ptr<const SceneStore> scene;    // never modified once published
+    std::shared_ptr<const SceneStore> appended; // shapes after scene's, ids continue from its count; may be null
+    LayerKey key;                               // scene version, zoom, pan and frame size
+    Camera camera;                              // world -> frame pixels
+    PenStyle pen{ 0, 0, 255, 2 };
+    uint32_t background = 0x00FFFFFF;
+    uint64_t serial = 0;                        // publish counter, 1 for the first snapshot
+};
+
+struct RenderedFrame {
+    PixelBuffer pixels;                         // 0x00RRGGBB, key.width x key.height
+    LayerKey key;                               // of the snapshot shown
+    Camera camera;
+    uint64_t serial = 0;                        // of the snapshot shown, 0 before the first frame
+    int64_t renderNanos = 0;
+};
+
+class RenderThread
+{
+public:
+    RenderThread() = default;
+    ~RenderThread();                            // stops the thread
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Areas are stroked on pool. onFrame runs on the render thread after each
+    // published frame, e.g. to wake the UI thread; it must not call back into
+    // this object.
+    void Start(ThreadPool& pool, std::function<void()> onFrame);
+    void Stop();                                // finishes the frame in flight, then joins
+    bool Running() const { return m_running.load(std::memory_order_relaxed); }
+
+    // ---- UI thread ----
+    // Hand a new view to the render thread. The scene is copied only when
+    // key.sceneVersion differs from the last published one, and then only the
+    // shapes past the shared copy when the edits allow (see above); the
+    // scene's change tracking is cleared for the next version. Returns the serial.
+    uint64_t Publish(SceneStore& scene, const LayerKey& key, const Camera& camera,
+        const PenStyle& pen, uint32_t background);
+    uint64_t LastPublished() const { return m_serial; }
+
+    // Switch Frame() to the newest finished frame. Returns false when none
+    // arrived since the last call. Frame() stays valid until the next take.
+    bool TakeFrame() { return m_frames.Take(); }
+    const RenderedFrame& Frame() const { return m_frames.Front(); }
+
+    // ---- counters, any thread ----
+    uint64_t FramesRendered() const { return m_rendered.load(std::memory_order_relaxed); }
+    uint64_t FramesScrolled() const { return m_scrolled.load(std::memory_order_relaxed); }
+    uint64_t SnapshotsSkipped() const { return m_skipped.load(std::memory_order_relaxed); }
+    uint64_t SceneCopies() const { return m_sceneCopies; }     // whole store copied (UI thread)
+    uint64_t SceneShares() const { return m_sceneShares; }     // only appended shapes copied (UI thread)
+
+private:
+    static const int32_t MIN_BAND_ROWS = 32;   // smaller areas are not split across the pool
+    static const size_t MAX_APPENDED_SHARE = 4; // appended vertices * this <= vertices of the shared copy
+
+    void RenderLoop();
+    void Render(const SceneSnapshot& snapshot);
+    void UpdateScene(const SceneSnapshot& snapshot);
+    void IndexShapes(uint32_t first);
+    void RenderArea(PixelBuffer& surface, const ScreenRect& area);
+
+    ThreadPool* m_pool = nullptr;
+    TripleBuffer<SceneSnapshot> m_snapshots;    // UI -> render
+    TripleBuffer<RenderedFrame> m_frames;       // render -> UI
+
+    // UI thread only
+    std::shared_ptr<const SceneStore> m_publishedScene;
+    std::shared_ptr<const SceneStore> m_publishedAppended;
+    uint64_t m_publishedVersion = 0;
+    uint64_t m_serial = 0;
+    uint64_t m_sceneCopies = 0;
+    uint64_t m_sceneShares = 0;
+
+    // render thread only
+    std::shared_ptr<const SceneStore> m_shared;     // of the snapshot shown
+    std::shared_ptr<const SceneStore> m_appended;
+    SceneStore m_scene;                             // m_shared's shapes followed by m_appended's
+    BoundsTree m_tree;
+    PolygonLod m_lod;
+    RetainedLayer<PixelBuffer> m_layer;
+    Camera m_camera;
+    PenStyle m_pen{ 0, 0, 255, 2 };
+    uint32_t m_background = 0x00FFFFFF;
+    uint64_t m_lastSerial = 0;
+    std::vector<std::vector<uint32_t>> m_bandIds;
+    std::vector<PixelBuffer> m_bandPixels;
+
+    std::function<void()> m_onFrame;
+    std::atomic<uint32_t> m_signal{ 0 };        // bumped to wake the render thread
+    std::atomic<bool> m_running{ false };
+    std::atomic<uint64_t> m_rendered{ 0 };
+    std::atomic<uint64_t> m_scrolled{ 0 };
+    std::atomic<uint64_t> m_skipped{ 0 };
+    std::thread m_thread;
+};
@@ -0,0 +1,248 @@
+#include "SceneFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(ShapeKind) == 1, "kinds section stores one byte per shape");
+
+namespace {
+
+    const char SCENE_MAGIC[8] = { 'G', 'D', 'I', 'S', 'C', 'E', 'N', 'E' };
+    const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    uint64_t AlignUp(uint64_t v)
+    {
+        return (v + SCENE_FILE_ALIGNMENT - 1) & ~(uint64_t)(SCENE_FILE_ALIGNMENT - 1);
+    }
+
+    FILE* OpenForWrite(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        FILE* f = nullptr;
+        if (_wfopen_s(&f, path.c_str(), L"wb") != 0)
+            return nullptr;
+        return f;
+#else
+        return std::fopen(path.c_str(), "wb");
+#endif
+    }
+
+    // Writes one section at its aligned offset, padding the gap before it
+    bool WriteSection(FILE* f, uint64_t& pos, uint64_t offset, const void* data, size_t bytes)
+    {
+        static const char zeros[SCENE_FILE_ALIGNMENT] = {};
+        if (offset > pos && std::fwrite(zeros, 1, (size_t)(offset - pos), f) != offset - pos)
+            return false;
+        pos = offset;
+
+        if (bytes > 0 && std::fwrite(data, 1, bytes, f) != bytes)
+            return false;
+        pos += bytes;
+        return true;
+    }
+
+} // namespace
+
+bool SaveSceneFile(const std::filesystem::path& path, const SceneStore& scene)
+{
+    const uint64_t shapes = scene.ShapeCount();
+    const uint64_t vertices = scene.VertexCount();
+
+    SceneFileHeader header{};
+    std::memcpy(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+    header.version = SCENE_FILE_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.shapeCount = shapes;
+    header.vertexCount = vertices;
+    header.kindsOffset = AlignUp(sizeof(SceneFileHeader));
+    header.offsetsOffset = AlignUp(header.kindsOffset + shapes * sizeof(ShapeKind));
+    header.countsOffset = AlignUp(header.offsetsOffset + shapes * sizeof(uint32_t));
+    header.xsOffset = AlignUp(header.countsOffset + shapes * sizeof(uint32_t));
+    header.ysOffset = AlignUp(header.xsOffset + vertices * sizeof(int32_t));
+    header.fileSize = header.ysOffset + vertices * sizeof(int32_t);
+
+    FILE* f = OpenForWrite(path);
+    if (!f)
+        return false;
+
+    uint64_t pos = 0;
+    bool ok =
+        WriteSection(f, pos, 0, &header, sizeof(header)) &&
+        WriteSection(f, pos, header.kindsOffset, scene.Kinds(), (size_t)shapes * sizeof(ShapeKind)) &&
+        WriteSection(f, pos, header.offsetsOffset, scene.Offsets(), (size_t)shapes * sizeof(uint32_t)) &&
+        WriteSection(f, pos, header.countsOffset, scene.Counts(), (size_t)shapes * sizeof(uint32_t)) &&
+        WriteSection(f, pos, header.xsOffset, scene.Xs(), (size_t)vertices * sizeof(int32_t)) &&
+        WriteSection(f, pos, header.ysOffset, scene.Ys(), (size_t)vertices * sizeof(int32_t));
+
+    if (std::fclose(f) != 0)
+        ok = false;
+    return ok;
+}
+
+// -------------------- SceneFileView --------------------
+SceneFileView::~SceneFileView()
+{
+    Close();
+}
+
+bool SceneFileView::Open(const std::filesystem::path& path)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_fileHandle = file;
+    m_mappingHandle = mapping;
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = (size_t)size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);            // the mapping keeps the file alive
+    if (data == MAP_FAILED)
+        return false;
+
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = (size_t)st.st_size;
+#endif
+
+    if (!Validate(m_size))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SceneFileView::Close()
+{
+    if (m_data)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+        CloseHandle((HANDLE)m_mappingHandle);
+        CloseHandle((HANDLE)m_fileHandle);
+#else
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_fileHandle = nullptr;
+    m_mappingHandle = nullptr;
+    m_header = nullptr;
+    m_kinds = nullptr;
+    m_offsets = nullptr;
+    m_counts = nullptr;
+    m_xs = nullptr;
+    m_ys = nullptr;
+}
+
+bool SceneFileView::Validate(size_t size)
+{
+    if (size < sizeof(SceneFileHeader))
+        return false;
+
+    const SceneFileHeader* h = reinterpret_cast<const SceneFileHeader*>(m_data);
+    if (std::memcmp(h->magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0 ||
+        h->version != SCENE_FILE_VERSION || h->byteOrder != BYTE_ORDER_MARK || h->fileSize > size)
+    {
+        return false;
+    }
+
+    // every section must be aligned and inside the file
+    auto sectionOk = [&](uint64_t offset, uint64_t count, uint64_t elemSize)
+        {
+            if (offset % SCENE_FILE_ALIGNMENT != 0 || count > size / elemSize)
+                return false;
+            return offset <= size && count * elemSize <= size - offset;
+        };
+
+    if (!sectionOk(h->kindsOffset, h->shapeCount, sizeof(ShapeKind)) ||
+        !sectionOk(h->offsetsOffset, h->shapeCount, sizeof(uint32_t)) ||
+        !sectionOk(h->countsOffset, h->shapeCount, sizeof(uint32_t)) ||
+        !sectionOk(h->xsOffset, h->vertexCount, sizeof(int32_t)) ||
+        !sectionOk(h->ysOffset, h->vertexCount, sizeof(int32_t)))
+    {
+        return false;
+    }
+
+    const ShapeKind* kinds = reinterpret_cast<const ShapeKind*>(m_data + h->kindsOffset);
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(m_data + h->offsetsOffset);
+    const uint32_t* counts = reinterpret_cast<const uint32_t*>(m_data + h->countsOffset);
+
+    // shape slices must tile the vertex pool in id order, like SceneStore
+    // keeps it: Remove, Insert and MoveTail rely on the packed layout
+    uint64_t next = 0;
+    for (uint64_t i = 0; i < h->shapeCount; ++i)
+    {
+        if (kinds[i] > SHAPE_POLIGON || offsets[i] != next)
+            return false;
+        next += counts[i];
+        if (next > h->vertexCount)
+            return false;
+    }
+    if (next != h->vertexCount)
+        return false;
+
+    m_header = h;
+    m_kinds = kinds;
+    m_offsets = offsets;
+    m_counts = counts;
+    m_xs = reinterpret_cast<const int32_t*>(m_data + h->xsOffset);
+    m_ys = reinterpret_cast<const int32_t*>(m_data + h->ysOffset);
+    return true;
+}
+
+void SceneFileView::CopyTo(SceneStore& scene) const
+{
+    scene.Assign(m_kinds, m_offsets, m_counts, ShapeCount(), m_xs, m_ys, VertexCount());
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "SceneStore.h"
+
+// -------------------- Binary scene file --------------------
+// Layout (little endian, every section starts on a SCENE_FILE_ALIGNMENT boundary):
+//
+//   SceneFileHeader
+//   kinds    uint8_t [shapeCount]
+//   offsets  uint32_t[shapeCount]
+//   counts   uint32_t[shapeCount]
+//   xs       int32_t [vertexCount]
+//   ys       int32_t [vertexCount]
+//
+// The sections are the SceneStore arrays as they are in memory, so a save is
+// one write per section and a mapped file can be read in place.
+
+const uint32_t SCENE_FILE_VERSION = 1;
+const uint32_t SCENE_FILE_ALIGNMENT = 64;
+
+struct SceneFileHeader {
+    char magic[8];              // "GDISCENE"
+    uint32_t version;
+    uint32_t byteOrder;         // 0x01020304 as written by the saving machine
+    uint64_t shapeCount;
+    uint64_t vertexCount;
+    uint64_t kindsOffset;
+    uint64_t offsetsOffset;
+    uint64_t countsOffset;
+    uint64_t xsOffset;
+    uint64_t ysOffset;
+    uint64_t fileSize;
+};
+
+bool SaveSceneFile(const std::filesystem::path& path, const SceneStore& scene);
+
+// Read-only, zero-copy view of a memory mapped scene file. Exposes the same
+// table accessors as SceneStore; pointers stay valid until Close().
+class SceneFileView
+{
+public:
+    SceneFileView() = default;
+    ~SceneFileView();
+    SceneFileView(const SceneFileView&) = delete;
+    SceneFileView& operator=(const SceneFileView&) = delete;
+
+    // Maps the file and validates header and section bounds. The shape
+    // slices must be packed: offsets[0] == 0, each shape starts where the
+    // previous one ends and the counts add up to vertexCount.
+    bool Open(const std::filesystem::path& path);
+    void Close();
+    bool IsOpen() const { return m_header != nullptr; }
+
+    size_t ShapeCount() const { return m_header ? (size_t)m_header->shapeCount : 0; }
+    size_t VertexCount() const { return m_header ? (size_t)m_header->vertexCount : 0; }
+
+    const ShapeKind* Kinds() const { return m_kinds; }
+    const uint32_t* Offsets() const { return m_offsets; }
+    const uint32_t* Counts() const { return m_counts; }
+    const int32_t* Xs() const { return m_xs; }
+    const int32_t* Ys() const { return m_ys; }
+
+    ShapeKind Kind(uint32_t id) const { return m_kinds[id]; }
+    uint32_t Offset(uint32_t id) const { return m_offsets[id]; }
+    uint32_t Count(uint32_t id) const { return m_counts[id]; }
+
+    // Copy into an editable store (one bulk copy per array)
+    void CopyTo(SceneStore& scene) const;
+
+private:
+    bool Validate(size_t size);
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    void* m_fileHandle = nullptr;       // platform handles, see SceneFile.cpp
+    void* m_mappingHandle = nullptr;
+
+    const SceneFileHeader* m_header = nullptr;
+    const ShapeKind* m_kinds = nullptr;
+    const uint32_t* m_offsets = nullptr;
+    const uint32_t* m_counts = nullptr;
+    const int32_t* m_xs = nullptr;
+    const int32_t* m_ys = nullptr;
+};
@@ -0,0 +1,77 @@
+#include "SceneGenerator.h"
+
+#include <vector>
+
+#include "RegularPolygon.h"
+
+void GenerateScene(const SceneSpec& spec, SceneStore& scene)
+{
+    SceneRandom rng(spec.seed);
+
+    const uint32_t totalWeight = spec.lineWeight + spec.rectWeight + spec.ellipseWeight +
+        spec.multilineWeight + spec.poligonWeight;
+    if (totalWeight == 0)
+        return;
+
+    const int32_t world = spec.worldSize > 1 ? spec.worldSize : 2;
+    const int32_t size = spec.maxShapeSize > 1 ? spec.maxShapeSize : 2;
+    const uint32_t maxWalk = spec.maxMultilineVertices > 3 ? spec.maxMultilineVertices : 4;
+
+    std::vector<WorldPoint> pts;
+    WorldPoint polygon[MAX_POLY_VERTICES];
+
+    while (scene.VertexCount() < spec.targetVertices)
+    {
+        const WorldPoint origin{ rng.Range(0, world - 1), rng.Range(0, world - 1) };
+        const WorldPoint corner{ origin.x + rng.Range(1, size), origin.y + rng.Range(1, size) };
+
+        uint32_t pick = (uint32_t)(rng.Next() % totalWeight);
+
+        if (pick < spec.lineWeight)
+        {
+            WorldPoint line[2] = { origin, corner };
+            scene.Append(SHAPE_LINE, line, 2);
+            continue;
+        }
+        pick -= spec.lineWeight;
+
+        if (pick < spec.rectWeight)
+        {
+            WorldPoint rect[2] = { origin, corner };
+            scene.Append(SHAPE_RECT, rect, 2);
+            continue;
+        }
+        pick -= spec.rectWeight;
+
+        if (pick < spec.ellipseWeight)
+        {
+            WorldPoint box[2] = { origin, corner };
+            scene.Append(SHAPE_ELLIPSE, box, 2);
+            continue;
+        }
+        pick -= spec.ellipseWeight;
+
+        if (pick < spec.multilineWeight)
+        {
+            // closed random walk inside the shape box
+            const uint32_t count = (uint32_t)rng.Range(3, (int32_t)maxWalk - 1);
+            const int32_t step = size / 8 > 1 ? size / 8 : 2;
+
+            pts.clear();
+            WorldPoint p = origin;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                pts.push_back(p);
+                p.x += rng.Range(-step, step);
+                p.y += rng.Range(-step, step);
+            }
+            pts.push_back(pts.front());
+            scene.Append(SHAPE_MULTILINE, pts.data(), (uint32_t)pts.size());
+            continue;
+        }
+
+        const int sides = rng.Range(MIN_POLY_SIDES, MAX_POLY_SIDES);
+        const int count = GenerateRegularPolygon(origin, WorldPoint{ origin.x + rng.Range(1, size / 2), origin.y }, sides, polygon);
+        scene.Append(SHAPE_POLIGON, polygon, (uint32_t)count);
+    }
+}
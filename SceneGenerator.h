@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "SceneStore.h"
+
+// -------------------- Synthetic scenes --------------------
+// Deterministic random scenes for benchmarks: the same spec gives the same
+// scene on every platform (own PRNG, no <random> distributions).
+//
+// Shapes are picked by weight; multilines are closed random walks and
+// poligons come from GenerateRegularPolygon, like the ones drawn in the app.
+
+struct SceneSpec {
+    size_t targetVertices = 1000000;    // generation stops once reached
+    uint64_t seed = 1;
+    int32_t worldSize = 1 << 20;        // shapes lie in [0, worldSize)^2
+    int32_t maxShapeSize = 2000;        // bounding box edge of one shape
+
+    // relative frequency of each kind
+    uint32_t lineWeight = 4;
+    uint32_t rectWeight = 2;
+    uint32_t ellipseWeight = 2;
+    uint32_t multilineWeight = 1;
+    uint32_t poligonWeight = 1;
+
+    uint32_t maxMultilineVertices = 256;
+};
+
+// xorshift64*: small, fast and identical everywhere
+class SceneRandom
+{
+public:
+    explicit SceneRandom(uint64_t seed) : m_state(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+
+    uint64_t Next()
+    {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return m_state * 0x2545F4914F6CDD1Dull;
+    }
+
+    // uniform in [lo, hi]
+    int32_t Range(int32_t lo, int32_t hi)
+    {
+        return lo + (int32_t)(Next() % (uint64_t)((int64_t)hi - lo + 1));
+    }
+
+private:
+    uint64_t m_state;
+};
+
+// Appends shapes to scene until it holds at least spec.targetVertices vertices
+void GenerateScene(const SceneSpec& spec, SceneStore& scene);
@@ -0,0 +1,241 @@
+#include "SceneHistory.h"
+
+#include <algorithm>
+
+namespace {
+
+    size_t HeldSize(const std::unique_ptr<SceneStore>& held, const std::unique_ptr<PackedShapes>& packed)
+    {
+        return (held ? held->MemoryBytes() : 0) + (packed ? packed->MemoryBytes() : 0);
+    }
+
+} // namespace
+
+SceneHistory::SceneHistory(size_t maxSteps, size_t maxHeldBytes)
+    : m_maxSteps(maxSteps > 0 ? maxSteps : 1), m_maxHeldBytes(maxHeldBytes)
+{
+}
+
+void SceneHistory::RecordAppend(uint32_t first, uint32_t count)
+{
+    if (count == 0)
+        return;
+
+    Entry e;
+    e.kind = HISTORY_APPEND;
+    e.first = first;
+    e.count = count;
+    Push(std::move(e));
+}
+
+void SceneHistory::RemoveShapes(SceneStore& scene, const uint32_t* ids, size_t count)
+{
+    Entry e;
+    e.kind = HISTORY_REMOVE;
+    e.ids.assign(ids, ids + count);
+    std::sort(e.ids.begin(), e.ids.end());
+    e.ids.erase(std::unique(e.ids.begin(), e.ids.end()), e.ids.end());
+    while (!e.ids.empty() && e.ids.back() >= scene.ShapeCount())
+        e.ids.pop_back();
+    if (e.ids.empty())
+        return;
+
+    // keep the shapes (ascending) and compact the scene, one pass
+    e.held = std::make_unique<SceneStore>();
+    scene.Extract(e.ids.data(), e.ids.size(), *e.held);
+
+    e.count = (uint32_t)e.ids.size();
+    Push(std::move(e));
+}
+
+void SceneHistory::ReplaceScene(SceneStore& scene, SceneStore&& next)
+{
+    Entry e;
+    e.kind = HISTORY_REPLACE;
+    e.held = std::make_unique<SceneStore>(std::move(next));
+    std::swap(scene, *e.held);
+    Push(std::move(e));
+}
+
+bool SceneHistory::Undo(SceneStore& scene, HistoryChange* change)
+{
+    if (!CanUndo())
+        return false;
+
+    Entry& e = m_entries[--m_done];
+    Warm(e);
+    Release(e);
+
+    switch (e.kind)
+    {
+    case HISTORY_APPEND:
+        // the appended shapes are at the tail again: everything after them was undone
+        e.held = std::make_unique<SceneStore>();
+        scene.MoveTail(e.first, *e.held);
+        break;
+
+    case HISTORY_REMOVE:
+        // every shape lands at the id it had before the removal
+        scene.Merge(e.ids.data(), *e.held);
+        e.held.reset();
+        break;
+
+    case HISTORY_REPLACE:
+        std::swap(scene, *e.held);
+        break;
+    }
+
+    Hold(e);
+    if (change)
+        *change = Describe(e, true);
+
+    // the entry after the next redo left the hot pair
+    Cool(m_done + 1);
+    return true;
+}
+
+bool SceneHistory::Redo(SceneStore& scene, HistoryChange* change)
+{
+    if (!CanRedo())
+        return false;
+
+    Entry& e = m_entries[m_done++];
+    Warm(e);
+    Release(e);
+
+    switch (e.kind)
+    {
+    case HISTORY_APPEND:
+        e.first = (uint32_t)scene.ShapeCount();
+        e.held->MoveTail(0, scene);
+        e.held.reset();
+        break;
+
+    case HISTORY_REMOVE: {
+        e.held = std::make_unique<SceneStore>();
+        scene.Extract(e.ids.data(), e.ids.size(), *e.held);
+        break;
+    }
+
+    case HISTORY_REPLACE:
+        std::swap(scene, *e.held);
+        break;
+    }
+
+    Hold(e);
+    if (change)
+        *change = Describe(e, false);
+
+    // and here the one before the next undo
+    if (m_done >= 2)
+        Cool(m_done - 2);
+    return true;
+}
+
+bool SceneHistory::PeekUndo(HistoryChange& change) const
+{
+    if (!CanUndo())
+        return false;
+    change = Describe(m_entries[m_done - 1], true);
+    return true;
+}
+
+bool SceneHistory::PeekRedo(HistoryChange& change) const
+{
+    if (!CanRedo())
+        return false;
+    change = Describe(m_entries[m_done], false);
+    return true;
+}
+
+HistoryChange SceneHistory::Describe(const Entry& entry, bool undo)
+{
+    const uint32_t* ids = entry.kind == HISTORY_REMOVE ? entry.ids.data() : nullptr;
+    return HistoryChange{ entry.kind, undo, entry.first, entry.count, ids };
+}
+
+void SceneHistory::Clear()
+{
+    m_entries.clear();
+    m_done = 0;
+    m_heldBytes = 0;
+}
+
+size_t SceneHistory::MemoryBytes() const
+{
+    size_t bytes = sizeof(*this) + m_entries.size() * sizeof(Entry) + m_heldBytes;
+    for (const Entry& e : m_entries)
+        bytes += e.ids.capacity() * sizeof(uint32_t);
+    return bytes;
+}
+
+void SceneHistory::Push(Entry&& entry)
+{
+    DropRedo();
+    m_entries.push_back(std::move(entry));
+    ++m_done;
+    Hold(m_entries.back());
+    if (m_done >= 2)
+        Cool(m_done - 2);
+    Trim();
+}
+
+void SceneHistory::DropRedo()
+{
+    while (m_entries.size() > m_done)
+    {
+        Release(m_entries.back());
+        m_entries.pop_back();
+    }
+}
+
+// Forget the oldest steps while over the step or memory budget (the newest
+// step is always kept, even if it alone is over the budget)
+void SceneHistory::Trim()
+{
+    while (m_entries.size() > 1 && (m_entries.size() > m_maxSteps || m_heldBytes > m_maxHeldBytes))
+    {
+        Release(m_entries.front());
+        m_entries.pop_front();
+        if (m_done > 0)
+            --m_done;
+    }
+}
+
+void SceneHistory::Hold(Entry& entry)
+{
+    m_heldBytes += HeldSize(entry.held, entry.packed);
+}
+
+void SceneHistory::Release(Entry& entry)
+{
+    m_heldBytes -= HeldSize(entry.held, entry.packed);
+}
+
+void SceneHistory::Cool(size_t index)
+{
+    if (index >= m_entries.size())
+        return;
+
+    Entry& e = m_entries[index];
+    if (!e.held || e.held->MemoryBytes() < MIN_PACK_BYTES)
+        return;
+
+    Release(e);
+    e.packed = std::make_unique<PackedShapes>();
+    e.packed->Pack(*e.held);
+    e.held.reset();
+    Hold(e);
+}
+
+void SceneHistory::Warm(Entry& entry)
+{
+    if (!entry.packed)
+        return;
+
+    Release(entry);
+    entry.held = std::make_unique<SceneStore>();
+    entry.packed->Unpack(*entry.held);
+    entry.packed.reset();
+    Hold(entry);
+}
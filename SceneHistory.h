@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "SceneStore.h"
+#include "VertexCodec.h"
+
+// -------------------- Undo / redo history --------------------
+// Command journal over a SceneStore. An entry never copies the scene: vertex
+// data lives either in the scene or in the entry that took it out, and moves
+// between the two on undo / redo.
+//
+//   append   the ids [first, first + count) were appended. Done: nothing is
+//            stored. Undone: the entry holds the shapes moved off the tail.
+//   remove   shapes were removed. The entry always holds them (with their
+//            ids) because the scene no longer does.
+//   replace  the whole scene was swapped (open file). The entry holds the
+//            other scene; undo / redo swap the two, O(1).
+//
+// Recording an append is O(1) and costs one small entry. The history keeps
+// at most maxSteps entries and evicts the oldest ones once the shapes held
+// by entries exceed maxHeldBytes.
+//
+// Only the next undo and the next redo are likely to be needed soon. Shapes
+// held by any other entry are cold: once at least MIN_PACK_BYTES, they are
+// delta encoded (PackedShapes) and decoded again when the entry is applied.
+// The budget counts the packed size, so it holds several times more steps.
+
+enum HistoryChangeKind
+{
+    HISTORY_APPEND = 0,
+    HISTORY_REMOVE,
+    HISTORY_REPLACE
+};
+
+// What an undo / redo did to the scene, for updating derived indices
+struct HistoryChange {
+    HistoryChangeKind kind;
+    bool undo;              // true: entry was undone, false: redone
+    uint32_t first;         // append: first id of the range
+    uint32_t count;         // append / remove: number of shapes
+    const uint32_t* ids;    // remove: the ascending ids taken out (redo) or put back (undo),
+                            // valid until the next history call
+};
+
+class SceneHistory
+{
+public:
+    static const size_t DEFAULT_MAX_STEPS = 10000;
+    static const size_t DEFAULT_MAX_HELD_BYTES = 256u << 20;
+    static const size_t MIN_PACK_BYTES = 4096;      // smaller held shapes stay as they are
+
+    explicit SceneHistory(size_t maxSteps = DEFAULT_MAX_STEPS, size_t maxHeldBytes = DEFAULT_MAX_HELD_BYTES);
+
+    // Shapes [first, first + count) were just appended to the scene
+    void RecordAppend(uint32_t first, uint32_t count);
+
+    // Remove the given ids from the scene and record it (ids in any order)
+    void RemoveShapes(SceneStore& scene, const uint32_t* ids, size_t count);
+
+    // Make next the current scene and record it; the old scene is kept
+    void ReplaceScene(SceneStore& scene, SceneStore&& next);
+
+    bool CanUndo() const { return m_done > 0; }
+    bool CanRedo() const { return m_done < m_entries.size(); }
+    bool Undo(SceneStore& scene, HistoryChange* change = nullptr);
+    bool Redo(SceneStore& scene, HistoryChange* change = nullptr);
+
+    // What the next Undo / Redo will do, before it is done: lets the caller
+    // drop the shapes about to leave the scene from its indices first
+    bool PeekUndo(HistoryChange& change) const;
+    bool PeekRedo(HistoryChange& change) const;
+
+    void Clear();
+
+    size_t Steps() const { return m_entries.size(); }
+    size_t UndoSteps() const { return m_done; }
+    size_t HeldBytes() const { return m_heldBytes; }        // shapes held by entries
+    size_t MemoryBytes() const;                             // entries + held shapes
+
+private:
+    struct Entry {
+        HistoryChangeKind kind;
+        uint32_t first = 0;
+        uint32_t count = 0;
+        std::vector<uint32_t> ids;                  // remove: ascending ids of the held shapes
+        std::unique_ptr<SceneStore> held;           // shapes not currently in the scene
+        std::unique_ptr<PackedShapes> packed;       // or the same, encoded while cold
+    };
+
+    static HistoryChange Describe(const Entry& entry, bool undo);
+    void Push(Entry&& entry);
+    void DropRedo();
+    void Trim();
+    void Hold(Entry& entry);                        // recount held bytes after entry.held changed
+    void Release(Entry& entry);
+    void Cool(size_t index);                        // pack the held shapes of a cold entry
+    void Warm(Entry& entry);                        // unpack them before the entry is applied
+
+    std::deque<Entry> m_entries;
+    size_t m_done = 0;                              // entries [0, m_done) are applied
+    size_t m_maxSteps;
+    size_t m_maxHeldBytes;
+    size_t m_heldBytes = 0;
+};
@@ -0,0 +1,288 @@
+#include "SceneStore.h"
+
+#include <algorithm>
+
+uint32_t SceneStore::Append(ShapeKind kind, const WorldPoint* pts, uint32_t count)
+{
+    const uint32_t id = static_cast<uint32_t>(m_kinds.size());
+
+    m_offsets.push_back(static_cast<uint32_t>(m_xs.size()));
+    m_counts.push_back(count);
+    m_kinds.push_back(kind);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        m_xs.push_back(pts[i].x);
+        m_ys.push_back(pts[i].y);
+    }
+
+    return id;
+}
+
+void SceneStore::Remove(uint32_t id)
+{
+    if (id >= m_kinds.size())
+        return;
+
+    MarkChanged(id);
+    const uint32_t offset = m_offsets[id];
+    const uint32_t count = m_counts[id];
+
+    // Close the gap in the vertex pool and shift the slices that followed it
+    m_xs.erase(m_xs.begin() + offset, m_xs.begin() + offset + count);
+    m_ys.erase(m_ys.begin() + offset, m_ys.begin() + offset + count);
+
+    m_offsets.erase(m_offsets.begin() + id);
+    m_counts.erase(m_counts.begin() + id);
+    m_kinds.erase(m_kinds.begin() + id);
+
+    for (size_t i = id; i < m_offsets.size(); ++i)
+        m_offsets[i] -= count;
+}
+
+void SceneStore::Insert(uint32_t id, ShapeKind kind, const int32_t* xs, const int32_t* ys, uint32_t count)
+{
+    if (id > m_kinds.size())
+        return;
+
+    MarkChanged(id);
+
+    // The new slice starts where the shape currently at id starts
+    const uint32_t offset = id < m_kinds.size() ? m_offsets[id] : static_cast<uint32_t>(m_xs.size());
+
+    m_xs.insert(m_xs.begin() + offset, xs, xs + count);
+    m_ys.insert(m_ys.begin() + offset, ys, ys + count);
+
+    for (size_t i = id; i < m_offsets.size(); ++i)
+        m_offsets[i] += count;
+
+    m_offsets.insert(m_offsets.begin() + id, offset);
+    m_counts.insert(m_counts.begin() + id, count);
+    m_kinds.insert(m_kinds.begin() + id, kind);
+}
+
+void SceneStore::MoveTail(uint32_t first, SceneStore& dst)
+{
+    CopyTail(first, dst);
+    Truncate(first);
+}
+
+void SceneStore::CopyTail(uint32_t first, SceneStore& dst) const
+{
+    if (first >= m_kinds.size())
+        return;
+
+    const uint32_t vertexBegin = m_offsets[first];
+    const uint32_t base = static_cast<uint32_t>(dst.m_xs.size());
+
+    dst.m_xs.insert(dst.m_xs.end(), m_xs.begin() + vertexBegin, m_xs.end());
+    dst.m_ys.insert(dst.m_ys.end(), m_ys.begin() + vertexBegin, m_ys.end());
+    for (size_t id = first; id < m_kinds.size(); ++id)
+        dst.m_offsets.push_back(m_offsets[id] - vertexBegin + base);
+    dst.m_counts.insert(dst.m_counts.end(), m_counts.begin() + first, m_counts.end());
+    dst.m_kinds.insert(dst.m_kinds.end(), m_kinds.begin() + first, m_kinds.end());
+}
+
+void SceneStore::Truncate(uint32_t count)
+{
+    if (count >= m_kinds.size())
+        return;
+
+    MarkChanged(count);
+    const uint32_t vertexEnd = m_offsets[count];
+    m_xs.resize(vertexEnd);
+    m_ys.resize(vertexEnd);
+    m_offsets.resize(count);
+    m_counts.resize(count);
+    m_kinds.resize(count);
+}
+
+void SceneStore::Extract(const uint32_t* ids, size_t count, SceneStore& dst)
+{
+    if (count == 0)
+        return;
+
+    MarkChanged(ids[0]);
+    const size_t shapes = m_kinds.size();
+    size_t vertices = 0;
+    for (size_t i = 0; i < count; ++i)
+        vertices += m_counts[ids[i]];
+    dst.Reserve(dst.ShapeCount() + count, dst.VertexCount() + vertices);
+
+    // Kept shapes after the first extracted one slide down over the gaps;
+    // writes never pass the shape being read
+    size_t next = 0;
+    uint32_t writeId = ids[0];
+    uint32_t writeVertex = m_offsets[ids[0]];
+    for (uint32_t id = ids[0]; id < shapes; ++id)
+    {
+        const uint32_t offset = m_offsets[id];
+        const uint32_t n = m_counts[id];
+
+        if (next < count && ids[next] == id)
+        {
+            dst.m_offsets.push_back(static_cast<uint32_t>(dst.m_xs.size()));
+            dst.m_counts.push_back(n);
+            dst.m_kinds.push_back(m_kinds[id]);
+            dst.m_xs.insert(dst.m_xs.end(), m_xs.begin() + offset, m_xs.begin() + offset + n);
+            dst.m_ys.insert(dst.m_ys.end(), m_ys.begin() + offset, m_ys.begin() + offset + n);
+            ++next;
+            continue;
+        }
+
+        if (writeVertex != offset)
+        {
+            std::copy(m_xs.begin() + offset, m_xs.begin() + offset + n, m_xs.begin() + writeVertex);
+            std::copy(m_ys.begin() + offset, m_ys.begin() + offset + n, m_ys.begin() + writeVertex);
+        }
+        m_offsets[writeId] = writeVertex;
+        m_counts[writeId] = n;
+        m_kinds[writeId] = m_kinds[id];
+        ++writeId;
+        writeVertex += n;
+    }
+
+    m_xs.resize(writeVertex);
+    m_ys.resize(writeVertex);
+    m_offsets.resize(writeId);
+    m_counts.resize(writeId);
+    m_kinds.resize(writeId);
+}
+
+void SceneStore::Merge(const uint32_t* ids, const SceneStore& src)
+{
+    const size_t count = src.m_kinds.size();
+    if (count == 0)
+        return;
+
+    MarkChanged(ids[0]);
+    const size_t oldShapes = m_kinds.size();
+    const size_t oldVertices = m_xs.size();
+    const size_t shapes = oldShapes + count;
+    const size_t vertices = oldVertices + src.m_xs.size();
+    m_xs.resize(vertices);
+    m_ys.resize(vertices);
+    m_offsets.resize(shapes);
+    m_counts.resize(shapes);
+    m_kinds.resize(shapes);
+
+    // Fill from the back: the old shapes move up to make room, writes never
+    // overtake the old shape being read
+    size_t next = count;                    // src shapes [0, next) still to place
+    size_t read = oldShapes;                // old shapes [0, read) still to place
+    size_t writeVertex = vertices;
+    for (size_t id = shapes; id-- > ids[0]; )
+    {
+        if (next > 0 && ids[next - 1] == id)
+        {
+            --next;
+            const uint32_t offset = src.m_offsets[next];
+            const uint32_t n = src.m_counts[next];
+            writeVertex -= n;
+            std::copy(src.m_xs.begin() + offset, src.m_xs.begin() + offset + n, m_xs.begin() + writeVertex);
+            std::copy(src.m_ys.begin() + offset, src.m_ys.begin() + offset + n, m_ys.begin() + writeVertex);
+            m_counts[id] = n;
+            m_kinds[id] = src.m_kinds[next];
+        }
+        else
+        {
+            --read;
+            const uint32_t offset = m_offsets[read];
+            const uint32_t n = m_counts[read];
+            writeVertex -= n;
+            if (writeVertex != offset)
+            {
+                std::copy_backward(m_xs.begin() + offset, m_xs.begin() + offset + n, m_xs.begin() + writeVertex + n);
+                std::copy_backward(m_ys.begin() + offset, m_ys.begin() + offset + n, m_ys.begin() + writeVertex + n);
+            }
+            m_counts[id] = n;
+            m_kinds[id] = m_kinds[read];
+        }
+        m_offsets[id] = static_cast<uint32_t>(writeVertex);
+    }
+}
+
+uint32_t SceneStore::IdAfterExtract(const uint32_t* ids, size_t count, uint32_t id)
+{
+    const size_t below = std::lower_bound(ids, ids + count, id) - ids;
+    if (below < count && ids[below] == id)
+        return NO_ID;
+    return id - static_cast<uint32_t>(below);
+}
+
+uint32_t SceneStore::IdAfterMerge(const uint32_t* ids, size_t count, uint32_t id)
+{
+    // ids[i] - i (the old id the i-th merged shape lands in front of) never
+    // decreases: count the merged shapes that land in front of id
+    size_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        const size_t mid = (lo + hi) / 2;
+        if (ids[mid] - mid <= id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return id + static_cast<uint32_t>(lo);
+}
+
+void SceneStore::Clear()
+{
+    m_xs.clear();
+    m_ys.clear();
+    m_offsets.clear();
+    m_counts.clear();
+    m_kinds.clear();
+    m_changed.first = 0;
+}
+
+void SceneStore::Assign(const ShapeKind* kinds, const uint32_t* offsets, const uint32_t* counts, size_t shapeCount,
+    const int32_t* xs, const int32_t* ys, size_t vertexCount)
+{
+    m_kinds.assign(kinds, kinds + shapeCount);
+    m_offsets.assign(offsets, offsets + shapeCount);
+    m_counts.assign(counts, counts + shapeCount);
+    m_xs.assign(xs, xs + vertexCount);
+    m_ys.assign(ys, ys + vertexCount);
+    m_changed.first = 0;
+}
+
+void SceneStore::Assign(std::vector<ShapeKind>&& kinds, std::vector<uint32_t>&& offsets, std::vector<uint32_t>&& counts,
+    std::vector<int32_t>&& xs, std::vector<int32_t>&& ys)
+{
+    m_kinds = std::move(kinds);
+    m_offsets = std::move(offsets);
+    m_counts = std::move(counts);
+    m_xs = std::move(xs);
+    m_ys = std::move(ys);
+    m_changed.first = 0;
+}
+
+void SceneStore::Reserve(size_t shapes, size_t vertices)
+{
+    m_xs.reserve(vertices);
+    m_ys.reserve(vertices);
+    m_offsets.reserve(shapes);
+    m_counts.reserve(shapes);
+    m_kinds.reserve(shapes);
+}
+
+WorldRect SceneStore::Bounds(uint32_t id) const
+{
+    const uint32_t begin = m_offsets[id];
+    const uint32_t end = begin + m_counts[id];
+    if (begin == end)
+        return WorldRect{ 0, 0, -1, -1 };
+
+    WorldRect box{ m_xs[begin], m_ys[begin], m_xs[begin], m_ys[begin] };
+    for (uint32_t v = begin + 1; v < end; ++v)
+        RectInclude(box, WorldPoint{ m_xs[v], m_ys[v] });
+    return box;
+}
+
+size_t SceneStore::MemoryBytes() const
+{
+    return m_xs.capacity() * sizeof(int32_t) + m_ys.capacity() * sizeof(int32_t) +
+        m_offsets.capacity() * sizeof(uint32_t) + m_counts.capacity() * sizeof(uint32_t) +
+        m_kinds.capacity() * sizeof(ShapeKind);
+}
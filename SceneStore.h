@@ -0,0 +1,127 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Geometry.h"
+
+// -------------------- Scene store --------------------
+// Committed shapes (stored in WORLD coordinates)
+enum ShapeKind : uint8_t
+{
+    SHAPE_LINE = 0,     // 2 vertices: start, end
+    SHAPE_RECT,         // 2 vertices: opposite corners
+    SHAPE_ELLIPSE,      // 2 vertices: bounding box corners
+    SHAPE_MULTILINE,    // n vertices, closed by repeating the first one
+    SHAPE_POLIGON       // regular polygon vertices, closed the same way
+};
+
+// All vertices live in one contiguous pool split in x / y arrays, each shape
+// is an (offset, count) slice of it plus a one byte kind. Shape ids are the
+// index in the shape table; Remove compacts the pool, so ids after the
+// removed shape move down by one (Insert is the inverse).
+class SceneStore
+{
+public:
+    uint32_t Append(ShapeKind kind, const WorldPoint* pts, uint32_t count);
+    void Remove(uint32_t id);
+    void Insert(uint32_t id, ShapeKind kind, const int32_t* xs, const int32_t* ys, uint32_t count);
+    void MoveTail(uint32_t first, SceneStore& dst);     // appends shapes [first, end) to dst and drops them here
+    void CopyTail(uint32_t first, SceneStore& dst) const;   // same, keeping them here
+    void Truncate(uint32_t count);                      // drops shapes [count, end)
+
+    // Many shapes at once, one pass over the pool instead of one per shape.
+    // ids must be ascending, unique and valid. Extract appends the shapes to
+    // dst in id order and compacts the rest; Merge is its inverse, shape i
+    // of src becomes id ids[i] (ids in the merged store).
+    void Extract(const uint32_t* ids, size_t count, SceneStore& dst);
+    void Merge(const uint32_t* ids, const SceneStore& src);
+
+    // Where an id of the other shapes lands, for renumbering derived indices.
+    // After Extract(ids, count) (extracted ids map to NO_ID) and after a
+    // Merge of count shapes at ids (id from before the merge).
+    static const uint32_t NO_ID = 0xFFFFFFFFu;
+    static uint32_t IdAfterExtract(const uint32_t* ids, size_t count, uint32_t id);
+    static uint32_t IdAfterMerge(const uint32_t* ids, size_t count, uint32_t id);
+
+    void Clear();
+    void Reserve(size_t shapes, size_t vertices);
+
+    size_t ShapeCount() const { return m_kinds.size(); }
+    size_t VertexCount() const { return m_xs.size(); }
+
+    ShapeKind Kind(uint32_t id) const { return m_kinds[id]; }
+    uint32_t Offset(uint32_t id) const { return m_offsets[id]; }
+    uint32_t Count(uint32_t id) const { return m_counts[id]; }
+
+    // Whole vertex pool, index with Offset(id) + i
+    const int32_t* Xs() const { return m_xs.data(); }
+    const int32_t* Ys() const { return m_ys.data(); }
+
+    // Whole shape table, one entry per id
+    const uint32_t* Offsets() const { return m_offsets.data(); }
+    const uint32_t* Counts() const { return m_counts.data(); }
+    const ShapeKind* Kinds() const { return m_kinds.data(); }
+
+    // Replace the whole scene with raw tables (one bulk copy per array)
+    void Assign(const ShapeKind* kinds, const uint32_t* offsets, const uint32_t* counts, size_t shapeCount,
+        const int32_t* xs, const int32_t* ys, size_t vertexCount);
+
+    // Same, taking over tables the caller built (no copy)
+    void Assign(std::vector<ShapeKind>&& kinds, std::vector<uint32_t>&& offsets, std::vector<uint32_t>&& counts,
+        std::vector<int32_t>&& xs, std::vector<int32_t>&& ys);
+
+    WorldPoint Vertex(uint32_t id, uint32_t i) const
+    {
+        uint32_t v = m_offsets[id] + i;
+        return WorldPoint{ m_xs[v], m_ys[v] };
+    }
+
+    WorldRect Bounds(uint32_t id) const;
+
+    // Visit every shape id of the given kind, in id order
+    template <class Fn>
+    void ForEachOfKind(ShapeKind kind, Fn&& fn) const
+    {
+        const size_t n = m_kinds.size();
+        for (size_t id = 0; id < n; ++id)
+        {
+            if (m_kinds[id] == kind)
+                fn(static_cast<uint32_t>(id));
+        }
+    }
+
+    // Bytes held by the store (capacity, not just size)
+    size_t MemoryBytes() const;
+
+    // Edit tracking for copies kept elsewhere (render thread snapshots): the
+    // lowest id an edit touched since ClearChanges. Shapes below it are as
+    // they were then; Append does not lower it. 0 for a new store and after
+    // any whole store copy, move or swap (the contents are another scene).
+    uint32_t FirstChanged() const { return m_changed.first; }
+    void ClearChanges() { m_changed.first = static_cast<uint32_t>(m_kinds.size()); }
+
+private:
+    void MarkChanged(uint32_t id)
+    {
+        if (id < m_changed.first)
+            m_changed.first = id;
+    }
+
+    // Not carried over by copies and moves: the store assigned to holds
+    // other shapes than the ones its copies were made from
+    struct ChangeFloor {
+        uint32_t first = 0;
+
+        ChangeFloor() = default;
+        ChangeFloor(const ChangeFloor&) {}
+        ChangeFloor& operator=(const ChangeFloor&) { first = 0; return *this; }
+    };
+
+    std::vector<int32_t> m_xs;
+    std::vector<int32_t> m_ys;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_counts;
+    std::vector<ShapeKind> m_kinds;
+    ChangeFloor m_changed;
+};
@@ -0,0 +1,185 @@
+#include "ShapePicking.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+    const int ELLIPSE_ROOT_ITERATIONS = 1074;      // enough bisection steps for any double
+
+    // Root of (r0 z0 / (s + r0))^2 + (z1 / (s + 1))^2 - 1 by bisection
+    double EllipseRoot(double r0, double z0, double z1, double g)
+    {
+        const double n0 = r0 * z0;
+        double s0 = z1 - 1.0;
+        double s1 = g < 0.0 ? 0.0 : std::hypot(n0, z1) - 1.0;
+        double s = 0.0;
+
+        for (int i = 0; i < ELLIPSE_ROOT_ITERATIONS; ++i)
+        {
+            s = (s0 + s1) / 2.0;
+            if (s == s0 || s == s1)
+                break;
+
+            double ratio0 = n0 / (s + r0);
+            double ratio1 = z1 / (s + 1.0);
+            g = ratio0 * ratio0 + ratio1 * ratio1 - 1.0;
+            if (g > 0.0)
+                s0 = s;
+            else if (g < 0.0)
+                s1 = s;
+            else
+                break;
+        }
+        return s;
+    }
+
+    // Point (y0, y1) in the first quadrant, ellipse axes e0 >= e1 > 0
+    // (D. Eberly, "Distance from a Point to an Ellipse")
+    double FirstQuadrantEllipseDistance(double e0, double e1, double y0, double y1)
+    {
+        if (y1 > 0.0)
+        {
+            if (y0 > 0.0)
+            {
+                double z0 = y0 / e0, z1 = y1 / e1;
+                double g = z0 * z0 + z1 * z1 - 1.0;
+                if (g == 0.0)
+                    return 0.0;
+
+                double r0 = (e0 / e1) * (e0 / e1);
+                double s = EllipseRoot(r0, z0, z1, g);
+                double x0 = r0 * y0 / (s + r0);
+                double x1 = y1 / (s + 1.0);
+                return std::hypot(x0 - y0, x1 - y1);
+            }
+            return std::fabs(y1 - e1);
+        }
+
+        double numer0 = e0 * y0;
+        double denom0 = e0 * e0 - e1 * e1;
+        if (numer0 < denom0)
+        {
+            double xde0 = numer0 / denom0;
+            double x0 = e0 * xde0;
+            double x1 = e1 * std::sqrt(1.0 - xde0 * xde0);
+            return std::hypot(x0 - y0, x1);
+        }
+        return std::fabs(y0 - e0);
+    }
+
+} // namespace
+
+double DistanceToSegment(double px, double py, double ax, double ay, double bx, double by)
+{
+    const double dx = bx - ax, dy = by - ay;
+    const double len2 = dx * dx + dy * dy;
+
+    double t = len2 > 0.0 ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0.0;
+    t = std::clamp(t, 0.0, 1.0);
+    return std::hypot(px - (ax + t * dx), py - (ay + t * dy));
+}
+
+double DistanceToRectOutline(double px, double py, const WorldRect& rect)
+{
+    const double left = rect.minX, right = rect.maxX, top = rect.minY, bottom = rect.maxY;
+
+    // outside: distance to the box; inside: distance to the nearest side
+    const double dx = std::max({ left - px, 0.0, px - right });
+    const double dy = std::max({ top - py, 0.0, py - bottom });
+    if (dx > 0.0 || dy > 0.0)
+        return std::hypot(dx, dy);
+
+    return std::min({ px - left, right - px, py - top, bottom - py });
+}
+
+double DistanceToEllipse(double px, double py, double cx, double cy, double rx, double ry)
+{
+    rx = std::fabs(rx);
+    ry = std::fabs(ry);
+
+    // flat ellipses are segments
+    if (rx == 0.0)
+        return DistanceToSegment(px, py, cx, cy - ry, cx, cy + ry);
+    if (ry == 0.0)
+        return DistanceToSegment(px, py, cx - rx, cy, cx + rx, cy);
+
+    double y0 = std::fabs(px - cx), y1 = std::fabs(py - cy);
+    if (rx >= ry)
+        return FirstQuadrantEllipseDistance(rx, ry, y0, y1);
+    return FirstQuadrantEllipseDistance(ry, rx, y1, y0);
+}
+
+double DistanceToShape(const SceneStore& scene, uint32_t id, double px, double py)
+{
+    const uint32_t count = scene.Count(id);
+    if (count == 0)
+        return INFINITY;
+
+    const int32_t* xs = scene.Xs() + scene.Offset(id);
+    const int32_t* ys = scene.Ys() + scene.Offset(id);
+    if (count == 1)
+        return std::hypot(px - xs[0], py - ys[0]);
+
+    switch (scene.Kind(id))
+    {
+    case SHAPE_LINE:
+        return DistanceToSegment(px, py, xs[0], ys[0], xs[1], ys[1]);
+
+    case SHAPE_RECT:
+        return DistanceToRectOutline(px, py, RectFromPoints(WorldPoint{ xs[0], ys[0] }, WorldPoint{ xs[1], ys[1] }));
+
+    case SHAPE_ELLIPSE:
+        return DistanceToEllipse(px, py, (xs[0] + (double)xs[1]) / 2.0, (ys[0] + (double)ys[1]) / 2.0,
+            (xs[1] - (double)xs[0]) / 2.0, (ys[1] - (double)ys[0]) / 2.0);
+
+    case SHAPE_MULTILINE:
+    case SHAPE_POLIGON: {
+        double best = INFINITY;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const uint32_t j = i + 1 < count ? i + 1 : 0;
+            best = std::min(best, DistanceToSegment(px, py, xs[i], ys[i], xs[j], ys[j]));
+        }
+        return best;
+    }
+    }
+    return INFINITY;
+}
+
+PickResult PickShape(const SceneStore& scene, BoundsTree& tree, double px, double py, double tolerance)
+{
+    PickResult result;
+
+    const WorldRect area{
+        (int32_t)std::floor(px - tolerance), (int32_t)std::floor(py - tolerance),
+        (int32_t)std::ceil(px + tolerance), (int32_t)std::ceil(py + tolerance) };
+
+    tree.Query(area, [&](uint32_t id)
+        {
+            double d = DistanceToShape(scene, id, px, py);
+            if (d > tolerance)
+                return;
+
+            if (!result.hit || d < result.distance || (d == result.distance && id > result.id))
+            {
+                result.hit = true;
+                result.id = id;
+                result.distance = d;
+            }
+        });
+
+    return result;
+}
+
+void SelectInRect(const SceneStore& scene, BoundsTree& tree, const WorldRect& box, std::vector<uint32_t>& out)
+{
+    out.clear();
+    tree.Query(box, [&](uint32_t id)
+        {
+            WorldRect b = scene.Bounds(id);
+            if (b.minX >= box.minX && b.maxX <= box.maxX && b.minY >= box.minY && b.maxY <= box.maxY)
+                out.push_back(id);
+        });
+    std::sort(out.begin(), out.end());
+}
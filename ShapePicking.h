@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BoundsTree.h"
+#include "Geometry.h"
+#include "SceneStore.h"
+
+// -------------------- Shape picking --------------------
+// Exact distances from a point to shape outlines (world coords) and the
+// pick / box selection queries built on them. Candidates come from the
+// BoundsTree, so a pick only measures the shapes whose box is near the
+// point.
+
+double DistanceToSegment(double px, double py, double ax, double ay, double bx, double by);
+double DistanceToRectOutline(double px, double py, const WorldRect& rect);
+double DistanceToEllipse(double px, double py, double cx, double cy, double rx, double ry);
+
+// Distance to the outline of a stored shape (multilines and poligons are closed)
+double DistanceToShape(const SceneStore& scene, uint32_t id, double px, double py);
+
+struct PickResult {
+    bool hit = false;
+    uint32_t id = 0;
+    double distance = 0.0;
+};
+
+// Nearest shape outline within tolerance; on ties the shape drawn last wins
+PickResult PickShape(const SceneStore& scene, BoundsTree& tree, double px, double py, double tolerance);
+
+// Ids (ascending) of the shapes lying completely inside box
+void SelectInRect(const SceneStore& scene, BoundsTree& tree, const WorldRect& box, std::vector<uint32_t>& out);
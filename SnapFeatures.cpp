@@ -0,0 +1,272 @@
+#include "SnapFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+
+    int64_t Orientation(int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t cx, int64_t cy)
+    {
+        return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+    }
+
+    int Sign(int64_t v)
+    {
+        return (v > 0) - (v < 0);
+    }
+
+    int32_t MinX(const SnapSegment& s) { return s.ax < s.bx ? s.ax : s.bx; }
+    int32_t MaxX(const SnapSegment& s) { return s.ax < s.bx ? s.bx : s.ax; }
+    int32_t MinY(const SnapSegment& s) { return s.ay < s.by ? s.ay : s.by; }
+    int32_t MaxY(const SnapSegment& s) { return s.ay < s.by ? s.by : s.ay; }
+
+    WorldRect SegmentBounds(const SnapSegment& s)
+    {
+        return WorldRect{ MinX(s), MinY(s), MaxX(s), MaxY(s) };
+    }
+
+    int32_t FloorHalf(int64_t v)
+    {
+        return (int32_t)(v >= 0 ? v / 2 : -((-v + 1) / 2));
+    }
+
+    void AppendMidpoints(const std::vector<SnapSegment>& segments, std::vector<WorldPoint>& out)
+    {
+        for (const SnapSegment& s : segments)
+        {
+            if (s.fresh)
+                out.push_back(WorldPoint{ FloorHalf((int64_t)s.ax + s.bx), FloorHalf((int64_t)s.ay + s.by) });
+        }
+    }
+
+    uint64_t PointKey(const WorldPoint& p)
+    {
+        return ((uint64_t)(uint32_t)p.x << 32) | (uint32_t)p.y;
+    }
+
+    // Take one copy of each of points out of from (one pass), moving what
+    // was found to erased
+    void EraseOnce(std::vector<WorldPoint>& from, const std::vector<WorldPoint>& points, std::vector<WorldPoint>& erased)
+    {
+        if (points.empty())
+            return;
+
+        std::unordered_map<uint64_t, uint32_t> wanted;
+        for (const WorldPoint& p : points)
+            ++wanted[PointKey(p)];
+
+        size_t kept = 0;
+        for (size_t i = 0; i < from.size(); ++i)
+        {
+            auto it = wanted.find(PointKey(from[i]));
+            if (it != wanted.end() && it->second > 0)
+            {
+                --it->second;
+                erased.push_back(from[i]);
+                continue;
+            }
+            from[kept++] = from[i];
+        }
+        from.resize(kept);
+    }
+
+} // namespace
+
+void AppendShapeSegments(const SceneStore& scene, uint32_t id, bool fresh, std::vector<SnapSegment>& out)
+{
+    const uint32_t count = scene.Count(id);
+    if (count < 2)
+        return;
+
+    const int32_t* xs = scene.Xs() + scene.Offset(id);
+    const int32_t* ys = scene.Ys() + scene.Offset(id);
+
+    auto add = [&](int32_t ax, int32_t ay, int32_t bx, int32_t by)
+        {
+            if (ax != bx || ay != by)
+                out.push_back(SnapSegment{ ax, ay, bx, by, fresh });
+        };
+
+    switch (scene.Kind(id))
+    {
+    case SHAPE_LINE:
+        add(xs[0], ys[0], xs[1], ys[1]);
+        break;
+
+    case SHAPE_RECT:
+        add(xs[0], ys[0], xs[1], ys[0]);
+        add(xs[1], ys[0], xs[1], ys[1]);
+        add(xs[1], ys[1], xs[0], ys[1]);
+        add(xs[0], ys[1], xs[0], ys[0]);
+        break;
+
+    case SHAPE_ELLIPSE:
+        break;
+
+    case SHAPE_MULTILINE:
+    case SHAPE_POLIGON:
+        for (uint32_t i = 0; i + 1 < count; ++i)
+            add(xs[i], ys[i], xs[i + 1], ys[i + 1]);
+        if (xs[0] != xs[count - 1] || ys[0] != ys[count - 1])
+            add(xs[count - 1], ys[count - 1], xs[0], ys[0]);
+        break;
+    }
+}
+
+bool SegmentCrossing(const SnapSegment& s, const SnapSegment& t, WorldPoint& out)
+{
+    // always interpolate along the same one of the two, so adding and
+    // removing a shape round its crossings the same way
+    if (std::tie(t.ax, t.ay, t.bx, t.by) < std::tie(s.ax, s.ay, s.bx, s.by))
+        return SegmentCrossing(t, s, out);
+
+    const int64_t d1 = Orientation(s.ax, s.ay, s.bx, s.by, t.ax, t.ay);
+    const int64_t d2 = Orientation(s.ax, s.ay, s.bx, s.by, t.bx, t.by);
+    const int64_t d3 = Orientation(t.ax, t.ay, t.bx, t.by, s.ax, s.ay);
+    const int64_t d4 = Orientation(t.ax, t.ay, t.bx, t.by, s.bx, s.by);
+
+    // strictly on opposite sides both ways: the crossing is interior to both
+    if (Sign(d1) * Sign(d2) >= 0 || Sign(d3) * Sign(d4) >= 0)
+        return false;
+
+    // s.a + (s.b - s.a) * d3 / (d3 - d4)
+    const double u = (double)d3 / ((double)d3 - (double)d4);
+    out.x = (int32_t)std::lround(s.ax + (double)(s.bx - s.ax) * u);
+    out.y = (int32_t)std::lround(s.ay + (double)(s.by - s.ay) * u);
+    return true;
+}
+
+void SweepCrossings(std::vector<SnapSegment>& segments, std::vector<WorldPoint>& out)
+{
+    std::sort(segments.begin(), segments.end(), [](const SnapSegment& a, const SnapSegment& b)
+        {
+            return MinX(a) < MinX(b);
+        });
+
+    std::vector<const SnapSegment*> active;
+    for (const SnapSegment& s : segments)
+    {
+        const int32_t x = MinX(s);
+        const int32_t y0 = MinY(s), y1 = MaxY(s);
+
+        // drop the segments the sweep has passed
+        for (size_t i = 0; i < active.size(); )
+        {
+            if (MaxX(*active[i]) < x)
+            {
+                active[i] = active.back();
+                active.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        for (const SnapSegment* a : active)
+        {
+            if (!s.fresh && !a->fresh)
+                continue;
+            if (MaxY(*a) < y0 || MinY(*a) > y1)
+                continue;
+
+            WorldPoint p;
+            if (SegmentCrossing(s, *a, p))
+                out.push_back(p);
+        }
+
+        active.push_back(&s);
+    }
+}
+
+void SnapFeatureCache::Rebuild(const SceneStore& scene)
+{
+    Clear();
+
+    m_scratch.clear();
+    for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+        AppendShapeSegments(scene, id, true, m_scratch);
+
+    AppendMidpoints(m_scratch, m_midpoints);
+    SweepCrossings(m_scratch, m_crossings);
+}
+
+void SnapFeatureCache::AddShapes(const SceneStore& scene, BoundsTree& tree, uint32_t first)
+{
+    const uint32_t end = (uint32_t)scene.ShapeCount();
+    if (first >= end)
+        return;
+
+    std::vector<uint32_t> ids(end - first);
+    for (uint32_t i = 0; i < end - first; ++i)
+        ids[i] = first + i;
+    AddShapes(scene, tree, ids.data(), ids.size());
+}
+
+void SnapFeatureCache::AddShapes(const SceneStore& scene, BoundsTree& tree, const uint32_t* ids, size_t count)
+{
+    if (!CollectSegments(scene, tree, ids, count))
+        return;
+
+    AppendMidpoints(m_scratch, m_midpoints);
+    SweepCrossings(m_scratch, m_crossings);
+}
+
+void SnapFeatureCache::RemoveShapes(const SceneStore& scene, BoundsTree& tree, const uint32_t* ids, size_t count,
+    std::vector<WorldPoint>& removed)
+{
+    if (!CollectSegments(scene, tree, ids, count))
+        return;
+
+    // the same midpoints and crossings AddShapes found for these shapes
+    std::vector<WorldPoint> midpoints, crossings;
+    AppendMidpoints(m_scratch, midpoints);
+    SweepCrossings(m_scratch, crossings);
+
+    EraseOnce(m_midpoints, midpoints, removed);
+    EraseOnce(m_crossings, crossings, removed);
+}
+
+// m_scratch = the segments of ids (fresh) and the other segments in the area
+// they cover; false when ids have no segments
+bool SnapFeatureCache::CollectSegments(const SceneStore& scene, BoundsTree& tree, const uint32_t* ids, size_t count)
+{
+    m_scratch.clear();
+    WorldRect region{ 0, 0, -1, -1 };
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (scene.Count(ids[i]) == 0)
+            continue;
+        WorldRect box = scene.Bounds(ids[i]);
+        region = region.minX > region.maxX ? box : RectUnion(region, box);
+        AppendShapeSegments(scene, ids[i], true, m_scratch);
+    }
+
+    if (m_scratch.empty())
+        return false;
+
+    // existing edges in that area
+    std::vector<SnapSegment> neighbours;
+    tree.Query(region, [&](uint32_t id)
+        {
+            if (std::binary_search(ids, ids + count, id))
+                return;
+
+            neighbours.clear();
+            AppendShapeSegments(scene, id, false, neighbours);
+            for (const SnapSegment& s : neighbours)
+            {
+                if (RectsIntersect(SegmentBounds(s), region))
+                    m_scratch.push_back(s);
+            }
+        });
+    return true;
+}
+
+void SnapFeatureCache::Clear()
+{
+    m_midpoints.clear();
+    m_crossings.clear();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BoundsTree.h"
+#include "Geometry.h"
+#include "SceneStore.h"
+
+// -------------------- Snap features --------------------
+// Derived snap candidates of the committed geometry: edge midpoints and the
+// points where two edges cross. They are computed once, when shapes are
+// committed, and kept here; the app indexes them in the snap grid next to
+// the vertices so a mouse move only does grid lookups.
+//
+// Crossings are found with a sweep over x: segments enter the active list in
+// order of their left end and leave once the sweep passes their right end,
+// and only active segments with overlapping y ranges are tested. Tests use
+// exact integer orientation (coordinate spans below 2^31). Only proper
+// crossings are reported; touching end points are already vertices and
+// collinear overlaps have no single point.
+//
+// Ellipses have no straight edges and are not considered.
+
+struct SnapSegment {
+    int32_t ax, ay, bx, by;
+    bool fresh;                 // belongs to the shapes being added
+};
+
+// Edges of a stored shape (multilines and poligons closed)
+void AppendShapeSegments(const SceneStore& scene, uint32_t id, bool fresh, std::vector<SnapSegment>& out);
+
+// Proper crossing of two segments, rounded to world units (the same point
+// whichever segment comes first)
+bool SegmentCrossing(const SnapSegment& s, const SnapSegment& t, WorldPoint& out);
+
+// Crossings of every pair with at least one fresh segment (segments are reordered)
+void SweepCrossings(std::vector<SnapSegment>& segments, std::vector<WorldPoint>& out);
+
+class SnapFeatureCache
+{
+public:
+    // Recompute everything from the scene
+    void Rebuild(const SceneStore& scene);
+
+    // Shapes [first, end) were appended: add their midpoints and their
+    // crossings with each other and with the shapes around them. The new
+    // shapes must already be in the tree (used to find the neighbours).
+    void AddShapes(const SceneStore& scene, BoundsTree& tree, uint32_t first);
+
+    // Same for the given ascending ids (shapes put back in the middle)
+    void AddShapes(const SceneStore& scene, BoundsTree& tree, const uint32_t* ids, size_t count);
+
+    // The given ascending ids are about to be removed: drop their midpoints
+    // and crossings and append the dropped points to removed (to take them
+    // out of the snap grid). Call while the scene and tree still hold them.
+    void RemoveShapes(const SceneStore& scene, BoundsTree& tree, const uint32_t* ids, size_t count,
+        std::vector<WorldPoint>& removed);
+
+    void Clear();
+
+    // Added entries are appended, so callers can index the tail they have not seen
+    const std::vector<WorldPoint>& Midpoints() const { return m_midpoints; }
+    const std::vector<WorldPoint>& Crossings() const { return m_crossings; }
+
+private:
+    bool CollectSegments(const SceneStore& scene, BoundsTree& tree, const uint32_t* ids, size_t count);
+
+    std::vector<WorldPoint> m_midpoints;
+    std::vector<WorldPoint> m_crossings;
+    std::vector<SnapSegment> m_scratch;
+};
@@ -0,0 +1,83 @@
+#include "SnapGrid.h"
+
+#include <cmath>
+
+SnapGrid::SnapGrid(int32_t cellSize)
+    : m_cellSize(cellSize > 0 ? cellSize : 1)
+{
+}
+
+// floor division so negative coordinates land in the right cell
+int32_t SnapGrid::CellOf(int32_t v) const
+{
+    int32_t c = v / m_cellSize;
+    if (v % m_cellSize != 0 && v < 0)
+        --c;
+    return c;
+}
+
+uint64_t SnapGrid::Key(int32_t cx, int32_t cy)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+}
+
+void SnapGrid::Insert(WorldPoint p)
+{
+    m_cells[Key(CellOf(p.x), CellOf(p.y))].push_back(p);
+    ++m_count;
+}
+
+bool SnapGrid::Remove(WorldPoint p)
+{
+    auto it = m_cells.find(Key(CellOf(p.x), CellOf(p.y)));
+    if (it == m_cells.end())
+        return false;
+
+    std::vector<WorldPoint>& bucket = it->second;
+    for (size_t i = 0; i < bucket.size(); ++i)
+    {
+        if (bucket[i].x == p.x && bucket[i].y == p.y)
+        {
+            // order inside a cell does not matter
+            bucket[i] = bucket.back();
+            bucket.pop_back();
+            if (bucket.empty())
+                m_cells.erase(it);
+            --m_count;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SnapGrid::Clear()
+{
+    m_cells.clear();
+    m_count = 0;
+}
+
+bool SnapGrid::FindNearest(double wx, double wy, double radius, WorldPoint& out) const
+{
+    const int32_t minX = static_cast<int32_t>(std::floor(wx - radius));
+    const int32_t minY = static_cast<int32_t>(std::floor(wy - radius));
+    const int32_t maxX = static_cast<int32_t>(std::ceil(wx + radius));
+    const int32_t maxY = static_cast<int32_t>(std::ceil(wy + radius));
+
+    bool found = false;
+    double bestDist2 = radius * radius;
+
+    ForEachInRect(minX, minY, maxX, maxY, [&](const WorldPoint& p)
+        {
+            double dx = p.x - wx;
+            double dy = p.y - wy;
+            double d2 = dx * dx + dy * dy;
+            if (d2 <= bestDist2)
+            {
+                bestDist2 = d2;
+                out = p;
+                found = true;
+            }
+        });
+
+    return found;
+}
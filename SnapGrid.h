@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Geometry.h"
+
+// -------------------- Snap grid --------------------
+// Uniform hash grid over world space vertices. Points are bucketed by the
+// cell they fall in, so a snap query only visits the few cells around the
+// cursor no matter how many vertices the scene holds.
+class SnapGrid
+{
+public:
+    explicit SnapGrid(int32_t cellSize = 64);
+
+    void Insert(WorldPoint p);
+    bool Remove(WorldPoint p);          // removes one stored copy of p
+    void Clear();
+
+    size_t Size() const { return m_count; }
+    int32_t CellSize() const { return m_cellSize; }
+
+    // Visit every stored point inside [minX, maxX] x [minY, maxY] (world coords)
+    template <class Fn>
+    void ForEachInRect(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, Fn&& fn) const
+    {
+        const int32_t cx0 = CellOf(minX), cx1 = CellOf(maxX);
+        const int32_t cy0 = CellOf(minY), cy1 = CellOf(maxY);
+
+        for (int32_t cy = cy0; cy <= cy1; ++cy)
+        {
+            for (int32_t cx = cx0; cx <= cx1; ++cx)
+            {
+                auto it = m_cells.find(Key(cx, cy));
+                if (it == m_cells.end())
+                    continue;
+
+                for (const WorldPoint& p : it->second)
+                {
+                    if (p.x >= minX && p.x <= maxX && p.y >= minY && p.y <= maxY)
+                        fn(p);
+                }
+            }
+        }
+    }
+
+    // Nearest stored point to (wx, wy) within radius (world units)
+    bool FindNearest(double wx, double wy, double radius, WorldPoint& out) const;
+
+private:
+    int32_t CellOf(int32_t v) const;
+    static uint64_t Key(int32_t cx, int32_t cy);
+
+    int32_t m_cellSize;
+    size_t m_count = 0;
+    std::unordered_map<uint64_t, std::vector<WorldPoint>> m_cells;
+};
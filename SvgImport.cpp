@@ -0,0 +1,764 @@
+#include "SvgImport.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace {
+
+    const size_t READ_CHUNK_BYTES = 1 << 20;        // file is streamed 1 MB at a time
+    const size_t BATCH_BYTES = 256 * 1024;          // element text handed to one task
+    const size_t PATH_PIECE_BYTES = 64 * 1024;      // longer path data is split into pieces of about this size
+    const size_t MAX_BATCHES_IN_FLIGHT = 16;        // bounds memory while streaming
+    const int CURVE_SEGMENTS = 8;                   // flattening of Bezier segments
+    const double PI = 3.14159265358979323846;
+
+    enum ElementKind
+    {
+        ELEMENT_LINE,
+        ELEMENT_RECT,
+        ELEMENT_ELLIPSE,
+        ELEMENT_CIRCLE,
+        ELEMENT_POLYLINE,
+        ELEMENT_POLYGON,
+        ELEMENT_PATH,
+        ELEMENT_PATH_DATA       // a piece of a long path's d attribute, the text is the raw path data
+    };
+
+    struct Element {
+        ElementKind kind;
+        uint32_t attrBegin;     // attribute text inside Batch::text
+        uint32_t attrLength;
+    };
+
+    struct Batch {
+        std::string text;
+        std::vector<Element> elements;
+    };
+
+    // Parsed shapes of one batch, appended to the scene in order
+    struct ParsedShapes {
+        std::vector<ShapeKind> kinds;
+        std::vector<uint32_t> counts;
+        std::vector<WorldPoint> points;
+    };
+
+    // ---------------- number parsing ----------------
+    bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',';
+    }
+
+    void SkipSeparators(const char*& p, const char* end)
+    {
+        while (p < end && IsSpace(*p))
+            ++p;
+    }
+
+    bool ParseNumber(const char*& p, const char* end, double& out)
+    {
+        SkipSeparators(p, end);
+        if (p < end && *p == '+')
+            ++p;
+
+        auto result = std::from_chars(p, end, out);
+        if (result.ec != std::errc())
+            return false;
+
+        p = result.ptr;
+        return true;
+    }
+
+    // Arc flags may be written without separators ("a10 10 0 01 5 5")
+    bool ParseFlag(const char*& p, const char* end, bool& out)
+    {
+        SkipSeparators(p, end);
+        if (p >= end || (*p != '0' && *p != '1'))
+            return false;
+        out = *p == '1';
+        ++p;
+        return true;
+    }
+
+    int32_t ToWorld(double v)
+    {
+        if (v > 2147483647.0) return INT32_MAX;
+        if (v < -2147483648.0) return INT32_MIN;
+        return (int32_t)std::lround(v);
+    }
+
+    // ---------------- attributes ----------------
+    // Value of attribute name in a raw attribute string, empty if missing
+    std::string_view FindAttribute(std::string_view attrs, std::string_view name)
+    {
+        size_t pos = 0;
+        while (pos < attrs.size())
+        {
+            size_t found = attrs.find(name, pos);
+            if (found == std::string_view::npos)
+                return {};
+
+            // must be a whole attribute name: preceded by a space, followed by '='
+            size_t after = found + name.size();
+            bool startOk = found == 0 || IsSpace(attrs[found - 1]);
+            size_t eq = after;
+            while (eq < attrs.size() && IsSpace(attrs[eq]))
+                ++eq;
+
+            if (startOk && eq < attrs.size() && attrs[eq] == '=')
+            {
+                size_t q = eq + 1;
+                while (q < attrs.size() && IsSpace(attrs[q]))
+                    ++q;
+                if (q < attrs.size() && (attrs[q] == '"' || attrs[q] == '\''))
+                {
+                    size_t close = attrs.find(attrs[q], q + 1);
+                    if (close == std::string_view::npos)
+                        return {};
+                    return attrs.substr(q + 1, close - q - 1);
+                }
+            }
+            pos = after;
+        }
+        return {};
+    }
+
+    double NumberAttribute(std::string_view attrs, std::string_view name, double fallback = 0.0)
+    {
+        std::string_view v = FindAttribute(attrs, name);
+        const char* p = v.data();
+        double out;
+        if (v.empty() || !ParseNumber(p, v.data() + v.size(), out))
+            return fallback;
+        return out;
+    }
+
+    // ---------------- shape output ----------------
+    void EmitShape(ParsedShapes& out, ShapeKind kind, const WorldPoint* pts, size_t count)
+    {
+        out.kinds.push_back(kind);
+        out.counts.push_back((uint32_t)count);
+        out.points.insert(out.points.end(), pts, pts + count);
+    }
+
+    // A finished point run: closed runs become multilines, open ones lines
+    void EmitRun(ParsedShapes& out, std::vector<WorldPoint>& run, bool closed)
+    {
+        if (run.size() >= 2)
+        {
+            if (closed)
+            {
+                if (run.front().x != run.back().x || run.front().y != run.back().y)
+                    run.push_back(run.front());
+                EmitShape(out, SHAPE_MULTILINE, run.data(), run.size());
+            }
+            else
+            {
+                for (size_t i = 0; i + 1 < run.size(); ++i)
+                    EmitShape(out, SHAPE_LINE, &run[i], 2);
+            }
+        }
+        run.clear();
+    }
+
+    void ParsePoints(std::string_view text, ParsedShapes& out, bool closed)
+    {
+        std::vector<WorldPoint> run;
+        const char* p = text.data();
+        const char* end = p + text.size();
+
+        double x, y;
+        while (ParseNumber(p, end, x) && ParseNumber(p, end, y))
+            run.push_back(WorldPoint{ ToWorld(x), ToWorld(y) });
+
+        EmitRun(out, run, closed);
+    }
+
+    // ---------------- path data ----------------
+    class PathBuilder
+    {
+    public:
+        explicit PathBuilder(ParsedShapes& out) : m_out(out) {}
+
+        void MoveTo(double x, double y)
+        {
+            Finish(false);
+            m_x = m_startX = x;
+            m_y = m_startY = y;
+            Add(x, y);
+        }
+
+        void LineTo(double x, double y)
+        {
+            if (m_run.empty())
+                Add(m_x, m_y);
+            m_x = x;
+            m_y = y;
+            Add(x, y);
+        }
+
+        void CubicTo(double c1x, double c1y, double c2x, double c2y, double x, double y)
+        {
+            const double x0 = m_x, y0 = m_y;
+            for (int i = 1; i <= CURVE_SEGMENTS; ++i)
+            {
+                double t = (double)i / CURVE_SEGMENTS, u = 1.0 - t;
+                double bx = u * u * u * x0 + 3 * u * u * t * c1x + 3 * u * t * t * c2x + t * t * t * x;
+                double by = u * u * u * y0 + 3 * u * u * t * c1y + 3 * u * t * t * c2y + t * t * t * y;
+                LineTo(bx, by);
+            }
+        }
+
+        void QuadTo(double cx, double cy, double x, double y)
+        {
+            const double x0 = m_x, y0 = m_y;
+            for (int i = 1; i <= CURVE_SEGMENTS; ++i)
+            {
+                double t = (double)i / CURVE_SEGMENTS, u = 1.0 - t;
+                LineTo(u * u * x0 + 2 * u * t * cx + t * t * x, u * u * y0 + 2 * u * t * cy + t * t * y);
+            }
+        }
+
+        // Endpoint arc parametrisation (SVG 1.1 F.6.5) flattened into segments
+        void ArcTo(double rx, double ry, double angleDeg, bool largeArc, bool sweep, double x, double y)
+        {
+            const double x0 = m_x, y0 = m_y;
+            rx = std::fabs(rx);
+            ry = std::fabs(ry);
+            if (rx == 0.0 || ry == 0.0 || (x0 == x && y0 == y))
+            {
+                LineTo(x, y);
+                return;
+            }
+
+            const double phi = angleDeg * PI / 180.0;
+            const double cosPhi = std::cos(phi), sinPhi = std::sin(phi);
+            const double dx = (x0 - x) / 2.0, dy = (y0 - y) / 2.0;
+            const double x1 = cosPhi * dx + sinPhi * dy;
+            const double y1 = -sinPhi * dx + cosPhi * dy;
+
+            // scale up radii that are too small to reach the end point
+            double lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+            if (lambda > 1.0)
+            {
+                rx *= std::sqrt(lambda);
+                ry *= std::sqrt(lambda);
+            }
+
+            double num = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+            double den = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+            double coef = (den > 0.0 && num > 0.0) ? std::sqrt(num / den) : 0.0;
+            if (largeArc == sweep)
+                coef = -coef;
+
+            const double cxp = coef * rx * y1 / ry;
+            const double cyp = -coef * ry * x1 / rx;
+            const double cx = cosPhi * cxp - sinPhi * cyp + (x0 + x) / 2.0;
+            const double cy = sinPhi * cxp + cosPhi * cyp + (y0 + y) / 2.0;
+
+            const double theta1 = std::atan2((y1 - cyp) / ry, (x1 - cxp) / rx);
+            double delta = std::atan2((-y1 - cyp) / ry, (-x1 - cxp) / rx) - theta1;
+            if (sweep && delta < 0.0) delta += 2.0 * PI;
+            if (!sweep && delta > 0.0) delta -= 2.0 * PI;
+
+            const int segments = (int)std::ceil(std::fabs(delta) / (PI / 8.0));
+            for (int i = 1; i <= segments; ++i)
+            {
+                double t = theta1 + delta * i / segments;
+                double ex = rx * std::cos(t), ey = ry * std::sin(t);
+                if (i == segments)
+                    LineTo(x, y);
+                else
+                    LineTo(cosPhi * ex - sinPhi * ey + cx, sinPhi * ex + cosPhi * ey + cy);
+            }
+        }
+
+        void Close()
+        {
+            m_x = m_startX;
+            m_y = m_startY;
+            Finish(true);
+        }
+
+        void Finish(bool closed)
+        {
+            EmitRun(m_out, m_run, closed);
+        }
+
+        double X() const { return m_x; }
+        double Y() const { return m_y; }
+
+    private:
+        void Add(double x, double y)
+        {
+            WorldPoint p{ ToWorld(x), ToWorld(y) };
+            if (!m_run.empty() && m_run.back().x == p.x && m_run.back().y == p.y)
+                return;
+            m_run.push_back(p);
+        }
+
+        ParsedShapes& m_out;
+        std::vector<WorldPoint> m_run;
+        double m_x = 0.0, m_y = 0.0;
+        double m_startX = 0.0, m_startY = 0.0;
+    };
+
+    void ParsePath(std::string_view d, ParsedShapes& out)
+    {
+        PathBuilder path(out);
+        const char* p = d.data();
+        const char* end = p + d.size();
+
+        char cmd = 0;
+        double lastCtrlX = 0.0, lastCtrlY = 0.0;    // for S / T reflection
+        char lastCmd = 0;
+
+        while (true)
+        {
+            SkipSeparators(p, end);
+            if (p >= end)
+                break;
+
+            if ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))
+            {
+                cmd = *p++;
+                if (cmd == 'Z' || cmd == 'z')
+                {
+                    path.Close();
+                    lastCmd = cmd;
+                    continue;
+                }
+            }
+            else if (cmd == 0)
+            {
+                break;      // numbers before any command
+            }
+
+            const bool rel = cmd >= 'a' && cmd <= 'z';
+            const double ox = rel ? path.X() : 0.0;
+            const double oy = rel ? path.Y() : 0.0;
+            double a[7];
+            bool ok = true;
+
+            switch (cmd)
+            {
+            case 'M': case 'm':
+                ok = ParseNumber(p, end, a[0]) && ParseNumber(p, end, a[1]);
+                if (ok)
+                {
+                    path.MoveTo(ox + a[0], oy + a[1]);
+                    cmd = rel ? 'l' : 'L';      // further pairs are implicit line-tos
+                }
+                break;
+            case 'L': case 'l':
+                ok = ParseNumber(p, end, a[0]) && ParseNumber(p, end, a[1]);
+                if (ok) path.LineTo(ox + a[0], oy + a[1]);
+                break;
+            case 'H': case 'h':
+                ok = ParseNumber(p, end, a[0]);
+                if (ok) path.LineTo(ox + a[0], path.Y());
+                break;
+            case 'V': case 'v':
+                ok = ParseNumber(p, end, a[0]);
+                if (ok) path.LineTo(path.X(), oy + a[0]);
+                break;
+            case 'C': case 'c':
+                ok = ParseNumber(p, end, a[0]) && ParseNumber(p, end, a[1]) && ParseNumber(p, end, a[2]) &&
+                    ParseNumber(p, end, a[3]) && ParseNumber(p, end, a[4]) && ParseNumber(p, end, a[5]);
+                if (ok)
+                {
+                    path.CubicTo(ox + a[0], oy + a[1], ox + a[2], oy + a[3], ox + a[4], oy + a[5]);
+                    lastCtrlX = ox + a[2];
+                    lastCtrlY = oy + a[3];
+                }
+                break;
+            case 'S': case 's':
+                ok = ParseNumber(p, end, a[0]) && ParseNumber(p, end, a[1]) && ParseNumber(p, end, a[2]) && ParseNumber(p, end, a[3]);
+                if (ok)
+                {
+                    bool smooth = lastCmd == 'C' || lastCmd == 'c' || lastCmd == 'S' || lastCmd == 's';
+                    double c1x = smooth ? 2 * path.X() - lastCtrlX : path.X();
+                    double c1y = smooth ? 2 * path.Y() - lastCtrlY : path.Y();
+                    path.CubicTo(c1x, c1y, ox + a[0], oy + a[1], ox + a[2], oy + a[3]);
+                    lastCtrlX = ox + a[0];
+                    lastCtrlY = oy + a[1];
+                }
+                break;
+            case 'Q': case 'q':
+                ok = ParseNumber(p, end, a[0]) && ParseNumber(p, end, a[1]) && ParseNumber(p, end, a[2]) && ParseNumber(p, end, a[3]);
+                if (ok)
+                {
+                    path.QuadTo(ox + a[0], oy + a[1], ox + a[2], oy + a[3]);
+                    lastCtrlX = ox + a[0];
+                    lastCtrlY = oy + a[1];
+                }
+                break;
+            case 'T': case 't':
+                ok = ParseNumber(p, end, a[0]) && ParseNumber(p, end, a[1]);
+                if (ok)
+                {
+                    bool smooth = lastCmd == 'Q' || lastCmd == 'q' || lastCmd == 'T' || lastCmd == 't';
+                    double cx = smooth ? 2 * path.X() - lastCtrlX : path.X();
+                    double cy = smooth ? 2 * path.Y() - lastCtrlY : path.Y();
+                    path.QuadTo(cx, cy, ox + a[0], oy + a[1]);
+                    lastCtrlX = cx;
+                    lastCtrlY = cy;
+                }
+                break;
+            case 'A': case 'a': {
+                bool largeArc = false, sweep = false;
+                ok = ParseNumber(p, end, a[0]) && ParseNumber(p, end, a[1]) && ParseNumber(p, end, a[2]) &&
+                    ParseFlag(p, end, largeArc) && ParseFlag(p, end, sweep) &&
+                    ParseNumber(p, end, a[3]) && ParseNumber(p, end, a[4]);
+                if (ok) path.ArcTo(a[0], a[1], a[2], largeArc, sweep, ox + a[3], oy + a[4]);
+                break;
+            }
+            default:
+                ok = false;
+                break;
+            }
+
+            if (!ok)
+                break;      // malformed data: keep what was parsed so far
+            lastCmd = cmd;
+        }
+
+        path.Finish(false);
+    }
+
+    // ---------------- batch parsing (runs on the pool) ----------------
+    ParsedShapes ParseBatch(const Batch& batch)
+    {
+        ParsedShapes out;
+
+        for (const Element& e : batch.elements)
+        {
+            std::string_view attrs(batch.text.data() + e.attrBegin, e.attrLength);
+
+            switch (e.kind)
+            {
+            case ELEMENT_LINE: {
+                WorldPoint pts[2] = {
+                    { ToWorld(NumberAttribute(attrs, "x1")), ToWorld(NumberAttribute(attrs, "y1")) },
+                    { ToWorld(NumberAttribute(attrs, "x2")), ToWorld(NumberAttribute(attrs, "y2")) } };
+                EmitShape(out, SHAPE_LINE, pts, 2);
+                break;
+            }
+            case ELEMENT_RECT: {
+                double x = NumberAttribute(attrs, "x"), y = NumberAttribute(attrs, "y");
+                WorldPoint pts[2] = {
+                    { ToWorld(x), ToWorld(y) },
+                    { ToWorld(x + NumberAttribute(attrs, "width")), ToWorld(y + NumberAttribute(attrs, "height")) } };
+                EmitShape(out, SHAPE_RECT, pts, 2);
+                break;
+            }
+            case ELEMENT_ELLIPSE:
+            case ELEMENT_CIRCLE: {
+                double cx = NumberAttribute(attrs, "cx"), cy = NumberAttribute(attrs, "cy");
+                double rx = e.kind == ELEMENT_CIRCLE ? NumberAttribute(attrs, "r") : NumberAttribute(attrs, "rx");
+                double ry = e.kind == ELEMENT_CIRCLE ? rx : NumberAttribute(attrs, "ry");
+                WorldPoint pts[2] = {
+                    { ToWorld(cx - rx), ToWorld(cy - ry) },
+                    { ToWorld(cx + rx), ToWorld(cy + ry) } };
+                EmitShape(out, SHAPE_ELLIPSE, pts, 2);
+                break;
+            }
+            case ELEMENT_POLYLINE:
+                ParsePoints(FindAttribute(attrs, "points"), out, false);
+                break;
+            case ELEMENT_POLYGON:
+                ParsePoints(FindAttribute(attrs, "points"), out, true);
+                break;
+            case ELEMENT_PATH:
+                ParsePath(FindAttribute(attrs, "d"), out);
+                break;
+            case ELEMENT_PATH_DATA:
+                ParsePath(attrs, out);
+                break;
+            }
+        }
+
+        return out;
+    }
+
+    bool ElementKindFromName(std::string_view name, ElementKind& kind)
+    {
+        if (name == "path")     { kind = ELEMENT_PATH; return true; }
+        if (name == "line")     { kind = ELEMENT_LINE; return true; }
+        if (name == "rect")     { kind = ELEMENT_RECT; return true; }
+        if (name == "ellipse")  { kind = ELEMENT_ELLIPSE; return true; }
+        if (name == "circle")   { kind = ELEMENT_CIRCLE; return true; }
+        if (name == "polyline") { kind = ELEMENT_POLYLINE; return true; }
+        if (name == "polygon")  { kind = ELEMENT_POLYGON; return true; }
+        return false;
+    }
+
+    // How far the search for the end of a markup got when it ran off the
+    // buffer. The next chunk resumes there instead of rescanning from '<',
+    // which would be quadratic in the length of a long element.
+    struct MarkupScan {
+        size_t next = 0;        // first index not scanned yet, 0 when not started
+        char quote = 0;         // attribute quote open at next
+    };
+
+    // Is text[start, ...) the marker, or too short to tell (-1)
+    int StartsWith(const std::string& text, size_t start, std::string_view marker)
+    {
+        const size_t available = text.size() - start;
+        const size_t n = available < marker.size() ? available : marker.size();
+        if (text.compare(start, n, marker.data(), n) != 0)
+            return 0;
+        return n == marker.size() ? 1 : -1;
+    }
+
+    // End of the markup starting at text[start] == '<', npos if not in the
+    // buffer yet (scan then records where to resume)
+    size_t FindMarkupEnd(const std::string& text, size_t start, MarkupScan& scan)
+    {
+        const bool resumed = scan.next > start;
+
+        // comments and CDATA end at their terminator, '>' inside is text
+        if (start + 1 >= text.size() || text[start + 1] == '!')
+        {
+            static const std::string_view MARKERS[][2] = { { "<!--", "-->" }, { "<![CDATA[", "]]>" } };
+            for (const auto& m : MARKERS)
+            {
+                const int is = StartsWith(text, start, m[0]);
+                if (is < 0)
+                {
+                    scan = MarkupScan{};
+                    return std::string::npos;
+                }
+                if (is == 0)
+                    continue;
+
+                // the terminator may straddle the previous end of the buffer
+                size_t from = start + m[0].size();
+                if (resumed && scan.next - m[1].size() + 1 > from)
+                    from = scan.next - m[1].size() + 1;
+                const size_t e = text.find(m[1], from);
+                if (e == std::string::npos)
+                {
+                    scan.next = text.size();
+                    return e;
+                }
+                scan = MarkupScan{};
+                return e + m[1].size();
+            }
+        }
+
+        char quote = resumed ? scan.quote : 0;
+        for (size_t i = resumed ? scan.next : start + 1; i < text.size(); ++i)
+        {
+            char c = text[i];
+            if (quote)
+            {
+                if (c == quote)
+                    quote = 0;
+            }
+            else if (c == '"' || c == '\'')
+            {
+                quote = c;
+            }
+            else if (c == '>')
+            {
+                scan = MarkupScan{};
+                return i + 1;
+            }
+        }
+
+        scan.next = text.size();
+        scan.quote = quote;
+        return std::string::npos;
+    }
+
+    // Appends the element to the batch, submitting full batches. A long path
+    // is cut into pieces at absolute moveto commands: no path state (current
+    // point, subpath start, curve reflection) carries across one, so the
+    // pieces parse independently on the pool and give the same shapes.
+    template <class Submit>
+    void AddElement(Batch& batch, ElementKind kind, std::string_view attrs, Submit&& submit)
+    {
+        std::string_view d;
+        if (kind == ELEMENT_PATH && attrs.size() > PATH_PIECE_BYTES)
+            d = FindAttribute(attrs, "d");
+
+        auto append = [&](ElementKind k, std::string_view text)
+            {
+                Element e;
+                e.kind = k;
+                e.attrBegin = (uint32_t)batch.text.size();
+                e.attrLength = (uint32_t)text.size();
+                batch.text.append(text);
+                batch.elements.push_back(e);
+
+                if (batch.text.size() >= BATCH_BYTES)
+                {
+                    submit(std::move(batch));
+                    batch = Batch{};
+                }
+            };
+
+        if (d.size() <= PATH_PIECE_BYTES)
+        {
+            append(kind, attrs);
+            return;
+        }
+
+        size_t begin = 0;
+        while (begin < d.size())
+        {
+            size_t cut = begin + PATH_PIECE_BYTES < d.size() ? d.find('M', begin + PATH_PIECE_BYTES) : std::string_view::npos;
+            if (cut == std::string_view::npos)
+                cut = d.size();
+            append(ELEMENT_PATH_DATA, d.substr(begin, cut - begin));
+            begin = cut;
+        }
+    }
+
+    FILE* OpenForRead(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        FILE* f = nullptr;
+        if (_wfopen_s(&f, path.c_str(), L"rb") != 0)
+            return nullptr;
+        return f;
+#else
+        return std::fopen(path.c_str(), "rb");
+#endif
+    }
+
+} // namespace
+
+bool ImportSvg(const std::filesystem::path& path, SceneStore& scene, ThreadPool& pool, SvgImportStats* stats)
+{
+    FILE* f = OpenForRead(path);
+    if (!f)
+        return false;
+
+    const uint32_t firstId = (uint32_t)scene.ShapeCount();
+    SvgImportStats local;
+    std::deque<std::future<ParsedShapes>> inFlight;
+
+    // Append the oldest batch result (keeps document order)
+    auto appendOldest = [&]()
+        {
+            ParsedShapes parsed = inFlight.front().get();
+            inFlight.pop_front();
+
+            size_t pointIndex = 0;
+            for (size_t i = 0; i < parsed.kinds.size(); ++i)
+            {
+                scene.Append(parsed.kinds[i], parsed.points.data() + pointIndex, parsed.counts[i]);
+                pointIndex += parsed.counts[i];
+            }
+            local.shapes += parsed.kinds.size();
+            local.vertices += parsed.points.size();
+        };
+
+    auto submit = [&](Batch&& batch)
+        {
+            if (batch.elements.empty())
+                return;
+            if (inFlight.size() >= MAX_BATCHES_IN_FLIGHT)
+                appendOldest();
+
+            auto shared = std::make_shared<Batch>(std::move(batch));
+            inFlight.push_back(pool.Submit([shared]() { return ParseBatch(*shared); }));
+        };
+
+    std::string buffer;
+    std::vector<char> chunk(READ_CHUNK_BYTES);
+    Batch batch;
+    MarkupScan scan;
+    bool eof = false;
+    bool ok = true;
+
+    while (!eof)
+    {
+        size_t n = std::fread(chunk.data(), 1, chunk.size(), f);
+        local.bytes += n;
+        eof = n < chunk.size();
+        if (eof && std::ferror(f))
+        {
+            ok = false;
+            break;
+        }
+        buffer.append(chunk.data(), n);
+
+        // Split every complete markup in the buffer, keep a trailing partial one
+        size_t pos = 0;
+        while (true)
+        {
+            size_t lt = buffer.find('<', pos);
+            if (lt == std::string::npos)
+            {
+                pos = buffer.size();
+                break;
+            }
+
+            size_t gt = FindMarkupEnd(buffer, lt, scan);
+            if (gt == std::string::npos)
+            {
+                pos = lt;
+                break;
+            }
+
+            // tag name
+            size_t nameBegin = lt + 1;
+            size_t nameEnd = nameBegin;
+            while (nameEnd < gt && buffer[nameEnd] != '>' && buffer[nameEnd] != '/' && !IsSpace(buffer[nameEnd]))
+                ++nameEnd;
+
+            std::string_view name(buffer.data() + nameBegin, nameEnd - nameBegin);
+            size_t colon = name.find(':');          // svg:path
+            if (colon != std::string_view::npos)
+                name = name.substr(colon + 1);
+
+            ElementKind kind;
+            if (ElementKindFromName(name, kind))
+            {
+                AddElement(batch, kind, std::string_view(buffer.data() + nameEnd, gt - nameEnd), submit);
+                ++local.elements;
+            }
+
+            pos = gt;
+        }
+
+        buffer.erase(0, pos);
+        if (scan.next > 0)
+            scan.next -= pos;
+    }
+
+    // a markup still open at the end of the file was cut off
+    if (ok && buffer.find('<') != std::string::npos)
+        ok = false;
+
+    std::fclose(f);
+    if (ok)
+        submit(std::move(batch));
+
+    while (!inFlight.empty())
+        appendOldest();
+
+    if (!ok)
+    {
+        // leave the scene as it was
+        SceneStore partial;
+        scene.MoveTail(firstId, partial);
+        return false;
+    }
+
+    if (stats)
+        *stats = local;
+    return true;
+}
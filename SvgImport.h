@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "SceneStore.h"
+
+class ThreadPool;
+
+// -------------------- Streaming SVG import --------------------
+// Reads an SVG file in fixed size chunks without building a DOM. The reader
+// thread only splits the text into elements; batches of elements (path data
+// is where the bytes are) are parsed on the thread pool and appended to the
+// scene in document order. Long path data is cut at its absolute moveto
+// commands, so a single huge path is parsed in parallel as well.
+//
+// Supported: line, rect, ellipse, circle, polyline, polygon and path
+// (M L H V C S Q T A Z, absolute and relative; curves and arcs are
+// flattened). Closed subpaths become multilines, open ones become lines.
+// Transforms, styles and nested coordinate systems are ignored.
+//
+// Returns false, with the scene left as it was, when the file cannot be
+// read or ends inside a markup.
+
+struct SvgImportStats {
+    uint64_t bytes = 0;
+    uint64_t elements = 0;      // supported elements found
+    uint64_t shapes = 0;        // shapes appended to the scene
+    uint64_t vertices = 0;
+};
+
+bool ImportSvg(const std::filesystem::path& path, SceneStore& scene, ThreadPool& pool, SvgImportStats* stats = nullptr);
@@ -0,0 +1,110 @@
+#include "ThreadPool.h"
+
+namespace {
+    // Identifies the pool and queue of the calling worker thread
+    thread_local const void* t_pool = nullptr;
+    thread_local unsigned t_queue = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    m_queues.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+
+    m_workers.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& t : m_workers)
+        t.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    unsigned index = t_pool == this
+        ? t_queue
+        : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % (unsigned)m_queues.size();
+
+    // counted before the push (a pop never sees it negative) and under the
+    // sleep mutex (a worker cannot miss the wake-up)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::TryPop(unsigned index, std::function<void()>& task)
+{
+    const unsigned count = (unsigned)m_queues.size();
+
+    // own queue: newest first
+    {
+        WorkerQueue& own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // steal: oldest first, starting at the next worker
+    for (unsigned i = 1; i < count; ++i)
+    {
+        WorkerQueue& victim = *m_queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            m_steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned index)
+{
+    t_pool = this;
+    t_queue = index;
+
+    while (true)
+    {
+        std::function<void()> task;
+        if (TryPop(index, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this]() { return m_stopping || m_pending.load(std::memory_order_relaxed) > 0; });
+        if (m_stopping && m_pending.load(std::memory_order_relaxed) == 0)
+            return;     // stopping and drained
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// -------------------- Thread pool --------------------
+// Work-stealing pool: every worker owns a task deque. Tasks submitted from a
+// worker go to its own deque and are popped LIFO (cache warm); tasks from
+// other threads are dealt round-robin. An idle worker steals the oldest task
+// from the other deques before going to sleep.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned threads = 0);      // 0 = one per hardware thread
+    ~ThreadPool();                                  // runs the queued tasks, then joins
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned Size() const { return (unsigned)m_workers.size(); }
+    uint64_t Steals() const { return m_steals.load(std::memory_order_relaxed); }
+
+    template <class F>
+    auto Submit(F&& fn) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(fn));
+        std::future<Result> result = task->get_future();
+        Enqueue([task]() { (*task)(); });
+        return result;
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void Enqueue(std::function<void()> task);
+    bool TryPop(unsigned index, std::function<void()>& task);
+    void WorkerLoop(unsigned index);
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::atomic<size_t> m_pending{ 0 };            // queued, not yet taken
+    std::atomic<unsigned> m_nextQueue{ 0 };
+    std::atomic<uint64_t> m_steals{ 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+};
@@ -0,0 +1,373 @@
+#include "TileCache.h"
+
+#include <cmath>
+#include <future>
+
+#include "BoundsTree.h"
+#include "ThreadPool.h"
+#include "TileRasterizer.h"
+
+namespace {
+
+    const double EXACT_SCALE_EPSILON = 1e-9;    // scales this close to 1 are drawn unscaled
+
+    int32_t FloorDiv(int64_t a, int64_t b)
+    {
+        int64_t q = a / b;
+        if ((a % b != 0) && ((a < 0) != (b < 0)))
+            --q;
+        return (int32_t)q;
+    }
+
+    ScreenRect Intersect(const ScreenRect& a, const ScreenRect& b)
+    {
+        return ScreenRect{
+            a.left > b.left ? a.left : b.left, a.top > b.top ? a.top : b.top,
+            a.right < b.right ? a.right : b.right, a.bottom < b.bottom ? a.bottom : b.bottom };
+    }
+
+} // namespace
+
+TileCache::TileCache(size_t budgetBytes)
+    : m_levelTiles(MAX_LEVEL - MIN_LEVEL + 1, 0)
+    , m_budget(budgetBytes)
+{
+}
+
+// -------------------- Level geometry --------------------
+int32_t TileCache::LevelForZoom(double zoom)
+{
+    if (!(zoom > 0.0))
+        return 0;
+
+    double level = std::round(std::log(zoom) / std::log(LEVEL_STEP));
+    if (level < MIN_LEVEL)
+        return MIN_LEVEL;
+    if (level > MAX_LEVEL)
+        return MAX_LEVEL;
+    return (int32_t)level;
+}
+
+double TileCache::LevelZoom(int32_t level)
+{
+    return std::pow(LEVEL_STEP, (double)level);
+}
+
+double TileCache::LevelScale(const Camera& camera, int32_t level)
+{
+    const double scale = camera.zoom / LevelZoom(level);
+    return std::fabs(scale - 1.0) < EXACT_SCALE_EPSILON ? 1.0 : scale;
+}
+
+Camera TileCache::TileCamera(const TileKey& key)
+{
+    Camera cam;
+    cam.zoom = LevelZoom(key.level);
+    cam.panX = -key.tx * TILE_SIZE;
+    cam.panY = -key.ty * TILE_SIZE;
+    return cam;
+}
+
+TileRange TileCache::TilesInView(const Camera& camera, int32_t level, const ScreenRect& area)
+{
+    // screen x = level pixel x * scale + pan
+    const double scale = LevelScale(camera, level);
+    const int64_t px0 = (int64_t)std::floor((area.left - camera.panX) / scale);
+    const int64_t py0 = (int64_t)std::floor((area.top - camera.panY) / scale);
+    const int64_t px1 = (int64_t)std::ceil((area.right - camera.panX) / scale) - 1;
+    const int64_t py1 = (int64_t)std::ceil((area.bottom - camera.panY) / scale) - 1;
+
+    return TileRange{ FloorDiv(px0, TILE_SIZE), FloorDiv(py0, TILE_SIZE), FloorDiv(px1, TILE_SIZE), FloorDiv(py1, TILE_SIZE) };
+}
+
+ScreenRect TileCache::TileScreenRect(const Camera& camera, const TileKey& key)
+{
+    // Edges are rounded from the unscaled tile grid so neighbours share them
+    const double scale = LevelScale(camera, key.level);
+    return ScreenRect{
+        (int32_t)std::llround((double)key.tx * TILE_SIZE * scale) + camera.panX,
+        (int32_t)std::llround((double)key.ty * TILE_SIZE * scale) + camera.panY,
+        (int32_t)std::llround((double)(key.tx + 1) * TILE_SIZE * scale) + camera.panX,
+        (int32_t)std::llround((double)(key.ty + 1) * TILE_SIZE * scale) + camera.panY };
+}
+
+WorldRect TileCache::TileWorldRect(const TileKey& key, int32_t marginPixels)
+{
+    // Level pixel p shows the world points with (int)(w * zoom) == p; one
+    // extra pixel on each side absorbs the truncation towards zero
+    const double zoom = LevelZoom(key.level);
+    const int64_t grow = (int64_t)marginPixels + 1;
+    return WorldRect{
+        (int32_t)std::floor(((int64_t)key.tx * TILE_SIZE - grow) / zoom),
+        (int32_t)std::floor(((int64_t)key.ty * TILE_SIZE - grow) / zoom),
+        (int32_t)std::ceil(((int64_t)(key.tx + 1) * TILE_SIZE + grow) / zoom),
+        (int32_t)std::ceil(((int64_t)(key.ty + 1) * TILE_SIZE + grow) / zoom) };
+}
+
+int32_t TileCache::MarginPixels() const
+{
+    return (m_pen.width > 1 ? m_pen.width : 1) / 2 + 2;
+}
+
+// -------------------- Style --------------------
+void TileCache::SetStyle(const PenStyle& pen, uint32_t background)
+{
+    if (pen == m_pen && background == m_background)
+        return;
+
+    m_pen = pen;
+    m_background = background;
+    Clear();
+}
+
+// -------------------- Cache --------------------
+const PixelBuffer* TileCache::Find(const TileKey& key)
+{
+    auto it = m_index.find(key);
+    if (it == m_index.end())
+    {
+        ++m_misses;
+        return nullptr;
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    ++m_hits;
+    return &it->second->pixels;
+}
+
+const PixelBuffer& TileCache::Insert(const TileKey& key, PixelBuffer&& tile)
+{
+    auto it = m_index.find(key);
+    if (it != m_index.end())
+    {
+        it->second->pixels = std::move(tile);
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return m_lru.front().pixels;
+    }
+
+    m_lru.push_front(Entry{ key, std::move(tile) });
+    m_index.emplace(key, m_lru.begin());
+    ++m_levelTiles[key.level - MIN_LEVEL];
+    m_bytes += TileBytes();
+
+    EvictToBudget();
+    return m_lru.front().pixels;
+}
+
+void TileCache::Erase(EntryList::iterator it)
+{
+    --m_levelTiles[it->key.level - MIN_LEVEL];
+    m_bytes -= TileBytes();
+    m_index.erase(it->key);
+    m_lru.erase(it);
+}
+
+void TileCache::EvictToBudget()
+{
+    // the most recent tile always stays, whatever the budget
+    while (m_bytes > m_budget && m_lru.size() > 1)
+    {
+        Erase(std::prev(m_lru.end()));
+        ++m_evictions;
+    }
+}
+
+void TileCache::SetBudget(size_t budgetBytes)
+{
+    m_budget = budgetBytes;
+    EvictToBudget();
+}
+
+void TileCache::Clear()
+{
+    m_lru.clear();
+    m_index.clear();
+    std::fill(m_levelTiles.begin(), m_levelTiles.end(), 0);
+    m_bytes = 0;
+}
+
+size_t TileCache::InvalidateWorldRect(const WorldRect& box)
+{
+    if (m_lru.empty())
+        return 0;
+
+    // Affected tile range of every level that has cached tiles
+    const int32_t margin = MarginPixels() + 1;
+    std::vector<TileRange>& ranges = m_ranges;
+    ranges.assign(m_levelTiles.size(), TileRange{ 1, 1, 0, 0 });
+    int64_t probes = 0;
+
+    for (size_t i = 0; i < m_levelTiles.size(); ++i)
+    {
+        if (m_levelTiles[i] == 0)
+            continue;
+
+        const double zoom = LevelZoom((int32_t)i + MIN_LEVEL);
+        TileRange& r = ranges[i];
+        r.x0 = FloorDiv((int64_t)std::floor(box.minX * zoom) - margin, TILE_SIZE);
+        r.y0 = FloorDiv((int64_t)std::floor(box.minY * zoom) - margin, TILE_SIZE);
+        r.x1 = FloorDiv((int64_t)std::ceil(box.maxX * zoom) + margin, TILE_SIZE);
+        r.y1 = FloorDiv((int64_t)std::ceil(box.maxY * zoom) + margin, TILE_SIZE);
+        probes += ((int64_t)r.x1 - r.x0 + 1) * ((int64_t)r.y1 - r.y0 + 1);
+    }
+
+    size_t dropped = 0;
+    if (probes <= (int64_t)m_index.size())
+    {
+        // Small edit: look the affected keys up
+        for (size_t i = 0; i < ranges.size(); ++i)
+        {
+            const TileRange& r = ranges[i];
+            for (int32_t ty = r.y0; ty <= r.y1; ++ty)
+            {
+                for (int32_t tx = r.x0; tx <= r.x1; ++tx)
+                {
+                    auto it = m_index.find(TileKey{ (int32_t)i + MIN_LEVEL, tx, ty });
+                    if (it == m_index.end())
+                        continue;
+                    Erase(it->second);
+                    ++dropped;
+                }
+            }
+        }
+    }
+    else
+    {
+        // Large edit: one pass over the cached tiles
+        for (auto it = m_lru.begin(); it != m_lru.end();)
+        {
+            const TileRange& r = ranges[it->key.level - MIN_LEVEL];
+            auto next = std::next(it);
+            if (it->key.tx >= r.x0 && it->key.tx <= r.x1 && it->key.ty >= r.y0 && it->key.ty <= r.y1)
+            {
+                Erase(it);
+                ++dropped;
+            }
+            it = next;
+        }
+    }
+
+    m_invalidated += dropped;
+    return dropped;
+}
+
+// -------------------- Composing a view --------------------
+// All tiles of level covering clip, if every one of them is cached
+bool TileCache::FindCover(const Camera& camera, int32_t level, const ScreenRect& clip, std::vector<TileDraw>& draws)
+{
+    const TileRange r = TilesInView(camera, level, clip);
+    for (int32_t ty = r.y0; ty <= r.y1; ++ty)
+        for (int32_t tx = r.x0; tx <= r.x1; ++tx)
+            if (!Contains(TileKey{ level, tx, ty }))
+                return false;
+
+    for (int32_t ty = r.y0; ty <= r.y1; ++ty)
+    {
+        for (int32_t tx = r.x0; tx <= r.x1; ++tx)
+        {
+            const TileKey key{ level, tx, ty };
+            const ScreenRect dst = TileScreenRect(camera, key);
+            const ScreenRect part = Intersect(dst, clip);
+            if (!RectIsEmpty(part))
+                draws.push_back(TileDraw{ Find(key), key, dst, part, true });
+        }
+    }
+    return true;
+}
+
+void TileCache::PlanView(const Camera& camera, const ScreenRect& area, std::vector<TileDraw>& draws, std::vector<TileKey>& missing)
+{
+    draws.clear();
+    missing.clear();
+    if (RectIsEmpty(area))
+        return;
+
+    const int32_t level = LevelForZoom(camera.zoom);
+    const TileRange r = TilesInView(camera, level, area);
+
+    for (int32_t ty = r.y0; ty <= r.y1; ++ty)
+    {
+        for (int32_t tx = r.x0; tx <= r.x1; ++tx)
+        {
+            const TileKey key{ level, tx, ty };
+            const ScreenRect dst = TileScreenRect(camera, key);
+            const ScreenRect clip = Intersect(dst, area);
+            if (RectIsEmpty(clip))
+                continue;
+
+            if (const PixelBuffer* tile = Find(key))
+            {
+                draws.push_back(TileDraw{ tile, key, dst, clip, false });
+                continue;
+            }
+
+            missing.push_back(key);
+
+            // Stand-in from the nearest level that has the area cached, finer first
+            for (int32_t d = 1; d <= MAX_FALLBACK_LEVELS; ++d)
+            {
+                const int32_t finer = level + d;
+                const int32_t coarser = level - d;
+                if (finer <= MAX_LEVEL && m_levelTiles[finer - MIN_LEVEL] > 0 && FindCover(camera, finer, clip, draws))
+                    break;
+                if (coarser >= MIN_LEVEL && m_levelTiles[coarser - MIN_LEVEL] > 0 && FindCover(camera, coarser, clip, draws))
+                    break;
+            }
+        }
+    }
+}
+
+void TileCache::RenderTile(const SceneStore& scene, BoundsTree& tree, const TileKey& key, PixelBuffer& out) const
+{
+    std::vector<uint32_t> ids;
+    tree.Query(TileWorldRect(key, MarginPixels()), [&](uint32_t id) { ids.push_back(id); });
+
+    RasterOptions options;
+    options.width = TILE_SIZE;
+    options.height = TILE_SIZE;
+    options.camera = TileCamera(key);
+    options.pen = m_pen;
+    options.background = m_background;
+    RasterizeShapes(scene, ids.data(), ids.size(), options, out);
+}
+
+void TileCache::RenderTiles(const SceneStore& scene, BoundsTree& tree, ThreadPool& pool, const TileKey* keys, size_t count)
+{
+    if (count == 0)
+        return;
+
+    std::vector<PixelBuffer> pixels(count);
+    if (count == 1)
+    {
+        RenderTile(scene, tree, keys[0], pixels[0]);
+    }
+    else
+    {
+        std::vector<std::vector<uint32_t>> ids(count);
+        for (size_t i = 0; i < count; ++i)
+            tree.Query(TileWorldRect(keys[i], MarginPixels()), [&](uint32_t id) { ids[i].push_back(id); });
+
+        RasterOptions options;
+        options.width = TILE_SIZE;
+        options.height = TILE_SIZE;
+        options.pen = m_pen;
+        options.background = m_background;
+
+        std::vector<std::future<void>> jobs;
+        jobs.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            jobs.push_back(pool.Submit([&, i, options]() mutable
+                {
+                    options.camera = TileCamera(keys[i]);
+                    RasterizeShapes(scene, ids[i].data(), ids[i].size(), options, pixels[i]);
+                }));
+        }
+        for (std::future<void>& f : jobs)
+            f.get();
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        Insert(keys[i], std::move(pixels[i]));
+    m_rendered += count;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "DisplayList.h"
+#include "Geometry.h"
+#include "PixelBuffer.h"
+#include "SceneStore.h"
+
+class BoundsTree;
+class ThreadPool;
+
+// -------------------- Tile pyramid cache --------------------
+// World space is cut into TILE_SIZE pixel square tiles at discrete zoom
+// levels. Level L is drawn at zoom LEVEL_STEP^L, the same 1.1x steps the
+// mouse wheel takes, so wheel zooms land exactly on a level and its tiles are
+// shown unscaled; other zooms scale the nearest level. Tile (L, tx, ty) holds
+// level pixels [tx * TILE_SIZE, (tx + 1) * TILE_SIZE) x [ty * ..., ...), i.e.
+// the scene rendered with camera { LEVEL_STEP^L, -tx * TILE_SIZE, -ty * TILE_SIZE }.
+//
+// Rasterized tiles are kept in an LRU list under a memory budget. Edits drop
+// only the tiles whose pixels the edited world area can reach.
+
+struct TileKey {
+    int32_t level;
+    int32_t tx;
+    int32_t ty;
+
+    bool operator==(const TileKey& o) const { return level == o.level && tx == o.tx && ty == o.ty; }
+};
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& k) const
+    {
+        uint64_t h = (uint64_t)(uint32_t)k.tx * 0x9E3779B97F4A7C15ull;
+        h ^= ((uint64_t)(uint32_t)k.ty + ((uint64_t)(uint32_t)k.level << 32)) * 0xC2B2AE3D27D4EB4Full;
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+// Tiles [x0, x1] x [y0, y1] of one level, inclusive
+struct TileRange {
+    int32_t x0;
+    int32_t y0;
+    int32_t x1;
+    int32_t y1;
+};
+
+// One tile to draw while composing a view: the tile's full screen rectangle
+// (scaled when the view is between levels) clipped to clip. Stand-ins come
+// from another level and cover a missing tile; drawing them before the
+// others needs no clipping, the view's own tiles overdraw what spills out.
+struct TileDraw {
+    const PixelBuffer* tile;
+    TileKey key;
+    ScreenRect dst;
+    ScreenRect clip;
+    bool standIn;
+};
+
+class TileCache
+{
+public:
+    static const int32_t TILE_SIZE = 256;
+    static constexpr double LEVEL_STEP = 1.1;
+    static const int32_t MIN_LEVEL = -25;               // 1.1^-25 ~ 0.09
+    static const int32_t MAX_LEVEL = 25;                // 1.1^25 ~ 10.8
+    static const int32_t MAX_FALLBACK_LEVELS = 8;       // levels searched for stand-in tiles
+    static const size_t DEFAULT_BUDGET_BYTES = 256u * 1024 * 1024;
+
+    explicit TileCache(size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+
+    // ---- level geometry ----
+    static int32_t LevelForZoom(double zoom);           // nearest level
+    static double LevelZoom(int32_t level);
+    static double LevelScale(const Camera& camera, int32_t level);     // view pixels per level pixel, 1.0 when exact
+    static Camera TileCamera(const TileKey& key);
+
+    // Tiles of level whose pixels lie in the screen rect under camera
+    static TileRange TilesInView(const Camera& camera, int32_t level, const ScreenRect& area);
+    static ScreenRect TileScreenRect(const Camera& camera, const TileKey& key);
+
+    // World area whose shapes can put pixels into the tile (strokes reach
+    // marginPixels beyond a shape's box)
+    static WorldRect TileWorldRect(const TileKey& key, int32_t marginPixels);
+
+    // ---- style ----
+    // Tiles are rendered with one pen on one background. Changing either clears the cache.
+    void SetStyle(const PenStyle& pen, uint32_t background);
+    const PenStyle& Pen() const { return m_pen; }
+    uint32_t Background() const { return m_background; }
+
+    // ---- cache ----
+    const PixelBuffer* Find(const TileKey& key);        // hit: becomes most recently used
+    bool Contains(const TileKey& key) const { return m_index.count(key) != 0; }
+    const PixelBuffer& Insert(const TileKey& key, PixelBuffer&& tile);     // evicts past the budget
+
+    // Drops the tiles of every level whose pixels the world box (grown by the
+    // pen) can reach. Returns the number of tiles dropped.
+    size_t InvalidateWorldRect(const WorldRect& box);
+    void Clear();
+
+    void SetBudget(size_t budgetBytes);
+    size_t BudgetBytes() const { return m_budget; }
+    size_t BytesUsed() const { return m_bytes; }
+    size_t Size() const { return m_index.size(); }
+
+    // ---- composing a view ----
+    // Tiles covering area under camera at the camera's level. Cached tiles go
+    // to draws, the others to missing; for each missing tile the nearest
+    // levels are searched for cached tiles that cover it and those are drawn
+    // (scaled) in its place. Pointers in draws are valid until the next
+    // Insert, Invalidate or Clear.
+    void PlanView(const Camera& camera, const ScreenRect& area, std::vector<TileDraw>& draws, std::vector<TileKey>& missing);
+
+    // Rasterizes tiles and inserts them. Shapes are looked up in tree on the
+    // calling thread (the tree is not thread safe); stroking runs on the pool.
+    void RenderTiles(const SceneStore& scene, BoundsTree& tree, ThreadPool& pool, const TileKey* keys, size_t count);
+
+    // One tile into out, single threaded
+    void RenderTile(const SceneStore& scene, BoundsTree& tree, const TileKey& key, PixelBuffer& out) const;
+
+    uint64_t Hits() const { return m_hits; }
+    uint64_t Misses() const { return m_misses; }
+    uint64_t Evictions() const { return m_evictions; }
+    uint64_t Invalidated() const { return m_invalidated; }
+    uint64_t Rendered() const { return m_rendered; }
+
+private:
+    struct Entry {
+        TileKey key;
+        PixelBuffer pixels;
+    };
+    using EntryList = std::list<Entry>;
+
+    static size_t TileBytes() { return (size_t)TILE_SIZE * TILE_SIZE * sizeof(uint32_t); }
+    int32_t MarginPixels() const;
+    void Erase(EntryList::iterator it);
+    void EvictToBudget();
+    bool FindCover(const Camera& camera, int32_t level, const ScreenRect& clip, std::vector<TileDraw>& draws);
+
+    EntryList m_lru;                                    // front: most recently used
+    std::unordered_map<TileKey, EntryList::iterator, TileKeyHash> m_index;
+    std::vector<int32_t> m_levelTiles;                  // cached tiles per level, index level - MIN_LEVEL
+    std::vector<TileRange> m_ranges;                    // InvalidateWorldRect scratch, same indexing
+    size_t m_budget;
+    size_t m_bytes = 0;
+
+    PenStyle m_pen{ 0, 0, 255, 2 };
+    uint32_t m_background = 0x00FFFFFF;
+
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_evictions = 0;
+    uint64_t m_invalidated = 0;
+    uint64_t m_rendered = 0;
+};
@@ -0,0 +1,461 @@
+#include "TileRasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <vector>
+
+#include "PngWriter.h"
+#include "PolygonLod.h"
+#include "ThreadPool.h"
+#include "TransformKernel.h"
+
+namespace {
+
+    const double PI = 3.14159265358979323846;
+    const int MIN_ELLIPSE_SEGMENTS = 8;
+    const int MAX_ELLIPSE_SEGMENTS = 1024;
+    const double ELLIPSE_SEGMENT_PIXELS = 4.0;      // target flattened segment length
+
+    // Scene transformed to screen space and binned to tiles
+    struct PreparedScene {
+        const SceneStore* scene = nullptr;
+        std::vector<ScreenPoint> points;            // one per scene vertex
+        std::vector<size_t> binOffsets;             // tile t owns binShapes[binOffsets[t], binOffsets[t + 1])
+        std::vector<uint32_t> binShapes;
+        uint32_t tileSize = 0;
+        uint32_t tilesX = 0;
+        uint32_t tilesY = 0;
+        double radius = 0.0;                        // half the pen width
+        double offset = 0.0;                        // odd widths are centred on pixel centres
+        uint32_t color = 0;
+    };
+
+    double Seconds(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    void PrepareScene(const SceneStore& scene, const RasterOptions& options, PreparedScene& out)
+    {
+        out.scene = &scene;
+        out.tileSize = std::max<uint32_t>(options.tileSize, 16);
+        out.tilesX = (options.width + out.tileSize - 1) / out.tileSize;
+        out.tilesY = (options.height + out.tileSize - 1) / out.tileSize;
+        out.radius = std::max(options.pen.width, 1) / 2.0;
+        out.offset = (std::max(options.pen.width, 1) % 2) ? 0.5 : 0.0;
+        out.color = ((uint32_t)options.pen.r << 16) | ((uint32_t)options.pen.g << 8) | options.pen.b;
+
+        out.points.resize(scene.VertexCount());
+        TransformToScreen(options.camera, scene.Xs(), scene.Ys(), scene.VertexCount(), out.points.data());
+
+        // Tile range touched by every shape (box grown by the stroke)
+        const size_t shapeCount = scene.ShapeCount();
+        const int32_t grow = (int32_t)std::ceil(out.radius) + 1;
+        std::vector<uint32_t> ranges(shapeCount * 4);
+        std::vector<size_t> counts((size_t)out.tilesX * out.tilesY + 1, 0);
+
+        for (uint32_t id = 0; id < (uint32_t)shapeCount; ++id)
+        {
+            uint32_t* range = &ranges[(size_t)id * 4];
+            range[0] = 1;   // empty unless set below
+            range[2] = 0;
+
+            const uint32_t count = scene.Count(id);
+            if (count < 2)
+                continue;
+
+            const ScreenPoint* p = &out.points[scene.Offset(id)];
+            int64_t minX = p[0].x, maxX = p[0].x, minY = p[0].y, maxY = p[0].y;
+            for (uint32_t i = 1; i < count; ++i)
+            {
+                minX = std::min<int64_t>(minX, p[i].x);
+                maxX = std::max<int64_t>(maxX, p[i].x);
+                minY = std::min<int64_t>(minY, p[i].y);
+                maxY = std::max<int64_t>(maxY, p[i].y);
+            }
+
+            minX = std::max<int64_t>(minX - grow, 0);
+            minY = std::max<int64_t>(minY - grow, 0);
+            maxX = std::min<int64_t>(maxX + grow, (int64_t)options.width - 1);
+            maxY = std::min<int64_t>(maxY + grow, (int64_t)options.height - 1);
+            if (minX > maxX || minY > maxY)
+                continue;
+
+            range[0] = (uint32_t)(minX / out.tileSize);
+            range[1] = (uint32_t)(minY / out.tileSize);
+            range[2] = (uint32_t)(maxX / out.tileSize);
+            range[3] = (uint32_t)(maxY / out.tileSize);
+
+            for (uint32_t ty = range[1]; ty <= range[3]; ++ty)
+                for (uint32_t tx = range[0]; tx <= range[2]; ++tx)
+                    ++counts[(size_t)ty * out.tilesX + tx];
+        }
+
+        // Prefix sums, then a second pass fills the bins in id order
+        out.binOffsets.assign(counts.size(), 0);
+        for (size_t t = 0; t + 1 < counts.size(); ++t)
+            out.binOffsets[t + 1] = out.binOffsets[t] + counts[t];
+        out.binShapes.resize(out.binOffsets.back());
+
+        std::vector<size_t> cursor(out.binOffsets.begin(), out.binOffsets.end() - 1);
+        for (uint32_t id = 0; id < (uint32_t)shapeCount; ++id)
+        {
+            const uint32_t* range = &ranges[(size_t)id * 4];
+            if (range[0] > range[2])
+                continue;
+
+            for (uint32_t ty = range[1]; ty <= range[3]; ++ty)
+                for (uint32_t tx = range[0]; tx <= range[2]; ++tx)
+                    out.binShapes[cursor[(size_t)ty * out.tilesX + tx]++] = id;
+        }
+    }
+
+    // Pixels of one tile, drawn into a target whose row 0 is image row originY
+    struct TileTarget {
+        PixelBuffer* buffer;
+        int originY;
+        ScreenRect clip;        // tile rectangle in image pixels
+        double radius;
+        uint32_t color;
+    };
+
+    // Round capped stroke from a to b. Pixel (x, y) is covered when its centre
+    // (x + 0.5, y + 0.5) lies within radius of the segment; the covered part
+    // of a row is one interval because the capsule is convex.
+    void StrokeSegment(const TileTarget& t, double ax, double ay, double bx, double by)
+    {
+        const double r = t.radius;
+        if (std::max(ax, bx) + r < t.clip.left || std::min(ax, bx) - r > t.clip.right ||
+            std::max(ay, by) + r < t.clip.top || std::min(ay, by) - r > t.clip.bottom)
+            return;
+
+        const double dx = bx - ax, dy = by - ay;
+        const double len2 = dx * dx + dy * dy;
+        const double rLen = r * std::sqrt(len2);
+        const double inf = std::numeric_limits<double>::infinity();
+
+        int y0 = std::max((int)std::floor(std::min(ay, by) - r - 0.5), (int)t.clip.top);
+        int y1 = std::min((int)std::ceil(std::max(ay, by) + r - 0.5), (int)t.clip.bottom - 1);
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            const double py = y + 0.5;
+            double lo = inf, hi = -inf;
+
+            // end caps
+            for (int end = 0; end < 2; ++end)
+            {
+                double cx = end ? bx : ax, cy = end ? by : ay;
+                double d = py - cy;
+                if (d * d <= r * r)
+                {
+                    double h = std::sqrt(r * r - d * d);
+                    lo = std::min(lo, cx - h);
+                    hi = std::max(hi, cx + h);
+                }
+            }
+
+            // body: 0 <= (p - a).d <= |d|^2 and |(p - a) x d| <= r |d|
+            if (len2 > 0.0)
+            {
+                double sLo = -inf, sHi = inf;
+                bool empty = false;
+
+                double along = (py - ay) * dy;
+                if (dx != 0.0)
+                {
+                    double u = ax - along / dx, v = ax + (len2 - along) / dx;
+                    sLo = std::max(sLo, std::min(u, v));
+                    sHi = std::min(sHi, std::max(u, v));
+                }
+                else if (along < 0.0 || along > len2)
+                {
+                    empty = true;
+                }
+
+                double across = (py - ay) * dx;
+                if (dy != 0.0)
+                {
+                    double u = ax + (across - rLen) / dy, v = ax + (across + rLen) / dy;
+                    sLo = std::max(sLo, std::min(u, v));
+                    sHi = std::min(sHi, std::max(u, v));
+                }
+                else if (std::fabs(across) > rLen)
+                {
+                    empty = true;
+                }
+
+                if (!empty && sLo <= sHi)
+                {
+                    lo = std::min(lo, sLo);
+                    hi = std::max(hi, sHi);
+                }
+            }
+
+            if (lo > hi)
+                continue;
+
+            double fx0 = std::max(std::ceil(lo - 0.5), (double)t.clip.left);
+            double fx1 = std::min(std::floor(hi - 0.5), (double)t.clip.right - 1);
+            if (fx0 > fx1)
+                continue;
+
+            uint32_t* row = t.buffer->Row(y - t.originY);
+            std::fill(row + (int)fx0, row + (int)fx1 + 1, t.color);
+        }
+    }
+
+    void StrokeEllipse(const TileTarget& t, double x0, double y0, double x1, double y1)
+    {
+        const double cx = (x0 + x1) / 2.0, cy = (y0 + y1) / 2.0;
+        const double rx = std::fabs(x1 - x0) / 2.0, ry = std::fabs(y1 - y0) / 2.0;
+
+        if (cx + rx + t.radius < t.clip.left || cx - rx - t.radius > t.clip.right ||
+            cy + ry + t.radius < t.clip.top || cy - ry - t.radius > t.clip.bottom)
+            return;
+
+        int segments = (int)std::ceil(2.0 * PI * std::max(rx, ry) / ELLIPSE_SEGMENT_PIXELS);
+        segments = std::clamp(segments, MIN_ELLIPSE_SEGMENTS, MAX_ELLIPSE_SEGMENTS);
+
+        double px = cx + rx, py = cy;
+        for (int i = 1; i <= segments; ++i)
+        {
+            double a = 2.0 * PI * i / segments;
+            double nx = cx + rx * std::cos(a), ny = cy + ry * std::sin(a);
+            StrokeSegment(t, px, py, nx, ny);
+            px = nx;
+            py = ny;
+        }
+    }
+
+    // Outline of one shape from its screen space vertices; o shifts odd pen
+    // widths onto pixel centres
+    void StrokeShape(const TileTarget& t, ShapeKind kind, const ScreenPoint* p, uint32_t count, double o)
+    {
+        switch (kind)
+        {
+        case SHAPE_LINE:
+            for (uint32_t i = 0; i + 1 < count; ++i)
+                StrokeSegment(t, p[i].x + o, p[i].y + o, p[i + 1].x + o, p[i + 1].y + o);
+            break;
+
+        case SHAPE_RECT: {
+            const double x0 = p[0].x + o, y0 = p[0].y + o, x1 = p[1].x + o, y1 = p[1].y + o;
+            StrokeSegment(t, x0, y0, x1, y0);
+            StrokeSegment(t, x1, y0, x1, y1);
+            StrokeSegment(t, x1, y1, x0, y1);
+            StrokeSegment(t, x0, y1, x0, y0);
+            break;
+        }
+
+        case SHAPE_ELLIPSE:
+            StrokeEllipse(t, p[0].x + o, p[0].y + o, p[1].x + o, p[1].y + o);
+            break;
+
+        case SHAPE_MULTILINE:
+        case SHAPE_POLIGON:
+            // drawn closed, like PolyPolygon on screen
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const ScreenPoint& a = p[i];
+                const ScreenPoint& c = p[(i + 1) % count];
+                StrokeSegment(t, a.x + o, a.y + o, c.x + o, c.y + o);
+            }
+            break;
+        }
+    }
+
+    void RasterizeTile(const PreparedScene& prep, const RasterOptions& options, PixelBuffer& buffer, int originY, uint32_t tx, uint32_t ty)
+    {
+        TileTarget t;
+        t.buffer = &buffer;
+        t.originY = originY;
+        t.clip.left = (int32_t)(tx * prep.tileSize);
+        t.clip.top = (int32_t)(ty * prep.tileSize);
+        t.clip.right = (int32_t)std::min(options.width, (tx + 1) * prep.tileSize);
+        t.clip.bottom = (int32_t)std::min(options.height, (ty + 1) * prep.tileSize);
+        t.radius = prep.radius;
+        t.color = prep.color;
+
+        for (int32_t y = t.clip.top; y < t.clip.bottom; ++y)
+        {
+            uint32_t* row = buffer.Row(y - originY);
+            std::fill(row + t.clip.left, row + t.clip.right, options.background);
+        }
+
+        const SceneStore& scene = *prep.scene;
+        const size_t tile = (size_t)ty * prep.tilesX + tx;
+
+        for (size_t b = prep.binOffsets[tile]; b < prep.binOffsets[tile + 1]; ++b)
+        {
+            const uint32_t id = prep.binShapes[b];
+            StrokeShape(t, scene.Kind(id), &prep.points[scene.Offset(id)], scene.Count(id), prep.offset);
+        }
+    }
+
+} // namespace
+
+Camera FitCameraToScene(const SceneStore& scene, uint32_t width, uint32_t height, int32_t marginPixels)
+{
+    Camera cam;
+    if (scene.VertexCount() == 0)
+        return cam;
+
+    const int32_t* xs = scene.Xs();
+    const int32_t* ys = scene.Ys();
+    int32_t minX = xs[0], maxX = xs[0], minY = ys[0], maxY = ys[0];
+    for (size_t i = 1; i < scene.VertexCount(); ++i)
+    {
+        minX = std::min(minX, xs[i]);
+        maxX = std::max(maxX, xs[i]);
+        minY = std::min(minY, ys[i]);
+        maxY = std::max(maxY, ys[i]);
+    }
+
+    const double availW = std::max<double>((double)width - 2.0 * marginPixels, 1.0);
+    const double availH = std::max<double>((double)height - 2.0 * marginPixels, 1.0);
+    const double spanX = std::max<double>((double)maxX - minX, 1.0);
+    const double spanY = std::max<double>((double)maxY - minY, 1.0);
+
+    cam.zoom = std::min(availW / spanX, availH / spanY);
+    cam.panX = marginPixels + (int32_t)((availW - spanX * cam.zoom) / 2.0) - (int32_t)(minX * cam.zoom);
+    cam.panY = marginPixels + (int32_t)((availH - spanY * cam.zoom) / 2.0) - (int32_t)(minY * cam.zoom);
+    return cam;
+}
+
+void RasterizeScene(const SceneStore& scene, const RasterOptions& options, ThreadPool& pool, PixelBuffer& out, RasterStats* stats)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    PreparedScene prep;
+    PrepareScene(scene, options, prep);
+    out.Resize((int)options.width, (int)options.height);
+
+    std::vector<std::future<void>> tiles;
+    tiles.reserve((size_t)prep.tilesX * prep.tilesY);
+    for (uint32_t ty = 0; ty < prep.tilesY; ++ty)
+        for (uint32_t tx = 0; tx < prep.tilesX; ++tx)
+            tiles.push_back(pool.Submit([&prep, &options, &out, tx, ty]() { RasterizeTile(prep, options, out, 0, tx, ty); }));
+
+    for (std::future<void>& f : tiles)
+        f.get();
+
+    if (stats)
+    {
+        stats->tiles = prep.tilesX * prep.tilesY;
+        stats->binnedShapes = prep.binShapes.size();
+        stats->rasterSeconds = Seconds(start);
+        stats->encodeSeconds = 0.0;
+    }
+}
+
+bool ExportScenePng(const std::filesystem::path& path, const SceneStore& scene, const RasterOptions& options, ThreadPool& pool, RasterStats* stats)
+{
+    if (options.width == 0 || options.height == 0)
+        return false;
+
+    PngWriter png;
+    if (!png.Open(path, options.width, options.height))
+        return false;
+
+    double rasterSeconds = 0.0, encodeSeconds = 0.0;
+    auto start = std::chrono::steady_clock::now();
+
+    PreparedScene prep;
+    PrepareScene(scene, options, prep);
+
+    // Two band buffers: band n + 1 is rasterized while band n is encoded
+    PixelBuffer bands[2];
+    std::vector<std::future<void>> pending[2];
+    bands[0].Resize((int)options.width, (int)prep.tileSize);
+    bands[1].Resize((int)options.width, (int)prep.tileSize);
+
+    auto launchBand = [&](uint32_t ty)
+        {
+            PixelBuffer& band = bands[ty % 2];
+            const int originY = (int)(ty * prep.tileSize);
+            for (uint32_t tx = 0; tx < prep.tilesX; ++tx)
+                pending[ty % 2].push_back(pool.Submit([&prep, &options, &band, originY, tx, ty]() { RasterizeTile(prep, options, band, originY, tx, ty); }));
+        };
+
+    launchBand(0);
+    rasterSeconds += Seconds(start);
+
+    bool ok = true;
+    for (uint32_t ty = 0; ty < prep.tilesY; ++ty)
+    {
+        start = std::chrono::steady_clock::now();
+        if (ty + 1 < prep.tilesY)
+            launchBand(ty + 1);
+        for (std::future<void>& f : pending[ty % 2])
+            f.get();
+        pending[ty % 2].clear();
+        rasterSeconds += Seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        const PixelBuffer& band = bands[ty % 2];
+        const uint32_t rows = std::min(prep.tileSize, options.height - ty * prep.tileSize);
+        for (uint32_t y = 0; y < rows && ok; ++y)
+            ok = png.WriteRow(band.Row((int)y));
+        encodeSeconds += Seconds(start);
+
+        if (!ok)
+        {
+            // let the in-flight band finish before its buffer goes away
+            for (std::future<void>& f : pending[(ty + 1) % 2])
+                f.get();
+            break;
+        }
+    }
+
+    start = std::chrono::steady_clock::now();
+    ok = png.Close() && ok;
+    encodeSeconds += Seconds(start);
+
+    if (stats)
+    {
+        stats->tiles = prep.tilesX * prep.tilesY;
+        stats->binnedShapes = prep.binShapes.size();
+        stats->rasterSeconds = rasterSeconds;
+        stats->encodeSeconds = encodeSeconds;
+    }
+    return ok;
+}
+
+void RasterizeShapes(const SceneStore& scene, const uint32_t* ids, size_t count, const RasterOptions& options, PixelBuffer& out)
+{
+    out.Resize((int)options.width, (int)options.height);
+    out.Fill(options.background);
+
+    const int32_t width = std::max(options.pen.width, 1);
+    TileTarget t;
+    t.buffer = &out;
+    t.originY = 0;
+    t.clip = ScreenRect{ 0, 0, (int32_t)options.width, (int32_t)options.height };
+    t.radius = width / 2.0;
+    t.color = ((uint32_t)options.pen.r << 16) | ((uint32_t)options.pen.g << 8) | options.pen.b;
+    const double o = (width % 2) ? 0.5 : 0.0;
+
+    const int lodLevel = options.lod ? PolygonLod::SelectLevel(options.camera.zoom) : -1;
+
+    std::vector<ScreenPoint> points;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t id = ids[i];
+        const ShapeKind kind = scene.Kind(id);
+        const int32_t* xs = scene.Xs() + scene.Offset(id);
+        const int32_t* ys = scene.Ys() + scene.Offset(id);
+        uint32_t n = scene.Count(id);
+        if (lodLevel >= 0 && (kind == SHAPE_MULTILINE || kind == SHAPE_POLIGON))
+            options.lod->Get(id, lodLevel, xs, ys, n);
+        if (n < 2)
+            continue;
+
+        points.resize(n);
+        TransformToScreen(options.camera, xs, ys, n, points.data());
+        StrokeShape(t, kind, points.data(), n, o);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "DisplayList.h"
+#include "Geometry.h"
+#include "PixelBuffer.h"
+#include "SceneStore.h"
+
+class PolygonLod;
+class ThreadPool;
+
+// -------------------- Tiled software rasterizer --------------------
+// Headless renderer for exports: the image is cut into square tiles, every
+// shape is binned to the tiles its screen bounding box touches and the tiles
+// are stroked in parallel. Strokes are round capped segments of the pen
+// width, outlines only, like the GDI pen with a hollow brush used on screen.
+//
+// PNG export renders one band of tiles at a time (the next band is
+// rasterized while the previous one is encoded), so memory stays at two
+// bands whatever the image height.
+
+struct RasterOptions {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    Camera camera;
+    PenStyle pen{ 0, 0, 255, 2 };                   // same as the on-screen shape pen
+    uint32_t background = 0x00FFFFFF;
+    uint32_t tileSize = 256;
+    const PolygonLod* lod = nullptr;                // RasterizeShapes: simplified levels picked by camera zoom
+};
+
+struct RasterStats {
+    uint32_t tiles = 0;
+    uint64_t binnedShapes = 0;      // shape/tile pairs after binning
+    double rasterSeconds = 0.0;     // binning + stroking (wall clock)
+    double encodeSeconds = 0.0;     // PNG encoding and writing
+};
+
+// Camera that fits every shape of the scene into a width x height image
+Camera FitCameraToScene(const SceneStore& scene, uint32_t width, uint32_t height, int32_t marginPixels);
+
+void RasterizeScene(const SceneStore& scene, const RasterOptions& options, ThreadPool& pool, PixelBuffer& out, RasterStats* stats = nullptr);
+
+// Single threaded: only the listed shapes, into an options.width x options.height
+// image. For callers that already know which shapes touch the image (the
+// tile cache asks its bounds tree), so nothing else is transformed or binned.
+// With options.lod set, dense polygons are stroked from the level that
+// PolygonLod::SelectLevel picks for the camera zoom; lod must be built from
+// the same scene.
+void RasterizeShapes(const SceneStore& scene, const uint32_t* ids, size_t count, const RasterOptions& options, PixelBuffer& out);
+
+bool ExportScenePng(const std::filesystem::path& path, const SceneStore& scene, const RasterOptions& options, ThreadPool& pool, RasterStats* stats = nullptr);
@@ -0,0 +1,205 @@
+#include "TransformKernel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC / Clang need the target enabled per function, MSVC accepts the intrinsics as is
+#if defined(TRANSFORM_X86) && !defined(_MSC_VER)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+    void TransformScalar(const Camera& cam, const int32_t* xs, const int32_t* ys, size_t count, ScreenPoint* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i].x = (int32_t)(xs[i] * cam.zoom) + cam.panX;
+            out[i].y = (int32_t)(ys[i] * cam.zoom) + cam.panY;
+        }
+    }
+
+#ifdef TRANSFORM_X86
+
+    TARGET_SSE2 void TransformSse2(const Camera& cam, const int32_t* xs, const int32_t* ys, size_t count, ScreenPoint* out)
+    {
+        const __m128d zoom = _mm_set1_pd(cam.zoom);
+        const __m128i pan = _mm_setr_epi32(cam.panX, cam.panY, cam.panX, cam.panY);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i));
+            __m128i y4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i));
+
+            // two doubles per register: low pair then high pair
+            __m128i xLo = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(x4), zoom));
+            __m128i xHi = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x4, _MM_SHUFFLE(1, 0, 3, 2))), zoom));
+            __m128i yLo = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(y4), zoom));
+            __m128i yHi = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(y4, _MM_SHUFFLE(1, 0, 3, 2))), zoom));
+
+            // interleave into x0 y0 x1 y1 | x2 y2 x3 y3
+            __m128i p01 = _mm_add_epi32(_mm_unpacklo_epi32(xLo, yLo), pan);
+            __m128i p23 = _mm_add_epi32(_mm_unpacklo_epi32(xHi, yHi), pan);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), p01);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 2), p23);
+        }
+
+        TransformScalar(cam, xs + i, ys + i, count - i, out + i);
+    }
+
+    TARGET_AVX2 void TransformAvx2(const Camera& cam, const int32_t* xs, const int32_t* ys, size_t count, ScreenPoint* out)
+    {
+        const __m256d zoom = _mm256_set1_pd(cam.zoom);
+        const __m128i pan = _mm_setr_epi32(cam.panX, cam.panY, cam.panX, cam.panY);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i));
+            __m128i y4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i));
+
+            __m128i xi = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtepi32_pd(x4), zoom));
+            __m128i yi = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtepi32_pd(y4), zoom));
+
+            __m128i p01 = _mm_add_epi32(_mm_unpacklo_epi32(xi, yi), pan);
+            __m128i p23 = _mm_add_epi32(_mm_unpackhi_epi32(xi, yi), pan);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), p01);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 2), p23);
+        }
+
+        TransformScalar(cam, xs + i, ys + i, count - i, out + i);
+    }
+
+    bool CpuHasAvx2()
+    {
+#if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7)
+            return false;
+
+        __cpuid(regs, 1);
+        const bool osxsave = (regs[2] & (1 << 27)) != 0;
+        const bool avx = (regs[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx)
+            return false;
+
+        // OS must save the YMM state
+        if ((_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    bool CpuHasSse2()
+    {
+#if defined(_M_X64) || defined(__x86_64__)
+        return true;    // part of the x86-64 baseline
+#elif defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 1);
+        return (regs[3] & (1 << 26)) != 0;
+#else
+        return __builtin_cpu_supports("sse2");
+#endif
+    }
+
+#endif // TRANSFORM_X86
+
+    bool PathSupported(TransformPath path)
+    {
+#ifdef TRANSFORM_X86
+        // cpuid is slow, ask once
+        static const bool hasSse2 = CpuHasSse2();
+        static const bool hasAvx2 = CpuHasAvx2();
+
+        switch (path)
+        {
+        case TRANSFORM_SCALAR: return true;
+        case TRANSFORM_SSE2:   return hasSse2;
+        case TRANSFORM_AVX2:   return hasAvx2;
+        }
+        return false;
+#else
+        return path == TRANSFORM_SCALAR;
+#endif
+    }
+
+    TransformPath& ActivePathSlot()
+    {
+        static TransformPath active = BestTransformPath();
+        return active;
+    }
+
+} // namespace
+
+void TransformToScreenWith(TransformPath path, const Camera& cam, const int32_t* xs, const int32_t* ys, size_t count, ScreenPoint* out)
+{
+#ifdef TRANSFORM_X86
+    if (PathSupported(path))
+    {
+        switch (path)
+        {
+        case TRANSFORM_AVX2:
+            TransformAvx2(cam, xs, ys, count, out);
+            return;
+        case TRANSFORM_SSE2:
+            TransformSse2(cam, xs, ys, count, out);
+            return;
+        case TRANSFORM_SCALAR:
+            break;
+        }
+    }
+#endif
+    TransformScalar(cam, xs, ys, count, out);
+}
+
+void TransformToScreen(const Camera& cam, const int32_t* xs, const int32_t* ys, size_t count, ScreenPoint* out)
+{
+    TransformToScreenWith(ActivePathSlot(), cam, xs, ys, count, out);
+}
+
+TransformPath BestTransformPath()
+{
+    static const TransformPath best =
+        PathSupported(TRANSFORM_AVX2) ? TRANSFORM_AVX2 :
+        PathSupported(TRANSFORM_SSE2) ? TRANSFORM_SSE2 : TRANSFORM_SCALAR;
+    return best;
+}
+
+TransformPath ActiveTransformPath()
+{
+    return ActivePathSlot();
+}
+
+void SetActiveTransformPath(TransformPath path)
+{
+    ActivePathSlot() = PathSupported(path) ? path : TRANSFORM_SCALAR;
+}
+
+const char* TransformPathName(TransformPath path)
+{
+    switch (path)
+    {
+    case TRANSFORM_SCALAR: return "scalar";
+    case TRANSFORM_SSE2:   return "sse2";
+    case TRANSFORM_AVX2:   return "avx2";
+    }
+    return "unknown";
+}
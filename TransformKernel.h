@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "Geometry.h"
+
+// -------------------- Batch world -> screen transform --------------------
+// out[i] = { (int)(xs[i] * zoom) + panX, (int)(ys[i] * zoom) + panY }
+//
+// Same double multiply and truncating conversion as the scalar WorldToScreen,
+// so every path is bit-exact with it (for results that fit in an int).
+// The SIMD path is picked once at runtime from the CPU features.
+
+enum TransformPath
+{
+    TRANSFORM_SCALAR = 0,
+    TRANSFORM_SSE2,
+    TRANSFORM_AVX2
+};
+
+void TransformToScreen(const Camera& cam, const int32_t* xs, const int32_t* ys, size_t count, ScreenPoint* out);
+
+// Explicit paths, mostly for equivalence checks and benchmarks. Calling a
+// path the CPU does not support falls back to the scalar one.
+void TransformToScreenWith(TransformPath path, const Camera& cam, const int32_t* xs, const int32_t* ys, size_t count, ScreenPoint* out);
+
+TransformPath BestTransformPath();          // fastest path this CPU supports
+TransformPath ActiveTransformPath();        // path used by TransformToScreen
+void SetActiveTransformPath(TransformPath path);
+const char* TransformPathName(TransformPath path);
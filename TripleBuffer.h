@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// -------------------- Triple buffer --------------------
+// Single producer / single consumer handoff of the latest value. The
+// producer fills Back() and publishes it with one atomic exchange, the
+// consumer switches to the newest published value with another; neither
+// side ever waits, and values published faster than they are taken
+// replace each other (only the newest is seen).
+//
+// Each side owns one slot, the third one sits in the middle: Publish swaps
+// the back slot with the middle one, Take swaps the front slot with it.
+// Slots are reused, so T should keep its capacity across assignments.
+template <class T>
+class TripleBuffer
+{
+public:
+    // Producer side: the slot to fill, not visible to the consumer
+    T& Back() { return m_slots[m_back]; }
+
+    // Producer side: make Back() the newest value and get a new back slot
+    void Publish()
+    {
+        m_back = m_middle.exchange((uint8_t)(m_back | FRESH), std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Consumer side: switch Front() to the newest published value. Returns
+    // false (Front() unchanged) when nothing was published since the last take.
+    bool Take()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    // Consumer side: the value taken last (a default T before the first take)
+    T& Front() { return m_slots[m_front]; }
+    const T& Front() const { return m_slots[m_front]; }
+
+    bool HasNew() const { return (m_middle.load(std::memory_order_relaxed) & FRESH) != 0; }
+
+private:
+    static const uint8_t INDEX_MASK = 3;
+    static const uint8_t FRESH = 4;             // middle slot published, not taken yet
+
+    T m_slots[3]{};
+    alignas(64) std::atomic<uint8_t> m_middle{ 1 };
+    alignas(64) uint8_t m_back = 2;             // producer only
+    alignas(64) uint8_t m_front = 0;            // consumer only
+};
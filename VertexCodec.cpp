@@ -0,0 +1,267 @@
+#include "VertexCodec.h"
+
+#include <bit>
+#include <cstring>
+
+namespace {
+
+    const size_t MAX_VARINT_BYTES = 5;      // 32 bit values
+
+    // Deltas are taken modulo 2^32, so any pair of int32 coordinates fits
+    // 32 bits and decoding wraps back to the exact value
+    inline uint32_t ZigZag(int32_t v)
+    {
+        return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    }
+
+    inline int32_t UnZigZag(uint32_t v)
+    {
+        return (int32_t)((v >> 1) ^ (0u - (v & 1)));
+    }
+
+    inline uint8_t* WriteVarint(uint8_t* p, uint32_t v)
+    {
+        while (v >= 0x80)
+        {
+            *p++ = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = (uint8_t)v;
+        return p;
+    }
+
+    inline size_t VarintSize(uint32_t v)
+    {
+        return (size_t)(std::bit_width(v | 1) + 6) / 7;
+    }
+
+    // Zig-zag deltas of one coordinate stream
+    inline uint8_t* WriteDeltas(uint8_t* p, const int32_t* values, uint32_t count)
+    {
+        uint32_t prev = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            p = WriteVarint(p, ZigZag((int32_t)((uint32_t)values[i] - prev)));
+            prev = (uint32_t)values[i];
+        }
+        return p;
+    }
+
+    // Caller guarantees 8 readable bytes at p. Returns nullptr on a varint
+    // longer than 32 bits. On little endian machines the varint is taken
+    // from one 8 byte load without a branch on its length: a byte-by-byte
+    // loop mispredicts on nearly every vertex when lengths vary.
+    inline const uint8_t* ReadVarintUnchecked(const uint8_t* p, uint32_t& v)
+    {
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+
+            // the lowest byte without the continuation bit ends the varint
+            const uint64_t stops = ~word & 0x0000008080808080ull;
+            if (stops == 0)
+                return nullptr;
+            const int bits = std::countr_zero(stops) + 1;       // 8, 16, .. 40
+            word &= ~0ull >> (64 - bits);
+            if (bits == 40 && (word >> 32) >= 0x10)
+                return nullptr;
+
+            v = (uint32_t)((word & 0x7F) | ((word >> 1) & (0x7Full << 7)) | ((word >> 2) & (0x7Full << 14)) |
+                ((word >> 3) & (0x7Full << 21)) | ((word >> 4) & (0xFull << 28)));
+            return p + bits / 8;
+        }
+        else
+        {
+            uint32_t result = 0;
+            for (size_t i = 0; i < MAX_VARINT_BYTES; ++i)
+            {
+                const uint32_t b = *p++;
+                result |= (b & 0x7F) << (7 * i);
+                if (b < 0x80)
+                {
+                    if (i == MAX_VARINT_BYTES - 1 && b >= 0x10)
+                        return nullptr;
+                    v = result;
+                    return p;
+                }
+            }
+            return nullptr;
+        }
+    }
+
+    // Bounds checked version for the last bytes of a buffer
+    inline const uint8_t* ReadVarint(const uint8_t* p, const uint8_t* end, uint32_t& v)
+    {
+        uint32_t result = 0;
+        for (size_t i = 0; i < MAX_VARINT_BYTES && p < end; ++i)
+        {
+            const uint32_t b = *p++;
+            result |= (b & 0x7F) << (7 * i);
+            if (b < 0x80)
+            {
+                if (i == MAX_VARINT_BYTES - 1 && b >= 0x10)
+                    return nullptr;
+                v = result;
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+} // namespace
+
+void EncodeVertices(const int32_t* xs, const int32_t* ys, uint32_t count, std::vector<uint8_t>& out)
+{
+    const size_t start = out.size();
+    out.resize(start + MaxEncodedVertexBytes(count));
+
+    // x stream length first, so the decoder can start on both streams at once
+    size_t xBytes = 0;
+    uint32_t prev = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        xBytes += VarintSize(ZigZag((int32_t)((uint32_t)xs[i] - prev)));
+        prev = (uint32_t)xs[i];
+    }
+
+    uint8_t* p = WriteVarint(out.data() + start, (uint32_t)xBytes);
+    p = WriteDeltas(p, xs, count);
+    p = WriteDeltas(p, ys, count);
+    out.resize((size_t)(p - out.data()));
+}
+
+size_t DecodeVertices(const uint8_t* data, size_t size, uint32_t count, int32_t* xs, int32_t* ys)
+{
+    const uint8_t* end = data + size;
+    uint32_t xBytes;
+    const uint8_t* px = ReadVarint(data, end, xBytes);
+    if (!px || xBytes > (size_t)(end - px))
+        return 0;
+    const uint8_t* const yStart = px + xBytes;
+    const uint8_t* py = yStart;
+
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t i = 0;
+
+    // Two independent chains (each varint's position depends on the length
+    // of the one before it), overlapped by the CPU. Runs while both streams
+    // have a worst case varint plus the 8 byte load left: no bounds check
+    // per byte.
+    for (; i < count && (size_t)(end - py) >= MAX_VARINT_BYTES + 8; ++i)
+    {
+        uint32_t dx, dy;
+        px = ReadVarintUnchecked(px, dx);
+        py = ReadVarintUnchecked(py, dy);
+        if (!px || !py)
+            return 0;
+
+        x += (uint32_t)UnZigZag(dx);
+        y += (uint32_t)UnZigZag(dy);
+        xs[i] = (int32_t)x;
+        ys[i] = (int32_t)y;
+    }
+
+    for (; i < count; ++i)
+    {
+        uint32_t dx, dy;
+        px = ReadVarint(px, end, dx);
+        py = px ? ReadVarint(py, end, dy) : nullptr;
+        if (!py)
+            return 0;
+
+        x += (uint32_t)UnZigZag(dx);
+        y += (uint32_t)UnZigZag(dy);
+        xs[i] = (int32_t)x;
+        ys[i] = (int32_t)y;
+    }
+
+    if (px != yStart)
+        return 0;   // x stream length does not match its varints
+    return (size_t)(py - data);
+}
+
+// -------------------- Packed shapes --------------------
+void PackedShapes::Pack(const SceneStore& scene)
+{
+    Clear();
+
+    const size_t shapes = scene.ShapeCount();
+    m_kinds.assign(scene.Kinds(), scene.Kinds() + shapes);
+    m_counts.assign(scene.Counts(), scene.Counts() + shapes);
+    m_blockOffsets.reserve((shapes + SHAPES_PER_BLOCK - 1) / SHAPES_PER_BLOCK);
+    m_vertexCount = scene.VertexCount();
+
+    for (uint32_t id = 0; id < (uint32_t)shapes; ++id)
+    {
+        if (id % SHAPES_PER_BLOCK == 0)
+            m_blockOffsets.push_back(m_bytes.size());
+        const uint32_t offset = scene.Offset(id);
+        EncodeVertices(scene.Xs() + offset, scene.Ys() + offset, scene.Count(id), m_bytes);
+    }
+    m_bytes.shrink_to_fit();
+}
+
+void PackedShapes::Unpack(SceneStore& scene) const
+{
+    const size_t shapes = m_kinds.size();
+    std::vector<uint32_t> offsets(shapes);
+    std::vector<int32_t> xs(m_vertexCount);
+    std::vector<int32_t> ys(m_vertexCount);
+
+    // the shapes' byte ranges are back to back, one pass decodes the lot
+    size_t vertex = 0;
+    size_t byte = 0;
+    for (uint32_t id = 0; id < (uint32_t)shapes; ++id)
+    {
+        offsets[id] = (uint32_t)vertex;
+        byte += DecodeVertices(m_bytes.data() + byte, m_bytes.size() - byte, m_counts[id], xs.data() + vertex, ys.data() + vertex);
+        vertex += m_counts[id];
+    }
+
+    scene.Assign(std::vector<ShapeKind>(m_kinds), std::move(offsets), std::vector<uint32_t>(m_counts), std::move(xs), std::move(ys));
+}
+
+bool PackedShapes::DecodeShape(uint32_t id, int32_t* xs, int32_t* ys) const
+{
+    if (id >= m_kinds.size())
+        return false;
+
+    // Skip the shapes before id in its block: past the x stream by its
+    // length, then along the y stream, where every varint ends on the one
+    // byte below 0x80
+    const uint8_t* p = m_bytes.data() + m_blockOffsets[id / SHAPES_PER_BLOCK];
+    const uint8_t* end = m_bytes.data() + m_bytes.size();
+    for (uint32_t skip = id - id % SHAPES_PER_BLOCK; skip < id; ++skip)
+    {
+        uint32_t xBytes;
+        p = ReadVarint(p, end, xBytes);
+        if (!p || xBytes > (size_t)(end - p))
+            return false;
+        p += xBytes;
+
+        size_t varints = m_counts[skip];
+        while (varints > 0 && p < end)
+            varints -= *p++ < 0x80;
+        if (varints > 0)
+            return false;
+    }
+
+    return DecodeVertices(p, (size_t)(end - p), m_counts[id], xs, ys) > 0 || m_counts[id] == 0;
+}
+
+void PackedShapes::Clear()
+{
+    m_bytes.clear();
+    m_blockOffsets.clear();
+    m_counts.clear();
+    m_kinds.clear();
+    m_vertexCount = 0;
+}
+
+size_t PackedShapes::MemoryBytes() const
+{
+    return m_bytes.capacity() + m_blockOffsets.capacity() * sizeof(uint64_t) +
+        m_counts.capacity() * sizeof(uint32_t) + m_kinds.capacity() * sizeof(ShapeKind);
+}
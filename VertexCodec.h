@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SceneStore.h"
+
+// -------------------- Compressed vertex storage --------------------
+// Each shape is encoded on its own: every coordinate as the zig-zag delta
+// from the same coordinate of the previous vertex (the first one from 0),
+// written as a little endian base 128 varint. All x deltas come first, then
+// all y deltas, after the byte length of the x part (one varint), so both
+// streams decode side by side. Hand drawn and traced shapes move a few units
+// per vertex, so most vertices take 2 to 4 bytes instead of the 8 of the raw
+// int32 pair.
+
+// Upper bound of the encoded size of count vertices
+inline size_t MaxEncodedVertexBytes(size_t count) { return 5 + count * 10; }
+
+// Appends the encoding of count vertices to out
+void EncodeVertices(const int32_t* xs, const int32_t* ys, uint32_t count, std::vector<uint8_t>& out);
+
+// Decodes count vertices from data[0..size) into xs / ys. Returns the number
+// of bytes read, 0 when the data is truncated or malformed.
+size_t DecodeVertices(const uint8_t* data, size_t size, uint32_t count, int32_t* xs, int32_t* ys);
+
+// The shapes of a SceneStore in encoded form, for geometry that is kept but
+// not drawn or edited (shapes held by the undo history). Kinds and counts
+// stay plain so shapes can be looked at without decoding; one shape or the
+// whole store decodes on demand. Shapes of the live scene are never packed:
+// painting, picking, snapping and the render thread read its vertex arrays
+// directly.
+class PackedShapes
+{
+public:
+    // Shapes are encoded back to back; the byte offset is kept for every
+    // SHAPES_PER_BLOCK-th one and DecodeShape skips forward from it
+    static const uint32_t SHAPES_PER_BLOCK = 32;
+
+    void Pack(const SceneStore& scene);
+    void Unpack(SceneStore& scene) const;     // replaces scene
+
+    // Vertices of one shape into the caller's buffers (Count(id) entries each)
+    bool DecodeShape(uint32_t id, int32_t* xs, int32_t* ys) const;
+
+    void Clear();
+
+    size_t ShapeCount() const { return m_kinds.size(); }
+    size_t VertexCount() const { return m_vertexCount; }
+    ShapeKind Kind(uint32_t id) const { return m_kinds[id]; }
+    uint32_t Count(uint32_t id) const { return m_counts[id]; }
+
+    size_t EncodedBytes() const { return m_bytes.size(); }
+    size_t MemoryBytes() const;     // capacity, like SceneStore::MemoryBytes
+
+private:
+    std::vector<uint8_t> m_bytes;
+    std::vector<uint64_t> m_blockOffsets;   // shape k * SHAPES_PER_BLOCK starts at m_bytes[m_blockOffsets[k]]
+    std::vector<uint32_t> m_counts;
+    std::vector<ShapeKind> m_kinds;
+    size_t m_vertexCount = 0;
+};
@@ -0,0 +1,295 @@
+#include "ViewportClip.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+    const double PI = 3.14159265358979323846;
+    const int MIN_ELLIPSE_SEGMENTS = 8;
+    const int MAX_ELLIPSE_SEGMENTS = 4096;
+    const double ELLIPSE_TOLERANCE_PIXELS = 0.5;    // largest gap between a chord and the curve
+
+    enum ClipEdge { EDGE_LEFT, EDGE_TOP, EDGE_RIGHT, EDGE_BOTTOM };
+
+    template <ClipEdge edge>
+    bool Inside(const ClipRect& r, ClipPoint p)
+    {
+        if constexpr (edge == EDGE_LEFT)
+            return p.x >= r.minX;
+        else if constexpr (edge == EDGE_TOP)
+            return p.y >= r.minY;
+        else if constexpr (edge == EDGE_RIGHT)
+            return p.x <= r.maxX;
+        else
+            return p.y <= r.maxY;
+    }
+
+    // Crossing of a-b (one end on each side) with the edge line; the clipped
+    // coordinate is set exactly so rounding cannot push it back out
+    template <ClipEdge edge>
+    ClipPoint Intersect(const ClipRect& r, ClipPoint a, ClipPoint b)
+    {
+        if constexpr (edge == EDGE_LEFT || edge == EDGE_RIGHT)
+        {
+            const double x = edge == EDGE_LEFT ? r.minX : r.maxX;
+            const double t = (x - a.x) / (b.x - a.x);
+            return ClipPoint{ x, a.y + t * (b.y - a.y) };
+        }
+        else
+        {
+            const double y = edge == EDGE_TOP ? r.minY : r.maxY;
+            const double t = (y - a.y) / (b.y - a.y);
+            return ClipPoint{ a.x + t * (b.x - a.x), y };
+        }
+    }
+
+    // One Sutherland-Hodgman stage: in against a single edge, into out.
+    // Branch free, every vertex writes both candidates and keeps the ones it
+    // needs (the crossing is computed even when unused).
+    template <ClipEdge edge>
+    void ClipAgainstEdge(const ClipRect& r, const ClipPoint* in, size_t count, std::vector<ClipPoint>& out)
+    {
+        out.resize(2 * count);
+        ClipPoint* o = out.data();
+        size_t n = 0;
+
+        ClipPoint prev = in[count - 1];
+        bool prevInside = Inside<edge>(r, prev);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const ClipPoint cur = in[i];
+            const bool curInside = Inside<edge>(r, cur);
+
+            o[n] = Intersect<edge>(r, prev, cur);
+            n += curInside != prevInside;
+            o[n] = cur;
+            n += curInside;
+
+            prev = cur;
+            prevInside = curInside;
+        }
+        out.resize(n);
+    }
+
+    bool SamePoint(ClipPoint a, ClipPoint b)
+    {
+        return a.x == b.x && a.y == b.y;
+    }
+
+} // namespace
+
+ClipRect ExpandedClipRect(const ScreenRect& viewport, double margin)
+{
+    return ClipRect{
+        viewport.left - margin, viewport.top - margin,
+        viewport.right - 1 + margin, viewport.bottom - 1 + margin };
+}
+
+ScreenPoint RoundClipPoint(ClipPoint p)
+{
+    return ScreenPoint{ (int32_t)std::lround(p.x), (int32_t)std::lround(p.y) };
+}
+
+ClipSide ClassifyBox(const ClipRect& r, const Camera& cam, const WorldRect& box)
+{
+    const ClipPoint lo = ToClipPoint(cam, box.minX, box.minY);
+    const ClipPoint hi = ToClipPoint(cam, box.maxX, box.maxY);
+
+    if (hi.x < r.minX || lo.x > r.maxX || hi.y < r.minY || lo.y > r.maxY)
+        return CLIP_OUTSIDE;
+    if (lo.x >= r.minX && hi.x <= r.maxX && lo.y >= r.minY && hi.y <= r.maxY)
+        return CLIP_INSIDE;
+    return CLIP_PARTIAL;
+}
+
+size_t ClipPolygon(const ClipRect& r, const ClipPoint* in, size_t count, std::vector<ClipPoint>& out, std::vector<ClipPoint>& scratch)
+{
+    out.clear();
+    if (count == 0)
+        return 0;
+
+    // Compaction pass into out: a chain of vertices all outside the same edge
+    // is replaced by its two ends. The shortcut stays on that outer side, so
+    // nothing changes inside the rectangle, and a shape reaching far past it
+    // leaves only a few vertices for the stages. The outcodes also give the
+    // edges the polygon crosses; only those stages run.
+    out.resize(count);
+    ClipPoint* kept = out.data();
+    size_t keptCount = 0;
+    unsigned crossed = 0;
+    unsigned all = 0xF;
+    unsigned runCodes = 0;      // common bits of the run ending at the last kept vertex
+    bool runInterior = false;   // that run has two or more vertices
+    for (size_t i = 0; i < count; ++i)
+    {
+        const ClipPoint p = in[i];
+        const unsigned code =
+            (unsigned)(p.x < r.minX) | (unsigned)(p.y < r.minY) << 1 |
+            (unsigned)(p.x > r.maxX) << 2 | (unsigned)(p.y > r.maxY) << 3;
+        crossed |= code;
+        all &= code;
+
+        // branch free: shapes far past the rectangle switch sides at random
+        const bool join = (runCodes & code) != 0;
+        keptCount -= (size_t)(join && runInterior);     // the previous end becomes interior
+        kept[keptCount++] = p;
+        runCodes = join ? runCodes & code : code;
+        runInterior = join;
+    }
+    out.resize(keptCount);
+
+    if (all)
+    {
+        out.clear();    // every vertex beyond one edge
+        return 0;
+    }
+    if (!crossed)
+        return out.size();
+
+    // Each stage reads the previous output and writes the other buffer
+    const ClipPoint* src = out.data();
+    size_t srcCount = out.size();
+    std::vector<ClipPoint>* dst = &scratch;
+    auto stage = [&](auto clipEdge)
+        {
+            if (srcCount == 0)
+                return;
+            clipEdge(r, src, srcCount, *dst);
+            src = dst->data();
+            srcCount = dst->size();
+            dst = dst == &scratch ? &out : &scratch;
+        };
+
+    if (crossed & 1)
+        stage(ClipAgainstEdge<EDGE_LEFT>);
+    if (crossed & 2)
+        stage(ClipAgainstEdge<EDGE_TOP>);
+    if (crossed & 4)
+        stage(ClipAgainstEdge<EDGE_RIGHT>);
+    if (crossed & 8)
+        stage(ClipAgainstEdge<EDGE_BOTTOM>);
+
+    if (srcCount == 0)
+        out.clear();
+    else if (src != out.data())
+        out.swap(scratch);
+    return out.size();
+}
+
+bool ClipSegment(const ClipRect& r, ClipPoint& a, ClipPoint& b)
+{
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double p[4] = { -dx, dx, -dy, dy };
+    const double q[4] = { a.x - r.minX, r.maxX - a.x, a.y - r.minY, r.maxY - a.y };
+
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (p[i] == 0.0)
+        {
+            if (q[i] < 0.0)
+                return false;   // parallel to this edge and outside it
+            continue;
+        }
+
+        const double t = q[i] / p[i];
+        if (p[i] < 0.0)
+        {
+            if (t > t1)
+                return false;
+            if (t > t0)
+                t0 = t;
+        }
+        else
+        {
+            if (t < t0)
+                return false;
+            if (t < t1)
+                t1 = t;
+        }
+    }
+
+    // Ends that moved are pinned into the rectangle: the division can leave
+    // them a hair outside
+    const ClipPoint start = a;
+    if (t1 < 1.0)
+    {
+        b.x = std::clamp(start.x + t1 * dx, r.minX, r.maxX);
+        b.y = std::clamp(start.y + t1 * dy, r.minY, r.maxY);
+    }
+    if (t0 > 0.0)
+    {
+        a.x = std::clamp(start.x + t0 * dx, r.minX, r.maxX);
+        a.y = std::clamp(start.y + t0 * dy, r.minY, r.maxY);
+    }
+    return true;
+}
+
+void ClipPolyline(const ClipRect& r, const ClipPoint* in, size_t count, std::vector<ClipPoint>& out, std::vector<uint32_t>& runCounts)
+{
+    size_t runStart = out.size();
+    bool open = false;      // the last point written is the unclipped end of the previous segment
+
+    auto closeRun = [&]()
+        {
+            if (out.size() - runStart >= 2)
+                runCounts.push_back((uint32_t)(out.size() - runStart));
+            else
+                out.resize(runStart);
+            runStart = out.size();
+            open = false;
+        };
+
+    for (size_t i = 0; i + 1 < count; ++i)
+    {
+        ClipPoint a = in[i];
+        ClipPoint b = in[i + 1];
+        if (!ClipSegment(r, a, b))
+        {
+            closeRun();
+            continue;
+        }
+
+        if (!open || !SamePoint(a, in[i]))
+        {
+            closeRun();
+            out.push_back(a);
+        }
+        out.push_back(b);
+
+        open = SamePoint(b, in[i + 1]);
+        if (!open)
+            closeRun();
+    }
+    closeRun();
+}
+
+void FlattenEllipse(ClipPoint a, ClipPoint b, std::vector<ClipPoint>& out)
+{
+    const double cx = (a.x + b.x) * 0.5;
+    const double cy = (a.y + b.y) * 0.5;
+    const double rx = std::fabs(b.x - a.x) * 0.5;
+    const double ry = std::fabs(b.y - a.y) * 0.5;
+    const double radius = std::max(rx, ry);
+
+    // a chord spanning angle s sits radius * (1 - cos(s / 2)) inside the curve
+    int segments = MAX_ELLIPSE_SEGMENTS;
+    if (radius <= ELLIPSE_TOLERANCE_PIXELS)
+        segments = MIN_ELLIPSE_SEGMENTS;
+    else
+    {
+        const double step = 2.0 * std::acos(1.0 - ELLIPSE_TOLERANCE_PIXELS / radius);
+        if (step > 2.0 * PI / MAX_ELLIPSE_SEGMENTS)
+            segments = std::clamp((int)std::ceil(2.0 * PI / step), MIN_ELLIPSE_SEGMENTS, MAX_ELLIPSE_SEGMENTS);
+    }
+
+    out.resize(segments);
+    for (int i = 0; i < segments; ++i)
+    {
+        const double angle = 2.0 * PI * i / segments;
+        out[i] = ClipPoint{ cx + rx * std::cos(angle), cy + ry * std::sin(angle) };
+    }
+}
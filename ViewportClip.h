@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Geometry.h"
+
+// -------------------- Viewport clipping --------------------
+// Geometry is clipped in screen space before it is submitted, so only what
+// can show in the window reaches the renderer and no coordinate handed to it
+// has to hold world * zoom. Points are transformed in double precision
+// (same truncation as TransformToScreen, without the int conversion), clipped,
+// and rounded only once they are known to lie in the clip rectangle.
+
+// Screen point before the final rounding
+struct ClipPoint {
+    double x;
+    double y;
+};
+
+// Screen space clip rectangle, bounds inclusive
+struct ClipRect {
+    double minX;
+    double minY;
+    double maxX;
+    double maxY;
+};
+
+// Pixels the clip rectangle extends past the viewport. Clipped polygons get
+// edges along the clip rectangle; the margin keeps them (and the caps of
+// clipped polylines) out of sight for any pen up to twice this wide.
+const double CLIP_MARGIN_PIXELS = 16.0;
+
+// viewport (right/bottom exclusive) grown by margin on every side
+ClipRect ExpandedClipRect(const ScreenRect& viewport, double margin = CLIP_MARGIN_PIXELS);
+
+inline ClipPoint ToClipPoint(const Camera& cam, int32_t x, int32_t y)
+{
+    // Truncation through int64_t: the int cast of TransformToScreen wherever
+    // that one is defined, and exact for any int32 coordinate at any zoom the
+    // editor allows (cheaper than std::trunc without SSE4.1)
+    return ClipPoint{
+        (double)(int64_t)(x * cam.zoom) + cam.panX,
+        (double)(int64_t)(y * cam.zoom) + cam.panY };
+}
+
+// Only for points inside a clip rectangle built by ExpandedClipRect
+ScreenPoint RoundClipPoint(ClipPoint p);
+
+enum ClipSide
+{
+    CLIP_INSIDE = 0,    // entirely in the rectangle
+    CLIP_OUTSIDE,       // entirely out of it
+    CLIP_PARTIAL
+};
+
+// Where the screen box of a world box falls (zoom must be > 0)
+ClipSide ClassifyBox(const ClipRect& r, const Camera& cam, const WorldRect& box);
+
+// Sutherland-Hodgman: the part of the closed polygon in[0..count) inside r,
+// written to out (replaced). scratch holds the intermediate stages; both keep
+// their storage between calls. Returns the output vertex count, 0 when
+// nothing is left.
+size_t ClipPolygon(const ClipRect& r, const ClipPoint* in, size_t count, std::vector<ClipPoint>& out, std::vector<ClipPoint>& scratch);
+
+// Liang-Barsky: trims the segment a-b to r. Returns false when no part of it
+// is inside.
+bool ClipSegment(const ClipRect& r, ClipPoint& a, ClipPoint& b);
+
+// The visible runs of the open polyline in[0..count), appended to out with
+// one entry per run in runCounts. Every run has at least 2 points.
+void ClipPolyline(const ClipRect& r, const ClipPoint* in, size_t count, std::vector<ClipPoint>& out, std::vector<uint32_t>& runCounts);
+
+// Closed polygon approximating the ellipse inscribed in the box a-b, with
+// vertices at most about half a pixel off the curve (segment count capped).
+// Written to out (replaced).
+void FlattenEllipse(ClipPoint a, ClipPoint b, std::vector<ClipPoint>& out);
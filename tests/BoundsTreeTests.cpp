@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <vector>
+
+#include "BoundsTree.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+
+namespace {
+
+    struct Box {
+        uint32_t id;
+        WorldRect rect;
+    };
+
+    WorldRect RandomBox(SceneRandom& rng, int32_t world, int32_t maxSize)
+    {
+        const int32_t x = rng.Range(-world, world);
+        const int32_t y = rng.Range(-world, world);
+        return WorldRect{ x, y, x + rng.Range(0, maxSize), y + rng.Range(0, maxSize) };
+    }
+
+    // Sorted ids from the tree and from testing every box
+    bool QueryMatchesBruteForce(BoundsTree& tree, const std::vector<Box>& boxes, const WorldRect& query)
+    {
+        std::vector<uint32_t> got;
+        tree.Query(query, [&](uint32_t id) { got.push_back(id); });
+
+        std::vector<uint32_t> expected;
+        for (const Box& b : boxes)
+        {
+            if (RectsIntersect(b.rect, query))
+                expected.push_back(b.id);
+        }
+
+        std::sort(got.begin(), got.end());
+        std::sort(expected.begin(), expected.end());
+        return got == expected;
+    }
+
+} // namespace
+
+TEST(bounds_tree, query_matches_brute_force)
+{
+    SceneRandom rng(21);
+    BoundsTree tree;
+    std::vector<Box> boxes;
+
+    // queries between inserts see the tree, the pending list and both
+    for (uint32_t id = 0; id < 5000; ++id)
+    {
+        const Box b{ id * 3 + 1, RandomBox(rng, 10000, id % 50 == 0 ? 4000 : 200) };
+        boxes.push_back(b);
+        tree.Insert(b.id, b.rect);
+
+        if (id % 97 == 0)
+            CHECK(QueryMatchesBruteForce(tree, boxes, RandomBox(rng, 10000, 3000)));
+    }
+    CHECK_EQ(tree.Size(), boxes.size());
+
+    for (int q = 0; q < 300; ++q)
+        CHECK(QueryMatchesBruteForce(tree, boxes, RandomBox(rng, 11000, q % 10 == 0 ? 20000 : 500)));
+
+    // touching edges count: bounds are inclusive
+    const WorldRect& first = boxes[0].rect;
+    CHECK(QueryMatchesBruteForce(tree, boxes, WorldRect{ first.maxX, first.maxY, first.maxX + 5, first.maxY + 5 }));
+    CHECK(QueryMatchesBruteForce(tree, boxes, WorldRect{ INT32_MIN, INT32_MIN, INT32_MAX, INT32_MAX }));
+}
+
+TEST(bounds_tree, remove_and_clear)
+{
+    SceneRandom rng(22);
+    BoundsTree tree;
+    std::vector<Box> boxes;
+    for (uint32_t id = 0; id < 600; ++id)
+    {
+        boxes.push_back(Box{ id, RandomBox(rng, 2000, 300) });
+        tree.Insert(id, boxes.back().rect);
+    }
+
+    for (int i = 0; i < 200; ++i)
+    {
+        const size_t k = (size_t)rng.Range(0, (int32_t)boxes.size() - 1);
+        CHECK(tree.Remove(boxes[k].id));
+        boxes.erase(boxes.begin() + k);
+
+        if (i % 10 == 0)
+            CHECK(QueryMatchesBruteForce(tree, boxes, RandomBox(rng, 2000, 800)));
+    }
+    CHECK(!tree.Remove(100000));
+    CHECK_EQ(tree.Size(), boxes.size());
+
+    tree.Clear();
+    size_t visited = 0;
+    tree.Query(WorldRect{ INT32_MIN, INT32_MIN, INT32_MAX, INT32_MAX }, [&](uint32_t) { ++visited; });
+    CHECK_EQ(visited, 0);
+}
+
+TEST(bounds_tree, identical_boxes)
+{
+    // every centroid equal: the median split must still terminate and find all
+    BoundsTree tree;
+    std::vector<Box> boxes;
+    for (uint32_t id = 0; id < 1000; ++id)
+    {
+        boxes.push_back(Box{ id, WorldRect{ 5, 5, 10, 10 } });
+        tree.Insert(id, boxes.back().rect);
+    }
+    CHECK(QueryMatchesBruteForce(tree, boxes, WorldRect{ 0, 0, 6, 6 }));
+    CHECK(QueryMatchesBruteForce(tree, boxes, WorldRect{ 11, 11, 20, 20 }));
+}
+
+TEST(bounds_tree, remap_renumbers_and_drops)
+{
+    SceneRandom rng(23);
+    BoundsTree tree;
+    std::vector<Box> boxes;
+    for (uint32_t id = 0; id < 3000; ++id)
+    {
+        boxes.push_back(Box{ id, RandomBox(rng, 5000, 300) });
+        tree.Insert(id, boxes.back().rect);
+    }
+    CHECK(QueryMatchesBruteForce(tree, boxes, RandomBox(rng, 5000, 2000)));
+
+    // drop every id divisible by 5 or 7 and shift the rest down, a few rounds
+    // so dropped items pile up past the rebuild threshold
+    auto shifted = [](uint32_t id)
+        {
+            // kept ids below id
+            return id % 5 == 0 || id % 7 == 0 ? BoundsTree::NO_ID : id - id / 5 - id / 7 + id / 35 - 1;
+        };
+    for (int round = 0; round < 4; ++round)
+    {
+        std::vector<Box> kept;
+        tree.Remap(shifted);
+        for (const Box& b : boxes)
+        {
+            if (shifted(b.id) != BoundsTree::NO_ID)
+                kept.push_back(Box{ shifted(b.id), b.rect });
+        }
+        boxes = kept;
+        CHECK_EQ(tree.Size(), boxes.size());
+
+        for (int q = 0; q < 50; ++q)
+            CHECK(QueryMatchesBruteForce(tree, boxes, RandomBox(rng, 5500, q % 10 == 0 ? 10000 : 800)));
+
+        // inserts after a remap land in the pending list next to the dead items
+        const Box added{ (uint32_t)boxes.size(), RandomBox(rng, 5000, 300) };
+        boxes.push_back(added);
+        tree.Insert(added.id, added.rect);
+        CHECK(QueryMatchesBruteForce(tree, boxes, WorldRect{ INT32_MIN, INT32_MIN, INT32_MAX, INT32_MAX }));
+    }
+}
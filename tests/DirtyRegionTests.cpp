@@ -0,0 +1,122 @@
+#include <vector>
+
+#include "DirtyRegion.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+
+namespace {
+
+    const int32_t CANVAS = 200;
+
+    bool Contains(const ScreenRect& r, int32_t x, int32_t y)
+    {
+        return x >= r.left && x < r.right && y >= r.top && y < r.bottom;
+    }
+
+    bool RegionContains(const DirtyRegion& region, int32_t x, int32_t y)
+    {
+        for (const ScreenRect& r : region.Rects())
+        {
+            if (Contains(r, x, y))
+                return true;
+        }
+        return false;
+    }
+
+} // namespace
+
+TEST(dirty_region, merges_keep_every_added_pixel)
+{
+    SceneRandom rng(41);
+    for (int round = 0; round < 50; ++round)
+    {
+        DirtyRegion region;
+        std::vector<ScreenRect> added;
+        ScreenRect addedBounds{ 0, 0, 0, 0 };
+
+        const int adds = rng.Range(1, 24);
+        for (int i = 0; i < adds; ++i)
+        {
+            const int32_t x = rng.Range(0, CANVAS - 1), y = rng.Range(0, CANVAS - 1);
+            const ScreenRect r{ x, y, x + rng.Range(0, 40), y + rng.Range(0, 40) };  // some empty
+            region.Add(r);
+            if (!RectIsEmpty(r))
+            {
+                added.push_back(r);
+                addedBounds = RectUnion(addedBounds, r);
+            }
+
+            CHECK(region.Rects().size() <= DirtyRegion::MAX_RECTS);
+            CHECK(region.IsEmpty() == added.empty());
+        }
+
+        // no empty rects kept, nothing grows past the union of the input
+        for (const ScreenRect& r : region.Rects())
+        {
+            CHECK(!RectIsEmpty(r));
+            CHECK(r.left >= addedBounds.left && r.top >= addedBounds.top &&
+                r.right <= addedBounds.right && r.bottom <= addedBounds.bottom);
+        }
+        const ScreenRect bounds = region.Bounds();
+        CHECK(added.empty() || (bounds.left == addedBounds.left && bounds.top == addedBounds.top &&
+            bounds.right == addedBounds.right && bounds.bottom == addedBounds.bottom));
+
+        // every dirty pixel is repainted
+        bool covered = true;
+        for (const ScreenRect& r : added)
+        {
+            for (int32_t y = r.top; y < r.bottom; ++y)
+                for (int32_t x = r.left; x < r.right; ++x)
+                    covered = covered && RegionContains(region, x, y);
+        }
+        CHECK(covered);
+    }
+}
+
+TEST(dirty_region, contained_rects_are_swallowed)
+{
+    DirtyRegion region;
+    region.Add(ScreenRect{ 10, 10, 50, 50 });
+    region.Add(ScreenRect{ 20, 20, 30, 30 });      // inside the first
+    CHECK_EQ(region.Rects().size(), 1);
+
+    region.Add(ScreenRect{ 100, 100, 110, 110 });
+    region.Add(ScreenRect{ 0, 0, 60, 60 });        // covers the first
+    CHECK_EQ(region.Rects().size(), 2);
+    CHECK(RegionContains(region, 105, 105));
+    CHECK(RegionContains(region, 0, 0));
+}
+
+TEST(dirty_region, merges_the_cheapest_pair)
+{
+    DirtyRegion region;
+    // two neighbours and three far apart: the neighbours merge
+    region.Add(ScreenRect{ 0, 0, 10, 10 });
+    region.Add(ScreenRect{ 10, 0, 20, 10 });
+    region.Add(ScreenRect{ 500, 0, 510, 10 });
+    region.Add(ScreenRect{ 0, 500, 10, 510 });
+    region.Add(ScreenRect{ 500, 500, 510, 510 });
+    REQUIRE(region.Rects().size() == DirtyRegion::MAX_RECTS);
+
+    int64_t area = 0;
+    for (const ScreenRect& r : region.Rects())
+        area += RectArea(r);
+    CHECK_EQ(area, 5 * 100);    // no waste: the merged pair was adjacent
+}
+
+TEST(dirty_region, all_overrides_rects)
+{
+    DirtyRegion region;
+    region.Add(ScreenRect{ 1, 1, 5, 5 });
+    region.AddAll();
+    CHECK(region.IsAll());
+    CHECK(region.Rects().empty());
+
+    region.Add(ScreenRect{ 1, 1, 5, 5 });          // already covered by all
+    CHECK(region.Rects().empty());
+    CHECK(!region.IsEmpty());
+
+    region.Clear();
+    CHECK(region.IsEmpty());
+    CHECK(!region.IsAll());
+}
@@ -0,0 +1,438 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "DisplayList.h"
+#include "FrameArena.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+#include "TileRasterizer.h"
+#include "ViewportClip.h"
+
+namespace {
+
+    enum PrimitiveKind { PRIM_POLYLINE, PRIM_POLYGON, PRIM_ELLIPSE };
+
+    // One primitive as a backend sees it: ellipses by their two corners
+    struct Primitive {
+        PrimitiveKind kind;
+        size_t pen;                     // index into the test's pens
+        std::vector<ScreenPoint> pts;
+    };
+
+    struct Call {
+        PrimitiveKind kind;
+        size_t pen;
+        size_t primitives;
+        size_t vertices;
+    };
+
+    // Backend that keeps every call and every primitive it was handed
+    class LogBackend : public DrawBackend
+    {
+    public:
+        explicit LogBackend(const std::vector<PenStyle>& pens) : m_pens(pens) {}
+
+        void SetPen(const PenStyle& pen) override
+        {
+            ++penChanges;
+            for (size_t i = 0; i < m_pens.size(); ++i)
+            {
+                if (m_pens[i] == pen)
+                    m_pen = i;
+            }
+        }
+
+        void PolyPolyline(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount) override
+        {
+            Add(PRIM_POLYLINE, pts, counts, polyCount);
+        }
+
+        void PolyPolygon(const ScreenPoint* pts, const uint32_t* counts, size_t polyCount) override
+        {
+            Add(PRIM_POLYGON, pts, counts, polyCount);
+        }
+
+        void Ellipses(const ScreenPoint* corners, size_t ellipseCount) override
+        {
+            std::vector<uint32_t> counts(ellipseCount, 2);
+            Add(PRIM_ELLIPSE, corners, counts.data(), ellipseCount);
+        }
+
+        size_t penChanges = 0;
+        std::vector<Call> calls;
+        std::vector<Primitive> primitives;
+
+    private:
+        void Add(PrimitiveKind kind, const ScreenPoint* pts, const uint32_t* counts, size_t polyCount)
+        {
+            Call call{ kind, m_pen, polyCount, 0 };
+            for (size_t i = 0; i < polyCount; ++i)
+            {
+                primitives.push_back(Primitive{ kind, m_pen, std::vector<ScreenPoint>(pts, pts + counts[i]) });
+                pts += counts[i];
+                call.vertices += counts[i];
+            }
+            calls.push_back(call);
+        }
+
+        const std::vector<PenStyle>& m_pens;
+        size_t m_pen = 0;
+    };
+
+    ScreenPoint ToScreen(const Camera& cam, int32_t x, int32_t y)
+    {
+        return ScreenPoint{ (int32_t)(x * cam.zoom) + cam.panX, (int32_t)(y * cam.zoom) + cam.panY };
+    }
+
+    // Records the shape into list and appends what drawing it on its own
+    // (one GDI call per shape, world to screen per vertex) would hand over
+    void RecordShape(const SceneStore& scene, uint32_t id, size_t pen, const Camera& cam, DisplayList& list, std::vector<Primitive>& drawn)
+    {
+        const uint32_t count = scene.Count(id);
+        if (count < 2)
+            return;
+
+        const int32_t* xs = scene.Xs() + scene.Offset(id);
+        const int32_t* ys = scene.Ys() + scene.Offset(id);
+        const WorldPoint a{ xs[0], ys[0] };
+        const WorldPoint b{ xs[1], ys[1] };
+
+        Primitive p{ PRIM_POLYGON, pen, {} };
+        switch (scene.Kind(id))
+        {
+        case SHAPE_LINE:
+            list.AddLine(a, b);
+            p.kind = PRIM_POLYLINE;
+            p.pts = { ToScreen(cam, a.x, a.y), ToScreen(cam, b.x, b.y) };
+            break;
+        case SHAPE_RECT:
+            list.AddRect(a, b);
+            p.pts = { ToScreen(cam, a.x, a.y), ToScreen(cam, b.x, a.y), ToScreen(cam, b.x, b.y), ToScreen(cam, a.x, b.y) };
+            break;
+        case SHAPE_ELLIPSE:
+            list.AddEllipse(a, b);
+            p.kind = PRIM_ELLIPSE;
+            p.pts = { ToScreen(cam, a.x, a.y), ToScreen(cam, b.x, b.y) };
+            break;
+        case SHAPE_MULTILINE:
+        case SHAPE_POLIGON:
+            list.AddPolygon(xs, ys, count);
+            for (uint32_t i = 0; i < count; ++i)
+                p.pts.push_back(ToScreen(cam, xs[i], ys[i]));
+            break;
+        }
+        drawn.push_back(p);
+    }
+
+    bool SamePoints(const std::vector<ScreenPoint>& a, const std::vector<ScreenPoint>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (a[i].x != b[i].x || a[i].y != b[i].y)
+                return false;
+        }
+        return true;
+    }
+
+    // The primitives of one pen and kind, in the order they were handed over
+    std::vector<const Primitive*> Select(const std::vector<Primitive>& all, size_t pen, PrimitiveKind kind)
+    {
+        std::vector<const Primitive*> out;
+        for (const Primitive& p : all)
+        {
+            if (p.pen == pen && p.kind == kind)
+                out.push_back(&p);
+        }
+        return out;
+    }
+
+    // Per pen and kind, the replay hands over exactly the primitives drawn
+    // shape by shape, in recording order
+    bool SameAsDrawn(const std::vector<Primitive>& replayed, const std::vector<Primitive>& drawn, size_t pens)
+    {
+        if (replayed.size() != drawn.size())
+            return false;
+        for (size_t pen = 0; pen < pens; ++pen)
+        {
+            for (PrimitiveKind kind : { PRIM_POLYLINE, PRIM_POLYGON, PRIM_ELLIPSE })
+            {
+                const std::vector<const Primitive*> r = Select(replayed, pen, kind), d = Select(drawn, pen, kind);
+                if (r.size() != d.size())
+                    return false;
+                for (size_t i = 0; i < r.size(); ++i)
+                {
+                    if (!SamePoints(r[i]->pts, d[i]->pts))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Calls of one pen come in one run, and a call ends only where the next
+    // primitive of its stream would take it past MAX_BATCH_VERTICES (a lone
+    // oversized primitive aside)
+    bool BatchedByPenAndChunk(const LogBackend& log)
+    {
+        size_t prim = 0, runs = 0;
+        std::vector<size_t> pens;
+        for (size_t c = 0; c < log.calls.size(); ++c)
+        {
+            const Call& call = log.calls[c];
+            if (call.vertices > DisplayList::MAX_BATCH_VERTICES && call.primitives != 1)
+                return false;
+            if (c == 0 || log.calls[c - 1].pen != call.pen)
+                ++runs;
+            if (std::find(pens.begin(), pens.end(), call.pen) == pens.end())
+                pens.push_back(call.pen);
+
+            prim += call.primitives;
+            const bool sameStream = c + 1 < log.calls.size() && log.calls[c + 1].pen == call.pen && log.calls[c + 1].kind == call.kind;
+            if (sameStream && call.vertices + log.primitives[prim].pts.size() <= DisplayList::MAX_BATCH_VERTICES)
+                return false;
+        }
+        return runs == pens.size() && runs == log.penChanges && prim == log.primitives.size();
+    }
+
+    bool InClipRect(const ClipRect& r, ScreenPoint p)
+    {
+        return p.x >= r.minX && p.x <= r.maxX && p.y >= r.minY && p.y <= r.maxY;
+    }
+
+} // namespace
+
+TEST(display_list, replay_matches_per_shape_drawing)
+{
+    SceneSpec spec;
+    spec.targetVertices = 200000;
+    spec.seed = 131;
+    SceneStore scene;
+    GenerateScene(spec, scene);
+    const Camera cam = FitCameraToScene(scene, 1920, 1080, 0);
+
+    // shapes spread over three pens, switching often
+    const std::vector<PenStyle> pens = { { 0, 0, 0, 1 }, { 255, 0, 0, 2 }, { 0, 128, 0, 5 } };
+    SceneRandom rng(132);
+    DisplayList list;
+    std::vector<Primitive> drawn;
+    for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+    {
+        const size_t pen = (size_t)rng.Range(0, 2);
+        list.SetPen(pens[pen]);
+        RecordShape(scene, id, pen, cam, list, drawn);
+    }
+    CHECK_EQ(list.PrimitiveCount(), drawn.size());
+
+    FrameArena arena;
+    LogBackend log(pens);
+    list.Replay(cam, log, arena);
+    CHECK_EQ(log.penChanges, 3);
+    CHECK(SameAsDrawn(log.primitives, drawn, pens.size()));
+    CHECK(BatchedByPenAndChunk(log));
+    CHECK(log.calls.size() < 30);               // a handful of calls for thousands of shapes
+
+    // RecordingBackend sees the same calls, and the list's own scratch
+    // gives the same replay
+    RecordingBackend recording;
+    list.Replay(cam, recording);
+    CHECK_EQ(recording.penChanges, 3);
+    CHECK_EQ(recording.calls, log.calls.size());
+    CHECK_EQ(recording.primitives, drawn.size());
+    CHECK_EQ(recording.vertices, list.VertexCount());
+
+    // Clear keeps the pens' groups; a pen without primitives issues nothing
+    list.Clear();
+    list.SetPen(pens[2]);
+    const WorldPoint a{ 10, 10 }, b{ 50, 30 };
+    list.AddLine(a, b);
+    list.AddEllipse(a, b);
+    LogBackend again(pens);
+    list.Replay(cam, again, arena);
+    CHECK_EQ(again.penChanges, 1);
+    REQUIRE(again.calls.size() == 2);
+    CHECK(again.calls[0].kind == PRIM_POLYLINE && again.calls[0].pen == 2);
+    CHECK(again.calls[1].kind == PRIM_ELLIPSE && again.calls[1].pen == 2);
+}
+
+TEST(display_list, streams_split_at_max_batch_vertices)
+{
+    const uint32_t MAX = DisplayList::MAX_BATCH_VERTICES;
+    const std::vector<PenStyle> pens = { { 0, 0, 0, 1 } };
+    Camera cam;
+    cam.zoom = 0.5;
+    cam.panX = 7;
+    cam.panY = -3;
+
+    DisplayList list;
+    list.SetPen(pens[0]);
+
+    // MAX lines: exactly two full chunks
+    for (uint32_t i = 0; i < MAX; ++i)
+        list.AddLine(WorldPoint{ (int32_t)i, 0 }, WorldPoint{ (int32_t)i, 100 });
+
+    // MAX / 2 + 1 ellipses: a full chunk and one left over
+    for (uint32_t i = 0; i < MAX / 2 + 1; ++i)
+        list.AddEllipse(WorldPoint{ (int32_t)i, 0 }, WorldPoint{ (int32_t)i + 10, 10 });
+
+    // polygons of 1000 points never split, one of 20000 goes out alone,
+    // rectangles join the polygon batches
+    std::vector<int32_t> xs(20000), ys(20000);
+    for (uint32_t i = 0; i < 20000; ++i)
+    {
+        xs[i] = (int32_t)(i % 300);
+        ys[i] = (int32_t)(i / 300);
+    }
+    for (int i = 0; i < 20; ++i)
+        list.AddPolygon(xs.data(), ys.data(), 1000);
+    list.AddPolygon(xs.data(), ys.data(), 20000);
+    for (int i = 0; i < 10; ++i)
+        list.AddRect(WorldPoint{ i, i }, WorldPoint{ i + 5, i + 9 });
+
+    FrameArena arena;
+    LogBackend log(pens);
+    list.Replay(cam, log, arena);
+    CHECK(BatchedByPenAndChunk(log));
+
+    std::vector<size_t> polylineCalls, polygonCalls, ellipseCalls;
+    for (const Call& call : log.calls)
+    {
+        std::vector<size_t>& sizes = call.kind == PRIM_POLYLINE ? polylineCalls : (call.kind == PRIM_POLYGON ? polygonCalls : ellipseCalls);
+        sizes.push_back(call.vertices);
+    }
+    CHECK(polylineCalls == std::vector<size_t>({ MAX, MAX }));
+    CHECK(ellipseCalls == std::vector<size_t>({ MAX, 2 }));
+    CHECK(polygonCalls == std::vector<size_t>({ 16000, 4000, 20000, 40 }));
+
+    // the points are the per vertex transform, across chunk boundaries too
+    const Primitive& last = log.primitives[MAX - 1];
+    CHECK(last.kind == PRIM_POLYLINE);
+    CHECK(last.pts[1].x == ToScreen(cam, (int32_t)MAX - 1, 100).x && last.pts[1].y == ToScreen(cam, 0, 100).y);
+    const Primitive& huge = log.primitives[MAX + 20];
+    CHECK_EQ(huge.pts.size(), 20000);
+    CHECK(huge.pts[19999].x == ToScreen(cam, xs[19999], 0).x && huge.pts[19999].y == ToScreen(cam, 0, ys[19999]).y);
+}
+
+TEST(display_list, clipped_replay_keeps_only_the_visible_part)
+{
+    const std::vector<PenStyle> pens = { { 0, 0, 0, 1 }, { 0, 0, 255, 3 } };
+    const ScreenRect viewport{ 0, 0, 800, 600 };
+    const ClipRect clip = ExpandedClipRect(viewport);
+    Camera cam;
+    cam.zoom = 2.0;
+    cam.panX = -100;
+    cam.panY = -50;
+
+    // hand placed: screen = 2 * world + pan
+    DisplayList list;
+    std::vector<Primitive> inside;
+    list.SetPen(pens[0]);
+    list.AddLine(WorldPoint{ 100, 100 }, WorldPoint{ 200, 150 });            // inside
+    list.AddLine(WorldPoint{ 2000, 2000 }, WorldPoint{ 2100, 2100 });        // outside
+    list.AddLine(WorldPoint{ 100, 100 }, WorldPoint{ 1000, 100 });           // crossing the right edge
+    list.AddRect(WorldPoint{ -500, 60 }, WorldPoint{ 150, 120 });            // crossing the left edge
+    list.SetPen(pens[1]);
+    list.AddEllipse(WorldPoint{ 300, 200 }, WorldPoint{ 600, 400 });         // crossing, within the guard
+    list.AddEllipse(WorldPoint{ -40000, -40000 }, WorldPoint{ 40000, 40000 }); // far past the guard
+    list.AddEllipse(WorldPoint{ 5000, 5000 }, WorldPoint{ 5100, 5100 });     // outside
+
+    FrameArena arena;
+    LogBackend log(pens);
+    list.Replay(cam, viewport, log, arena);
+    CHECK(BatchedByPenAndChunk(log));
+
+    const std::vector<const Primitive*> lines = Select(log.primitives, 0, PRIM_POLYLINE);
+    REQUIRE(lines.size() == 2);
+    CHECK(SamePoints(lines[0]->pts, { ToScreen(cam, 100, 100), ToScreen(cam, 200, 150) }));
+    REQUIRE(lines[1]->pts.size() == 2);
+    CHECK(lines[1]->pts[0].x == 100 && lines[1]->pts[0].y == 150);
+    CHECK(lines[1]->pts[1].x == (int32_t)clip.maxX && lines[1]->pts[1].y == 150);
+
+    const std::vector<const Primitive*> rects = Select(log.primitives, 0, PRIM_POLYGON);
+    REQUIRE(rects.size() == 1);
+    bool rectInside = true;
+    for (const ScreenPoint& p : rects[0]->pts)
+        rectInside = rectInside && InClipRect(clip, p);
+    CHECK(rectInside);
+
+    // the small ellipse whole, the huge one as its clipped outline, the far
+    // one dropped
+    const std::vector<const Primitive*> ellipses = Select(log.primitives, 1, PRIM_ELLIPSE);
+    REQUIRE(ellipses.size() == 1);
+    CHECK(SamePoints(ellipses[0]->pts, { ToScreen(cam, 300, 200), ToScreen(cam, 600, 400) }));
+    const std::vector<const Primitive*> outlines = Select(log.primitives, 1, PRIM_POLYGON);
+    REQUIRE(outlines.size() == 1);
+    bool outlineInside = true;
+    for (const ScreenPoint& p : outlines[0]->pts)
+        outlineInside = outlineInside && InClipRect(clip, p);
+    CHECK(outlineInside);
+    CHECK(outlines[0]->pts.size() >= 4);
+}
+
+TEST(display_list, clipped_replay_matches_per_shape_drawing_inside)
+{
+    // a view into the middle of a scene: shapes wholly inside come out as
+    // drawn shape by shape, everything handed over lies in the clip
+    // rectangle (ellipses aside, they may pass whole), and less is submitted
+    SceneSpec spec;
+    spec.targetVertices = 100000;
+    spec.seed = 133;
+    spec.worldSize = 20000;
+    spec.maxShapeSize = 1500;
+    SceneStore scene;
+    GenerateScene(spec, scene);
+
+    const ScreenRect viewport{ 0, 0, 1280, 800 };
+    const ClipRect clip = ExpandedClipRect(viewport);
+    Camera cam;
+    cam.zoom = 0.25;
+    cam.panX = -1800;
+    cam.panY = -1500;
+
+    const std::vector<PenStyle> pens = { { 0, 0, 0, 1 } };
+    DisplayList list;
+    list.SetPen(pens[0]);
+    std::vector<Primitive> drawn, drawnInside;
+    for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+    {
+        const size_t before = drawn.size();
+        RecordShape(scene, id, 0, cam, list, drawn);
+        if (drawn.size() > before && ClassifyBox(clip, cam, scene.Bounds(id)) == CLIP_INSIDE)
+            drawnInside.push_back(drawn.back());
+    }
+
+    FrameArena arena;
+    LogBackend log(pens);
+    list.Replay(cam, viewport, log, arena);
+    CHECK(BatchedByPenAndChunk(log));
+
+    // the inside shapes, in order, among what was handed over
+    bool found = true;
+    for (PrimitiveKind kind : { PRIM_POLYLINE, PRIM_POLYGON, PRIM_ELLIPSE })
+    {
+        const std::vector<const Primitive*> r = Select(log.primitives, 0, kind), d = Select(drawnInside, 0, kind);
+        size_t next = 0;
+        for (const Primitive* p : d)
+        {
+            while (next < r.size() && !SamePoints(r[next]->pts, p->pts))
+                ++next;
+            found = found && next < r.size();
+            ++next;
+        }
+    }
+    CHECK(found);
+    CHECK(drawnInside.size() > 100);
+
+    bool inClip = true;
+    size_t submitted = 0;
+    for (const Primitive& p : log.primitives)
+    {
+        submitted += p.pts.size();
+        for (const ScreenPoint& q : p.pts)
+            inClip = inClip && (p.kind == PRIM_ELLIPSE || InClipRect(clip, q));
+    }
+    CHECK(inClip);
+    CHECK(submitted < list.VertexCount() / 2);
+}
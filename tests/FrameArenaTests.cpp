@@ -0,0 +1,277 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "BoundsTree.h"
+#include "DisplayList.h"
+#include "FrameArena.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+#include "TileRasterizer.h"
+
+// -------------------- Allocation counting --------------------
+// As in the benchmark: every heap allocation of drawer_tests goes through
+// these, so a test can count the allocations one frame makes.
+static std::atomic<uint64_t> g_allocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+// Out of line for the same reason as the benchmark's (-Wmismatched-new-delete)
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+namespace {
+
+    // Same recording as the app's RecordShape, without levels of detail
+    void RecordShape(const SceneStore& scene, DisplayList& list, uint32_t id)
+    {
+        const uint32_t count = scene.Count(id);
+        if (count < 2)
+            return;
+
+        const int32_t* xs = scene.Xs() + scene.Offset(id);
+        const int32_t* ys = scene.Ys() + scene.Offset(id);
+        const WorldPoint a{ xs[0], ys[0] };
+        const WorldPoint b{ xs[1], ys[1] };
+
+        switch (scene.Kind(id))
+        {
+        case SHAPE_LINE:      list.AddLine(a, b); break;
+        case SHAPE_RECT:      list.AddRect(a, b); break;
+        case SHAPE_ELLIPSE:   list.AddEllipse(a, b); break;
+        case SHAPE_MULTILINE:
+        case SHAPE_POLIGON:   list.AddPolygon(xs, ys, count); break;
+        }
+    }
+
+    // Every byte set to tag, to find overlapping allocations later
+    void Stamp(void* p, size_t bytes, uint8_t tag)
+    {
+        std::memset(p, tag, bytes);
+    }
+
+    bool Stamped(const void* p, size_t bytes, uint8_t tag)
+    {
+        const uint8_t* b = static_cast<const uint8_t*>(p);
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            if (b[i] != tag)
+                return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+TEST(frame_arena, allocations_are_aligned_and_disjoint)
+{
+    FrameArena arena(4096);
+    SceneRandom rng(121);
+    struct Piece {
+        void* p;
+        size_t bytes;
+    };
+    std::vector<Piece> pieces;
+    bool aligned = true;
+    size_t requested = 0;
+    for (int i = 0; i < 2000; ++i)
+    {
+        const size_t align = (size_t)1 << rng.Range(0, 4);     // 1 to 16
+        const size_t bytes = (size_t)rng.Range(0, 300);
+        void* p = arena.Allocate(bytes, align);
+        aligned = aligned && p != nullptr && (uintptr_t)p % align == 0;
+        Stamp(p, bytes, (uint8_t)i);
+        pieces.push_back(Piece{ p, bytes });
+        requested += bytes;
+    }
+    CHECK(aligned);
+
+    // nothing written later reached into an earlier piece
+    bool disjoint = true;
+    for (size_t i = 0; i < pieces.size(); ++i)
+        disjoint = disjoint && Stamped(pieces[i].p, pieces[i].bytes, (uint8_t)i);
+    CHECK(disjoint);
+    CHECK(arena.BytesUsed() >= requested);
+    CHECK(arena.PeakBytes() == arena.BytesUsed());
+    CHECK(arena.Capacity() >= arena.BytesUsed());
+
+    // the default alignment suits any scalar, typed arrays their type
+    CHECK((uintptr_t)arena.Allocate(1) % alignof(std::max_align_t) == 0);
+    arena.Allocate(3, 1);
+    CHECK((uintptr_t)arena.AllocateArray<double>(5) % alignof(double) == 0);
+    arena.Allocate(1, 1);
+    CHECK((uintptr_t)arena.AllocateArray<ScreenPoint>(7) % alignof(ScreenPoint) == 0);
+}
+
+TEST(frame_arena, overflow_chains_blocks_and_reset_folds_them)
+{
+    FrameArena arena(1000);
+    CHECK_EQ(arena.HeapAllocations(), 0);       // the first block waits for first use
+    CHECK_EQ(arena.Capacity(), 0);
+
+    // a frame of ten 400 byte buffers overflows into chained blocks, the
+    // earlier buffers stay where they are
+    std::vector<void*> buffers;
+    for (int i = 0; i < 10; ++i)
+    {
+        buffers.push_back(arena.Allocate(400));
+        Stamp(buffers.back(), 400, (uint8_t)(i + 1));
+    }
+    bool kept = true;
+    for (size_t i = 0; i < buffers.size(); ++i)
+        kept = kept && Stamped(buffers[i], 400, (uint8_t)(i + 1));
+    CHECK(kept);
+    const uint64_t blocks = arena.HeapAllocations();
+    const size_t capacity = arena.Capacity();
+    CHECK(blocks > 1);
+    CHECK(capacity >= 4000);
+    CHECK(arena.PeakBytes() >= 4000);
+
+    // Reset replaces the chain with one block of the same total
+    arena.Reset();
+    CHECK_EQ(arena.HeapAllocations(), blocks + 1);
+    CHECK_EQ(arena.Capacity(), capacity);
+    CHECK_EQ(arena.BytesUsed(), 0);
+
+    // and the same frame again fits in it: no more blocks, frame after frame
+    for (int frame = 0; frame < 5; ++frame)
+    {
+        arena.Reset();
+        for (int i = 0; i < 10; ++i)
+            arena.Allocate(400);
+    }
+    CHECK_EQ(arena.HeapAllocations(), blocks + 1);
+    CHECK_EQ(arena.Capacity(), capacity);
+
+    // one allocation larger than any block gets a block of its own size
+    arena.Reset();
+    void* big = arena.Allocate(capacity * 3, 1);
+    Stamp(big, capacity * 3, 0x5A);
+    CHECK(Stamped(big, capacity * 3, 0x5A));
+    CHECK_EQ(arena.Capacity(), capacity * 4);
+    const uint64_t chained = arena.HeapAllocations();
+    arena.Reset();
+    CHECK_EQ(arena.HeapAllocations(), chained + 1);
+    CHECK_EQ(arena.Capacity(), capacity * 4);
+}
+
+TEST(frame_arena, paint_frames_stop_allocating)
+{
+    // the WM_PAINT path: reset the arena, re-record the visible shapes and
+    // replay them, plain and clipped. Once the arena and the display list
+    // have grown to the frames shown, a frame makes no heap allocation.
+    SceneSpec spec;
+    spec.targetVertices = 100000;
+    spec.seed = 122;
+    SceneStore scene;
+    GenerateScene(spec, scene);
+    BoundsTree tree;
+    for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+    {
+        if (scene.Count(id) > 0)
+            tree.Insert(id, scene.Bounds(id));
+    }
+
+    FrameArena arena;
+    DisplayList list;
+    const PenStyle pen{ 0, 0, 255, 2 };
+    const ScreenRect viewport{ 0, 0, 1280, 800 };
+
+    // a few views, each a little off the last, and the whole scene
+    std::vector<Camera> cameras;
+    const Camera fit = FitCameraToScene(scene, 1280, 800, 0);
+    for (int i = 0; i < 4; ++i)
+    {
+        Camera c = fit;
+        c.zoom = fit.zoom * (1 + 2 * i);
+        c.panX = fit.panX * c.zoom / fit.zoom - 300 * i;
+        c.panY = fit.panY * c.zoom / fit.zoom - 200 * i;
+        cameras.push_back(c);
+    }
+    cameras.push_back(fit);
+
+    uint64_t submitted = 0;
+    auto paint = [&](const Camera& camera, bool clipped)
+        {
+            arena.Reset();
+            list.Clear();
+            list.SetPen(pen);
+            const WorldRect visible{
+                (int32_t)(-camera.panX / camera.zoom), (int32_t)(-camera.panY / camera.zoom),
+                (int32_t)((viewport.right - camera.panX) / camera.zoom) + 1, (int32_t)((viewport.bottom - camera.panY) / camera.zoom) + 1 };
+            tree.Query(visible, [&](uint32_t id) { RecordShape(scene, list, id); });
+
+            RecordingBackend backend;
+            if (clipped)
+                list.Replay(camera, viewport, backend, arena);
+            else
+                list.Replay(camera, backend, arena);
+            submitted += backend.vertices;
+        };
+
+    // warm up: every view both ways, twice (flattened ellipses swap two of
+    // the clip stage buffers, so each grows on its own turn)
+    for (int round = 0; round < 2; ++round)
+    {
+        for (const Camera& c : cameras)
+        {
+            paint(c, false);
+            paint(c, true);
+        }
+    }
+    const uint64_t arenaBlocks = arena.HeapAllocations();
+
+    bool none = true;
+    for (int round = 0; round < 3; ++round)
+    {
+        for (const Camera& c : cameras)
+        {
+            for (bool clipped : { false, true })
+            {
+                const uint64_t before = g_allocations.load(std::memory_order_relaxed);
+                paint(c, clipped);
+                none = none && g_allocations.load(std::memory_order_relaxed) == before;
+            }
+        }
+    }
+    CHECK(none);
+    CHECK_EQ(arena.HeapAllocations(), arenaBlocks);
+    CHECK(submitted > 0);
+}
@@ -0,0 +1,134 @@
+#include <cstdint>
+
+#include "FramePacing.h"
+#include "TestCheck.h"
+
+TEST(frame_pacing, coalescer_keeps_the_newest_move)
+{
+    MoveCoalescer moves;
+    ScreenPoint p{ -1, -1 };
+    CHECK(!moves.Take(p));
+    CHECK(!moves.HasPending());
+
+    moves.Push(ScreenPoint{ 1, 2 });
+    moves.Push(ScreenPoint{ 3, 4 });
+    moves.Push(ScreenPoint{ 5, 6 });
+    CHECK(moves.HasPending());
+    REQUIRE(moves.Take(p));
+    CHECK(p.x == 5 && p.y == 6);
+    CHECK(!moves.Take(p));
+
+    moves.Push(ScreenPoint{ 7, 8 });
+    REQUIRE(moves.Take(p));
+    CHECK(p.x == 7 && p.y == 8);
+
+    CHECK_EQ(moves.Received(), 4);
+    CHECK_EQ(moves.Merged(), 2);
+    CHECK_EQ(moves.Processed(), 2);
+}
+
+TEST(frame_pacing, one_frame_per_interval)
+{
+    ManualClock clock;
+    clock.Set(1000);
+    FrameScheduler frames(clock, 50);
+    REQUIRE(frames.IntervalMicros() == 20000);
+
+    CHECK(frames.Request());                    // slot free: present now
+    clock.Advance(1000);
+    CHECK(!frames.Request());                   // inside the interval: deferred
+    CHECK(frames.HasPending());
+    CHECK_EQ(frames.MicrosUntilDue(), 19000);
+    CHECK(!frames.Request());                   // folded into the pending frame
+    CHECK(!frames.Request());
+
+    clock.Advance(18999);
+    CHECK(!frames.TakeDue());
+    CHECK_EQ(frames.MicrosUntilDue(), 1);
+    clock.Advance(1);
+    CHECK(frames.TakeDue());
+    CHECK(!frames.HasPending());
+    CHECK(!frames.TakeDue());                   // taken once
+
+    // the slot after a deferred frame counts from when it was presented
+    clock.Advance(19999);
+    CHECK(!frames.Request());
+    clock.Advance(1);
+    CHECK(frames.TakeDue());
+
+    CHECK_EQ(frames.Requested(), 5);
+    CHECK_EQ(frames.Presented(), 3);
+    CHECK_EQ(frames.Merged(), 2);
+}
+
+TEST(frame_pacing, idle_requests_present_at_once)
+{
+    ManualClock clock;
+    FrameScheduler frames(clock, 60);
+    for (int i = 0; i < 10; ++i)
+    {
+        clock.Advance(frames.IntervalMicros());
+        CHECK(frames.Request());
+        CHECK_EQ(frames.MicrosUntilDue(), frames.IntervalMicros());
+    }
+
+    // 0 fps: no pacing once the slot booked at the old rate has passed
+    frames.SetTargetFps(0);
+    CHECK_EQ(frames.IntervalMicros(), 0);
+    CHECK(!frames.Request());
+    clock.Advance(frames.MicrosUntilDue());
+    CHECK(frames.TakeDue());
+    for (int i = 0; i < 10; ++i)
+        CHECK(frames.Request());
+    CHECK_EQ(frames.Presented(), 21);
+}
+
+TEST(frame_pacing, fast_mouse_is_paced_to_the_frame_rate)
+{
+    // a 1000 Hz mouse for two seconds against a 60 fps schedule; the frame
+    // timer is checked every millisecond like WM_TIMER would fire
+    ManualClock clock;
+    FrameScheduler frames(clock, 60);
+    MoveCoalescer moves;
+
+    uint64_t waitingSince = 0;
+    bool waiting = false;
+    uint64_t worstWait = 0;
+    int32_t lastDrawn = -1;
+    bool newestDrawn = true;
+
+    auto present = [&]()
+        {
+            ScreenPoint p{};
+            if (moves.Take(p))
+            {
+                newestDrawn = newestDrawn && p.x > lastDrawn;
+                lastDrawn = p.x;
+            }
+            if (waiting && clock.NowMicros() - waitingSince > worstWait)
+                worstWait = clock.NowMicros() - waitingSince;
+            waiting = false;
+        };
+
+    for (int32_t ms = 0; ms < 2000; ++ms)
+    {
+        clock.Set((uint64_t)ms * 1000);
+        moves.Push(ScreenPoint{ ms, 0 });
+        if (!waiting)
+        {
+            waiting = true;
+            waitingSince = clock.NowMicros();
+        }
+        if (frames.Request() || frames.TakeDue())
+            present();
+    }
+
+    // about 60 frames a second, never more, and no move waits past one interval
+    CHECK(frames.Presented() >= 118 && frames.Presented() <= 121);
+    CHECK(worstWait <= frames.IntervalMicros());
+    CHECK(newestDrawn);
+    CHECK_EQ(moves.Received(), 2000);
+    CHECK_EQ(moves.Processed(), frames.Presented());
+    CHECK_EQ(moves.Merged() + moves.Processed() + (moves.HasPending() ? 1 : 0), moves.Received());
+    CHECK_EQ(frames.Requested(), 2000);
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LatencyStats.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+
+namespace {
+
+    // Log-uniform durations from 1 ns to ~17 minutes
+    uint64_t RandomNanos(SceneRandom& rng)
+    {
+        const int bits = rng.Range(0, 40);
+        return (1ull << bits) + (rng.Next() & ((1ull << bits) - 1));
+    }
+
+    // Nearest rank, the rank ValueAtPercentile looks for
+    uint64_t ExactPercentile(const std::vector<uint64_t>& sorted, double percentile)
+    {
+        uint64_t rank = (uint64_t)(percentile / 100.0 * (double)sorted.size() + 0.5);
+        if (rank < 1)
+            rank = 1;
+        return sorted[rank - 1];
+    }
+
+} // namespace
+
+TEST(latency_stats, buckets_tile_the_range)
+{
+    using H = LatencyHistogram;
+    bool contiguous = true, roundTrip = true, precise = true;
+    for (uint32_t b = 0; b < H::BUCKET_COUNT; ++b)
+    {
+        const uint64_t low = H::BucketLow(b), high = H::BucketHigh(b);
+        roundTrip = roundTrip && H::BucketOf(low) == b && H::BucketOf(high) == b;
+        if (b + 1 < H::BUCKET_COUNT)
+            contiguous = contiguous && H::BucketLow(b + 1) == high + 1;
+        precise = precise && (high - low) * H::SUB_BUCKETS <= low;      // width within 1/SUB_BUCKETS of the value
+    }
+    CHECK(contiguous);
+    CHECK(roundTrip);
+    CHECK(precise);
+
+    CHECK_EQ(H::BucketLow(0), 0);
+    CHECK_EQ(H::BucketHigh(H::BUCKET_COUNT - 1), H::MAX_VALUE);
+    CHECK_EQ(H::BucketOf(H::MAX_VALUE + 1), H::BUCKET_COUNT - 1);     // clamped
+    CHECK_EQ(H::BucketOf(UINT64_MAX), H::BUCKET_COUNT - 1);
+}
+
+TEST(latency_stats, percentiles_within_bucket_precision)
+{
+    SceneRandom rng(61);
+    for (size_t n : { 1, 2, 10, 1000, 100000 })
+    {
+        LatencyHistogram h;
+        std::vector<uint64_t> samples(n);
+        uint64_t sum = 0;
+        for (uint64_t& v : samples)
+        {
+            v = RandomNanos(rng);
+            h.Record(v);
+            sum += v;
+        }
+        std::sort(samples.begin(), samples.end());
+
+        CHECK_EQ(h.Count(), n);
+        CHECK_EQ(h.Min(), samples.front());
+        CHECK_EQ(h.Max(), samples.back());
+        CHECK(h.Mean() == (double)sum / (double)n);
+
+        // the reported value is the bucket top: never below the sample, at
+        // most one bucket width above it, and never above the max
+        bool within = true;
+        for (double p : { 0.0, 1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 100.0 })
+        {
+            const uint64_t exact = ExactPercentile(samples, p);
+            const uint64_t got = h.ValueAtPercentile(p);
+            within = within && got >= exact && got - exact <= exact / LatencyHistogram::SUB_BUCKETS && got <= h.Max();
+        }
+        CHECK(within);
+        CHECK_EQ(h.ValueAtPercentile(100.0), h.Max());
+        CHECK_EQ(h.ValueAtPercentile(-5.0), h.ValueAtPercentile(0.0));
+        CHECK_EQ(h.ValueAtPercentile(250.0), h.Max());
+    }
+}
+
+TEST(latency_stats, small_values_are_exact)
+{
+    LatencyHistogram h;
+    for (uint64_t v = 0; v < 2 * LatencyHistogram::SUB_BUCKETS; ++v)
+        h.Record(v);
+    CHECK_EQ(h.ValueAtPercentile(50.0), LatencyHistogram::SUB_BUCKETS - 1);
+    CHECK_EQ(h.Min(), 0);
+    CHECK_EQ(h.Max(), 2 * LatencyHistogram::SUB_BUCKETS - 1);
+}
+
+TEST(latency_stats, empty_merge_and_reset)
+{
+    LatencyHistogram empty;
+    CHECK_EQ(empty.Count(), 0);
+    CHECK_EQ(empty.Min(), 0);
+    CHECK_EQ(empty.Max(), 0);
+    CHECK(empty.Mean() == 0.0);
+    CHECK_EQ(empty.ValueAtPercentile(99.0), 0);
+
+    // two halves merged answer like one histogram of everything
+    SceneRandom rng(62);
+    LatencyHistogram a, b, all;
+    for (int i = 0; i < 5000; ++i)
+    {
+        const uint64_t v = RandomNanos(rng);
+        (i % 3 == 0 ? a : b).Record(v);
+        all.Record(v);
+    }
+    a.Merge(b);
+    a.Merge(empty);
+    CHECK_EQ(a.Count(), all.Count());
+    CHECK_EQ(a.Min(), all.Min());
+    CHECK_EQ(a.Max(), all.Max());
+    CHECK(a.Mean() == all.Mean());
+    bool same = true;
+    for (double p = 0.0; p <= 100.0; p += 0.5)
+        same = same && a.ValueAtPercentile(p) == all.ValueAtPercentile(p);
+    CHECK(same);
+
+    a.Reset();
+    CHECK_EQ(a.Count(), 0);
+    CHECK_EQ(a.ValueAtPercentile(50.0), 0);
+    a.Record(7);
+    CHECK(a.Min() == 7 && a.Max() == 7 && a.ValueAtPercentile(1.0) == 7);
+}
+
+TEST(latency_stats, timers_measure_at_least_the_elapsed_time)
+{
+    const uint64_t before = LatencyNowNanos();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    const uint64_t after = LatencyNowNanos();
+    CHECK(after - before >= 5000000);
+
+    bool monotonic = true;
+    uint64_t last = LatencyNowNanos();
+    for (int i = 0; i < 10000; ++i)
+    {
+        const uint64_t now = LatencyNowNanos();
+        monotonic = monotonic && now >= last;
+        last = now;
+    }
+    CHECK(monotonic);
+
+    // each Mark records the time since the previous one into its channel
+    const char* const names[] = { "first", "second", "third" };
+    LatencyRecorder recorder(names, 3);
+    {
+        LatencySplit split(recorder);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        split.Mark(0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(6));
+        split.Mark(1);
+        split.Mark(1);
+    }
+    CHECK_EQ(recorder.Histogram(0).Count(), 1);
+    CHECK_EQ(recorder.Histogram(1).Count(), 2);
+    CHECK_EQ(recorder.Histogram(2).Count(), 0);
+    CHECK(recorder.Histogram(0).Max() >= 2000000);
+    CHECK(recorder.Histogram(1).Max() >= 6000000);
+    CHECK(recorder.Histogram(1).Min() < recorder.Histogram(1).Max());
+
+    recorder.Reset();
+    CHECK_EQ(recorder.Histogram(1).Count(), 0);
+}
+
+TEST(latency_stats, format_channel)
+{
+    const char* const names[] = { "WM_PAINT" };
+    LatencyRecorder recorder(names, 1);
+    CHECK_EQ(recorder.ChannelCount(), 1);
+    CHECK(std::strcmp(recorder.Name(0), "WM_PAINT") == 0);
+    for (int i = 0; i < 99; ++i)
+        recorder.Record(0, 1000000);        // 1 ms
+    recorder.Record(0, 5000000);
+
+    char buf[128];
+    const size_t n = recorder.FormatChannel(0, buf, sizeof(buf));
+    CHECK_EQ(n, std::strlen(buf));
+    CHECK(std::string(buf) == "WM_PAINT         n=100      p50=1.016ms p99=1.016ms max=5.000ms");
+
+    // truncated to the buffer, still terminated
+    char small[12];
+    CHECK_EQ(recorder.FormatChannel(0, small, sizeof(small)), sizeof(small) - 1);
+    CHECK(std::string(small) == "WM_PAINT   ");
+    CHECK_EQ(recorder.FormatChannel(0, small, 0), 0);
+}
@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+#include "TestCheck.h"
+
+namespace {
+
+    // Everything the drain thread wrote, one entry per line
+    std::vector<std::string> ReadLines(FILE* sink)
+    {
+        std::vector<std::string> lines;
+        std::rewind(sink);
+        std::string line;
+        int c;
+        while ((c = std::fgetc(sink)) != EOF)
+        {
+            if (c == '\n')
+            {
+                lines.push_back(line);
+                line.clear();
+            }
+            else
+            {
+                line.push_back((char)c);
+            }
+        }
+        if (!line.empty())
+            lines.push_back(line);
+        return lines;
+    }
+
+    bool PushNumbered(Logger& logger, uint32_t i)
+    {
+        char text[32];
+        const int n = std::snprintf(text, sizeof(text), "message %u", i);
+        return logger.Push(LOG_LEVEL_INFO, text, (size_t)n);
+    }
+
+    std::string Numbered(uint32_t i)
+    {
+        return "[info] message " + std::to_string(i);
+    }
+
+} // namespace
+
+TEST(logger, concurrent_push_keeps_count_and_order)
+{
+    FILE* sink = std::tmpfile();
+    REQUIRE(sink);
+    auto logger = std::make_unique<Logger>();     // the ring is too big for the stack
+    logger->Start(sink);
+
+    // the producer runs flat out, so the drain thread falls behind and the
+    // ring overflows now and then; accepted records which pushes got in
+    const uint32_t MESSAGES = 200000;
+    std::vector<uint32_t> accepted;
+    accepted.reserve(MESSAGES);
+    std::thread producer([&]()
+        {
+            for (uint32_t i = 0; i < MESSAGES; ++i)
+            {
+                if (PushNumbered(*logger, i))
+                    accepted.push_back(i);
+                if (i % 4096 == 0)
+                    std::this_thread::yield();
+            }
+        });
+    producer.join();
+    logger->Stop();
+
+    CHECK_EQ(logger->Written(), accepted.size());
+    CHECK_EQ(logger->Dropped(), MESSAGES - accepted.size());
+
+    // every accepted message exactly once, in push order
+    const std::vector<std::string> lines = ReadLines(sink);
+    REQUIRE(lines.size() == accepted.size());
+    bool inOrder = true;
+    for (size_t i = 0; i < lines.size(); ++i)
+        inOrder = inOrder && lines[i] == Numbered(accepted[i]);
+    CHECK(inOrder);
+    std::fclose(sink);
+}
+
+TEST(logger, full_ring_drops_and_counts)
+{
+    FILE* sink = std::tmpfile();
+    REQUIRE(sink);
+    auto logger = std::make_unique<Logger>();
+
+    // nothing drains before Start: the ring takes SLOT_COUNT messages
+    const uint32_t EXTRA = 37;
+    uint32_t pushed = 0;
+    for (uint32_t i = 0; i < Logger::SLOT_COUNT + EXTRA; ++i)
+        pushed += PushNumbered(*logger, i) ? 1 : 0;
+    CHECK_EQ(pushed, Logger::SLOT_COUNT);
+    CHECK_EQ(logger->Dropped(), EXTRA);
+    CHECK_EQ(logger->Written(), 0);
+
+    // the backlog drains once the thread starts, and the ring takes more
+    logger->Start(sink);
+    logger->Stop();
+    CHECK_EQ(logger->Written(), Logger::SLOT_COUNT);
+    CHECK(PushNumbered(*logger, 5000));
+
+    const std::vector<std::string> lines = ReadLines(sink);
+    REQUIRE(lines.size() == Logger::SLOT_COUNT);
+    CHECK(lines.front() == Numbered(0));
+    CHECK(lines.back() == Numbered(Logger::SLOT_COUNT - 1));
+    std::fclose(sink);
+}
+
+TEST(logger, stop_drains_and_joins)
+{
+    FILE* sink = std::tmpfile();
+    REQUIRE(sink);
+    auto logger = std::make_unique<Logger>();
+    logger->Stop();                                 // not started: nothing to join
+
+    // start, push and stop several times: each stop writes what is queued
+    uint32_t next = 0;
+    for (int round = 0; round < 20; ++round)
+    {
+        logger->Start(sink);
+        std::thread producer([&]()
+            {
+                for (int i = 0; i < 300; ++i)
+                    CHECK(PushNumbered(*logger, next++));
+            });
+        producer.join();
+        logger->Stop();
+        logger->Stop();
+        CHECK_EQ(logger->Written(), next);
+    }
+    CHECK_EQ(logger->Dropped(), 0);
+    CHECK_EQ(ReadLines(sink).size(), next);
+    std::fclose(sink);
+}
+
+TEST(logger, messages_are_truncated_and_prefixed)
+{
+    FILE* sink = std::tmpfile();
+    REQUIRE(sink);
+    auto logger = std::make_unique<Logger>();
+    logger->Start(sink);
+
+    const std::string longText(Logger::MESSAGE_SIZE * 2, 'x');
+    logger->Push(LOG_LEVEL_ERROR, longText.c_str(), longText.size());
+    logger->Push(LOG_LEVEL_WARN, "ends in a newline\n", 18);
+    logger->Push(LOG_LEVEL_DEBUG, "", 0);
+    {
+        LogLine line(LOG_LEVEL_INFO, *logger);
+        line << "zoom " << 1.5 << ' ' << 42 << " shapes";
+    }
+    logger->Stop();
+
+    const std::vector<std::string> lines = ReadLines(sink);
+    REQUIRE(lines.size() == 4);
+    CHECK(lines[0] == "[error] " + std::string(Logger::MESSAGE_SIZE - 1, 'x'));
+    CHECK(lines[1] == "[warn] ends in a newline");
+    CHECK(lines[2] == "[debug] ");
+    CHECK(lines[3] == "[info] zoom 1.5 42 shapes");
+    std::fclose(sink);
+}
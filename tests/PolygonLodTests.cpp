@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "PolygonLod.h"
+#include "SceneGenerator.h"
+#include "SceneStore.h"
+#include "TestCheck.h"
+#include "TileRasterizer.h"
+
+namespace {
+
+    struct Chain {
+        std::vector<int32_t> xs;
+        std::vector<int32_t> ys;
+    };
+
+    // Closed random walk with small steps, like a traced multiline: dense
+    // enough that every level drops vertices
+    Chain RandomWalk(SceneRandom& rng, uint32_t count, int32_t step)
+    {
+        Chain c;
+        int32_t x = rng.Range(-10000, 10000), y = rng.Range(-10000, 10000);
+        for (uint32_t i = 0; i + 1 < count; ++i)
+        {
+            c.xs.push_back(x);
+            c.ys.push_back(y);
+            x += rng.Range(-step, step);
+            y += rng.Range(-step, step);
+        }
+        c.xs.push_back(c.xs[0]);
+        c.ys.push_back(c.ys[0]);
+        return c;
+    }
+
+    double SegmentDistance(double px, double py, double ax, double ay, double bx, double by)
+    {
+        const double dx = bx - ax, dy = by - ay;
+        const double len2 = dx * dx + dy * dy;
+        const double t = len2 > 0.0 ? std::clamp(((px - ax) * dx + (py - ay) * dy) / len2, 0.0, 1.0) : 0.0;
+        return std::hypot(ax + t * dx - px, ay + t * dy - py);
+    }
+
+    // Largest distance from a vertex of the full chain to the simplified one
+    double MaxChainError(const Chain& full, const int32_t* xs, const int32_t* ys, uint32_t count)
+    {
+        double worst = 0.0;
+        for (size_t i = 0; i < full.xs.size(); ++i)
+        {
+            double best = count == 1 ? std::hypot(full.xs[i] - xs[0], full.ys[i] - ys[0]) : INFINITY;
+            for (uint32_t j = 0; j + 1 < count; ++j)
+                best = std::min(best, SegmentDistance(full.xs[i], full.ys[i], xs[j], ys[j], xs[j + 1], ys[j + 1]));
+            worst = std::max(worst, best);
+        }
+        return worst;
+    }
+
+    // World error bound of level k: the tolerances of levels 0..k add up
+    double CumulativeTolerance(int level)
+    {
+        return PolygonLod::PIXEL_TOLERANCE * (std::ldexp(1.0, level + 1) - 1.0);
+    }
+
+} // namespace
+
+TEST(polygon_lod, simplify_keeps_endpoints_and_tolerance)
+{
+    SceneRandom rng(81);
+    for (int round = 0; round < 40; ++round)
+    {
+        const Chain c = RandomWalk(rng, (uint32_t)rng.Range(3, 3000), rng.Range(1, 20));
+        const uint32_t count = (uint32_t)c.xs.size();
+        const double tolerance = rng.Range(1, 400) / 20.0;
+
+        const std::vector<uint32_t> kept = SimplifyDouglasPeucker(c.xs.data(), c.ys.data(), count, tolerance);
+        REQUIRE(kept.size() >= 2);
+        CHECK_EQ(kept.front(), 0);
+        CHECK_EQ(kept.back(), count - 1);
+
+        // every dropped vertex lies within tolerance of the segment replacing it
+        bool within = true;
+        for (size_t k = 0; k + 1 < kept.size(); ++k)
+        {
+            CHECK(kept[k] < kept[k + 1]);
+            const uint32_t a = kept[k], b = kept[k + 1];
+            for (uint32_t i = a + 1; i < b; ++i)
+                within = within && SegmentDistance(c.xs[i], c.ys[i], c.xs[a], c.ys[a], c.xs[b], c.ys[b]) <= tolerance + 1e-9;
+        }
+        CHECK(within);
+    }
+
+    // two or fewer vertices are kept as they are
+    const int32_t xs[] = { 1, 2 }, ys[] = { 3, 4 };
+    CHECK_EQ(SimplifyDouglasPeucker(xs, ys, 2, 100.0).size(), 2);
+    CHECK_EQ(SimplifyDouglasPeucker(xs, ys, 1, 100.0).size(), 1);
+}
+
+TEST(polygon_lod, levels_stay_within_the_screen_tolerance)
+{
+    SceneRandom rng(82);
+    for (int round = 0; round < 12; ++round)
+    {
+        const Chain c = RandomWalk(rng, (uint32_t)rng.Range(PolygonLod::MIN_VERTICES, 1500), rng.Range(1, 6));
+        PolygonLod lod;
+        lod.Build(7, c.xs.data(), c.ys.data(), (uint32_t)c.xs.size());
+
+        uint32_t previous = (uint32_t)c.xs.size();
+        for (int level = 0; level < PolygonLod::LEVELS; ++level)
+        {
+            const int32_t* xs;
+            const int32_t* ys;
+            uint32_t count;
+            REQUIRE(lod.Get(7, level, xs, ys, count));
+            CHECK(count >= 2 && count <= previous);
+            previous = count;
+
+            // the closing vertex stays, so the outline stays closed
+            CHECK(xs[0] == c.xs.front() && ys[0] == c.ys.front());
+            CHECK(xs[count - 1] == c.xs.back() && ys[count - 1] == c.ys.back());
+
+            CHECK(MaxChainError(c, xs, ys, count) <= CumulativeTolerance(level) + 1e-9);
+        }
+    }
+
+    // at the zoom each level is picked for, its world error is at most
+    // 2 * PIXEL_TOLERANCE screen pixels
+    for (int step = -40; step <= 10; ++step)
+    {
+        const double zoom = std::pow(1.1, step);
+        const int level = PolygonLod::SelectLevel(zoom);
+        if (level >= 0)
+            CHECK(CumulativeTolerance(level) * zoom <= 2 * PolygonLod::PIXEL_TOLERANCE + 1e-9);
+    }
+}
+
+TEST(polygon_lod, select_level_boundaries)
+{
+    CHECK_EQ(PolygonLod::SelectLevel(1.1), -1);
+    CHECK_EQ(PolygonLod::SelectLevel(1.0), 0);
+    CHECK_EQ(PolygonLod::SelectLevel(0.51), 0);
+    CHECK_EQ(PolygonLod::SelectLevel(0.5), 1);
+    CHECK_EQ(PolygonLod::SelectLevel(0.26), 1);
+    CHECK_EQ(PolygonLod::SelectLevel(0.25), 2);
+    CHECK_EQ(PolygonLod::SelectLevel(0.125), 3);
+    CHECK_EQ(PolygonLod::SelectLevel(0.001), PolygonLod::LEVELS - 1);
+}
+
+TEST(polygon_lod, small_polygons_have_no_levels)
+{
+    SceneRandom rng(83);
+    const Chain small = RandomWalk(rng, PolygonLod::MIN_VERTICES - 1, 10);
+    const Chain dense = RandomWalk(rng, PolygonLod::MIN_VERTICES, 10);
+
+    PolygonLod lod;
+    const int32_t* xs;
+    const int32_t* ys;
+    uint32_t count;
+
+    lod.Build(1, small.xs.data(), small.ys.data(), (uint32_t)small.xs.size());
+    CHECK(!lod.Get(1, 0, xs, ys, count));
+
+    lod.Build(2, dense.xs.data(), dense.ys.data(), (uint32_t)dense.xs.size());
+    CHECK(lod.Get(2, 0, xs, ys, count));
+    CHECK(!lod.Get(2, -1, xs, ys, count));
+    CHECK(!lod.Get(2, PolygonLod::LEVELS, xs, ys, count));
+
+    // rebuilding an id with too few vertices drops its levels
+    lod.Build(2, small.xs.data(), small.ys.data(), (uint32_t)small.xs.size());
+    CHECK(!lod.Get(2, 0, xs, ys, count));
+    CHECK_EQ(lod.MemoryBytes(), 0);
+}
+
+TEST(polygon_lod, rasterize_strokes_the_selected_level)
+{
+    SceneRandom rng(84);
+    SceneStore scene;
+    PolygonLod lod;
+    for (int i = 0; i < 6; ++i)
+    {
+        const Chain c = RandomWalk(rng, 800, 8);
+        std::vector<WorldPoint> pts;
+        for (size_t v = 0; v < c.xs.size(); ++v)
+            pts.push_back(WorldPoint{ c.xs[v], c.ys[v] });
+        const uint32_t id = scene.Append(i % 2 ? SHAPE_MULTILINE : SHAPE_POLIGON, pts.data(), (uint32_t)pts.size());
+        lod.Build(id, c.xs.data(), c.ys.data(), (uint32_t)c.xs.size());
+    }
+    const WorldPoint line[] = { { -5000, -5000 }, { 5000, 5000 } };
+    scene.Append(SHAPE_LINE, line, 2);
+
+    std::vector<uint32_t> ids;
+    for (uint32_t id = 0; id < scene.ShapeCount(); ++id)
+        ids.push_back(id);
+
+    for (double zoom : { 2.0, 1.0, 0.3, 0.05 })
+    {
+        RasterOptions options;
+        options.width = 400;
+        options.height = 300;
+        options.camera.zoom = zoom;
+        options.camera.panX = 200;
+        options.camera.panY = 150;
+
+        // the same scene with every dense shape replaced by its level
+        const int level = PolygonLod::SelectLevel(zoom);
+        SceneStore simplified;
+        for (uint32_t id : ids)
+        {
+            const int32_t* xs = scene.Xs() + scene.Offset(id);
+            const int32_t* ys = scene.Ys() + scene.Offset(id);
+            uint32_t count = scene.Count(id);
+            lod.Get(id, level, xs, ys, count);
+            std::vector<WorldPoint> pts;
+            for (uint32_t v = 0; v < count; ++v)
+                pts.push_back(WorldPoint{ xs[v], ys[v] });
+            simplified.Append(scene.Kind(id), pts.data(), count);
+        }
+
+        PixelBuffer withLod, expected;
+        options.lod = &lod;
+        RasterizeShapes(scene, ids.data(), ids.size(), options, withLod);
+        options.lod = nullptr;
+        RasterizeShapes(simplified, ids.data(), ids.size(), options, expected);
+
+        REQUIRE(withLod.Width() == expected.Width() && withLod.Height() == expected.Height());
+        CHECK(std::memcmp(withLod.Data(), expected.Data(), (size_t)expected.Width() * expected.Height() * sizeof(uint32_t)) == 0);
+    }
+}
@@ -0,0 +1,109 @@
+#include <cmath>
+#include <cstdlib>
+
+#include "RegularPolygon.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+
+namespace {
+
+    // The per vertex trig the app used before the tables: base angle from
+    // atan2, radius from the edge point (with the exact pi, the app's 3.1415
+    // drifted by up to two units on large polygons)
+    void BaselinePolygon(WorldPoint center, WorldPoint edge, int sides, WorldPoint* out)
+    {
+        const double dx = (double)edge.x - center.x;
+        const double dy = (double)edge.y - center.y;
+        const double r = std::sqrt(dx * dx + dy * dy);
+        const double base = std::atan2(dy, dx);
+        const double dtheta = 2.0 * std::acos(-1.0) / sides;
+
+        for (int i = 0; i < sides; ++i)
+        {
+            const double theta = base + i * dtheta;
+            out[i].x = (int32_t)(center.x + r * std::cos(theta));
+            out[i].y = (int32_t)(center.y + r * std::sin(theta));
+        }
+        out[sides] = out[0];
+    }
+
+} // namespace
+
+TEST(regular_polygon, matches_the_trig_baseline)
+{
+    SceneRandom rng(91);
+    WorldPoint got[MAX_POLY_VERTICES];
+    WorldPoint expected[MAX_POLY_VERTICES];
+
+    for (int sides = MIN_POLY_SIDES; sides <= MAX_POLY_SIDES; ++sides)
+    {
+        for (int round = 0; round < 50; ++round)
+        {
+            const int32_t reach = round < 25 ? 1000 : 1000000;
+            const WorldPoint center{ rng.Range(-reach, reach), rng.Range(-reach, reach) };
+            const WorldPoint edge{ center.x + rng.Range(-reach, reach), center.y + rng.Range(-reach, reach) };
+
+            REQUIRE(GenerateRegularPolygon(center, edge, sides, got) == sides + 1);
+            BaselinePolygon(center, edge, sides, expected);
+
+            // the first vertex is the edge point itself, the last closes the outline
+            CHECK(got[0].x == edge.x && got[0].y == edge.y);
+            CHECK(got[sides].x == got[0].x && got[sides].y == got[0].y);
+
+            // rotation and trig round differently: truncation may land one unit apart
+            bool close = true;
+            for (int i = 0; i <= sides; ++i)
+                close = close && std::abs(got[i].x - expected[i].x) <= 1 && std::abs(got[i].y - expected[i].y) <= 1;
+            CHECK(close);
+        }
+    }
+}
+
+TEST(regular_polygon, sides_are_clamped)
+{
+    const WorldPoint center{ 0, 0 }, edge{ 100, 0 };
+    WorldPoint out[MAX_POLY_VERTICES];
+    CHECK_EQ(GenerateRegularPolygon(center, edge, 0, out), MIN_POLY_SIDES + 1);
+    CHECK_EQ(GenerateRegularPolygon(center, edge, -5, out), MIN_POLY_SIDES + 1);
+    CHECK_EQ(GenerateRegularPolygon(center, edge, 1000, out), MAX_POLY_VERTICES);
+
+    // a square is exact
+    CHECK_EQ(GenerateRegularPolygon(center, edge, 4, out), 5);
+    CHECK(out[1].x == 0 && out[1].y == 100);
+    CHECK(out[2].x == -100 && out[2].y == 0);
+    CHECK(out[3].x == 0 && out[3].y == -100);
+
+    // center == edge collapses to a point
+    CHECK_EQ(GenerateRegularPolygon(center, center, 7, out), 8);
+    bool collapsed = true;
+    for (int i = 0; i < 8; ++i)
+        collapsed = collapsed && out[i].x == 0 && out[i].y == 0;
+    CHECK(collapsed);
+}
+
+TEST(regular_polygon, cache_regenerates_only_on_change)
+{
+    RegularPolygonCache cache;
+    const WorldPoint center{ 10, 20 }, edge{ 13, 24 };
+
+    CHECK(cache.Update(center, edge, 6));
+    CHECK_EQ(cache.Count(), 7);
+    CHECK(std::fabs(cache.Radius() - 5.0) < 1e-12);
+
+    WorldPoint direct[MAX_POLY_VERTICES];
+    GenerateRegularPolygon(center, edge, 6, direct);
+    bool same = true;
+    for (int i = 0; i < cache.Count(); ++i)
+        same = same && cache.Points()[i].x == direct[i].x && cache.Points()[i].y == direct[i].y;
+    CHECK(same);
+
+    // mouse moves that keep the same points are free
+    for (int i = 0; i < 5; ++i)
+        CHECK(!cache.Update(center, edge, 6));
+
+    CHECK(cache.Update(center, edge, 7));
+    CHECK_EQ(cache.Count(), 8);
+    CHECK(cache.Update(WorldPoint{ 11, 20 }, edge, 7));
+    CHECK(cache.Update(WorldPoint{ 11, 20 }, WorldPoint{ 13, 25 }, 7));
+    CHECK(!cache.Update(WorldPoint{ 11, 20 }, WorldPoint{ 13, 25 }, 7));
+}
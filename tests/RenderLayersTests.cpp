@@ -0,0 +1,169 @@
+#include <cstring>
+#include <vector>
+
+#include "PixelBuffer.h"
+#include "RenderLayers.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+#include "TileRasterizer.h"
+
+namespace {
+
+    LayerKey MakeKey(uint64_t version, double zoom, int32_t panX, int32_t panY, int32_t width, int32_t height)
+    {
+        LayerKey key;
+        key.sceneVersion = version;
+        key.zoom = zoom;
+        key.panX = panX;
+        key.panY = panY;
+        key.width = width;
+        key.height = height;
+        return key;
+    }
+
+    // Renders area of a frame under camera into surface, the way the render
+    // thread fills a band or an exposed strip
+    void RenderArea(const SceneStore& scene, const Camera& camera, const ScreenRect& area, PixelBuffer& surface)
+    {
+        std::vector<uint32_t> ids(scene.ShapeCount());
+        for (uint32_t id = 0; id < (uint32_t)ids.size(); ++id)
+            ids[id] = id;
+
+        RasterOptions options;
+        options.width = (uint32_t)(area.right - area.left);
+        options.height = (uint32_t)(area.bottom - area.top);
+        options.camera = camera;
+        options.camera.panX -= area.left;
+        options.camera.panY -= area.top;
+        PixelBuffer pixels;
+        RasterizeShapes(scene, ids.data(), ids.size(), options, pixels);
+        surface.Blit(pixels, area.left, area.top);
+    }
+
+} // namespace
+
+TEST(render_layers, update_renders_only_on_a_key_change)
+{
+    RetainedLayer<PixelBuffer> layer;
+    int renders = 0;
+    auto render = [&](PixelBuffer& surface)
+        {
+            ++renders;
+            surface.Fill(0x00112233);
+        };
+
+    const LayerKey key = MakeKey(1, 1.0, 10, 20, 64, 48);
+    CHECK(!layer.IsValid());
+    CHECK(!layer.Update(key, render));
+    CHECK_EQ(renders, 1);
+    CHECK_EQ(layer.GetSurface().Width(), 64);
+    CHECK_EQ(layer.GetSurface().Height(), 48);
+    CHECK_EQ(layer.GetSurface().Get(63, 47), 0x00112233);
+
+    // overlay frames (hover circle, previews) repaint with the same key
+    for (int i = 0; i < 10; ++i)
+        CHECK(layer.Update(key, render));
+    CHECK_EQ(renders, 1);
+    CHECK_EQ(layer.Hits(), 10);
+
+    // every field of the key is a miss
+    CHECK(!layer.Update(MakeKey(2, 1.0, 10, 20, 64, 48), render));
+    CHECK(!layer.Update(MakeKey(2, 1.1, 10, 20, 64, 48), render));
+    CHECK(!layer.Update(MakeKey(2, 1.1, 11, 20, 64, 48), render));
+    CHECK(!layer.Update(MakeKey(2, 1.1, 11, 21, 64, 48), render));
+    CHECK(!layer.Update(MakeKey(2, 1.1, 11, 21, 65, 48), render));
+    CHECK(!layer.Update(MakeKey(2, 1.1, 11, 21, 65, 49), render));
+    CHECK_EQ(renders, 7);
+    CHECK_EQ(layer.Misses(), 7);
+    CHECK_EQ(layer.GetSurface().Width(), 65);
+
+    layer.Invalidate();
+    CHECK(!layer.Update(MakeKey(2, 1.1, 11, 21, 65, 49), render));
+    CHECK_EQ(renders, 8);
+}
+
+TEST(render_layers, patch_only_for_scene_edits)
+{
+    RetainedLayer<PixelBuffer> layer;
+    int patches = 0;
+    auto patch = [&](PixelBuffer& surface)
+        {
+            ++patches;
+            surface.FillRect(2, 2, 4, 4, 0x00FF0000);
+        };
+
+    // nothing to patch before the first full render
+    CHECK(!layer.Patch(MakeKey(1, 1.0, 0, 0, 8, 8), patch));
+    CHECK_EQ(patches, 0);
+
+    layer.Update(MakeKey(1, 1.0, 0, 0, 8, 8), [](PixelBuffer& s) { s.Fill(0); });
+
+    // a new scene version over the same camera patches in place
+    CHECK(layer.Patch(MakeKey(2, 1.0, 0, 0, 8, 8), patch));
+    CHECK_EQ(patches, 1);
+    CHECK_EQ(layer.Key().sceneVersion, 2);
+    CHECK_EQ(layer.GetSurface().Get(3, 3), 0x00FF0000);
+    CHECK_EQ(layer.GetSurface().Get(5, 5), 0);
+
+    // the patched layer is now a hit for that version
+    CHECK(layer.Update(MakeKey(2, 1.0, 0, 0, 8, 8), [](PixelBuffer&) {}));
+
+    // a camera or size change needs a full render
+    CHECK(!layer.Patch(MakeKey(3, 2.0, 0, 0, 8, 8), patch));
+    CHECK(!layer.Patch(MakeKey(3, 1.0, 1, 0, 8, 8), patch));
+    CHECK(!layer.Patch(MakeKey(3, 1.0, 0, 0, 9, 8), patch));
+    CHECK_EQ(patches, 1);
+    CHECK_EQ(layer.Patches(), 1);
+}
+
+TEST(render_layers, scroll_matches_a_full_render)
+{
+    SceneSpec spec;
+    spec.targetVertices = 20000;
+    spec.seed = 81;
+    spec.worldSize = 3000;
+    spec.maxShapeSize = 600;
+    SceneStore scene;
+    GenerateScene(spec, scene);
+
+    const int32_t width = 320, height = 240;
+    Camera camera;
+    camera.zoom = 0.75;
+    RetainedLayer<PixelBuffer> layer;
+    layer.Update(MakeKey(1, camera.zoom, 0, 0, width, height), [&](PixelBuffer& surface)
+        {
+            RenderArea(scene, camera, ScreenRect{ 0, 0, width, height }, surface);
+        });
+
+    // small drags in every direction, pure rows and columns, and jumps past
+    // the frame size that need a full render
+    SceneRandom rng(82);
+    PixelBuffer reference(width, height);
+    bool same = true;
+    int scrolled = 0;
+    for (int i = 0; i < 60; ++i)
+    {
+        int32_t dx = rng.Range(-40, 40), dy = rng.Range(-40, 40);
+        if (i % 10 == 1)
+            dx = 0;
+        else if (i % 10 == 2)
+            dy = 0;
+        else if (i % 10 == 3)
+            dx = width + 5;
+        camera.panX += dx;
+        camera.panY += dy;
+
+        const LayerKey key = MakeKey(1, camera.zoom, camera.panX, camera.panY, width, height);
+        auto strip = [&](PixelBuffer& surface, const ScreenRect& area) { RenderArea(scene, camera, area, surface); };
+        if (layer.Scroll(key, strip))
+            ++scrolled;
+        else
+            layer.Update(key, [&](PixelBuffer& surface) { RenderArea(scene, camera, ScreenRect{ 0, 0, width, height }, surface); });
+
+        RenderArea(scene, camera, ScreenRect{ 0, 0, width, height }, reference);
+        same = same && std::memcmp(layer.GetSurface().Data(), reference.Data(), (size_t)width * height * sizeof(uint32_t)) == 0;
+    }
+    CHECK(same);
+    CHECK_EQ(scrolled, 54);
+    CHECK_EQ(layer.Scrolls(), 54);
+}
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "PixelBuffer.h"
+#include "PolygonLod.h"
+#include "RenderThread.h"
+#include "SceneGenerator.h"
+#include "SceneHistory.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+#include "TileRasterizer.h"
+
+namespace {
+
+    const PenStyle PEN{ 0, 0, 255, 2 };
+    const uint32_t BACKGROUND = 0x00FFFFFF;
+
+    void TestScene(uint64_t seed, SceneStore& scene)
+    {
+        SceneSpec spec;
+        spec.targetVertices = 20000;
+        spec.seed = seed;
+        spec.worldSize = 2000;
+        spec.maxShapeSize = 500;
+        spec.maxMultilineVertices = 64;
+        GenerateScene(spec, scene);
+    }
+
+    LayerKey MakeKey(uint64_t version, const Camera& camera, int32_t width, int32_t height)
+    {
+        LayerKey key;
+        key.sceneVersion = version;
+        key.zoom = camera.zoom;
+        key.panX = camera.panX;
+        key.panY = camera.panY;
+        key.width = width;
+        key.height = height;
+        return key;
+    }
+
+    // The frame rendered in one pass from the UI thread's scene, with the
+    // polygon levels the render thread builds
+    void FullRender(const SceneStore& scene, const LayerKey& key, const Camera& camera, PixelBuffer& out)
+    {
+        PolygonLod lod;
+        std::vector<uint32_t> ids(scene.ShapeCount());
+        for (uint32_t id = 0; id < (uint32_t)ids.size(); ++id)
+        {
+            ids[id] = id;
+            const ShapeKind kind = scene.Kind(id);
+            if (kind == SHAPE_MULTILINE || kind == SHAPE_POLIGON)
+                lod.Build(id, scene.Xs() + scene.Offset(id), scene.Ys() + scene.Offset(id), scene.Count(id));
+        }
+
+        RasterOptions options;
+        options.width = (uint32_t)key.width;
+        options.height = (uint32_t)key.height;
+        options.camera = camera;
+        options.pen = PEN;
+        options.background = BACKGROUND;
+        options.lod = &lod;
+        RasterizeShapes(scene, ids.data(), ids.size(), options, out);
+    }
+
+    bool SamePixels(const PixelBuffer& a, const PixelBuffer& b)
+    {
+        return a.Width() == b.Width() && a.Height() == b.Height() &&
+            std::memcmp(a.Data(), b.Data(), (size_t)a.Width() * a.Height() * sizeof(uint32_t)) == 0;
+    }
+
+    // Takes frames until the one for serial shows; false after a generous
+    // timeout (sanitizer builds are slow)
+    bool WaitForFrame(RenderThread& renderer, uint64_t serial)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            renderer.TakeFrame();
+            if (renderer.Frame().serial >= serial)
+                return true;
+            std::this_thread::yield();
+        }
+        return false;
+    }
+
+} // namespace
+
+TEST(render_thread, frames_match_a_full_render_after_edits)
+{
+    SceneStore scene;
+    TestScene(91, scene);
+    ThreadPool pool(2);
+    RenderThread renderer;
+    renderer.Start(pool, nullptr);
+
+    Camera camera;
+    camera.zoom = 0.6;                          // dense polygons drawn from their levels
+    camera.panX = -20;
+    camera.panY = 10;
+    uint64_t version = 1;
+    PixelBuffer reference;
+
+    // publish, wait for the frame and compare it with a full render
+    auto show = [&]()
+        {
+            const LayerKey key = MakeKey(version, camera, 400, 300);
+            const uint64_t serial = renderer.Publish(scene, key, camera, PEN, BACKGROUND);
+            if (!WaitForFrame(renderer, serial))
+                return false;
+            FullRender(scene, key, camera, reference);
+            const RenderedFrame& frame = renderer.Frame();
+            return frame.serial == serial && frame.key == key && SamePixels(frame.pixels, reference);
+        };
+
+    CHECK(show());
+    CHECK_EQ(renderer.SceneCopies(), 1);
+
+    // drawn shapes: only they are copied
+    const WorldPoint line[2] = { { 100, 100 }, { 500, 300 } };
+    scene.Append(SHAPE_LINE, line, 2);
+    ++version;
+    CHECK(show());
+    const WorldPoint square[5] = { { 50, 400 }, { 250, 400 }, { 250, 600 }, { 50, 600 }, { 50, 400 } };
+    scene.Append(SHAPE_MULTILINE, square, 5);
+    scene.Append(SHAPE_RECT, square, 2);
+    ++version;
+    CHECK(show());
+    CHECK_EQ(renderer.SceneCopies(), 1);
+    CHECK_EQ(renderer.SceneShares(), 2);
+
+    // undoing a drawn shape stays past the shared copy
+    scene.Truncate((uint32_t)scene.ShapeCount() - 1);
+    ++version;
+    CHECK(show());
+    CHECK_EQ(renderer.SceneShares(), 3);
+
+    // pans alone copy nothing
+    camera.panX += 37;
+    camera.panY -= 12;
+    CHECK(show());
+    CHECK_EQ(renderer.SceneCopies(), 1);
+    CHECK_EQ(renderer.SceneShares(), 3);
+
+    // deleting shared shapes needs a new copy
+    const uint32_t ids[3] = { 2, 40, 41 };
+    SceneStore removed;
+    scene.Extract(ids, 3, removed);
+    ++version;
+    CHECK(show());
+    CHECK_EQ(renderer.SceneCopies(), 2);
+
+    // appended shapes dropped together with shared ones
+    scene.Append(SHAPE_LINE, line, 2);
+    ++version;
+    CHECK(show());
+    CHECK_EQ(renderer.SceneShares(), 4);
+    scene.Truncate((uint32_t)scene.ShapeCount() - 2);
+    ++version;
+    CHECK(show());
+    CHECK_EQ(renderer.SceneCopies(), 3);
+
+    // appended shapes outgrowing the shared copy fold into a new one
+    SceneStore more;
+    TestScene(92, more);
+    more.CopyTail(0, scene);
+    ++version;
+    CHECK(show());
+    CHECK_EQ(renderer.SceneCopies(), 4);
+
+    renderer.Stop();
+}
+
+TEST(render_thread, history_swaps_copy_the_whole_scene)
+{
+    // open file, undo and redo swap the store for another scene; none of
+    // them may reuse the copy made from the scene before
+    SceneStore scene;
+    TestScene(95, scene);
+    SceneStore opened;
+    TestScene(96, opened);
+    opened.Truncate((uint32_t)std::min(scene.ShapeCount(), opened.ShapeCount()) - 10);
+    SceneHistory history;
+    ThreadPool pool(2);
+    RenderThread renderer;
+    renderer.Start(pool, nullptr);
+
+    Camera camera;
+    camera.zoom = 0.6;
+    uint64_t version = 1;
+    PixelBuffer reference;
+    auto show = [&]()
+        {
+            const LayerKey key = MakeKey(version++, camera, 400, 300);
+            const uint64_t serial = renderer.Publish(scene, key, camera, PEN, BACKGROUND);
+            if (!WaitForFrame(renderer, serial))
+                return false;
+            FullRender(scene, key, camera, reference);
+            return renderer.Frame().serial == serial && SamePixels(renderer.Frame().pixels, reference);
+        };
+
+    CHECK(show());
+    history.ReplaceScene(scene, std::move(opened));
+    CHECK(show());
+    REQUIRE(history.Undo(scene));
+    CHECK(show());
+    REQUIRE(history.Redo(scene));
+    CHECK(show());
+    CHECK_EQ(renderer.SceneCopies(), 4);
+    CHECK_EQ(renderer.SceneShares(), 0);
+
+    // drawing after the swap shares the new copy again
+    const WorldPoint line[2] = { { 100, 100 }, { 500, 300 } };
+    scene.Append(SHAPE_LINE, line, 2);
+    CHECK(show());
+    CHECK_EQ(renderer.SceneShares(), 1);
+
+    renderer.Stop();
+}
+
+TEST(render_thread, publish_and_take_under_load)
+{
+    // the UI side publishes flat out (pans, resizes and edits) and takes
+    // frames as they come, waiting for one now and then like a paint would;
+    // run under -DDRAWER_SANITIZE=thread to check the snapshot and frame
+    // handoff for races
+    SceneStore scene;
+    TestScene(93, scene);
+    ThreadPool pool(2);
+    RenderThread renderer;
+    std::atomic<uint64_t> notified{ 0 };
+    renderer.Start(pool, [&]() { notified.fetch_add(1); });
+
+    SceneRandom rng(94);
+    Camera camera;
+    camera.zoom = 1.25;
+    int32_t width = 320, height = 240;
+    uint64_t version = 1;
+    std::vector<LayerKey> keys(1);              // by serial
+    uint64_t last = 0;
+    bool ordered = true, matching = true;
+
+    auto check = [&]()
+        {
+            const RenderedFrame& frame = renderer.Frame();
+            ordered = ordered && frame.serial >= last && frame.serial <= renderer.LastPublished();
+            matching = matching && frame.key == keys[frame.serial] &&
+                frame.pixels.Width() == frame.key.width && frame.pixels.Height() == frame.key.height &&
+                frame.camera.panX == frame.key.panX && frame.camera.panY == frame.key.panY;
+            last = frame.serial;
+        };
+
+    const int PUBLISHES = 1500;
+    for (int i = 0; i < PUBLISHES; ++i)
+    {
+        camera.panX += rng.Range(-24, 24);
+        camera.panY += rng.Range(-24, 24);
+        if (i % 97 == 0)
+        {
+            width = rng.Range(200, 400);
+            height = rng.Range(150, 300);
+        }
+        if (i % 23 == 0)
+        {
+            // mostly drawing, now and then an undo or a delete
+            const int edit = rng.Range(0, 9);
+            if (edit < 7)
+            {
+                const WorldPoint line[2] = { { rng.Range(0, 2000), rng.Range(0, 2000) }, { rng.Range(0, 2000), rng.Range(0, 2000) } };
+                scene.Append(SHAPE_LINE, line, 2);
+            }
+            else if (edit < 9)
+            {
+                scene.Truncate((uint32_t)scene.ShapeCount() - 1);
+            }
+            else
+            {
+                const uint32_t id = (uint32_t)rng.Range(0, (int32_t)scene.ShapeCount() - 1);
+                SceneStore removed;
+                scene.Extract(&id, 1, removed);
+            }
+            ++version;
+        }
+
+        const LayerKey key = MakeKey(version, camera, width, height);
+        keys.push_back(key);
+        const uint64_t serial = renderer.Publish(scene, key, camera, PEN, BACKGROUND);
+        REQUIRE(serial == keys.size() - 1);
+        if (i % 5 == 0)
+        {
+            REQUIRE(WaitForFrame(renderer, serial));
+            check();
+        }
+        else if (renderer.TakeFrame())
+        {
+            check();
+        }
+    }
+
+    REQUIRE(WaitForFrame(renderer, renderer.LastPublished()));
+    check();
+    CHECK(ordered);
+    CHECK(matching);
+
+    // the newest frame shows the final scene and view
+    PixelBuffer reference;
+    FullRender(scene, keys.back(), camera, reference);
+    CHECK(SamePixels(renderer.Frame().pixels, reference));
+
+    // every snapshot was either rendered or skipped for a newer one
+    CHECK_EQ(renderer.FramesRendered() + renderer.SnapshotsSkipped(), (uint64_t)PUBLISHES);
+    CHECK(renderer.FramesScrolled() > 0);
+    CHECK(renderer.SceneShares() > renderer.SceneCopies());
+
+    renderer.Stop();
+    CHECK_EQ(notified.load(), renderer.FramesRendered());
+}
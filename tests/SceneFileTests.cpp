@@ -0,0 +1,197 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "SceneFile.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+
+namespace {
+
+    std::filesystem::path TempPath(const char* name)
+    {
+        return std::filesystem::temp_directory_path() / name;
+    }
+
+    bool SameScene(const SceneStore& a, const SceneStore& b)
+    {
+        if (a.ShapeCount() != b.ShapeCount() || a.VertexCount() != b.VertexCount())
+            return false;
+        for (uint32_t id = 0; id < (uint32_t)a.ShapeCount(); ++id)
+        {
+            if (a.Kind(id) != b.Kind(id) || a.Offset(id) != b.Offset(id) || a.Count(id) != b.Count(id))
+                return false;
+        }
+        const size_t bytes = a.VertexCount() * sizeof(int32_t);
+        return bytes == 0 || (std::memcmp(a.Xs(), b.Xs(), bytes) == 0 && std::memcmp(a.Ys(), b.Ys(), bytes) == 0);
+    }
+
+    std::vector<char> ReadFile(const std::filesystem::path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void WriteFile(const std::filesystem::path& path, const std::vector<char>& bytes)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), (std::streamsize)bytes.size());
+    }
+
+    // A saved file with one table entry overwritten
+    bool OpensWithTableEntry(const std::vector<char>& saved, bool offsetsTable, uint32_t id, uint32_t value)
+    {
+        SceneFileHeader header;
+        std::memcpy(&header, saved.data(), sizeof(header));
+        std::vector<char> bytes = saved;
+        const uint64_t table = offsetsTable ? header.offsetsOffset : header.countsOffset;
+        std::memcpy(bytes.data() + table + (size_t)id * sizeof(uint32_t), &value, sizeof(value));
+
+        const std::filesystem::path path = TempPath("drawer_tests_scene_bad.bin");
+        WriteFile(path, bytes);
+        SceneFileView view;
+        const bool opened = view.Open(path);
+        view.Close();
+        std::filesystem::remove(path);
+        return opened;
+    }
+
+} // namespace
+
+TEST(scene_file, save_and_open_round_trip)
+{
+    for (uint64_t seed : { 1, 2, 3 })
+    {
+        SceneSpec spec;
+        spec.targetVertices = 20000 * (size_t)seed;
+        spec.seed = seed;
+        SceneStore scene;
+        GenerateScene(spec, scene);
+
+        const std::filesystem::path path = TempPath("drawer_tests_scene.bin");
+        REQUIRE(SaveSceneFile(path, scene));
+
+        SceneFileView view;
+        REQUIRE(view.Open(path));
+        CHECK_EQ(view.ShapeCount(), scene.ShapeCount());
+        CHECK_EQ(view.VertexCount(), scene.VertexCount());
+
+        // sections are read in place from the mapping, aligned
+        CHECK((uintptr_t)view.Xs() % SCENE_FILE_ALIGNMENT == 0);
+        CHECK((uintptr_t)view.Offsets() % SCENE_FILE_ALIGNMENT == 0);
+        CHECK(view.Kind(5) == scene.Kind(5) && view.Count(5) == scene.Count(5) && view.Offset(5) == scene.Offset(5));
+
+        SceneStore loaded;
+        view.CopyTo(loaded);
+        CHECK(SameScene(scene, loaded));
+
+        view.Close();
+        CHECK(!view.IsOpen());
+        std::filesystem::remove(path);
+    }
+}
+
+TEST(scene_file, empty_scene_round_trip)
+{
+    const std::filesystem::path path = TempPath("drawer_tests_scene_empty.bin");
+    SceneStore empty;
+    REQUIRE(SaveSceneFile(path, empty));
+
+    SceneFileView view;
+    REQUIRE(view.Open(path));
+    CHECK_EQ(view.ShapeCount(), 0);
+    SceneStore loaded;
+    const WorldPoint pts[] = { { 1, 2 }, { 3, 4 } };
+    loaded.Append(SHAPE_LINE, pts, 2);
+    view.CopyTo(loaded);
+    CHECK_EQ(loaded.ShapeCount(), 0);
+    CHECK_EQ(loaded.VertexCount(), 0);
+    std::filesystem::remove(path);
+}
+
+TEST(scene_file, rejects_slices_that_do_not_tile_the_pool)
+{
+    SceneStore scene;
+    const WorldPoint line[] = { { 0, 0 }, { 10, 10 } };
+    const WorldPoint tri[] = { { 0, 0 }, { 10, 0 }, { 5, 8 }, { 0, 0 } };
+    scene.Append(SHAPE_LINE, line, 2);          // vertices [0, 2)
+    scene.Append(SHAPE_MULTILINE, tri, 4);      // [2, 6)
+    scene.Append(SHAPE_RECT, line, 2);          // [6, 8)
+
+    const std::filesystem::path path = TempPath("drawer_tests_scene_tiles.bin");
+    REQUIRE(SaveSceneFile(path, scene));
+    const std::vector<char> saved = ReadFile(path);
+    std::filesystem::remove(path);
+    REQUIRE(saved.size() >= sizeof(SceneFileHeader));
+
+    // unchanged values still open
+    CHECK(OpensWithTableEntry(saved, true, 1, 2));
+    CHECK(OpensWithTableEntry(saved, false, 1, 4));
+
+    CHECK(!OpensWithTableEntry(saved, true, 0, 1));         // first shape not at 0
+    CHECK(!OpensWithTableEntry(saved, true, 1, 3));         // gap after shape 0
+    CHECK(!OpensWithTableEntry(saved, true, 1, 1));         // overlaps shape 0
+    CHECK(!OpensWithTableEntry(saved, true, 2, 2));         // aliases shape 1, in bounds
+    CHECK(!OpensWithTableEntry(saved, false, 2, 1));        // counts add up to less than the pool
+    CHECK(!OpensWithTableEntry(saved, false, 1, 3));        // next shape does not follow
+    CHECK(!OpensWithTableEntry(saved, false, 2, 0xFFFFFFFFu));  // past the pool
+}
+
+TEST(scene_file, rejects_damaged_files)
+{
+    SceneSpec spec;
+    spec.targetVertices = 2000;
+    SceneStore scene;
+    GenerateScene(spec, scene);
+
+    const std::filesystem::path path = TempPath("drawer_tests_scene_damaged.bin");
+    REQUIRE(SaveSceneFile(path, scene));
+    const std::vector<char> saved = ReadFile(path);
+    SceneFileHeader header;
+    std::memcpy(&header, saved.data(), sizeof(header));
+
+    SceneFileView view;
+    auto opens = [&](const std::vector<char>& bytes)
+        {
+            WriteFile(path, bytes);
+            const bool opened = view.Open(path);
+            view.Close();
+            return opened;
+        };
+
+    CHECK(opens(saved));
+
+    std::vector<char> bytes = saved;
+    bytes[0] = 'X';
+    CHECK(!opens(bytes));                                   // magic
+
+    bytes = saved;
+    bytes.resize(saved.size() - 4);
+    CHECK(!opens(bytes));                                   // truncated pool
+
+    bytes = saved;
+    bytes.resize(sizeof(SceneFileHeader) - 1);
+    CHECK(!opens(bytes));                                   // truncated header
+
+    bytes = saved;
+    bytes[(size_t)header.kindsOffset] = (char)(SHAPE_POLIGON + 1);
+    CHECK(!opens(bytes));                                   // unknown kind
+
+    bytes = saved;
+    SceneFileHeader moved = header;
+    moved.xsOffset += 4;
+    std::memcpy(bytes.data(), &moved, sizeof(moved));
+    CHECK(!opens(bytes));                                   // misaligned section
+
+    bytes = saved;
+    SceneFileHeader grown = header;
+    grown.vertexCount = (uint64_t)1 << 62;
+    std::memcpy(bytes.data(), &grown, sizeof(grown));
+    CHECK(!opens(bytes));                                   // sizes that overflow
+
+    std::filesystem::remove(path);
+    CHECK(!view.Open(path));                                // missing
+    CHECK(!view.IsOpen());
+}
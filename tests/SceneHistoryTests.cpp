@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "SceneGenerator.h"
+#include "SceneHistory.h"
+#include "TestCheck.h"
+
+namespace {
+
+    bool SameScene(const SceneStore& a, const SceneStore& b)
+    {
+        if (a.ShapeCount() != b.ShapeCount() || a.VertexCount() != b.VertexCount())
+            return false;
+        for (uint32_t id = 0; id < (uint32_t)a.ShapeCount(); ++id)
+        {
+            if (a.Kind(id) != b.Kind(id) || a.Offset(id) != b.Offset(id) || a.Count(id) != b.Count(id))
+                return false;
+        }
+        const size_t bytes = a.VertexCount() * sizeof(int32_t);
+        return bytes == 0 || (std::memcmp(a.Xs(), b.Xs(), bytes) == 0 && std::memcmp(a.Ys(), b.Ys(), bytes) == 0);
+    }
+
+    // Roughly one shape in every, ascending
+    std::vector<uint32_t> RandomIds(SceneRandom& rng, size_t shapes, int32_t every)
+    {
+        std::vector<uint32_t> ids;
+        for (uint32_t id = 0; id < (uint32_t)shapes; ++id)
+        {
+            if (rng.Range(1, every) == 1)
+                ids.push_back(id);
+        }
+        return ids;
+    }
+
+    void AppendRandomShape(SceneRandom& rng, SceneStore& scene, uint32_t vertices)
+    {
+        std::vector<WorldPoint> pts(vertices);
+        WorldPoint p{ rng.Range(0, 100000), rng.Range(0, 100000) };
+        for (WorldPoint& v : pts)
+        {
+            v = p;
+            p.x += rng.Range(-20, 20);
+            p.y += rng.Range(-20, 20);
+        }
+        scene.Append(vertices > 2 ? SHAPE_MULTILINE : SHAPE_LINE, pts.data(), vertices);
+    }
+
+    // Bytes of the plain tables holding the given shapes
+    size_t RawBytes(const SceneStore& scene, const std::vector<uint32_t>& ids)
+    {
+        size_t bytes = 0;
+        for (uint32_t id : ids)
+            bytes += scene.Count(id) * 2 * sizeof(int32_t) + 2 * sizeof(uint32_t) + sizeof(ShapeKind);
+        return bytes;
+    }
+
+} // namespace
+
+TEST(scene_history, extract_and_merge_match_per_shape_edits)
+{
+    SceneRandom rng(31);
+    for (int32_t every : { 1, 2, 7, 50 })
+    {
+        SceneSpec spec;
+        spec.targetVertices = 30000;
+        spec.seed = (uint64_t)every;
+        SceneStore original;
+        GenerateScene(spec, original);
+        const std::vector<uint32_t> ids = RandomIds(rng, original.ShapeCount(), every);
+        REQUIRE(!ids.empty());
+
+        // what one Remove per shape (highest first) and one Insert per shape give
+        SceneStore expected = original;
+        SceneStore expectedHeld;
+        for (uint32_t id : ids)
+        {
+            const uint32_t offset = original.Offset(id);
+            expectedHeld.Insert((uint32_t)expectedHeld.ShapeCount(), original.Kind(id), original.Xs() + offset,
+                original.Ys() + offset, original.Count(id));
+        }
+        for (size_t i = ids.size(); i-- > 0; )
+            expected.Remove(ids[i]);
+
+        SceneStore scene = original;
+        SceneStore held;
+        scene.Extract(ids.data(), ids.size(), held);
+        CHECK(SameScene(scene, expected));
+        CHECK(SameScene(held, expectedHeld));
+
+        // every kept shape moves down by the number of extracted ones before it
+        bool mapped = true;
+        uint32_t next = 0;
+        for (uint32_t id = 0; id < (uint32_t)original.ShapeCount(); ++id)
+        {
+            const uint32_t to = SceneStore::IdAfterExtract(ids.data(), ids.size(), id);
+            if (std::binary_search(ids.begin(), ids.end(), id))
+            {
+                mapped = mapped && to == SceneStore::NO_ID;
+                continue;
+            }
+            mapped = mapped && to == next && SceneStore::IdAfterMerge(ids.data(), ids.size(), next) == id;
+            ++next;
+        }
+        CHECK(mapped);
+
+        scene.Merge(ids.data(), held);
+        CHECK(SameScene(scene, original));
+    }
+}
+
+TEST(scene_history, extract_and_merge_edge_cases)
+{
+    SceneRandom rng(32);
+    SceneStore original;
+    for (int i = 0; i < 10; ++i)
+        AppendRandomShape(rng, original, (uint32_t)rng.Range(2, 40));
+
+    // nothing, the first, the last and everything
+    const std::vector<std::vector<uint32_t>> sets = { {}, { 0 }, { 9 }, { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 } };
+    for (const std::vector<uint32_t>& ids : sets)
+    {
+        SceneStore scene = original;
+        SceneStore held;
+        scene.Extract(ids.data(), ids.size(), held);
+        CHECK_EQ(scene.ShapeCount(), original.ShapeCount() - ids.size());
+        CHECK_EQ(held.ShapeCount(), ids.size());
+        scene.Merge(ids.data(), held);
+        CHECK(SameScene(scene, original));
+    }
+
+    // extracted shapes are appended after what dst already holds
+    SceneStore scene = original;
+    SceneStore held;
+    AppendRandomShape(rng, held, 5);
+    const uint32_t ids[] = { 3, 4 };
+    scene.Extract(ids, 2, held);
+    REQUIRE(held.ShapeCount() == 3);
+    CHECK(held.Offset(1) == 5 && held.Count(1) == original.Count(3));
+    CHECK(held.Vertex(2, 0).x == original.Vertex(4, 0).x && held.Vertex(2, 0).y == original.Vertex(4, 0).y);
+}
+
+TEST(scene_history, undo_and_redo_restore_every_step)
+{
+    SceneRandom rng(33);
+    SceneSpec spec;
+    spec.targetVertices = 40000;
+    SceneStore scene;
+    GenerateScene(spec, scene);
+
+    SceneHistory history;
+    std::vector<SceneStore> states{ scene };
+    for (int step = 0; step < 120; ++step)
+    {
+        const int op = rng.Range(0, 9);
+        if (op < 5)
+        {
+            const uint32_t first = (uint32_t)scene.ShapeCount();
+            const uint32_t count = (uint32_t)rng.Range(1, 3);
+            for (uint32_t i = 0; i < count; ++i)
+                AppendRandomShape(rng, scene, (uint32_t)rng.Range(2, 300));
+            history.RecordAppend(first, count);
+        }
+        else if (op < 9)
+        {
+            // any order, duplicates allowed
+            std::vector<uint32_t> ids = RandomIds(rng, scene.ShapeCount(), 40);
+            if (!ids.empty())
+                ids.push_back(ids.front());
+            std::reverse(ids.begin(), ids.end());
+            history.RemoveShapes(scene, ids.data(), ids.size());
+            if (ids.empty())
+                continue;
+        }
+        else
+        {
+            SceneSpec other;
+            other.targetVertices = 5000;
+            other.seed = (uint64_t)step;
+            SceneStore next;
+            GenerateScene(other, next);
+            history.ReplaceScene(scene, std::move(next));
+        }
+        states.push_back(scene);
+    }
+    REQUIRE(history.Steps() == states.size() - 1);
+
+    // all the way back and forth twice: held shapes are packed and unpacked on the way
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        bool same = true;
+        for (size_t i = states.size() - 1; i-- > 0; )
+        {
+            HistoryChange peeked;
+            REQUIRE(history.PeekUndo(peeked));
+            HistoryChange change;
+            REQUIRE(history.Undo(scene, &change));
+            same = same && SameScene(scene, states[i]) && change.kind == peeked.kind && change.undo;
+        }
+        CHECK(same);
+        CHECK(!history.CanUndo());
+
+        for (size_t i = 1; i < states.size(); ++i)
+        {
+            REQUIRE(history.Redo(scene));
+            same = same && SameScene(scene, states[i]);
+        }
+        CHECK(same);
+        CHECK(!history.CanRedo());
+    }
+}
+
+TEST(scene_history, change_reports_the_moved_ids)
+{
+    SceneRandom rng(34);
+    SceneStore scene;
+    for (int i = 0; i < 20; ++i)
+        AppendRandomShape(rng, scene, 4);
+
+    SceneHistory history;
+    const uint32_t ids[] = { 12, 3, 7 };
+    history.RemoveShapes(scene, ids, 3);
+    AppendRandomShape(rng, scene, 6);
+    AppendRandomShape(rng, scene, 6);
+    history.RecordAppend(17, 2);
+
+    HistoryChange change;
+    REQUIRE(history.PeekUndo(change));
+    CHECK(change.kind == HISTORY_APPEND && change.undo && change.first == 17 && change.count == 2);
+    REQUIRE(history.Undo(scene, &change));
+    CHECK_EQ(scene.ShapeCount(), 17);
+
+    // ascending, the ids the shapes had (and have again)
+    REQUIRE(history.PeekUndo(change));
+    REQUIRE(change.kind == HISTORY_REMOVE && change.count == 3);
+    CHECK(change.ids[0] == 3 && change.ids[1] == 7 && change.ids[2] == 12);
+    REQUIRE(history.Undo(scene, &change));
+    CHECK(change.kind == HISTORY_REMOVE && change.undo && change.count == 3 && change.ids[2] == 12);
+    CHECK(!history.PeekUndo(change));
+
+    REQUIRE(history.PeekRedo(change));
+    CHECK(change.kind == HISTORY_REMOVE && !change.undo && change.ids[0] == 3);
+}
+
+TEST(scene_history, memory_grows_by_the_step_only)
+{
+    SceneRandom rng(35);
+    SceneSpec spec;
+    spec.targetVertices = 200000;
+    SceneStore scene;
+    GenerateScene(spec, scene);
+    SceneHistory history;
+
+    // an append holds no geometry: every step costs the same few bytes
+    size_t before = history.MemoryBytes();
+    size_t firstStep = 0;
+    bool constant = true;
+    for (int i = 0; i < 2000; ++i)
+    {
+        AppendRandomShape(rng, scene, 50);
+        history.RecordAppend((uint32_t)scene.ShapeCount() - 1, 1);
+        const size_t after = history.MemoryBytes();
+        if (i == 0)
+            firstStep = after - before;
+        constant = constant && after - before == firstStep;
+        before = after;
+    }
+    CHECK(constant);
+    CHECK(firstStep > 0 && firstStep <= 128);
+    CHECK_EQ(history.HeldBytes(), 0);
+
+    // a remove holds at most the plain tables of its shapes while hot, less
+    // once packed; the scene gives back what the history takes
+    size_t rawTotal = 0;
+    bool bounded = true;
+    for (int i = 0; i < 20; ++i)
+    {
+        const std::vector<uint32_t> ids = RandomIds(rng, scene.ShapeCount(), 30);
+        const size_t raw = RawBytes(scene, ids);
+        const size_t vertices = scene.VertexCount();
+        rawTotal += raw;
+
+        const size_t held = history.HeldBytes();
+        const size_t memory = history.MemoryBytes();
+        history.RemoveShapes(scene, ids.data(), ids.size());
+        bounded = bounded && history.HeldBytes() - held <= raw;
+        bounded = bounded && history.MemoryBytes() - memory <= raw + ids.size() * sizeof(uint32_t) + firstStep;
+        bounded = bounded && vertices - scene.VertexCount() == (raw - ids.size() * 9) / 8;
+    }
+    CHECK(bounded);
+    CHECK(history.HeldBytes() < rawTotal / 2);      // all but the last two are packed
+
+    // walking the history does not grow it (the first walk may pack the
+    // entry that was still hot after the last remove)
+    const size_t recorded = history.MemoryBytes();
+    size_t settled = 0;
+    for (int round = 0; round < 3; ++round)
+    {
+        while (history.Undo(scene))
+        {
+        }
+        while (history.Redo(scene))
+        {
+        }
+        if (round == 0)
+            settled = history.MemoryBytes();
+        CHECK(history.MemoryBytes() == settled && settled <= recorded);
+    }
+}
+
+TEST(scene_history, budget_evicts_the_oldest_steps)
+{
+    SceneRandom rng(36);
+    SceneSpec spec;
+    spec.targetVertices = 100000;
+    SceneStore scene;
+    GenerateScene(spec, scene);
+
+    const size_t budget = 64 * 1024;
+    SceneHistory history(50, budget);
+    bool within = true;
+    for (int i = 0; i < 200; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            const std::vector<uint32_t> ids = RandomIds(rng, scene.ShapeCount(), 200);
+            history.RemoveShapes(scene, ids.data(), ids.size());
+        }
+        else
+        {
+            AppendRandomShape(rng, scene, 10);
+            history.RecordAppend((uint32_t)scene.ShapeCount() - 1, 1);
+        }
+        within = within && history.Steps() <= 50 && (history.HeldBytes() <= budget || history.Steps() == 1);
+    }
+    CHECK(within);
+    CHECK_EQ(history.Steps(), 50);
+}
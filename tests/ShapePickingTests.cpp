@@ -0,0 +1,186 @@
+#include <cmath>
+#include <vector>
+
+#include "BoundsTree.h"
+#include "SceneGenerator.h"
+#include "ShapePicking.h"
+#include "TestCheck.h"
+
+namespace {
+
+    struct PickScene {
+        SceneStore scene;
+        BoundsTree tree;
+
+        uint32_t Add(ShapeKind kind, std::initializer_list<WorldPoint> pts)
+        {
+            std::vector<WorldPoint> v(pts);
+            const uint32_t id = scene.Append(kind, v.data(), (uint32_t)v.size());
+            tree.Insert(id, scene.Bounds(id));
+            return id;
+        }
+    };
+
+    bool Near(double a, double b)
+    {
+        return std::fabs(a - b) < 1e-9;
+    }
+
+    // Every shape measured, same tie rule as PickShape (the later id wins)
+    PickResult BruteForcePick(const SceneStore& scene, double px, double py, double tolerance)
+    {
+        PickResult result;
+        for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+        {
+            const double d = DistanceToShape(scene, id, px, py);
+            if (d <= tolerance && (!result.hit || d <= result.distance))
+            {
+                result.hit = true;
+                result.id = id;
+                result.distance = d;
+            }
+        }
+        return result;
+    }
+
+} // namespace
+
+TEST(shape_picking, distances_to_outlines)
+{
+    CHECK(Near(DistanceToSegment(5, 3, 0, 0, 10, 0), 3.0));
+    CHECK(Near(DistanceToSegment(13, 4, 0, 0, 10, 0), 5.0));        // past the end: to the end point
+    CHECK(Near(DistanceToSegment(3, 4, 0, 0, 0, 0), 5.0));          // degenerate segment
+
+    const WorldRect rect{ 0, 0, 100, 50 };
+    CHECK(Near(DistanceToRectOutline(50, 10, rect), 10.0));         // inside: nearest side
+    CHECK(Near(DistanceToRectOutline(50, -7, rect), 7.0));
+    CHECK(Near(DistanceToRectOutline(103, 54, rect), 5.0));         // off a corner
+    CHECK(Near(DistanceToRectOutline(100, 20, rect), 0.0));
+
+    CHECK(Near(DistanceToEllipse(0, 0, 0, 0, 10, 10), 10.0));       // centre of a circle
+    CHECK(Near(DistanceToEllipse(13, 0, 0, 0, 10, 4), 3.0));
+    CHECK(Near(DistanceToEllipse(0, -9, 0, 0, 10, 4), 5.0));
+    CHECK(Near(DistanceToEllipse(7, 1, 0, 0, 10, 0), 1.0));         // flat: a segment
+
+    // against the nearest of many points sampled on the outline
+    SceneRandom rng(51);
+    bool close = true;
+    for (int i = 0; i < 200; ++i)
+    {
+        const double rx = rng.Range(1, 300), ry = rng.Range(1, 300);
+        const double px = rng.Range(-400, 400), py = rng.Range(-400, 400);
+        double sampled = INFINITY;
+        const int SAMPLES = 20000;
+        for (int k = 0; k < SAMPLES; ++k)
+        {
+            const double t = 2.0 * std::acos(-1.0) * k / SAMPLES;
+            sampled = std::fmin(sampled, std::hypot(px - rx * std::cos(t), py - ry * std::sin(t)));
+        }
+        const double d = DistanceToEllipse(px, py, 0, 0, rx, ry);
+        close = close && d <= sampled + 1e-9 && sampled - d < 0.1;
+    }
+    CHECK(close);
+}
+
+TEST(shape_picking, hit_miss_and_tolerance)
+{
+    PickScene s;
+    const uint32_t line = s.Add(SHAPE_LINE, { { 0, 0 }, { 100, 0 } });
+    const uint32_t rect = s.Add(SHAPE_RECT, { { 200, 200 }, { 400, 300 } });
+
+    PickResult pick = PickShape(s.scene, s.tree, 50, 3, 5);
+    CHECK(pick.hit && pick.id == line && Near(pick.distance, 3.0));
+
+    CHECK(!PickShape(s.scene, s.tree, 50, 6, 5).hit);               // just outside
+    CHECK(PickShape(s.scene, s.tree, 50, 5, 5).hit);                // on the tolerance: inclusive
+    CHECK(PickShape(s.scene, s.tree, 104, 3, 5).hit);               // round the end point
+    CHECK(!PickShape(s.scene, s.tree, 104, 4, 5).hit);
+    CHECK(!PickShape(s.scene, s.tree, 1000, 1000, 5).hit);          // far from everything
+
+    // a rect is picked on its outline, not inside
+    CHECK(!PickShape(s.scene, s.tree, 300, 250, 5).hit);
+    pick = PickShape(s.scene, s.tree, 300, 296.5, 5);
+    CHECK(pick.hit && pick.id == rect && Near(pick.distance, 3.5));
+
+    // fractional cursors and tolerances (zoomed in views)
+    CHECK(PickShape(s.scene, s.tree, 50.5, 0.25, 0.3).hit);
+    CHECK(!PickShape(s.scene, s.tree, 50.5, 0.35, 0.3).hit);
+
+    // empty scene
+    PickScene empty;
+    CHECK(!PickShape(empty.scene, empty.tree, 0, 0, 100).hit);
+}
+
+TEST(shape_picking, z_order)
+{
+    PickScene s;
+    const uint32_t below = s.Add(SHAPE_RECT, { { 0, 0 }, { 100, 100 } });
+    const uint32_t above = s.Add(SHAPE_RECT, { { 0, 0 }, { 100, 100 } });
+    const uint32_t nearer = s.Add(SHAPE_LINE, { { -50, 52 }, { 0, 52 } });
+
+    // same distance: the shape drawn last (on top) wins
+    PickResult pick = PickShape(s.scene, s.tree, 50, 2, 5);
+    CHECK(pick.hit && pick.id == above);
+
+    // a nearer outline beats a later one
+    s.Add(SHAPE_LINE, { { -50, 57 }, { 0, 57 } });
+    pick = PickShape(s.scene, s.tree, -3, 53, 5);
+    CHECK(pick.hit && pick.id == nearer);
+
+    // without the top shape the one below is found
+    s.tree.Remap([&](uint32_t id) { return id == above ? BoundsTree::NO_ID : id; });
+    pick = PickShape(s.scene, s.tree, 50, 2, 5);
+    CHECK(pick.hit && pick.id == below);
+}
+
+TEST(shape_picking, matches_brute_force)
+{
+    SceneSpec spec;
+    spec.targetVertices = 40000;
+    spec.worldSize = 20000;
+    spec.seed = 52;
+    PickScene s;
+    GenerateScene(spec, s.scene);
+    for (uint32_t id = 0; id < (uint32_t)s.scene.ShapeCount(); ++id)
+        s.tree.Insert(id, s.scene.Bounds(id));
+
+    SceneRandom rng(53);
+    bool same = true;
+    int hits = 0;
+    for (int i = 0; i < 2000; ++i)
+    {
+        // half of the cursors next to a vertex, so most of those hit
+        double px = rng.Range(0, spec.worldSize), py = rng.Range(0, spec.worldSize);
+        if (i % 2 == 0)
+        {
+            const WorldPoint v = s.scene.Vertex((uint32_t)rng.Range(0, (int32_t)s.scene.ShapeCount() - 1), 0);
+            px = v.x + rng.Range(-600, 600) / 100.0;
+            py = v.y + rng.Range(-600, 600) / 100.0;
+        }
+        const double tolerance = rng.Range(1, 80) / 10.0;
+
+        const PickResult pick = PickShape(s.scene, s.tree, px, py, tolerance);
+        const PickResult expected = BruteForcePick(s.scene, px, py, tolerance);
+        same = same && pick.hit == expected.hit && (!pick.hit || (pick.id == expected.id && pick.distance == expected.distance));
+        hits += pick.hit ? 1 : 0;
+    }
+    CHECK(same);
+    CHECK(hits > 500);
+}
+
+TEST(shape_picking, select_in_rect_takes_whole_shapes)
+{
+    PickScene s;
+    const uint32_t inside = s.Add(SHAPE_RECT, { { 10, 10 }, { 20, 20 } });
+    s.Add(SHAPE_LINE, { { 15, 15 }, { 150, 15 } });                 // crosses the box edge
+    const uint32_t touching = s.Add(SHAPE_ELLIPSE, { { 0, 0 }, { 100, 100 } });
+    s.Add(SHAPE_RECT, { { 500, 500 }, { 510, 510 } });
+    const uint32_t poly = s.Add(SHAPE_MULTILINE, { { 40, 40 }, { 60, 40 }, { 50, 60 }, { 40, 40 } });
+
+    std::vector<uint32_t> ids{ 99 };
+    SelectInRect(s.scene, s.tree, WorldRect{ 0, 0, 100, 100 }, ids);
+    CHECK(ids == std::vector<uint32_t>({ inside, touching, poly }));
+
+    SelectInRect(s.scene, s.tree, WorldRect{ 200, 200, 300, 300 }, ids);
+    CHECK(ids.empty());
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <vector>
+
+#include "BoundsTree.h"
+#include "SceneGenerator.h"
+#include "SnapFeatures.h"
+#include "TestCheck.h"
+
+namespace {
+
+    std::vector<WorldPoint> Sorted(std::vector<WorldPoint> pts)
+    {
+        std::sort(pts.begin(), pts.end(), [](const WorldPoint& a, const WorldPoint& b)
+            {
+                return a.x != b.x ? a.x < b.x : a.y < b.y;
+            });
+        return pts;
+    }
+
+    bool SamePoints(const std::vector<WorldPoint>& a, const std::vector<WorldPoint>& b)
+    {
+        const std::vector<WorldPoint> sa = Sorted(a), sb = Sorted(b);
+        if (sa.size() != sb.size())
+            return false;
+        for (size_t i = 0; i < sa.size(); ++i)
+        {
+            if (sa[i].x != sb[i].x || sa[i].y != sb[i].y)
+                return false;
+        }
+        return true;
+    }
+
+    // The same features as recomputing everything from the scene
+    bool MatchesRebuild(const SnapFeatureCache& cache, const SceneStore& scene)
+    {
+        SnapFeatureCache fresh;
+        fresh.Rebuild(scene);
+        return SamePoints(cache.Midpoints(), fresh.Midpoints()) && SamePoints(cache.Crossings(), fresh.Crossings());
+    }
+
+    // Shapes crowded into a small world so most of them cross something
+    void CrowdedScene(uint64_t seed, SceneStore& scene)
+    {
+        SceneSpec spec;
+        spec.targetVertices = 20000;
+        spec.seed = seed;
+        spec.worldSize = 20000;
+        spec.maxMultilineVertices = 48;
+        GenerateScene(spec, scene);
+    }
+
+    // Every pair of edges tested, no sweep
+    std::vector<WorldPoint> PairwiseCrossings(const SceneStore& scene)
+    {
+        std::vector<SnapSegment> segments;
+        for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+            AppendShapeSegments(scene, id, true, segments);
+
+        std::vector<WorldPoint> crossings;
+        for (size_t i = 0; i < segments.size(); ++i)
+        {
+            for (size_t j = i + 1; j < segments.size(); ++j)
+            {
+                WorldPoint p;
+                if (SegmentCrossing(segments[i], segments[j], p))
+                    crossings.push_back(p);
+            }
+        }
+        return crossings;
+    }
+
+} // namespace
+
+TEST(snap_features, crossings_match_pairwise_tests)
+{
+    for (uint64_t seed : { 4, 5, 6 })
+    {
+        SceneSpec spec;
+        spec.targetVertices = 3000;
+        spec.seed = seed;
+        spec.worldSize = 3000;
+        spec.maxShapeSize = 800;
+        spec.maxMultilineVertices = 24;
+        SceneStore scene;
+        GenerateScene(spec, scene);
+
+        // shared end points and collinear runs as well: axis aligned rects on a coarse grid
+        SceneRandom rng(seed);
+        for (int i = 0; i < 40; ++i)
+        {
+            const WorldPoint a{ rng.Range(0, 10) * 100, rng.Range(0, 10) * 100 };
+            const WorldPoint rect[2] = { a, WorldPoint{ a.x + rng.Range(1, 5) * 100, a.y + rng.Range(1, 5) * 100 } };
+            scene.Append(SHAPE_RECT, rect, 2);
+        }
+
+        SnapFeatureCache cache;
+        cache.Rebuild(scene);
+        const std::vector<WorldPoint> expected = PairwiseCrossings(scene);
+        CHECK(expected.size() > 100);
+        CHECK(SamePoints(cache.Crossings(), expected));
+    }
+}
+
+TEST(snap_features, crossing_cases)
+{
+    WorldPoint p{};
+    CHECK(SegmentCrossing(SnapSegment{ 0, 0, 10, 10, true }, SnapSegment{ 0, 10, 10, 0, false }, p));
+    CHECK(p.x == 5 && p.y == 5);
+    CHECK(!SegmentCrossing(SnapSegment{ 0, 0, 10, 0, true }, SnapSegment{ 10, 0, 10, 10, false }, p));     // shared end
+    CHECK(!SegmentCrossing(SnapSegment{ 0, 0, 10, 0, true }, SnapSegment{ 5, 0, 15, 0, false }, p));      // collinear overlap
+    CHECK(!SegmentCrossing(SnapSegment{ 0, 0, 10, 0, true }, SnapSegment{ 5, 0, 5, 10, false }, p));      // T: touches only
+    CHECK(!SegmentCrossing(SnapSegment{ 0, 0, 10, 0, true }, SnapSegment{ 0, 1, 10, 1, false }, p));      // parallel
+
+    // rounded to the nearest world unit
+    CHECK(SegmentCrossing(SnapSegment{ 0, 0, 3, 1, true }, SnapSegment{ 0, 1, 3, 0, false }, p));
+    CHECK(p.x == 2 && p.y == 1);
+
+    // spans up to the documented limit (below 2^31) stay exact
+    const int32_t big = (1 << 30) - 1;
+    CHECK(SegmentCrossing(SnapSegment{ -big, -big, big, big, true }, SnapSegment{ -big, big, big, -big, false }, p));
+    CHECK(p.x == 0 && p.y == 0);
+}
+
+TEST(snap_features, incremental_adds_match_rebuild)
+{
+    SceneStore source;
+    CrowdedScene(41, source);
+
+    // shapes committed in batches of growing size, as the app does
+    SceneStore scene;
+    BoundsTree tree;
+    SnapFeatureCache cache;
+    uint32_t next = 0, batch = 1;
+    while (next < (uint32_t)source.ShapeCount())
+    {
+        const uint32_t first = (uint32_t)scene.ShapeCount();
+        for (uint32_t i = 0; i < batch && next < (uint32_t)source.ShapeCount(); ++i, ++next)
+        {
+            const uint32_t offset = source.Offset(next);
+            const uint32_t id = (uint32_t)scene.ShapeCount();
+            scene.Insert(id, source.Kind(next), source.Xs() + offset, source.Ys() + offset, source.Count(next));
+            tree.Insert(id, scene.Bounds(id));
+        }
+        cache.AddShapes(scene, tree, first);
+        batch = batch < 64 ? batch * 2 : 1;
+    }
+
+    CHECK(!cache.Crossings().empty());
+    CHECK(MatchesRebuild(cache, scene));
+}
+
+TEST(snap_features, remove_and_restore_match_rebuild)
+{
+    SceneRandom rng(42);
+    for (uint64_t seed : { 1, 2, 3 })
+    {
+        SceneStore original;
+        CrowdedScene(seed, original);
+        SceneStore scene = original;
+
+        BoundsTree tree;
+        for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+            tree.Insert(id, scene.Bounds(id));
+        SnapFeatureCache cache;
+        cache.Rebuild(scene);
+        const size_t featuresBefore = cache.Midpoints().size() + cache.Crossings().size();
+
+        std::vector<uint32_t> ids;
+        for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+        {
+            if (rng.Range(0, 9) == 0)
+                ids.push_back(id);
+        }
+        REQUIRE(!ids.empty());
+
+        // the removed points are exactly what the cache lost
+        std::vector<WorldPoint> removed;
+        cache.RemoveShapes(scene, tree, ids.data(), ids.size(), removed);
+        CHECK_EQ(removed.size(), featuresBefore - cache.Midpoints().size() - cache.Crossings().size());
+
+        tree.Remap([&](uint32_t id)
+            {
+                const uint32_t to = SceneStore::IdAfterExtract(ids.data(), ids.size(), id);
+                return to == SceneStore::NO_ID ? BoundsTree::NO_ID : to;
+            });
+        SceneStore held;
+        scene.Extract(ids.data(), ids.size(), held);
+        CHECK(MatchesRebuild(cache, scene));
+
+        // put back at the same ids
+        scene.Merge(ids.data(), held);
+        tree.Remap([&](uint32_t id) { return SceneStore::IdAfterMerge(ids.data(), ids.size(), id); });
+        for (uint32_t id : ids)
+            tree.Insert(id, scene.Bounds(id));
+        cache.AddShapes(scene, tree, ids.data(), ids.size());
+        CHECK(MatchesRebuild(cache, scene));
+        CHECK_EQ(cache.Midpoints().size() + cache.Crossings().size(), featuresBefore);
+    }
+}
+
+TEST(snap_features, crossing_does_not_depend_on_the_order)
+{
+    SceneRandom rng(43);
+    bool symmetric = true;
+    int crossed = 0;
+    for (int i = 0; i < 20000; ++i)
+    {
+        const SnapSegment s{ rng.Range(-1000, 1000), rng.Range(-1000, 1000), rng.Range(-1000, 1000), rng.Range(-1000, 1000), true };
+        const SnapSegment t{ rng.Range(-1000, 1000), rng.Range(-1000, 1000), rng.Range(-1000, 1000), rng.Range(-1000, 1000), false };
+        WorldPoint st{}, ts{};
+        const bool a = SegmentCrossing(s, t, st);
+        const bool b = SegmentCrossing(t, s, ts);
+        symmetric = symmetric && a == b && (!a || (st.x == ts.x && st.y == ts.y));
+        crossed += a ? 1 : 0;
+    }
+    CHECK(symmetric);
+    CHECK(crossed > 1000);
+}
@@ -0,0 +1,132 @@
+#include <vector>
+
+#include "SceneGenerator.h"
+#include "SnapGrid.h"
+#include "TestCheck.h"
+
+namespace {
+
+    // The search the grid replaces: every point, nearest within radius
+    bool LinearNearest(const std::vector<WorldPoint>& pts, double wx, double wy, double radius, double& bestDist2)
+    {
+        bool found = false;
+        bestDist2 = radius * radius;
+        for (const WorldPoint& p : pts)
+        {
+            const double dx = p.x - wx;
+            const double dy = p.y - wy;
+            const double d2 = dx * dx + dy * dy;
+            if (d2 <= bestDist2)
+            {
+                bestDist2 = d2;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // Random queries against the grid and the linear scan. Ties may pick a
+    // different point, so the distances are compared.
+    void CompareWithScan(const SnapGrid& grid, const std::vector<WorldPoint>& pts, SceneRandom& rng, int32_t lo, int32_t hi, double radius)
+    {
+        for (int q = 0; q < 2000; ++q)
+        {
+            const double wx = rng.Range(lo, hi) + rng.Range(0, 99) / 100.0;
+            const double wy = rng.Range(lo, hi) + rng.Range(0, 99) / 100.0;
+
+            double scanDist2 = 0.0;
+            const bool scanFound = LinearNearest(pts, wx, wy, radius, scanDist2);
+
+            WorldPoint hit{};
+            const bool gridFound = grid.FindNearest(wx, wy, radius, hit);
+            CHECK(gridFound == scanFound);
+            if (gridFound && scanFound)
+            {
+                const double dx = hit.x - wx;
+                const double dy = hit.y - wy;
+                CHECK(dx * dx + dy * dy == scanDist2);
+            }
+        }
+    }
+
+} // namespace
+
+TEST(snap_grid, matches_linear_scan)
+{
+    SceneRandom rng(11);
+    for (int32_t cellSize : { 1, 7, 64, 1000 })
+    {
+        SnapGrid grid(cellSize);
+        std::vector<WorldPoint> pts;
+        for (int i = 0; i < 3000; ++i)
+        {
+            // negative coordinates exercise the floor division of cells
+            const WorldPoint p{ rng.Range(-2000, 2000), rng.Range(-2000, 2000) };
+            pts.push_back(p);
+            grid.Insert(p);
+        }
+        CHECK_EQ(grid.Size(), pts.size());
+
+        CompareWithScan(grid, pts, rng, -2100, 2100, 10.0);
+        CompareWithScan(grid, pts, rng, -2100, 2100, 75.5);     // radius over several cells
+    }
+}
+
+TEST(snap_grid, remove_keeps_matching_scan)
+{
+    SceneRandom rng(12);
+    SnapGrid grid(32);
+    std::vector<WorldPoint> pts;
+    for (int i = 0; i < 4000; ++i)
+    {
+        const WorldPoint p{ rng.Range(-500, 500), rng.Range(-500, 500) };
+        pts.push_back(p);
+        grid.Insert(p);
+    }
+
+    // duplicates stay until their last copy is removed
+    while (pts.size() > 1000)
+    {
+        const size_t i = (size_t)rng.Range(0, (int32_t)pts.size() - 1);
+        CHECK(grid.Remove(pts[i]));
+        pts[i] = pts.back();
+        pts.pop_back();
+    }
+    CHECK_EQ(grid.Size(), pts.size());
+    CHECK(!grid.Remove(WorldPoint{ 100000, 100000 }));
+
+    CompareWithScan(grid, pts, rng, -520, 520, 12.0);
+}
+
+TEST(snap_grid, rect_visits_exactly_the_points_inside)
+{
+    SceneRandom rng(13);
+    SnapGrid grid(16);
+    std::vector<WorldPoint> pts;
+    for (int i = 0; i < 2000; ++i)
+    {
+        const WorldPoint p{ rng.Range(-300, 300), rng.Range(-300, 300) };
+        pts.push_back(p);
+        grid.Insert(p);
+    }
+
+    for (int q = 0; q < 200; ++q)
+    {
+        const int32_t x0 = rng.Range(-320, 320), y0 = rng.Range(-320, 320);
+        const int32_t x1 = x0 + rng.Range(0, 100), y1 = y0 + rng.Range(0, 100);
+
+        size_t expected = 0;
+        for (const WorldPoint& p : pts)
+            expected += p.x >= x0 && p.x <= x1 && p.y >= y0 && p.y <= y1;
+
+        size_t visited = 0;
+        bool allInside = true;
+        grid.ForEachInRect(x0, y0, x1, y1, [&](const WorldPoint& p)
+            {
+                ++visited;
+                allInside = allInside && p.x >= x0 && p.x <= x1 && p.y >= y0 && p.y <= y1;
+            });
+        CHECK(allInside);
+        CHECK_EQ(visited, expected);
+    }
+}
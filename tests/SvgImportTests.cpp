@@ -0,0 +1,249 @@
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "SceneGenerator.h"
+#include "SvgImport.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+
+namespace {
+
+    std::filesystem::path Fixture(const char* name)
+    {
+        return std::filesystem::path(DRAWER_TEST_FIXTURES) / name;
+    }
+
+    bool ShapeIs(const SceneStore& scene, uint32_t id, ShapeKind kind, std::initializer_list<WorldPoint> pts)
+    {
+        if (id >= scene.ShapeCount() || scene.Kind(id) != kind || scene.Count(id) != pts.size())
+            return false;
+        uint32_t i = 0;
+        for (const WorldPoint& p : pts)
+        {
+            const WorldPoint v = scene.Vertex(id, i++);
+            if (v.x != p.x || v.y != p.y)
+                return false;
+        }
+        return true;
+    }
+
+    void AppendPoint(std::string& out, const char* cmd, int32_t x, int32_t y)
+    {
+        char text[48];
+        std::snprintf(text, sizeof(text), "%s%d %d ", cmd, x, y);
+        out += text;
+    }
+
+    // Writes the scene as SVG; shapes come back as the importer maps them
+    // (poligons become multilines). onePath puts every multiline in a single
+    // path, one absolute moveto per subpath and relative line-tos inside.
+    // padding adds a comment of that many bytes up front so elements
+    // straddle the reader's chunks.
+    void WriteSvg(const std::filesystem::path& path, const SceneStore& scene, bool onePath, size_t padding)
+    {
+        std::string svg = "<svg xmlns=\"http://www.w3.org/2000/svg\">\n<!-- ";
+        svg.append(padding, 'x');
+        svg += " -->\n";
+
+        std::string d;
+        for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+        {
+            const WorldPoint a = scene.Vertex(id, 0);
+            const WorldPoint b = scene.Vertex(id, 1);
+            char text[160];
+            switch (scene.Kind(id))
+            {
+            case SHAPE_LINE:
+                std::snprintf(text, sizeof(text), "<line x1=\"%d\" y1=\"%d\" x2=\"%d\" y2=\"%d\"/>\n", a.x, a.y, b.x, b.y);
+                svg += text;
+                break;
+            case SHAPE_RECT:
+                std::snprintf(text, sizeof(text), "<rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\"/>\n", a.x, a.y, b.x - a.x, b.y - a.y);
+                svg += text;
+                break;
+            case SHAPE_ELLIPSE:
+                std::snprintf(text, sizeof(text), "<ellipse cx=\"%.1f\" cy=\"%.1f\" rx=\"%.1f\" ry=\"%.1f\"/>\n",
+                    (a.x + b.x) / 2.0, (a.y + b.y) / 2.0, (b.x - a.x) / 2.0, (b.y - a.y) / 2.0);
+                svg += text;
+                break;
+            case SHAPE_MULTILINE:
+            case SHAPE_POLIGON: {
+                std::string& out = onePath ? d : svg;
+                if (!onePath)
+                    out += "<path d=\"";
+                AppendPoint(out, "M", a.x, a.y);
+                for (uint32_t i = 1; i < scene.Count(id); ++i)
+                {
+                    const WorldPoint p = scene.Vertex(id, i - 1), q = scene.Vertex(id, i);
+                    AppendPoint(out, "l", q.x - p.x, q.y - p.y);
+                }
+                out += "z";
+                if (!onePath)
+                    out += "\"/>\n";
+                break;
+            }
+            }
+        }
+        if (onePath)
+            svg += "<path data-note='quoted > and \"' d=\"" + d + "\"/>\n";
+        svg += "</svg>\n";
+
+        FILE* f = std::fopen(path.string().c_str(), "wb");
+        std::fwrite(svg.data(), 1, svg.size(), f);
+        std::fclose(f);
+    }
+
+    // The scene the importer should build from WriteSvg's output: poligons
+    // become multilines, repeated vertices of a path collapse (the importer
+    // drops them), and with onePath the multilines come after the rest
+    void ExpectedImport(const SceneStore& source, bool onePath, SceneStore& expected)
+    {
+        std::vector<WorldPoint> run;
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (uint32_t id = 0; id < (uint32_t)source.ShapeCount(); ++id)
+            {
+                const ShapeKind kind = source.Kind(id);
+                const bool dense = kind == SHAPE_MULTILINE || kind == SHAPE_POLIGON;
+                if (onePath ? (pass == 0) == dense : pass == 1)
+                    continue;
+
+                run.clear();
+                for (uint32_t i = 0; i < source.Count(id); ++i)
+                {
+                    const WorldPoint p = source.Vertex(id, i);
+                    if (!dense || run.empty() || run.back().x != p.x || run.back().y != p.y)
+                        run.push_back(p);
+                }
+                if (run.size() >= 2)
+                    expected.Append(dense ? SHAPE_MULTILINE : kind, run.data(), (uint32_t)run.size());
+            }
+        }
+    }
+
+    bool SameScene(const SceneStore& a, const SceneStore& b)
+    {
+        if (a.ShapeCount() != b.ShapeCount() || a.VertexCount() != b.VertexCount())
+            return false;
+        for (uint32_t id = 0; id < (uint32_t)a.ShapeCount(); ++id)
+        {
+            if (a.Kind(id) != b.Kind(id) || a.Count(id) != b.Count(id))
+                return false;
+        }
+        for (size_t v = 0; v < a.VertexCount(); ++v)
+        {
+            if (a.Xs()[v] != b.Xs()[v] || a.Ys()[v] != b.Ys()[v])
+                return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+TEST(svg_import, every_element_kind)
+{
+    ThreadPool pool(2);
+    SceneStore scene;
+    SvgImportStats stats;
+    REQUIRE(ImportSvg(Fixture("shapes.svg"), scene, pool, &stats));
+
+    // comments, CDATA and text are skipped; quoted '>' does not end a tag
+    CHECK_EQ(stats.elements, 8);
+    CHECK_EQ(stats.shapes, scene.ShapeCount());
+    CHECK_EQ(stats.vertices, scene.VertexCount());
+    REQUIRE(scene.ShapeCount() == 17);
+
+    CHECK(ShapeIs(scene, 0, SHAPE_LINE, { { 10, 20 }, { 110, 120 } }));
+    CHECK(ShapeIs(scene, 1, SHAPE_RECT, { { 5, 6 }, { 55, 46 } }));
+    CHECK(ShapeIs(scene, 2, SHAPE_ELLIPSE, { { 170, 80 }, { 230, 120 } }));
+    CHECK(ShapeIs(scene, 3, SHAPE_ELLIPSE, { { 290, 40 }, { 310, 60 } }));
+    CHECK(ShapeIs(scene, 4, SHAPE_LINE, { { 0, 0 }, { 10, 0 } }));     // open polyline: one line per segment
+    CHECK(ShapeIs(scene, 5, SHAPE_LINE, { { 10, 0 }, { 10, 10 } }));
+    CHECK(ShapeIs(scene, 6, SHAPE_MULTILINE, { { 50, 50 }, { 60, 50 }, { 55, 58 }, { 50, 50 } }));
+    CHECK(ShapeIs(scene, 7, SHAPE_MULTILINE, { { 100, 100 }, { 120, 100 }, { 120, 120 }, { 100, 120 }, { 100, 100 } }));
+    CHECK(ShapeIs(scene, 8, SHAPE_LINE, { { 150, 100 }, { 160, 100 } }));    // relative moveto after z
+    CHECK(scene.Vertex(9, 0).x == 0 && scene.Vertex(9, 0).y == 0);           // flattened cubic
+    CHECK(scene.Vertex(16, 1).x == 10 && scene.Vertex(16, 1).y == 0);
+}
+
+TEST(svg_import, elements_across_read_chunks)
+{
+    SceneSpec spec;
+    spec.targetVertices = 300000;
+    spec.seed = 5;
+    SceneStore source;
+    GenerateScene(spec, source);
+
+    ThreadPool pool(4);
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "drawer_tests_import.svg";
+
+    // a comment longer than a read chunk, then elements straddling chunk ends;
+    // as one path the multilines are split into pieces parsed in parallel
+    for (bool onePath : { false, true })
+    {
+        WriteSvg(path, source, onePath, (1 << 20) + 12345);
+        SceneStore imported;
+        SvgImportStats stats;
+        REQUIRE(ImportSvg(path, imported, pool, &stats));
+        SceneStore expected;
+        ExpectedImport(source, onePath, expected);
+        CHECK(SameScene(imported, expected));
+        CHECK_EQ(stats.bytes, std::filesystem::file_size(path));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(svg_import, markup_split_at_every_offset_of_a_read_chunk)
+{
+    const size_t CHUNK = 1 << 20;       // the importer's read size
+    ThreadPool pool(2);
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "drawer_tests_split.svg";
+    const std::string fake = "<line x1=\"9\" y1=\"9\" x2=\"9\" y2=\"9\"/>";
+    const std::string real = "<line x1=\"1\" y1=\"2\" x2=\"3\" y2=\"4\" note='a > b'/>";
+
+    // the chunk end falls inside each opener, terminator and quoted '>'
+    const std::string pieces[] = {
+        "<!-- " + fake + " -->", "<![CDATA[ " + fake + " ]]>", real };
+    for (const std::string& piece : pieces)
+    {
+        for (size_t offset = 0; offset <= piece.size(); ++offset)
+        {
+            std::string svg = "<svg>";
+            svg.append(CHUNK - offset - svg.size(), ' ');
+            svg += piece + real + "</svg>";
+
+            FILE* f = std::fopen(path.string().c_str(), "wb");
+            REQUIRE(f);
+            std::fwrite(svg.data(), 1, svg.size(), f);
+            std::fclose(f);
+
+            SceneStore scene;
+            REQUIRE(ImportSvg(path, scene, pool));
+            const size_t expected = &piece == &pieces[2] ? 2 : 1;
+            CHECK_EQ(scene.ShapeCount(), expected);
+            CHECK(ShapeIs(scene, (uint32_t)expected - 1, SHAPE_LINE, { { 1, 2 }, { 3, 4 } }));
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(svg_import, failures_leave_the_scene_unchanged)
+{
+    ThreadPool pool(2);
+    SceneStore scene;
+    const WorldPoint line[] = { { 1, 1 }, { 2, 2 } };
+    scene.Append(SHAPE_LINE, line, 2);
+
+    // cut off inside a path: the complete line before it is not kept either
+    CHECK(!ImportSvg(Fixture("truncated.svg"), scene, pool));
+    CHECK_EQ(scene.ShapeCount(), 1);
+    CHECK_EQ(scene.VertexCount(), 2);
+
+    CHECK(!ImportSvg(Fixture("missing.svg"), scene, pool));
+
+    // a directory opens but every read fails
+    CHECK(!ImportSvg(std::filesystem::temp_directory_path(), scene, pool));
+    CHECK_EQ(scene.ShapeCount(), 1);
+}
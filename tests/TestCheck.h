@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// -------------------- Test harness --------------------
+// TEST(suite, name) { ... } registers a test with drawer_tests, which runs
+// every suite or only the ones named on its command line (one CTest test
+// per suite). CHECK records a failure and carries on, REQUIRE also leaves
+// the test. Failures are reported with the file, line and expression.
+
+typedef void (*TestFn)();
+
+int RegisterTest(const char* suite, const char* name, TestFn fn);
+void ReportFailure(const char* file, int line, const char* expr);
+void ReportFailure(const char* file, int line, const char* expr, long long actual, long long expected);
+
+#define TEST(suite, name) \
+    static void suite##_##name(); \
+    static const int suite##_##name##_registered = RegisterTest(#suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) ReportFailure(__FILE__, __LINE__, #cond); } while (0)
+
+#define REQUIRE(cond) \
+    do { if (!(cond)) { ReportFailure(__FILE__, __LINE__, #cond); return; } } while (0)
+
+// Integral comparison that prints both values on a mismatch
+#define CHECK_EQ(actual, expected) \
+    do { \
+        const long long check_a_ = (long long)(actual); \
+        const long long check_e_ = (long long)(expected); \
+        if (check_a_ != check_e_) \
+            ReportFailure(__FILE__, __LINE__, #actual " == " #expected, check_a_, check_e_); \
+    } while (0)
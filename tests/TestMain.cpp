@@ -0,0 +1,81 @@
+// -------------------- drawer_tests --------------------
+//   drawer_tests [SUITE...]
+// Runs the registered tests of the named suites (all of them without
+// arguments). Exits with 1 when a check failed or a named suite is unknown.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "TestCheck.h"
+
+namespace {
+
+    struct TestCase {
+        const char* suite;
+        const char* name;
+        TestFn fn;
+    };
+
+    // function local, so registration from other files' static
+    // initializers never sees it unconstructed
+    std::vector<TestCase>& Registry()
+    {
+        static std::vector<TestCase> tests;
+        return tests;
+    }
+
+    int g_failures = 0;
+
+} // namespace
+
+int RegisterTest(const char* suite, const char* name, TestFn fn)
+{
+    Registry().push_back(TestCase{ suite, name, fn });
+    return (int)Registry().size();
+}
+
+void ReportFailure(const char* file, int line, const char* expr)
+{
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    ++g_failures;
+}
+
+void ReportFailure(const char* file, int line, const char* expr, long long actual, long long expected)
+{
+    std::fprintf(stderr, "%s:%d: check failed: %s (got %lld, expected %lld)\n", file, line, expr, actual, expected);
+    ++g_failures;
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool known = false;
+        for (const TestCase& t : Registry())
+            known = known || std::strcmp(t.suite, argv[i]) == 0;
+        if (!known)
+        {
+            std::fprintf(stderr, "unknown suite %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    int run = 0;
+    for (const TestCase& t : Registry())
+    {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc && !selected; ++i)
+            selected = std::strcmp(t.suite, argv[i]) == 0;
+        if (!selected)
+            continue;
+
+        const int before = g_failures;
+        t.fn();
+        ++run;
+        std::printf("%-6s %s.%s\n", g_failures == before ? "ok" : "FAIL", t.suite, t.name);
+    }
+
+    std::printf("%d tests, %d failed checks\n", run, g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
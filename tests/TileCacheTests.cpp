@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "BoundsTree.h"
+#include "PixelBuffer.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+#include "TileCache.h"
+#include "TileRasterizer.h"
+
+namespace {
+
+    const PenStyle PEN{ 10, 20, 30, 2 };
+    const uint32_t BACKGROUND = 0x00F0F0F0;
+
+    struct TiledScene {
+        SceneStore scene;
+        BoundsTree tree;
+
+        explicit TiledScene(uint64_t seed)
+        {
+            SceneSpec spec;
+            spec.targetVertices = 30000;
+            spec.seed = seed;
+            spec.worldSize = 8000;
+            spec.maxShapeSize = 1500;
+            GenerateScene(spec, scene);
+            for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+                tree.Insert(id, scene.Bounds(id));
+        }
+    };
+
+    // The whole view rasterized in one go, the reference for composed tiles
+    void FullRender(const SceneStore& scene, const Camera& camera, int32_t width, int32_t height, PixelBuffer& out)
+    {
+        std::vector<uint32_t> ids(scene.ShapeCount());
+        for (uint32_t id = 0; id < (uint32_t)ids.size(); ++id)
+            ids[id] = id;
+
+        RasterOptions options;
+        options.width = (uint32_t)width;
+        options.height = (uint32_t)height;
+        options.camera = camera;
+        options.pen = PEN;
+        options.background = BACKGROUND;
+        RasterizeShapes(scene, ids.data(), ids.size(), options, out);
+    }
+
+    // What RenderSceneTiles does with GDI, for a camera on a level: every
+    // missing tile rendered, then each tile copied unscaled into its clip.
+    // Returns false when a tile is missing or would have to be scaled.
+    bool ComposeView(TileCache& cache, TiledScene& s, ThreadPool& pool, const Camera& camera, PixelBuffer& view)
+    {
+        const ScreenRect area{ 0, 0, view.Width(), view.Height() };
+        std::vector<TileDraw> draws;
+        std::vector<TileKey> missing;
+        cache.PlanView(camera, area, draws, missing);
+        cache.RenderTiles(s.scene, s.tree, pool, missing.data(), missing.size());
+        cache.PlanView(camera, area, draws, missing);
+        if (!missing.empty())
+            return false;
+
+        view.Fill(0xDEADBEEF);
+        for (const TileDraw& d : draws)
+        {
+            if (d.standIn || d.dst.right - d.dst.left != TileCache::TILE_SIZE || d.dst.bottom - d.dst.top != TileCache::TILE_SIZE)
+                return false;
+
+            const int32_t left = std::max(d.clip.left, 0), right = std::min(d.clip.right, view.Width());
+            for (int32_t y = std::max(d.clip.top, 0); y < std::min(d.clip.bottom, view.Height()); ++y)
+            {
+                if (left < right)
+                    std::memcpy(view.Row(y) + left, d.tile->Row(y - d.dst.top) + (left - d.dst.left), (size_t)(right - left) * sizeof(uint32_t));
+            }
+        }
+        return true;
+    }
+
+    bool SamePixels(const PixelBuffer& a, const PixelBuffer& b)
+    {
+        return a.Width() == b.Width() && a.Height() == b.Height() &&
+            std::memcmp(a.Data(), b.Data(), (size_t)a.Width() * a.Height() * sizeof(uint32_t)) == 0;
+    }
+
+} // namespace
+
+TEST(tile_cache, views_match_a_full_render)
+{
+    TiledScene s(71);
+    ThreadPool pool(4);
+    TileCache cache;
+    cache.SetStyle(PEN, BACKGROUND);
+
+    SceneRandom rng(72);
+    PixelBuffer composed(700, 500), reference;
+    size_t inked = 0;
+    for (int32_t level : { -12, -4, 0, 3 })
+    {
+        // pans off the tile grid, some with the view straddling the origin
+        for (int i = 0; i < 4; ++i)
+        {
+            Camera camera;
+            camera.zoom = TileCache::LevelZoom(level);
+            camera.panX = rng.Range(-4000, 300);
+            camera.panY = rng.Range(-4000, 300);
+
+            REQUIRE(ComposeView(cache, s, pool, camera, composed));
+            FullRender(s.scene, camera, composed.Width(), composed.Height(), reference);
+            CHECK(SamePixels(composed, reference));
+            inked += (size_t)std::count_if(reference.Data(), reference.Data() + (size_t)reference.Width() * reference.Height(),
+                [](uint32_t c) { return c != BACKGROUND; });
+        }
+    }
+    CHECK(inked > 100000);
+    CHECK(cache.Hits() > 0);
+}
+
+TEST(tile_cache, edits_redraw_only_the_tiles_they_reach)
+{
+    TiledScene s(73);
+    ThreadPool pool(4);
+    TileCache cache;
+    cache.SetStyle(PEN, BACKGROUND);
+
+    Camera camera;
+    camera.zoom = TileCache::LevelZoom(0);
+    camera.panX = -1200;
+    camera.panY = -900;
+    PixelBuffer composed(800, 600), reference;
+    REQUIRE(ComposeView(cache, s, pool, camera, composed));
+    const size_t tiles = cache.Size();
+
+    // a short line inside the view, as the app commits it
+    const WorldPoint line[2] = { { 1500, 1100 }, { 1700, 1180 } };
+    const uint32_t id = s.scene.Append(SHAPE_LINE, line, 2);
+    s.tree.Insert(id, s.scene.Bounds(id));
+
+    // stale tiles still show the old scene
+    REQUIRE(ComposeView(cache, s, pool, camera, composed));
+    FullRender(s.scene, camera, composed.Width(), composed.Height(), reference);
+    CHECK(!SamePixels(composed, reference));
+
+    const size_t dropped = cache.InvalidateWorldRect(s.scene.Bounds(id));
+    CHECK(dropped > 0);
+    CHECK(cache.Size() >= tiles - dropped);
+    CHECK(cache.Size() > 0);
+
+    const uint64_t rendered = cache.Rendered();
+    REQUIRE(ComposeView(cache, s, pool, camera, composed));
+    CHECK(SamePixels(composed, reference));
+    CHECK(cache.Rendered() - rendered <= dropped);
+}
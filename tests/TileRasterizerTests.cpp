@@ -0,0 +1,366 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "PixelBuffer.h"
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+#include "ThreadPool.h"
+#include "TileRasterizer.h"
+
+namespace {
+
+    // ---- minimal PNG reader for what PngWriter produces ----
+    // 8-bit RGB, filters None and Sub, zlib with stored or fixed Huffman
+    // blocks. Every chunk CRC and the Adler-32 are checked.
+
+    uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+    {
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc ^= data[i];
+            for (int k = 0; k < 8; ++k)
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+        return ~crc;
+    }
+
+    uint32_t BigEndian32(const uint8_t* p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    class BitReader
+    {
+    public:
+        BitReader(const std::vector<uint8_t>& data, size_t pos) : m_data(data), m_pos(pos) {}
+
+        bool Bit(uint32_t& out)
+        {
+            if (m_pos >= m_data.size())
+                return false;
+            out = (m_data[m_pos] >> m_bit) & 1;
+            if (++m_bit == 8)
+            {
+                m_bit = 0;
+                ++m_pos;
+            }
+            return true;
+        }
+
+        // count bits, least significant first (deflate's extra bits)
+        bool Bits(int count, uint32_t& out)
+        {
+            out = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                uint32_t b;
+                if (!Bit(b))
+                    return false;
+                out |= b << i;
+            }
+            return true;
+        }
+
+        // count bits, most significant first (Huffman codes)
+        bool Code(int count, uint32_t& code)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                uint32_t b;
+                if (!Bit(b))
+                    return false;
+                code = (code << 1) | b;
+            }
+            return true;
+        }
+
+        void AlignToByte()
+        {
+            if (m_bit)
+            {
+                m_bit = 0;
+                ++m_pos;
+            }
+        }
+
+        size_t Pos() const { return m_pos; }
+        void Skip(size_t bytes) { m_pos += bytes; }
+
+    private:
+        const std::vector<uint8_t>& m_data;
+        size_t m_pos;
+        int m_bit = 0;
+    };
+
+    // Fixed Huffman literal/length symbol
+    bool FixedSymbol(BitReader& in, uint32_t& symbol)
+    {
+        uint32_t code = 0;
+        if (!in.Code(7, code))
+            return false;
+        if (code <= 0x17)
+        {
+            symbol = 256 + code;
+            return true;
+        }
+        if (!in.Code(1, code))
+            return false;
+        if (code >= 0x30 && code <= 0xBF)
+        {
+            symbol = code - 0x30;
+            return true;
+        }
+        if (code >= 0xC0 && code <= 0xC7)
+        {
+            symbol = 280 + code - 0xC0;
+            return true;
+        }
+        if (!in.Code(1, code) || code < 0x190 || code > 0x1FF)
+            return false;
+        symbol = 144 + code - 0x190;
+        return true;
+    }
+
+    bool Inflate(const std::vector<uint8_t>& z, std::vector<uint8_t>& out)
+    {
+        static const uint16_t LEN_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t LEN_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t DIST_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const uint8_t DIST_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        if (z.size() < 6 || (z[0] & 0x0F) != 8 || ((z[0] << 8) | z[1]) % 31 != 0)
+            return false;
+
+        BitReader in(z, 2);
+        uint32_t final = 0;
+        while (!final)
+        {
+            uint32_t type;
+            if (!in.Bits(1, final) || !in.Bits(2, type))
+                return false;
+
+            if (type == 0)
+            {
+                in.AlignToByte();
+                const size_t p = in.Pos();
+                if (p + 4 > z.size())
+                    return false;
+                const uint32_t len = z[p] | (z[p + 1] << 8);
+                if ((len ^ (z[p + 2] | (z[p + 3] << 8))) != 0xFFFF || p + 4 + len > z.size())
+                    return false;
+                out.insert(out.end(), z.begin() + p + 4, z.begin() + p + 4 + len);
+                in.Skip(4 + len);
+                continue;
+            }
+            if (type != 1)
+                return false;       // PngWriter never writes dynamic blocks
+
+            while (true)
+            {
+                uint32_t symbol;
+                if (!FixedSymbol(in, symbol) || symbol > 285)
+                    return false;
+                if (symbol < 256)
+                {
+                    out.push_back((uint8_t)symbol);
+                    continue;
+                }
+                if (symbol == 256)
+                    break;
+
+                uint32_t extra, distCode = 0, distExtra;
+                if (!in.Bits(LEN_EXTRA[symbol - 257], extra))
+                    return false;
+                const uint32_t length = LEN_BASE[symbol - 257] + extra;
+                if (!in.Code(5, distCode) || distCode >= 30 || !in.Bits(DIST_EXTRA[distCode], distExtra))
+                    return false;
+                const uint32_t distance = DIST_BASE[distCode] + distExtra;
+                if (distance > out.size())
+                    return false;
+                for (uint32_t i = 0; i < length; ++i)
+                    out.push_back(out[out.size() - distance]);
+            }
+        }
+
+        // Adler-32 of the uncompressed data follows the last block
+        in.AlignToByte();
+        if (in.Pos() + 4 > z.size())
+            return false;
+        uint32_t a = 1, b = 0;
+        for (uint8_t v : out)
+        {
+            a = (a + v) % 65521;
+            b = (b + a) % 65521;
+        }
+        return BigEndian32(&z[in.Pos()]) == ((b << 16) | a);
+    }
+
+    bool ReadPng(const std::filesystem::path& path, PixelBuffer& image)
+    {
+        std::ifstream file(path, std::ios::binary);
+        const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        if (bytes.size() < 8 || std::memcmp(bytes.data(), SIGNATURE, 8) != 0)
+            return false;
+
+        uint32_t width = 0, height = 0;
+        std::vector<uint8_t> idat;
+        bool ended = false;
+        for (size_t pos = 8; pos < bytes.size() && !ended; )
+        {
+            if (pos + 12 > bytes.size())
+                return false;
+            const uint32_t length = BigEndian32(&bytes[pos]);
+            if (pos + 12 + length > bytes.size())
+                return false;
+            const uint8_t* type = &bytes[pos + 4];
+            const uint8_t* data = &bytes[pos + 8];
+            if (Crc32(type, 4 + (size_t)length) != BigEndian32(data + length))
+                return false;
+
+            if (std::memcmp(type, "IHDR", 4) == 0)
+            {
+                width = BigEndian32(data);
+                height = BigEndian32(data + 4);
+                if (length != 13 || data[8] != 8 || data[9] != 2 || data[12] != 0)
+                    return false;       // 8-bit RGB, not interlaced
+            }
+            else if (std::memcmp(type, "IDAT", 4) == 0)
+            {
+                idat.insert(idat.end(), data, data + length);
+            }
+            else if (std::memcmp(type, "IEND", 4) == 0)
+            {
+                ended = true;
+            }
+            pos += 12 + length;
+        }
+
+        std::vector<uint8_t> raw;
+        const size_t stride = (size_t)width * 3 + 1;
+        if (!ended || width == 0 || !Inflate(idat, raw) || raw.size() != stride * height)
+            return false;
+
+        image.Resize((int)width, (int)height);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            uint8_t* row = &raw[y * stride];
+            if (row[0] == 1)
+            {
+                for (size_t i = 4; i < stride; ++i)
+                    row[i] = (uint8_t)(row[i] + row[i - 3]);
+            }
+            else if (row[0] != 0)
+            {
+                return false;
+            }
+            for (uint32_t x = 0; x < width; ++x)
+                image.Set((int)x, (int)y, ((uint32_t)row[1 + x * 3] << 16) | ((uint32_t)row[2 + x * 3] << 8) | row[3 + x * 3]);
+        }
+        return true;
+    }
+
+    bool SamePixels(const PixelBuffer& a, const PixelBuffer& b)
+    {
+        return a.Width() == b.Width() && a.Height() == b.Height() &&
+            std::memcmp(a.Data(), b.Data(), (size_t)a.Width() * a.Height() * sizeof(uint32_t)) == 0;
+    }
+
+    // Untiled reference: every shape stroked into one image
+    void ReferenceRaster(const SceneStore& scene, const RasterOptions& options, PixelBuffer& out)
+    {
+        std::vector<uint32_t> ids(scene.ShapeCount());
+        for (uint32_t id = 0; id < (uint32_t)ids.size(); ++id)
+            ids[id] = id;
+        RasterizeShapes(scene, ids.data(), ids.size(), options, out);
+    }
+
+    SceneStore TestScene(uint64_t seed)
+    {
+        SceneSpec spec;
+        spec.targetVertices = 30000;
+        spec.seed = seed;
+        spec.worldSize = 20000;
+        spec.maxShapeSize = 3000;
+        SceneStore scene;
+        GenerateScene(spec, scene);
+        return scene;
+    }
+
+} // namespace
+
+TEST(tile_rasterizer, tiles_match_an_untiled_reference)
+{
+    const SceneStore scene = TestScene(31);
+    ThreadPool one(1), four(4);
+
+    for (uint8_t penWidth : { 1, 2, 5 })
+    {
+        RasterOptions options;
+        options.width = 900;
+        options.height = 700;
+        options.camera = FitCameraToScene(scene, options.width, options.height, 10);
+        options.pen = PenStyle{ 10, 20, 30, penWidth };
+
+        PixelBuffer reference;
+        ReferenceRaster(scene, options, reference);
+
+        // tile edges anywhere (partial tiles at the right and bottom), any thread count
+        for (uint32_t tileSize : { 16u, 100u, 256u, 4096u })
+        {
+            options.tileSize = tileSize;
+            PixelBuffer tiled;
+            RasterStats stats;
+            RasterizeScene(scene, options, tileSize == 100 ? one : four, tiled, &stats);
+            CHECK(SamePixels(tiled, reference));
+            CHECK_EQ(stats.tiles, ((900 + tileSize - 1) / tileSize) * ((700 + tileSize - 1) / tileSize));
+        }
+    }
+}
+
+TEST(tile_rasterizer, png_export_matches_the_raster)
+{
+    const SceneStore scene = TestScene(32);
+    ThreadPool pool(3);
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "drawer_tests_export.png";
+
+    // several bands, a last band cut short, and a zoom that puts shapes across the image edge
+    for (double zoomScale : { 1.0, 3.0 })
+    {
+        RasterOptions options;
+        options.width = 777;
+        options.height = 1000;
+        options.tileSize = 128;
+        options.camera = FitCameraToScene(scene, options.width, options.height, 0);
+        options.camera.zoom *= zoomScale;
+        options.background = 0x00F0E0D0;
+
+        RasterStats stats;
+        REQUIRE(ExportScenePng(path, scene, options, pool, &stats));
+
+        PixelBuffer decoded;
+        REQUIRE(ReadPng(path, decoded));
+        PixelBuffer reference;
+        ReferenceRaster(scene, options, reference);
+        CHECK(SamePixels(decoded, reference));
+    }
+
+    // a blank image is all runs
+    RasterOptions blank;
+    blank.width = 300;
+    blank.height = 200;
+    blank.camera.panX = -1000000;
+    REQUIRE(ExportScenePng(path, scene, blank, pool));
+    PixelBuffer decoded;
+    REQUIRE(ReadPng(path, decoded));
+    CHECK_EQ(decoded.Get(0, 0), blank.background);
+    CHECK_EQ(decoded.Get(299, 199), blank.background);
+    CHECK(std::filesystem::file_size(path) < 200 * 16);     // a few bytes per row
+
+    RasterOptions empty;
+    CHECK(!ExportScenePng(path, scene, empty, pool));
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,143 @@
+#include <cmath>
+#include <vector>
+
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+#include "TransformKernel.h"
+
+namespace {
+
+    const TransformPath PATHS[] = { TRANSFORM_SCALAR, TRANSFORM_SSE2, TRANSFORM_AVX2 };
+
+    // Every path this CPU runs against the scalar one, over every count up
+    // to maxCount (all SIMD tails) and from an unaligned start
+    void CheckPathsMatchScalar(const Camera& cam, const std::vector<int32_t>& xs, const std::vector<int32_t>& ys, size_t maxCount)
+    {
+        std::vector<ScreenPoint> expected(xs.size());
+        std::vector<ScreenPoint> got(xs.size() + 1);
+
+        for (TransformPath path : PATHS)
+        {
+            if (path > BestTransformPath())
+                continue;
+
+            for (size_t start = 0; start < 2; ++start)
+            {
+                for (size_t count = 0; count + start <= maxCount && count + start <= xs.size(); ++count)
+                {
+                    TransformToScreenWith(TRANSFORM_SCALAR, cam, xs.data() + start, ys.data() + start, count, expected.data());
+
+                    // a sentinel past the end catches stores beyond count
+                    got[count] = ScreenPoint{ 0x5A5A5A5A, 0x5A5A5A5A };
+                    TransformToScreenWith(path, cam, xs.data() + start, ys.data() + start, count, got.data());
+
+                    bool same = true;
+                    for (size_t i = 0; i < count; ++i)
+                        same = same && got[i].x == expected[i].x && got[i].y == expected[i].y;
+                    CHECK(same);
+                    CHECK(got[count].x == 0x5A5A5A5A && got[count].y == 0x5A5A5A5A);
+                }
+            }
+        }
+    }
+
+} // namespace
+
+TEST(transform_kernel, scalar_is_truncating_world_to_screen)
+{
+    const int32_t xs[] = { 0, 1, -1, 3, -3, 5, -5 };
+    const int32_t ys[] = { 7, -7, 2, -2, 9, -9, 0 };
+    Camera cam;
+    cam.zoom = 0.5;
+    cam.panX = 100;
+    cam.panY = -40;
+
+    ScreenPoint out[7];
+    TransformToScreenWith(TRANSFORM_SCALAR, cam, xs, ys, 7, out);
+    for (int i = 0; i < 7; ++i)
+    {
+        // ties truncate toward zero: 1.5 -> 1, -1.5 -> -1
+        CHECK_EQ(out[i].x, (int32_t)std::trunc(xs[i] * 0.5) + 100);
+        CHECK_EQ(out[i].y, (int32_t)std::trunc(ys[i] * 0.5) - 40);
+    }
+}
+
+TEST(transform_kernel, paths_match_scalar_on_ties_and_signs)
+{
+    // odd values at zoom 0.5 and 1.5 land exactly on .5 products, both signs
+    std::vector<int32_t> xs, ys;
+    for (int32_t v = -37; v <= 37; ++v)
+    {
+        xs.push_back(v);
+        ys.push_back(-v * 3 + 1);
+    }
+
+    for (double zoom : { 0.5, 1.5, 2.5, 1.0, 0.1, 10.0, 1.1 * 1.1 * 1.1 })
+    {
+        Camera cam;
+        cam.zoom = zoom;
+        cam.panX = -123;
+        cam.panY = 4567;
+        CheckPathsMatchScalar(cam, xs, ys, xs.size());
+    }
+}
+
+TEST(transform_kernel, paths_match_scalar_on_large_values)
+{
+    SceneRandom rng(71);
+    std::vector<int32_t> xs(67), ys(67);
+
+    for (int round = 0; round < 40; ++round)
+    {
+        // zoom steps of the app (1.1x between 0.1 and 10) and a few odd ones
+        Camera cam;
+        cam.zoom = round < 30 ? std::pow(1.1, rng.Range(-24, 24)) : rng.Range(1, 1000000) / 100000.0;
+        cam.panX = rng.Range(-100000, 100000);
+        cam.panY = rng.Range(-100000, 100000);
+
+        // products up to the int range (less the pan), beyond it the scalar
+        // conversion is undefined
+        const double limit = (2147483647.0 - 100000.0) / cam.zoom;
+        const int32_t maxValue = (int32_t)std::fmin(limit, 2147483647.0);
+        for (size_t i = 0; i < xs.size(); ++i)
+        {
+            xs[i] = i % 5 == 0 ? (i % 2 ? maxValue : -maxValue) : rng.Range(-maxValue, maxValue);
+            ys[i] = rng.Range(-maxValue, maxValue);
+        }
+        CheckPathsMatchScalar(cam, xs, ys, xs.size());
+    }
+}
+
+TEST(transform_kernel, dispatch_uses_a_supported_path)
+{
+    const TransformPath saved = ActiveTransformPath();
+
+    std::vector<int32_t> xs(1000), ys(1000);
+    SceneRandom rng(72);
+    for (size_t i = 0; i < xs.size(); ++i)
+    {
+        xs[i] = rng.Range(-1000000, 1000000);
+        ys[i] = rng.Range(-1000000, 1000000);
+    }
+    Camera cam;
+    cam.zoom = 1.1 * 1.1;
+    cam.panX = 960;
+    cam.panY = 540;
+
+    std::vector<ScreenPoint> expected(xs.size()), got(xs.size());
+    TransformToScreenWith(TRANSFORM_SCALAR, cam, xs.data(), ys.data(), xs.size(), expected.data());
+
+    for (TransformPath path : PATHS)
+    {
+        SetActiveTransformPath(path);
+        CHECK(ActiveTransformPath() <= BestTransformPath());
+        TransformToScreen(cam, xs.data(), ys.data(), xs.size(), got.data());
+
+        bool same = true;
+        for (size_t i = 0; i < xs.size(); ++i)
+            same = same && got[i].x == expected[i].x && got[i].y == expected[i].y;
+        CHECK(same);
+    }
+
+    SetActiveTransformPath(saved);
+}
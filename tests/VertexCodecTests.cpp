@@ -0,0 +1,227 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+#include "VertexCodec.h"
+
+namespace {
+
+    // Random walk: steps up to maxStep per vertex from a random start
+    void RandomWalk(SceneRandom& rng, uint32_t count, int32_t maxStep, std::vector<int32_t>& xs, std::vector<int32_t>& ys)
+    {
+        xs.resize(count);
+        ys.resize(count);
+        int32_t x = rng.Range(-1000000, 1000000), y = rng.Range(-1000000, 1000000);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            x += rng.Range(-maxStep, maxStep);
+            y += rng.Range(-maxStep, maxStep);
+            xs[i] = x;
+            ys[i] = y;
+        }
+    }
+
+    // Any int32, deltas wrapping past the int32 range
+    void RandomCoordinates(SceneRandom& rng, uint32_t count, std::vector<int32_t>& xs, std::vector<int32_t>& ys)
+    {
+        xs.resize(count);
+        ys.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            xs[i] = (int32_t)(uint32_t)rng.Next();
+            ys[i] = (int32_t)(uint32_t)(rng.Next() >> 32);
+        }
+    }
+
+    // Encoded after some unrelated bytes, decoded from where it starts
+    bool RoundTrips(const std::vector<int32_t>& xs, const std::vector<int32_t>& ys)
+    {
+        const uint32_t count = (uint32_t)xs.size();
+        std::vector<uint8_t> bytes(3, 0xAB);
+        EncodeVertices(xs.data(), ys.data(), count, bytes);
+        const size_t encoded = bytes.size() - 3;
+        if (encoded > MaxEncodedVertexBytes(count))
+            return false;
+
+        std::vector<int32_t> outXs(count + 1, 7), outYs(count + 1, 7);
+        return DecodeVertices(bytes.data() + 3, encoded, count, outXs.data(), outYs.data()) == encoded &&
+            std::memcmp(xs.data(), outXs.data(), count * sizeof(int32_t)) == 0 &&
+            std::memcmp(ys.data(), outYs.data(), count * sizeof(int32_t)) == 0 &&
+            outXs[count] == 7 && outYs[count] == 7;     // nothing written past count
+    }
+
+    bool SameScene(const SceneStore& a, const SceneStore& b)
+    {
+        if (a.ShapeCount() != b.ShapeCount() || a.VertexCount() != b.VertexCount())
+            return false;
+        for (uint32_t id = 0; id < (uint32_t)a.ShapeCount(); ++id)
+        {
+            if (a.Kind(id) != b.Kind(id) || a.Count(id) != b.Count(id))
+                return false;
+            for (uint32_t i = 0; i < a.Count(id); ++i)
+            {
+                const WorldPoint p = a.Vertex(id, i), q = b.Vertex(id, i);
+                if (p.x != q.x || p.y != q.y)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace
+
+TEST(vertex_codec, vertices_round_trip)
+{
+    SceneRandom rng(111);
+    std::vector<int32_t> xs, ys;
+    bool same = true;
+
+    // lengths around the switch from the unchecked to the bounds checked
+    // loop, small and large steps
+    for (uint32_t count = 0; count < 40; ++count)
+    {
+        for (int32_t step : { 0, 3, 60, 9000, 1 << 24 })
+        {
+            RandomWalk(rng, count, step, xs, ys);
+            same = same && RoundTrips(xs, ys);
+        }
+        RandomCoordinates(rng, count, xs, ys);
+        same = same && RoundTrips(xs, ys);
+    }
+    for (int i = 0; i < 200; ++i)
+    {
+        RandomWalk(rng, (uint32_t)rng.Range(40, 5000), rng.Range(0, 1 << rng.Range(0, 30)), xs, ys);
+        same = same && RoundTrips(xs, ys);
+        RandomCoordinates(rng, (uint32_t)rng.Range(40, 500), xs, ys);
+        same = same && RoundTrips(xs, ys);
+    }
+    CHECK(same);
+
+    // extreme coordinates and deltas wrap through the modulo 2^32 deltas
+    xs = { INT32_MIN, INT32_MAX, 0, -1, INT32_MAX, INT32_MIN, 1, INT32_MIN, INT32_MIN };
+    ys = { INT32_MAX, INT32_MIN, -1, 0, INT32_MIN, INT32_MAX, 64, INT32_MAX, 0 };
+    CHECK(RoundTrips(xs, ys));
+
+    // hand drawn strokes: a few units per vertex take a byte per coordinate
+    RandomWalk(rng, 10000, 60, xs, ys);
+    std::vector<uint8_t> bytes;
+    EncodeVertices(xs.data(), ys.data(), 10000, bytes);
+    CHECK(bytes.size() <= 2 * 10000 + 16);
+}
+
+TEST(vertex_codec, truncated_and_malformed_input_is_rejected)
+{
+    SceneRandom rng(112);
+    std::vector<int32_t> xs, ys, outXs, outYs;
+    bool rejected = true;
+    for (uint32_t count : { 1u, 2u, 5u, 17u, 300u })
+    {
+        for (int32_t step : { 3, 1 << 20 })
+        {
+            RandomWalk(rng, count, step, xs, ys);
+            std::vector<uint8_t> bytes;
+            EncodeVertices(xs.data(), ys.data(), count, bytes);
+            outXs.resize(count + 1);
+            outYs.resize(count + 1);
+
+            // every prefix: the data ends inside the y stream (or earlier)
+            for (size_t size = 0; size < bytes.size(); ++size)
+            {
+                std::vector<uint8_t> prefix(bytes.begin(), bytes.begin() + size);
+                rejected = rejected && DecodeVertices(prefix.data(), size, count, outXs.data(), outYs.data()) == 0;
+            }
+
+            // asking for more vertices than encoded, or fewer (the x
+            // stream length no longer matches)
+            rejected = rejected && DecodeVertices(bytes.data(), bytes.size(), count + 1, outXs.data(), outYs.data()) == 0;
+            rejected = rejected && DecodeVertices(bytes.data(), bytes.size(), count - 1, outXs.data(), outYs.data()) == 0;
+
+            // a wrong x stream length
+            std::vector<uint8_t> bad = bytes;
+            bad[0] ^= 1;
+            rejected = rejected && DecodeVertices(bad.data(), bad.size(), count, outXs.data(), outYs.data()) == 0;
+        }
+    }
+    CHECK(rejected);
+
+    // varints longer than 32 bits, in the x length and in the streams (long
+    // enough for the unchecked loop and short enough for the checked one)
+    const uint8_t longLength[] = { 0x80, 0x80, 0x80, 0x80, 0x10, 0, 0 };
+    int32_t x = 0, y = 0;
+    CHECK_EQ(DecodeVertices(longLength, sizeof(longLength), 1, &x, &y), 0);
+    const uint8_t sixBytes[] = { 6, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0 };
+    CHECK_EQ(DecodeVertices(sixBytes, sizeof(sixBytes), 1, &x, &y), 0);
+    std::vector<uint8_t> longStream(40, 0);
+    longStream[0] = 5;
+    longStream[1] = longStream[2] = longStream[3] = longStream[4] = 0xFF;
+    longStream[5] = 0x7F;
+    xs.assign(20, 0);
+    ys.assign(20, 0);
+    CHECK_EQ(DecodeVertices(longStream.data(), longStream.size(), 1, xs.data(), ys.data()), 0);
+
+    // random bytes never read past the buffer; whatever decodes stays inside it
+    bool bounded = true;
+    std::vector<uint8_t> noise;
+    for (int i = 0; i < 5000; ++i)
+    {
+        noise.resize((size_t)rng.Range(0, 64));
+        for (uint8_t& b : noise)
+            b = (uint8_t)rng.Range(0, 255);
+        if (!noise.empty() && rng.Range(0, 1))
+            noise[0] = (uint8_t)rng.Range(0, (int32_t)noise.size());
+        const uint32_t count = (uint32_t)rng.Range(0, 20);
+        const size_t read = DecodeVertices(noise.data(), noise.size(), count, xs.data(), ys.data());
+        bounded = bounded && read <= noise.size();
+    }
+    CHECK(bounded);
+}
+
+TEST(vertex_codec, packed_shapes_round_trip)
+{
+    SceneSpec spec;
+    spec.targetVertices = 50000;
+    spec.seed = 113;
+    SceneStore scene;
+    GenerateScene(spec, scene);
+    scene.Append(SHAPE_MULTILINE, nullptr, 0);      // an empty shape mid block
+    const WorldPoint far[2] = { { INT32_MIN, INT32_MAX }, { INT32_MAX, INT32_MIN } };
+    scene.Append(SHAPE_LINE, far, 2);
+
+    PackedShapes packed;
+    packed.Pack(scene);
+    CHECK_EQ(packed.ShapeCount(), scene.ShapeCount());
+    CHECK_EQ(packed.VertexCount(), scene.VertexCount());
+    CHECK(packed.EncodedBytes() < scene.VertexCount() * 2 * sizeof(int32_t));
+
+    SceneStore unpacked;
+    const WorldPoint stale[2] = { { 1, 2 }, { 3, 4 } };
+    unpacked.Append(SHAPE_RECT, stale, 2);          // replaced, not appended to
+    packed.Unpack(unpacked);
+    CHECK(SameScene(scene, unpacked));
+
+    // every shape on its own, first and last of a block included
+    std::vector<int32_t> xs, ys;
+    bool same = true;
+    for (uint32_t id = 0; id < (uint32_t)scene.ShapeCount(); ++id)
+    {
+        xs.assign(scene.Count(id), 0);
+        ys.assign(scene.Count(id), 0);
+        same = same && packed.Kind(id) == scene.Kind(id) && packed.Count(id) == scene.Count(id) &&
+            packed.DecodeShape(id, xs.data(), ys.data());
+        for (uint32_t i = 0; i < scene.Count(id); ++i)
+            same = same && xs[i] == scene.Vertex(id, i).x && ys[i] == scene.Vertex(id, i).y;
+    }
+    CHECK(same);
+    CHECK(!packed.DecodeShape((uint32_t)scene.ShapeCount(), xs.data(), ys.data()));
+
+    // an empty store
+    SceneStore empty;
+    packed.Pack(empty);
+    CHECK_EQ(packed.ShapeCount(), 0);
+    CHECK_EQ(packed.EncodedBytes(), 0);
+    packed.Unpack(unpacked);
+    CHECK_EQ(unpacked.ShapeCount(), 0);
+    CHECK_EQ(unpacked.VertexCount(), 0);
+}
@@ -0,0 +1,270 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "SceneGenerator.h"
+#include "TestCheck.h"
+#include "ViewportClip.h"
+
+namespace {
+
+    // Random geometry around a view sized clip rectangle is checked against
+    // properties any correct clip must have
+    const double CLIP_EPSILON = 1e-6;
+    const int ROUNDS = 20000;
+
+    ClipRect ViewClipRect()
+    {
+        return ExpandedClipRect(ScreenRect{ 0, 0, 1280, 800 });
+    }
+
+    // Up to reach rectangle sizes past every side, with fractional parts
+    ClipPoint RandomClipPoint(SceneRandom& rng, const ClipRect& r, int32_t reach = 1)
+    {
+        const double w = r.maxX - r.minX;
+        const double h = r.maxY - r.minY;
+        const int32_t span = (2 * reach + 1) << 16;
+        return ClipPoint{
+            r.minX - reach * w + (double)rng.Range(0, span) / (1 << 16) * w,
+            r.minY - reach * h + (double)rng.Range(0, span) / (1 << 16) * h };
+    }
+
+    bool InClipRect(const ClipRect& r, ClipPoint p, double eps)
+    {
+        return p.x >= r.minX - eps && p.x <= r.maxX + eps && p.y >= r.minY - eps && p.y <= r.maxY + eps;
+    }
+
+    // Even-odd rule
+    bool PointInPolygon(const ClipPoint* pts, size_t count, ClipPoint p)
+    {
+        bool in = false;
+        for (size_t i = 0, j = count - 1; i < count; j = i++)
+        {
+            if ((pts[i].y > p.y) != (pts[j].y > p.y) &&
+                p.x < pts[j].x + (p.y - pts[j].y) * (pts[i].x - pts[j].x) / (pts[i].y - pts[j].y))
+                in = !in;
+        }
+        return in;
+    }
+
+    double DistanceToSegment(ClipPoint p, ClipPoint a, ClipPoint b)
+    {
+        const double dx = b.x - a.x;
+        const double dy = b.y - a.y;
+        const double len2 = dx * dx + dy * dy;
+        double t = len2 > 0.0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0.0;
+        t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+        const double ex = a.x + t * dx - p.x;
+        const double ey = a.y + t * dy - p.y;
+        return std::sqrt(ex * ex + ey * ey);
+    }
+
+} // namespace
+
+TEST(viewport_clip, segments_keep_exactly_the_visible_part)
+{
+    // the kept part lies on the original, in the rectangle, and covers
+    // every sample of the original that is inside
+    const ClipRect r = ViewClipRect();
+    SceneRandom rng(101);
+    bool inside = true, onOriginal = true, covered = true;
+    int kept = 0;
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        const ClipPoint a = RandomClipPoint(rng, r);
+        ClipPoint b = RandomClipPoint(rng, r);
+        if (rng.Range(0, 7) == 0)
+            b.y = a.y;      // axis parallel now and then
+        ClipPoint ca = a, cb = b;
+        const bool visible = ClipSegment(r, ca, cb);
+        kept += visible ? 1 : 0;
+
+        if (visible)
+        {
+            inside = inside && InClipRect(r, ca, CLIP_EPSILON) && InClipRect(r, cb, CLIP_EPSILON);
+            onOriginal = onOriginal && DistanceToSegment(ca, a, b) <= CLIP_EPSILON && DistanceToSegment(cb, a, b) <= CLIP_EPSILON;
+        }
+        for (int i = 0; i <= 64; ++i)
+        {
+            const double t = i / 64.0;
+            const ClipPoint p{ a.x + t * (b.x - a.x), a.y + t * (b.y - a.y) };
+            if (InClipRect(r, p, -CLIP_EPSILON))
+                covered = covered && visible && DistanceToSegment(p, ca, cb) <= CLIP_EPSILON;
+        }
+    }
+    CHECK(inside);
+    CHECK(onOriginal);
+    CHECK(covered);
+    CHECK(kept > ROUNDS / 10 && kept < ROUNDS);
+}
+
+TEST(viewport_clip, polylines_keep_every_visible_piece)
+{
+    const ClipRect r = ViewClipRect();
+    SceneRandom rng(102);
+    std::vector<ClipPoint> in, out;
+    std::vector<uint32_t> runs;
+    bool longRuns = true, countsAddUp = true, inside = true, covered = true;
+    for (int round = 0; round < ROUNDS / 4; ++round)
+    {
+        in.resize((size_t)rng.Range(2, 24));
+        for (ClipPoint& p : in)
+            p = RandomClipPoint(rng, r);
+        out.clear();
+        runs.clear();
+        ClipPolyline(r, in.data(), in.size(), out, runs);
+
+        size_t total = 0;
+        for (uint32_t n : runs)
+        {
+            longRuns = longRuns && n >= 2;
+            total += n;
+        }
+        countsAddUp = countsAddUp && total == out.size();
+        for (const ClipPoint& p : out)
+            inside = inside && InClipRect(r, p, CLIP_EPSILON);
+
+        // every inside sample of every original segment lies on some run
+        for (size_t s = 0; s + 1 < in.size(); ++s)
+        {
+            for (int i = 0; i <= 8; ++i)
+            {
+                const double t = i / 8.0;
+                const ClipPoint p{ in[s].x + t * (in[s + 1].x - in[s].x), in[s].y + t * (in[s + 1].y - in[s].y) };
+                if (!InClipRect(r, p, -CLIP_EPSILON))
+                    continue;
+
+                bool onRun = false;
+                size_t first = 0;
+                for (uint32_t n : runs)
+                {
+                    for (size_t k = first; k + 1 < first + n && !onRun; ++k)
+                        onRun = DistanceToSegment(p, out[k], out[k + 1]) <= CLIP_EPSILON;
+                    first += n;
+                }
+                covered = covered && onRun;
+            }
+        }
+    }
+    CHECK(longRuns);
+    CHECK(countsAddUp);
+    CHECK(inside);
+    CHECK(covered);
+}
+
+TEST(viewport_clip, polygons_cover_the_same_points_inside)
+{
+    // self intersecting polygons included, and vertices far past the
+    // rectangle (high zoom) that the compaction pass folds away
+    const ClipRect r = ViewClipRect();
+    SceneRandom rng(103);
+    std::vector<ClipPoint> in, out, scratch;
+    bool inside = true, sameCoverage = true;
+    int empty = 0;
+    for (int round = 0; round < ROUNDS / 4; ++round)
+    {
+        const int32_t reach = round % 3 == 0 ? 1000 : 1;
+        in.resize((size_t)rng.Range(3, 24));
+        for (ClipPoint& p : in)
+            p = RandomClipPoint(rng, r, reach);
+        ClipPolygon(r, in.data(), in.size(), out, scratch);
+        empty += out.empty() ? 1 : 0;
+
+        for (const ClipPoint& p : out)
+            inside = inside && InClipRect(r, p, CLIP_EPSILON);
+        for (int i = 0; i < 64; ++i)
+        {
+            const ClipPoint p{
+                r.minX + 0.5 + (double)rng.Range(0, 1 << 16) / (1 << 16) * (r.maxX - r.minX - 1.0),
+                r.minY + 0.5 + (double)rng.Range(0, 1 << 16) / (1 << 16) * (r.maxY - r.minY - 1.0) };
+            const bool inOriginal = PointInPolygon(in.data(), in.size(), p);
+            const bool inClipped = !out.empty() && PointInPolygon(out.data(), out.size(), p);
+            sameCoverage = sameCoverage && inOriginal == inClipped;
+        }
+    }
+    CHECK(inside);
+    CHECK(sameCoverage);
+    CHECK(empty > 0 && empty < ROUNDS / 4);
+}
+
+TEST(viewport_clip, clip_cases)
+{
+    const ClipRect r{ 0, 0, 100, 50 };
+    std::vector<ClipPoint> out, scratch;
+
+    // inside: untouched
+    ClipPoint a{ 10, 10 }, b{ 90, 40 };
+    REQUIRE(ClipSegment(r, a, b));
+    CHECK(a.x == 10 && a.y == 10 && b.x == 90 && b.y == 40);
+
+    // across: trimmed to the edges; outside or only past a corner: dropped
+    a = ClipPoint{ -50, 25 };
+    b = ClipPoint{ 150, 25 };
+    REQUIRE(ClipSegment(r, a, b));
+    CHECK(a.x == 0 && b.x == 100 && a.y == 25 && b.y == 25);
+    a = ClipPoint{ -10, -10 };
+    b = ClipPoint{ -1, 60 };
+    CHECK(!ClipSegment(r, a, b));
+    a = ClipPoint{ 90, -20 };
+    b = ClipPoint{ 130, 20 };
+    CHECK(!ClipSegment(r, a, b));
+
+    // a polygon round the whole rectangle becomes the rectangle
+    const ClipPoint around[4] = { { -1e9, -1e9 }, { 1e9, -1e9 }, { 1e9, 1e9 }, { -1e9, 1e9 } };
+    REQUIRE(ClipPolygon(r, around, 4, out, scratch) == 4);
+    bool corners = true;
+    for (const ClipPoint& p : out)
+        corners = corners && (p.x == 0 || p.x == 100) && (p.y == 0 || p.y == 50);
+    CHECK(corners);
+
+    // one entirely off to the side is gone, one inside is kept as it is
+    const ClipPoint off[3] = { { 200, 0 }, { 300, 10 }, { 250, 40 } };
+    CHECK_EQ(ClipPolygon(r, off, 3, out, scratch), 0);
+    const ClipPoint tri[3] = { { 10, 10 }, { 60, 10 }, { 30, 40 } };
+    REQUIRE(ClipPolygon(r, tri, 3, out, scratch) == 3);
+    CHECK(out[0].x == 10 && out[1].x == 60 && out[2].y == 40);
+
+    // a polyline leaving and coming back is split into two runs
+    std::vector<uint32_t> runs;
+    out.clear();
+    const ClipPoint zigzag[3] = { { 10, 25 }, { 50, 200 }, { 90, 25 } };
+    ClipPolyline(r, zigzag, 3, out, runs);
+    CHECK(runs == std::vector<uint32_t>({ 2, 2 }));
+
+    // boxes: the screen box of a world box at 10x zoom
+    Camera cam;
+    cam.zoom = 10.0;
+    cam.panX = -500;
+    CHECK_EQ(ClassifyBox(r, cam, WorldRect{ 51, 1, 59, 4 }), CLIP_INSIDE);
+    CHECK_EQ(ClassifyBox(r, cam, WorldRect{ 45, 1, 55, 4 }), CLIP_PARTIAL);
+    CHECK_EQ(ClassifyBox(r, cam, WorldRect{ 0, 0, 40, 4 }), CLIP_OUTSIDE);
+    CHECK_EQ(ClassifyBox(r, cam, WorldRect{ -100000, -100000, 100000, 100000 }), CLIP_PARTIAL);
+}
+
+TEST(viewport_clip, ellipses_flatten_close_to_the_curve)
+{
+    std::vector<ClipPoint> out;
+    for (double radius : { 0.25, 3.0, 40.0, 900.0, 1e6 })
+    {
+        const ClipPoint a{ 100 - radius, 50 - radius / 2 }, b{ 100 + radius, 50 + radius / 2 };
+        FlattenEllipse(a, b, out);
+        REQUIRE(out.size() >= 4);
+
+        // vertices on the curve, chord midpoints at most about half a pixel
+        // inside it (capped segment counts aside)
+        bool onCurve = true, close = true;
+        for (size_t i = 0; i < out.size(); ++i)
+        {
+            const double ux = (out[i].x - 100) / radius, uy = (out[i].y - 50) / (radius / 2);
+            onCurve = onCurve && std::fabs(ux * ux + uy * uy - 1.0) < 1e-9;
+
+            const ClipPoint& n = out[(i + 1) % out.size()];
+            const double mx = (out[i].x + n.x) / 2 - 100, my = (out[i].y + n.y) / 2 - 50;
+            const double scale = std::sqrt(mx * mx / (radius * radius) + my * my * 4 / (radius * radius));
+            const double gap = std::hypot(mx, my) * (1.0 / scale - 1.0);
+            close = close && (gap <= 0.6 || radius >= 1e6);
+        }
+        CHECK(onCurve);
+        CHECK(close);
+    }
+}